@@ -0,0 +1,121 @@
+/*
+ * Benchmark of Block main loop - ppoll versus epoll reactor.
+ * Build and run with make bench.
+ */
+
+#include "block.h"
+#include "connection.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/**
+ * Connection which only counts received lines.
+ */
+class BenchConnection:public rts2core::Connection
+{
+	public:
+		BenchConnection (int _sock, rts2core::Block *_master):rts2core::Connection (_sock, _master) { lines = 0; }
+
+		virtual void processLine () { lines++; }
+
+		long lines;
+};
+
+/**
+ * Block with N socket pairs, one end of each registered as connection.
+ */
+class BenchBlock:public rts2core::Block
+{
+	public:
+		BenchBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+		virtual ~BenchBlock ()
+		{
+			for (std::vector <int>::iterator iter = peers.begin (); iter != peers.end (); iter++)
+				close (*iter);
+		}
+
+		int createPairs (int n)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				int sv[2];
+				if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+				{
+					perror ("socketpair");
+					return -1;
+				}
+				addConnection (new BenchConnection (sv[0], this));
+				peers.push_back (sv[1]);
+			}
+			// move connections from added queue to connections
+			idle ();
+			return 0;
+		}
+
+		/**
+		 * Run given number of loop iterations, writing single line to active peers before each iteration.
+		 *
+		 * @return average time per loop iteration in usec
+		 */
+		double runLoops (int loops, int active)
+		{
+			struct timeval t1, t2;
+			gettimeofday (&t1, NULL);
+			for (int l = 0; l < loops; l++)
+			{
+				for (int a = 0; a < active; a++)
+				{
+					if (write (peers[random () % peers.size ()], "l\n", 2) != 2)
+						perror ("write");
+				}
+				oneRunLoop ();
+			}
+			gettimeofday (&t2, NULL);
+			return ((t2.tv_sec - t1.tv_sec) * 1e6 + (t2.tv_usec - t1.tv_usec)) / loops;
+		}
+
+		virtual int run () { return 0; }
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+
+	private:
+		std::vector <int> peers;
+};
+
+int main (int argc, char **argv)
+{
+	int sizes[] = {16, 128, 1024, 4096};
+	int loops = 2000;
+
+	std::cout << std::setw (8) << "conns" << std::setw (8) << "active" << std::setw (14) << "ppoll [us]" << std::setw (14) << "epoll [us]" << std::endl;
+
+	for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+	{
+		double t[2];
+		for (int e = 0; e < 2; e++)
+		{
+			srandom (1);
+			BenchBlock b (argc, argv);
+			b.setTimeout (0);
+			if (e && b.setUseEpoll (true))
+			{
+				std::cerr << "epoll is not available" << std::endl;
+				return 1;
+			}
+			if (b.createPairs (sizes[i]))
+				return 1;
+			t[e] = b.runLoops (loops, 4);
+		}
+		std::cout << std::setw (8) << sizes[i] << std::setw (8) << 4 << std::fixed << std::setprecision (2) << std::setw (14) << t[0] << std::setw (14) << t[1] << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Benchmark of protocol line processing - Connection::processBuffer and
+ * paramNext* parsing of value updates.
+ * Build and run with make bench.
+ */
+
+#include "block.h"
+#include "connection.h"
+#include "value.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+class BenchBlock:public rts2core::Block
+{
+	public:
+		BenchBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+
+		virtual int run () { return 0; }
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+/**
+ * Produce traffic similar to what camera and mount daemons send - metainformation
+ * followed by value updates.
+ */
+static std::string metaTraffic ()
+{
+	std::ostringstream os;
+	os << PROTO_METAINFO " " << RTS2_VALUE_TIME << " infotime \"time of last update\"\n"
+		<< PROTO_METAINFO " " << (RTS2_VALUE_DOUBLE | RTS2_VALUE_FITS) << " CCD_TEMP \"CCD temperature\"\n"
+		<< PROTO_METAINFO " " << (RTS2_VALUE_DOUBLE | RTS2_VALUE_WRITABLE) << " exposure \"exposure time\"\n"
+		<< PROTO_METAINFO " " << RTS2_VALUE_INTEGER << " binning \"binning\"\n"
+		<< PROTO_METAINFO " " << RTS2_VALUE_LONGINT << " readout_pixels \"number of pixels\"\n"
+		<< PROTO_METAINFO " " << RTS2_VALUE_STRING << " filter \"filter name\"\n"
+		<< PROTO_METAINFO " " << (RTS2_VALUE_RADEC | RTS2_VALUE_FITS) << " TEL \"telescope position\"\n"
+		<< PROTO_METAINFO " " << RTS2_VALUE_ALTAZ << " TEL_ALTAZ \"horizontal position\"\n"
+		<< PROTO_METAINFO " " << (RTS2_VALUE_ARRAY | RTS2_VALUE_DOUBLE) << " AXES \"axis counts\"\n"
+		<< PROTO_METAINFO " " << (RTS2_VALUE_STAT | RTS2_VALUE_DOUBLE) << " average \"image average\"\n";
+	return os.str ();
+}
+
+static std::string valueTraffic (int seq)
+{
+	std::ostringstream os;
+	os << std::setprecision (15)
+		<< PROTO_VALUE " infotime " << 1700000000.123456 + seq << "\n"
+		<< PROTO_VALUE " CCD_TEMP " << -20.125 + seq * 1e-3 << "\n"
+		<< PROTO_VALUE " exposure " << 10.5 << "\n"
+		<< PROTO_VALUE " binning " << (seq % 4) << "\n"
+		<< PROTO_VALUE " readout_pixels " << 16777216 + seq << "\n"
+		<< PROTO_VALUE " filter \"R band\"\n"
+		<< PROTO_VALUE " TEL " << 123.456789 + seq * 1e-5 << " " << -12.345678 << "\n"
+		<< PROTO_VALUE " TEL_ALTAZ " << 45.123456 << " " << 270.654321 << "\n"
+		<< PROTO_VALUE " AXES " << 1234567 << " " << -7654321 << " " << 0.25 << " " << 1e-7 << "\n"
+		<< PROTO_VALUE " average " << 1234.5 << " " << 10 << " " << 1200.25 << " " << 900 << " " << 1500 << " " << 45.2 << "\n";
+	return os.str ();
+}
+
+int main (int argc, char **argv)
+{
+	BenchBlock b (argc, argv);
+	b.setTimeout (0);
+
+	int sv[2];
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+	{
+		perror ("socketpair");
+		return 1;
+	}
+
+	rts2core::Connection *conn = new rts2core::Connection (sv[0], &b);
+	b.addConnection (conn);
+	b.oneRunLoop ();
+
+	std::string meta = metaTraffic ();
+	if (write (sv[1], meta.c_str (), meta.length ()) != (ssize_t) meta.length ())
+		perror ("write");
+	b.oneRunLoop ();
+
+	// prepare traffic, sent in 4kB chunks
+	std::string traffic;
+	int lines = 0;
+	for (int i = 0; traffic.length () < 4 * 1024 * 1024; i++)
+	{
+		traffic += valueTraffic (i);
+		lines += 10;
+	}
+
+	struct timeval t1, t2;
+	gettimeofday (&t1, NULL);
+	for (size_t pos = 0; pos < traffic.length (); pos += 4096)
+	{
+		size_t len = traffic.length () - pos < 4096 ? traffic.length () - pos : 4096;
+		if (write (sv[1], traffic.c_str () + pos, len) != (ssize_t) len)
+			perror ("write");
+		// connection reads at most its buffer size in single loop
+		int pending;
+		do
+		{
+			b.oneRunLoop ();
+		}
+		while (ioctl (sv[0], FIONREAD, &pending) == 0 && pending > 0);
+	}
+	gettimeofday (&t2, NULL);
+
+	double dt = (t2.tv_sec - t1.tv_sec) + (t2.tv_usec - t1.tv_usec) / 1e6;
+
+	std::cout << "values " << conn->valueSize () << " CCD_TEMP " << conn->getValueDouble ("CCD_TEMP") << std::endl;
+	std::cout << std::fixed << std::setprecision (2)
+		<< "processed " << lines << " lines (" << traffic.length () / 1048576.0 << " MB) in " << dt * 1000 << " ms, "
+		<< lines / dt / 1e6 << " Mlines/s, " << traffic.length () / dt / 1048576.0 << " MB/s" << std::endl;
+
+	close (sv[1]);
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Benchmark of camera readout statistics - pixel by pixel loop with
+ * histogram rescan versus PixelStatistics.
+ * Build and run with make bench.
+ */
+
+#include "pixelstats.h"
+#include "imghdr.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define WIDTH    16384
+// rows send in one chunk
+#define ROWS     256
+#define CHUNKS   16
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Statistics as calculated in Camera before PixelStatistics was introduced.
+ */
+static double oldStatistics (uint16_t *data, size_t pixels, uint32_t *modeCount, double &mode)
+{
+	long double tSum = 0;
+	double tMin = 65536;
+	double tMax = -1;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		uint16_t tD = data[i];
+		tSum += tD;
+		if (tD < tMin)
+			tMin = tD;
+		if (tD > tMax)
+			tMax = tD;
+		modeCount[tD]++;
+	}
+	uint32_t modeNum = 0;
+	for (unsigned int i = 0; i < 65536; i++)
+	{
+		if (modeCount[i] > modeNum)
+		{
+			mode = i;
+			modeNum = modeCount[i];
+		}
+	}
+	return tSum;
+}
+
+int main (int argc, char **argv)
+{
+	size_t pixels = WIDTH * ROWS;
+	uint16_t *data = new uint16_t[pixels * CHUNKS];
+	srandom (1);
+	for (size_t i = 0; i < pixels * CHUNKS; i++)
+		data[i] = 1000 + random () % 50 + random () % 50;
+
+	uint32_t *modeCount = new uint32_t[65536];
+	memset (modeCount, 0, 65536 * sizeof (uint32_t));
+	double oldSum = 0, oldMode = 0;
+	double t1 = now ();
+	for (int c = 0; c < CHUNKS; c++)
+		oldSum += oldStatistics (data + c * pixels, pixels, modeCount, oldMode);
+	double t2 = now ();
+
+	rts2camd::PixelStatistics ps;
+	rts2camd::ChunkStatistics cs;
+	long double newSum = 0;
+	for (int c = 0; c < CHUNKS; c++)
+	{
+		ps.calculate ((char *) (data + c * pixels), pixels * sizeof (uint16_t), RTS2_DATA_USHORT, true, cs);
+		newSum += cs.sum;
+	}
+	double t3 = now ();
+
+	std::cout << "sum " << std::setprecision (15) << oldSum << " " << (double) newSum << " mode " << oldMode << " " << ps.getMode () << std::endl;
+	std::cout << std::fixed << std::setprecision (2)
+		<< CHUNKS << " chunks of " << WIDTH << "x" << ROWS << " pixels: old " << (t2 - t1) * 1000 << " ms, new "
+		<< (t3 - t2) * 1000 << " ms, " << pixels * CHUNKS / (t3 - t2) / 1e6 << " Mpix/s" << std::endl;
+
+	delete[] modeCount;
+	delete[] data;
+	return 0;
+}
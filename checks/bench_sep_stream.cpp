@@ -0,0 +1,198 @@
+/*
+ * Benchmark of SEP star detection latency - background and extraction run
+ * after the whole frame was read out, versus sep_stream fed with readout
+ * chunks. Frame is the dummy camera stellar field (gen_type 6 with default
+ * values), sent in readout_size chunks spread over the readout time.
+ * Build and run with make bench.
+ */
+
+#include "sep/sep.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define WIDTH         2048
+#define HEIGHT        2048
+// dummy camera defaults
+#define NOISE_BIAS    400
+#define NOISE_RANGE   300
+#define ASTAR_S       5.0
+#define ASTAR_AMP     200000
+#define MOFFAT_BETA   2.5
+#define READOUT_SIZE  100000
+// readout time of the whole frame
+#define READOUT_TIME  1.0
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double moffat (double r, double sigma2, double beta)
+{
+	return pow (1 + r * r / sigma2, -beta);
+}
+
+/**
+ * Stellar field as generated by dummy camera, stars are added only to
+ * pixels in their neighbourhood.
+ */
+static void generateField (uint16_t *data)
+{
+	srandom (0);
+	int nstars = WIDTH * HEIGHT / 300 / ASTAR_S / ASTAR_S;
+	double *sx = new double[nstars];
+	double *sy = new double[nstars];
+	for (int j = 0; j < nstars; j++)
+	{
+		sx[j] = (double) random () / RAND_MAX * WIDTH;
+		sy[j] = (double) random () / RAND_MAX * HEIGHT;
+	}
+
+	double s2 = ASTAR_S * ASTAR_S;
+	int rmax = ceil (ASTAR_S * 10);
+	double norm = 0;
+	for (int x = -rmax; x < rmax; x++)
+		for (int y = -rmax; y < rmax; y++)
+			norm += moffat (hypot (x, y), s2, MOFFAT_BETA);
+
+	double *fdata = new double[WIDTH * HEIGHT];
+	for (int i = 0; i < WIDTH * HEIGHT; i++)
+		fdata[i] = NOISE_BIAS + NOISE_RANGE * ((double) random () / RAND_MAX) - NOISE_RANGE / 2;
+
+	for (int j = 0; j < nstars; j++)
+	{
+		double flux = 3.0 * ASTAR_AMP / (1.0 + j) / norm;
+		for (int y = (int) sy[j] - rmax; y <= (int) sy[j] + rmax; y++)
+		{
+			if (y < 0 || y >= HEIGHT)
+				continue;
+			for (int x = (int) sx[j] - rmax; x <= (int) sx[j] + rmax; x++)
+			{
+				double r = hypot (x - sx[j], y - sy[j]);
+				if (x >= 0 && x < WIDTH && r < rmax)
+					fdata[y * WIDTH + x] += flux * moffat (r, s2, MOFFAT_BETA);
+			}
+		}
+	}
+
+	for (int i = 0; i < WIDTH * HEIGHT; i++)
+		data[i] = fdata[i] > 65535 ? 65535 : fdata[i];
+
+	delete[] fdata;
+	delete[] sx;
+	delete[] sy;
+}
+
+/**
+ * Send frame in chunks, calling sep_stream_add if stream is not NULL.
+ * Returns time when the last chunk arrived.
+ */
+static double readout (uint16_t *data, sep_stream *stream)
+{
+	size_t size = WIDTH * HEIGHT * sizeof (uint16_t);
+	useconds_t pause = READOUT_TIME * 1e6 * READOUT_SIZE / size;
+	double last = now ();
+	for (size_t off = 0; off < size; off += READOUT_SIZE)
+	{
+		usleep (pause);
+		last = now ();
+		if (stream && sep_stream_add (stream, (char *) data + off, size - off < READOUT_SIZE ? size - off : READOUT_SIZE))
+			return NAN;
+	}
+	return last;
+}
+
+int main (int argc, char **argv)
+{
+	float conv[] = {1,2,1, 2,4,2, 1,2,1};
+	uint16_t *data = new uint16_t[WIDTH * HEIGHT];
+	generateField (data);
+
+	long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+	int threads = ncpu > 0 ? ncpu : 1;
+	sep_set_threads (threads);
+
+	// full frame, as Camera::findSepStars without streaming and with sep_rms_map
+	double last = readout (data, NULL);
+	sep_image raw = {data, NULL, NULL, SEP_TUINT16, 0, 0, WIDTH, HEIGHT, 0.0, SEP_NOISE_NONE, 0.0, 0.0};
+	float *fdata = new float[WIDTH * HEIGHT];
+	float *rms = new float[WIDTH * HEIGHT];
+	sep_image im = {fdata, rms, NULL, SEP_TFLOAT, SEP_TFLOAT, 0, WIDTH, HEIGHT, 0.0, SEP_NOISE_STDDEV, 0.0, 0.0};
+	sep_bkg *bkg = NULL;
+	sep_catalog *batch = NULL;
+	int status = sep_background (&raw, 64, 64, 3, 3, 0.0, &bkg);
+	if (status == 0)
+	{
+		for (int i = 0; i < WIDTH * HEIGHT; i++)
+			fdata[i] = data[i];
+		status = sep_bkg_subarray (bkg, fdata, SEP_TFLOAT);
+	}
+	if (status == 0)
+		status = sep_bkg_rmsarray (bkg, rms, SEP_TFLOAT);
+	if (status == 0)
+		status = sep_extract_tiled (&im, 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 2 * threads, &batch);
+	double batchLatency = now () - last;
+	if (status)
+	{
+		std::cerr << "full frame extraction failed: " << status << std::endl;
+		return 1;
+	}
+
+	// streaming during readout
+	sep_stream *stream = NULL;
+	sep_catalog *streamed = NULL;
+	status = sep_stream_new (WIDTH, HEIGHT, SEP_TUINT16, 64, 64, 3, 3, 0.0, 1.5, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 1, &stream);
+	if (status == 0)
+	{
+		last = readout (data, stream);
+		status = isnan (last) ? -1 : sep_stream_finish (stream, &streamed);
+	}
+	double streamLatency = now () - last;
+	if (status)
+	{
+		std::cerr << "streaming extraction failed: " << status << std::endl;
+		return 1;
+	}
+
+	// stars found by both, background differs slightly before the last row
+	int matched = 0;
+	for (int i = 0; i < batch->nobj; i++)
+	{
+		for (int k = 0; k < streamed->nobj; k++)
+		{
+			if (fabs (streamed->x[k] - batch->x[i]) < 0.5 && fabs (streamed->y[k] - batch->y[i]) < 0.5)
+			{
+				matched++;
+				break;
+			}
+		}
+	}
+
+	std::cout << WIDTH << "x" << HEIGHT << " frame read out in " << READOUT_TIME << " s, " << READOUT_SIZE << " bytes chunks, " << threads << " threads:" << std::endl
+		<< std::fixed << std::setprecision (1)
+		<< "  full frame: " << batch->nobj << " stars " << batchLatency * 1000 << " ms after last chunk" << std::endl
+		<< "  streaming:  " << streamed->nobj << " stars " << streamLatency * 1000 << " ms after last chunk, "
+		<< matched << " matched" << std::endl;
+
+	int failed = matched < 0.9 * batch->nobj || abs (streamed->nobj - batch->nobj) > 0.05 * batch->nobj;
+
+	sep_catalog_free (batch);
+	sep_catalog_free (streamed);
+	sep_stream_free (stream);
+	sep_bkg_free (bkg);
+	delete[] fdata;
+	delete[] rms;
+	delete[] data;
+
+	return failed;
+}
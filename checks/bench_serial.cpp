@@ -0,0 +1,208 @@
+/*
+ * Benchmark of serial port exchange with slow device - blocking writeRead
+ * called from main loop versus queued transactions. Latency of commands
+ * from other connection, sent every millisecond, is measured while the
+ * main loop talks to the device.
+ * Build and run with make bench.
+ */
+
+#include "block.h"
+#include "connection/serial.h"
+#include "serialsim.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// device reply delay in seconds
+#define DELAY     0.02
+#define REQUESTS  50
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+class BenchTransaction:public rts2core::SerialTransaction
+{
+	public:
+		BenchTransaction (int *_done):rts2core::SerialTransaction (":GR#", 4, 20, "#") { done = _done; }
+
+		virtual void finished (rts2core::transStatusT status, const char *rbuf, int rlen)
+		{
+			if (status == rts2core::TRANS_OK && strcmp (rbuf, "12:34:56") == 0)
+				(*done)++;
+		}
+
+	private:
+		int *done;
+};
+
+/**
+ * Connection receiving lines with time when they were sent.
+ */
+class PingConnection:public rts2core::Connection
+{
+	public:
+		PingConnection (int _sock, rts2core::Block *_master):rts2core::Connection (_sock, _master) { reset (); }
+
+		virtual void processLine ()
+		{
+			double l = now () - atof (getCommand ());
+			latency += l;
+			if (l > maxLatency)
+				maxLatency = l;
+			lines++;
+		}
+
+		void reset ()
+		{
+			latency = maxLatency = 0;
+			lines = 0;
+		}
+
+		double latency;
+		double maxLatency;
+		long lines;
+};
+
+static volatile bool pinging = true;
+
+/**
+ * Send current time to the socket every millisecond.
+ */
+static void *pinger (void *arg)
+{
+	int sock = *((int *) arg);
+	while (pinging)
+	{
+		char buf[50];
+		int len = snprintf (buf, sizeof (buf), "%.6f\n", now ());
+		if (write (sock, buf, len) != len)
+			break;
+		usleep (1000);
+	}
+	return NULL;
+}
+
+class BenchBlock:public rts2core::Block
+{
+	public:
+		BenchBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+
+		/**
+		 * Exchange with device from main loop, blocking it.
+		 *
+		 * @return number of sucessfull exchanges
+		 */
+		int runSync (rts2core::ConnSerial *conn)
+		{
+			int done = 0;
+			for (int i = 0; i < REQUESTS; i++)
+			{
+				oneRunLoop ();
+				char buf[20];
+				if (conn->writeRead (":GR#", 4, buf, 20, "#") > 0 && strncmp (buf, "12:34:56", 8) == 0)
+					done++;
+			}
+			return done;
+		}
+
+		/**
+		 * Queue all exchanges, run main loop until they are done.
+		 */
+		int runAsync (rts2core::ConnSerial *conn)
+		{
+			int done = 0;
+			for (int i = 0; i < REQUESTS; i++)
+				conn->queueTransaction (new BenchTransaction (&done));
+			double end = now () + REQUESTS * DELAY * 10;
+			while (conn->transactionsQueued () > 0 && now () < end)
+				oneRunLoop ();
+			return done;
+		}
+
+		virtual int run () { return 0; }
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+int main (int argc, char **argv)
+{
+	BenchBlock b (argc, argv);
+	b.setTimeout (1000);
+
+	int sv[2];
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+	{
+		perror ("socketpair");
+		return 1;
+	}
+	PingConnection *ping = new PingConnection (sv[0], &b);
+	b.addConnection (ping);
+	pthread_t pingThread;
+	if (pthread_create (&pingThread, NULL, pinger, &sv[1]))
+		return 1;
+
+	std::cout << REQUESTS << " requests, device replies after " << DELAY * 1000 << " ms" << std::endl
+		<< std::setw (8) << "mode" << std::setw (10) << "replies" << std::setw (12) << "total [s]" << std::setw (22) << "command latency [ms]" << std::setw (20) << "max latency [ms]" << std::endl;
+
+	int ret = 0;
+	for (int a = 0; a < 2 && ret == 0; a++)
+	{
+		SerialSim sim;
+		sim.addReply (":GR#", "12:34:56#", DELAY);
+		if (sim.start ())
+		{
+			std::cerr << "cannot open pseudo terminal" << std::endl;
+			ret = 1;
+			break;
+		}
+		rts2core::ConnSerial *conn = new rts2core::ConnSerial (sim.getPort (), &b, rts2core::BS9600, rts2core::C8, rts2core::NONE, 10);
+		if (conn->init ())
+		{
+			delete conn;
+			ret = 1;
+			break;
+		}
+
+		// let ping connection settle
+		for (int i = 0; i < 10; i++)
+			b.oneRunLoop ();
+		ping->reset ();
+
+		double t = now ();
+		int done;
+		if (a)
+		{
+			b.addConnection (conn);
+			done = b.runAsync (conn);
+			b.removeConnection (conn);
+		}
+		else
+		{
+			done = b.runSync (conn);
+		}
+		t = now () - t;
+		delete conn;
+
+		std::cout << std::setw (8) << (a ? "async" : "sync") << std::setw (10) << done << std::fixed << std::setprecision (3) << std::setw (12) << t << std::setprecision (2) << std::setw (22) << ping->latency / ping->lines * 1000 << std::setw (20) << ping->maxLatency * 1000 << std::endl;
+		if (done != REQUESTS)
+			ret = 1;
+	}
+
+	pinging = false;
+	pthread_join (pingThread, NULL);
+	close (sv[1]);
+	return ret;
+}
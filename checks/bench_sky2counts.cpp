@@ -0,0 +1,66 @@
+/*
+ * Benchmark of GEM sky2counts calls in tracking loop. Compares tracking
+ * with steps of 0.1 second, which reuse astrometry context, with steps
+ * long enough to rebuild the context on every call.
+ * Build and run with make bench.
+ */
+
+#include "gemtest.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <sys/time.h>
+
+#define CALLS    20000
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// returns microseconds per call
+static double track (GemTest *gemTest, double JD, double step)
+{
+	struct ln_equ_posn pos;
+	pos.ra = 20;
+	pos.dec = 80;
+
+	int32_t ac = -70000000;
+	int32_t dc = -68000000;
+
+	double t1 = now ();
+	for (int i = 0; i < CALLS; i++)
+	{
+		if (gemTest->test_sky2counts (JD + i * step / 86400.0, 0, &pos, ac, dc))
+		{
+			std::cerr << "sky2counts failed" << std::endl;
+			return -1;
+		}
+	}
+	return (now () - t1) * 1e6 / CALLS;
+}
+
+int main (int argc, char **argv)
+{
+	static const char *targv[] = {"bench"};
+	GemTest *gemTest = new GemTest (0, (char **) targv);
+
+	// same telescope as in check_gem_hko
+	gemTest->setTelescope (20.70752, -156.257, 3039, 67108864, 67108864, 0, 75.81458333, -5.8187805555, 186413.511111, 186413.511111, -81949557, -47392062, -76983817, -21692458);
+
+	// 2016-01-13T05:20:47 UTC
+	double JD = 2457400.722766;
+
+	double tracking = track (gemTest, JD, 0.1);
+	double rebuild = track (gemTest, JD + 1, 61);
+
+	std::cout << std::fixed << std::setprecision (2)
+		<< CALLS << " sky2counts calls: tracking " << tracking << " us/call, with full astrometry update "
+		<< rebuild << " us/call" << std::endl;
+
+	delete gemTest;
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Benchmark of target set loading - bulk TargetSet::load and
+ * TargetSet::loadScripts, which read targets and their scripts in
+ * set-based queries, versus loading of the same targets one by one.
+ * Needs database; when it is not available, benchmark is skipped.
+ * Build and run with make bench.
+ */
+
+#include "rts2db/appdb.h"
+#include "rts2db/target.h"
+#include "rts2db/targetset.h"
+#include "configuration.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define ROUNDS    3
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+class BenchTargetSet:public rts2db::AppDb
+{
+	public:
+		BenchTargetSet (int argc, char **argv);
+
+	protected:
+		virtual int processOption (int in_opt);
+		virtual int init ();
+		virtual int doProcessing ();
+
+	private:
+		const char *camera;
+		bool skip;
+
+		/**
+		 * Retrieve script of all targets in set.
+		 *
+		 * @return number of targets with script
+		 */
+		int getScripts (rts2db::TargetSet &set);
+
+		/**
+		 * Compare targets loaded by bulk and by single target loads.
+		 *
+		 * @return number of differences
+		 */
+		int compare (rts2db::TargetSet &bulk, rts2db::TargetSet &single);
+};
+
+BenchTargetSet::BenchTargetSet (int argc, char **argv):rts2db::AppDb (argc, argv)
+{
+	camera = "C0";
+	skip = false;
+
+	addOption ('c', "camera", 1, "camera for which scripts are retrieved (default to C0)");
+}
+
+int BenchTargetSet::processOption (int in_opt)
+{
+	switch (in_opt)
+	{
+		case 'c':
+			camera = optarg;
+			break;
+		default:
+			return rts2db::AppDb::processOption (in_opt);
+	}
+	return 0;
+}
+
+int BenchTargetSet::init ()
+{
+	if (rts2db::AppDb::init ())
+	{
+		std::cout << "database not available, skipping target set benchmark" << std::endl;
+		skip = true;
+		return 0;
+	}
+	rts2core::Configuration::instance ();
+	return 0;
+}
+
+int BenchTargetSet::getScripts (rts2db::TargetSet &set)
+{
+	int ret = 0;
+	for (rts2db::TargetSet::iterator iter = set.begin (); iter != set.end (); iter++)
+	{
+		std::string buf;
+		try
+		{
+			iter->second->getScript (camera, buf);
+			ret++;
+		}
+		catch (rts2core::Error &er)
+		{
+		}
+	}
+	return ret;
+}
+
+int BenchTargetSet::compare (rts2db::TargetSet &bulk, rts2db::TargetSet &single)
+{
+	int diff = 0;
+	double JD = ln_get_julian_from_sys ();
+	if (bulk.size () != single.size ())
+	{
+		std::cerr << "bulk load returned " << bulk.size () << " targets, single loads " << single.size () << std::endl;
+		diff++;
+	}
+	for (rts2db::TargetSet::iterator iter = bulk.begin (); iter != bulk.end (); iter++)
+	{
+		rts2db::TargetSet::iterator si = single.find (iter->first);
+		if (si == single.end ())
+		{
+			std::cerr << "target " << iter->first << " not loaded by single load" << std::endl;
+			diff++;
+			continue;
+		}
+		rts2db::Target *b = iter->second;
+		rts2db::Target *s = si->second;
+		struct ln_equ_posn bp, sp;
+		b->getPosition (&bp, JD);
+		s->getPosition (&sp, JD);
+		// model target position is random
+		if (b->getTargetType () == TYPE_MODEL)
+			bp = sp;
+		// calibration target without calibration images has no name
+		const char *bn = b->getTargetName ();
+		const char *sn = s->getTargetName ();
+		if ((bn == NULL) != (sn == NULL) || (bn && strcmp (bn, sn)) || b->getTargetType () != s->getTargetType ()
+			|| b->getTargetEnabled () != s->getTargetEnabled () || b->getTargetPriority () != s->getTargetPriority ()
+			|| !((isnan (bp.ra) && isnan (sp.ra)) || fabs (bp.ra - sp.ra) < 1e-9)
+			|| !((isnan (bp.dec) && isnan (sp.dec)) || fabs (bp.dec - sp.dec) < 1e-9))
+		{
+			std::cerr << "target " << iter->first << " differs" << std::endl;
+			diff++;
+		}
+	}
+	return diff;
+}
+
+int BenchTargetSet::doProcessing ()
+{
+	if (skip)
+		return 0;
+
+	double bulkLoad = INFINITY, bulkScripts = INFINITY, singleLoad = INFINITY, singleScripts = INFINITY;
+	int bulkScriptsFound = 0, singleScriptsFound = 0;
+	size_t targets = 0;
+	int ret = 0;
+
+	for (int r = 0; r < ROUNDS && ret == 0; r++)
+	{
+		rts2db::TargetSet bulk;
+		double t = now ();
+		bulk.load ();
+		bulkLoad = std::min (bulkLoad, now () - t);
+
+		t = now ();
+		bulk.loadScripts ();
+		bulkScriptsFound = getScripts (bulk);
+		bulkScripts = std::min (bulkScripts, now () - t);
+		bulk.clearScripts ();
+
+		std::list <int> ids;
+		for (rts2db::TargetSet::iterator iter = bulk.begin (); iter != bulk.end (); iter++)
+			ids.push_back (iter->first);
+		targets = ids.size ();
+
+		rts2db::TargetSet single;
+		t = now ();
+		single.load (ids);
+		singleLoad = std::min (singleLoad, now () - t);
+
+		t = now ();
+		singleScriptsFound = getScripts (single);
+		singleScripts = std::min (singleScripts, now () - t);
+
+		if (compare (bulk, single) || bulkScriptsFound != singleScriptsFound)
+			ret = 1;
+	}
+
+	std::cout << targets << " targets, " << bulkScriptsFound << " scripts for camera " << camera << ", best of " << ROUNDS << " rounds" << std::endl
+		<< std::setw (8) << "mode" << std::setw (12) << "load [s]" << std::setw (14) << "scripts [s]" << std::setw (20) << "per target [ms]" << std::endl
+		<< std::fixed << std::setprecision (3)
+		<< std::setw (8) << "single" << std::setw (12) << singleLoad << std::setw (14) << singleScripts << std::setw (20) << (targets ? (singleLoad + singleScripts) / targets * 1000 : 0) << std::endl
+		<< std::setw (8) << "bulk" << std::setw (12) << bulkLoad << std::setw (14) << bulkScripts << std::setw (20) << (targets ? (bulkLoad + bulkScripts) / targets * 1000 : 0) << std::endl;
+
+	if (ret)
+		std::cerr << "targets loaded by bulk and single loads differ" << std::endl;
+	return ret;
+}
+
+int main (int argc, char **argv)
+{
+	BenchTargetSet app (argc, argv);
+	return app.run ();
+}
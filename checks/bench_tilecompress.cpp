@@ -0,0 +1,128 @@
+/*
+ * Benchmark of tile compression - speed and compression ratio of Rice
+ * compression of test images with single and multiple threads.
+ * Build and run with make bench.
+ */
+
+#include "tilecompress.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// repeat compression to get measurable times
+#define REPEAT   20
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Reads primary image of simple FITS file with integer data. Returns
+ * stored values converted to host byte order, without BZERO applied.
+ */
+static int readImage (const char *fname, std::vector <char> &data, int &bytepix, long &width, long &height)
+{
+	FILE *f = fopen (fname, "r");
+	if (f == NULL)
+	{
+		std::cerr << "cannot open " << fname << std::endl;
+		return -1;
+	}
+	char card[81];
+	card[80] = '\0';
+	int bitpix = 0;
+	int cards = 0;
+	width = height = 0;
+	while (fread (card, 1, 80, f) == 80)
+	{
+		cards++;
+		if (strncmp (card, "BITPIX  =", 9) == 0)
+			bitpix = atoi (card + 10);
+		else if (strncmp (card, "NAXIS1  =", 9) == 0)
+			width = atol (card + 10);
+		else if (strncmp (card, "NAXIS2  =", 9) == 0)
+			height = atol (card + 10);
+		else if (strncmp (card, "END     ", 8) == 0)
+			break;
+	}
+	if (bitpix != 8 && bitpix != 16 && bitpix != 32)
+	{
+		std::cerr << fname << ": unsupported BITPIX " << bitpix << std::endl;
+		fclose (f);
+		return -1;
+	}
+	// data starts at next 2880 bytes block
+	fseek (f, ((cards * 80 + 2879) / 2880) * 2880, SEEK_SET);
+
+	bytepix = bitpix / 8;
+	data.resize (width * height * bytepix);
+	if (fread (&(data[0]), bytepix, width * height, f) != (size_t) (width * height))
+	{
+		std::cerr << fname << ": cannot read data" << std::endl;
+		fclose (f);
+		return -1;
+	}
+	fclose (f);
+
+	// FITS is big endian
+	for (size_t i = 0; i < data.size (); i += bytepix)
+	{
+		for (int j = 0; j < bytepix / 2; j++)
+		{
+			char c = data[i + j];
+			data[i + j] = data[i + bytepix - 1 - j];
+			data[i + bytepix - 1 - j] = c;
+		}
+	}
+	return 0;
+}
+
+static void bench (const char *fname)
+{
+	std::vector <char> data;
+	int bytepix;
+	long width, height;
+	if (readImage (fname, data, bytepix, width, height))
+		return;
+
+	rts2core::TileCompressor single (1);
+	rts2core::TileCompressor multi;
+
+	double t1 = now ();
+	for (int i = 0; i < REPEAT; i++)
+		single.compress (&(data[0]), bytepix, width, height);
+	double t2 = now ();
+	for (int i = 0; i < REPEAT; i++)
+		multi.compress (&(data[0]), bytepix, width, height);
+	double t3 = now ();
+
+	double mb = data.size () * (double) REPEAT / 1048576.0;
+	std::cout << std::fixed << std::setprecision (2)
+		<< fname << " " << width << "x" << height << "x" << bytepix * 8 << " bit, ratio "
+		<< data.size () / (double) multi.getCompressedSize () << ": 1 thread "
+		<< mb / (t2 - t1) << " MB/s, " << multi.getThreads () << " threads " << mb / (t3 - t2) << " MB/s" << std::endl;
+}
+
+int main (int argc, char **argv)
+{
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+			bench (argv[i]);
+	}
+	else
+	{
+		bench ("data/fram.fits");
+		bench ("data/image.fits");
+	}
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * Benchmark of GEM checkTrajectory. Compares block evaluation of the
+ * trajectory with the original loop, which converted and checked the
+ * steps one by one. Build and run with make bench.
+ */
+
+#include "gemtest.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define TRAJECTORIES    500
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+class GemBench:public GemTest
+{
+	public:
+		GemBench (int argc, char **argv):GemTest (argc, argv) {}
+
+		int stepLoop (double JD, int32_t ac, int32_t dc, int32_t &at, int32_t &dt, int32_t as, int32_t ds, unsigned int steps, double alt_margin, double az_margin, bool ignore_soft_beginning);
+};
+
+// previous checkTrajectory implementation, without logging and flip checks
+int GemBench::stepLoop (double JD, int32_t ac, int32_t dc, int32_t &at, int32_t &dt, int32_t as, int32_t ds, unsigned int steps, double alt_margin, double az_margin, bool ignore_soft_beginning)
+{
+	int32_t t_a = ac;
+	int32_t t_d = dc;
+
+	int32_t step_a = (ac > at) ? -as : as;
+	int32_t step_d = (dc > dt) ? -ds : ds;
+
+	int32_t soft_a = ac;
+	int32_t soft_d = dc;
+
+	bool hard_beginning = false;
+	bool soft_hit = false;
+
+	for (unsigned int c = 0; c < steps; c++)
+	{
+		struct ln_equ_posn pos, un_pos;
+		struct ln_hrz_posn hrz;
+		int flip = 0;
+
+		int32_t n_a;
+		int32_t n_d;
+
+		if (labs (t_a - at) < as)
+		{
+			n_a = at;
+			step_a = 0;
+		}
+		else
+		{
+			n_a = t_a + step_a;
+		}
+
+		if (labs (t_d - dt) < ds)
+		{
+			n_d = dt;
+			step_d = 0;
+		}
+		else
+		{
+			n_d = t_d + step_d;
+		}
+
+		counts2sky (n_a, n_d, pos.ra, pos.dec, flip, un_pos.ra, un_pos.dec, JD);
+
+		struct ln_lnlat_posn latpos;
+		latpos.lat = telLatitude->getValueDouble ();
+		latpos.lng = telLongitude->getValueDouble ();
+
+		ln_get_hrz_from_equ (&pos, &latpos, JD, &hrz);
+
+		if (soft_hit == true || ignore_soft_beginning == true)
+		{
+			if (hardHorizon->is_good (&hrz) == 0)
+			{
+				if (c == 0)
+				{
+					hard_beginning = true;
+				}
+				else if (hard_beginning == false || c > 20)
+				{
+					if (soft_hit == true)
+					{
+						at = soft_a;
+						dt = soft_d;
+						return 2;
+					}
+					at = t_a;
+					dt = t_d;
+					return 3;
+				}
+			}
+			else
+			{
+				hard_beginning = false;
+			}
+		}
+
+		if (step_a == 0 && step_d == 0)
+			return 0;
+
+		if (soft_hit == false && hard_beginning == false)
+		{
+			if (hardHorizon->is_good_with_margin (&hrz, alt_margin, az_margin) == 0)
+			{
+				if (ignore_soft_beginning == false)
+				{
+					soft_hit = true;
+					soft_a = t_a;
+					soft_d = t_d;
+				}
+			}
+			else if (ignore_soft_beginning == true)
+			{
+				ignore_soft_beginning = false;
+				soft_a = t_a;
+				soft_d = t_d;
+			}
+		}
+
+		t_a = n_a;
+		t_d = n_d;
+	}
+
+	if (soft_hit == true)
+	{
+		at = soft_a;
+		dt = soft_d;
+	}
+	else
+	{
+		at = t_a;
+		dt = t_d;
+	}
+	return 1;
+}
+
+int main (int argc, char **argv)
+{
+	static const char *targv[] = {"bench"};
+	GemBench *gemBench = new GemBench (0, (char **) targv);
+
+	// same telescope as in check_gem_hko
+	gemBench->setTelescope (20.70752, -156.257, 3039, 67108864, 67108864, 0, 75.81458333, -5.8187805555, 186413.511111, 186413.511111, -81949557, -47392062, -76983817, -21692458);
+
+	// 2016-01-13T05:20:47 UTC
+	double JD = 2457400.722766;
+
+	int32_t from_a[TRAJECTORIES], from_d[TRAJECTORIES], to_a[TRAJECTORIES], to_d[TRAJECTORIES];
+	int32_t loop_a[TRAJECTORIES], loop_d[TRAJECTORIES];
+	int loop_ret[TRAJECTORIES];
+
+	srandom (42);
+	for (int i = 0; i < TRAJECTORIES; i++)
+	{
+		from_a[i] = -81949557 + random () % (81949557 - 47392062);
+		from_d[i] = -76983817 + random () % (76983817 - 21692458);
+		to_a[i] = -81949557 + random () % (81949557 - 47392062);
+		to_d[i] = -76983817 + random () % (76983817 - 21692458);
+	}
+
+	// step of 0.1 degree, as calculateMove uses
+	int32_t as = 18641;
+	int32_t ds = 18641;
+
+	double t1 = now ();
+	for (int i = 0; i < TRAJECTORIES; i++)
+	{
+		loop_a[i] = to_a[i];
+		loop_d[i] = to_d[i];
+		loop_ret[i] = gemBench->stepLoop (JD, from_a[i], from_d[i], loop_a[i], loop_d[i], as, ds, TRAJECTORY_CHECK_LIMIT, 5.0, 5.0, false);
+	}
+	double loop = now () - t1;
+
+	int differ = 0;
+
+	t1 = now ();
+	for (int i = 0; i < TRAJECTORIES; i++)
+	{
+		int32_t at = to_a[i];
+		int32_t dt = to_d[i];
+		int ret = gemBench->test_checkTrajectory (JD, from_a[i], from_d[i], at, dt, as, ds, TRAJECTORY_CHECK_LIMIT, 5.0, 5.0, false, false);
+		if (ret != loop_ret[i] || at != loop_a[i] || dt != loop_d[i])
+			differ++;
+	}
+	double block = now () - t1;
+
+	std::cout << std::fixed << std::setprecision (2)
+		<< TRAJECTORIES << " trajectories: step loop " << loop * 1e3 / TRAJECTORIES << " ms/trajectory, block evaluation "
+		<< block * 1e3 / TRAJECTORIES << " ms/trajectory, " << differ << " results differ" << std::endl;
+
+	delete gemBench;
+	return differ ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+/*
+ * Benchmark of UCAC5 cone searches - RA/Dec bands of u5index.unf with
+ * zNNN.xyz indices versus HEALPix pixel index, and scalar versus
+ * vectorized cone match kernel. Runs on synthetic catalogue written to
+ * temporary directory. Build and run with make bench.
+ */
+
+#include "ucac5/UCAC5Bands.hpp"
+#include "ucac5/UCAC5Idx.hpp"
+#include "ucac5/UCAC5Cone.hpp"
+#include "ucac5/UCAC5PixelIdx.hpp"
+#include "ucac5/UCAC5Catalogue.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// stars are generated in band around equator with about UCAC5 density
+#define STARS        2000000
+#define DEC_LIMIT    10.0
+#define QUERIES      2000
+#define RADIUS       0.5
+#define KERNEL_RUNS  20
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void toVector (int32_t ira, int32_t idc, Vector &v)
+{
+	double ra = ira / 3600000.0 * M_PI / 180.0;
+	double dec = idc / 3600000.0 * M_PI / 180.0;
+	v.xyz.x = cos (dec) * cos (ra);
+	v.xyz.y = cos (dec) * sin (ra);
+	v.xyz.z = sin (dec);
+}
+
+static bool byRa (const struct ucac5 &a, const struct ucac5 &b)
+{
+	return a.ira < b.ira;
+}
+
+/**
+ * Write zone files, their xyz indices and u5index.unf.
+ */
+static int writeCatalogue (const std::string &dir)
+{
+	std::vector <struct ucac5> *zones = new std::vector <struct ucac5>[UCAC5_ZONES];
+	srand48 (42);
+	double zmax = sin (DEC_LIMIT * M_PI / 180.0);
+	for (int i = 0; i < STARS; i++)
+	{
+		struct ucac5 s;
+		memset (&s, 0, sizeof (s));
+		double dec = asin ((drand48 () * 2 - 1) * zmax) * 180.0 / M_PI;
+		s.srcid = i;
+		s.ira = drand48 () * 360.0 * 3600000.0;
+		s.idc = dec * 3600000.0;
+		s.gmag = 8000 + lrand48 () % 12000;
+		zones[(int) floor ((dec + 90.0) / 0.2)].push_back (s);
+	}
+
+	std::vector <uint32_t> n0 (UCAC5_ZONES * UCAC5_RA_BINS, 0);
+	std::vector <uint32_t> nn (UCAC5_ZONES * UCAC5_RA_BINS, 0);
+	for (int z = 0; z < UCAC5_ZONES; z++)
+	{
+		std::vector <struct ucac5> &stars = zones[z];
+		std::sort (stars.begin (), stars.end (), byRa);
+
+		char fn[20];
+		snprintf (fn, sizeof (fn), "/z%03d", z + 1);
+		FILE *zf = fopen ((dir + fn).c_str (), "w");
+		FILE *xf = fopen ((dir + fn + ".xyz").c_str (), "w");
+		if (zf == NULL || xf == NULL)
+			return -1;
+		size_t k = 0;
+		for (int b = 0; b < UCAC5_RA_BINS; b++)
+		{
+			n0[b * UCAC5_ZONES + z] = k;
+			while (k < stars.size () && stars[k].ira < (b + 1) * 0.25 * 3600000.0)
+				k++;
+			nn[b * UCAC5_ZONES + z] = k - n0[b * UCAC5_ZONES + z];
+		}
+		for (std::vector <struct ucac5>::iterator iter = stars.begin (); iter != stars.end (); iter++)
+		{
+			Vector v;
+			toVector (iter->ira, iter->idc, v);
+			fwrite (&(*iter), sizeof (struct ucac5), 1, zf);
+			fwrite (v.data, sizeof (v.data), 1, xf);
+		}
+		fclose (zf);
+		fclose (xf);
+	}
+	delete[] zones;
+
+	FILE *f = fopen ((dir + "/u5index.unf").c_str (), "w");
+	if (f == NULL)
+		return -1;
+	fwrite (&n0[0], sizeof (uint32_t), n0.size (), f);
+	fwrite (&nn[0], sizeof (uint32_t), nn.size (), f);
+	fclose (f);
+	return 0;
+}
+
+int main (int argc, char **argv)
+{
+	char tmpl[] = "/tmp/bench_ucac5_XXXXXX";
+	if (mkdtemp (tmpl) == NULL)
+	{
+		perror ("cannot create temporary directory");
+		return 1;
+	}
+	std::string dir (tmpl);
+
+	if (writeCatalogue (dir) || UCAC5PixelIdx::build (dir.c_str (), UCAC5_PIXEL_ORDER))
+	{
+		perror ("cannot write catalogue");
+		return 1;
+	}
+
+	UCAC5PixelIdx pixels;
+	if (pixels.open (dir.c_str ()))
+	{
+		perror ("cannot open pixel index");
+		return 1;
+	}
+
+	// UCAC5Idx opens zone indices from current directory
+	if (chdir (dir.c_str ()))
+		return 1;
+
+	// UCAC5Bands does not wrap cones around 0h
+	std::vector <Vector> centers (QUERIES);
+	for (int i = 0; i < QUERIES; i++)
+		toVector ((5 + drand48 () * 350.0) * 3600000.0, (drand48 () * 2 - 1) * (DEC_LIMIT - 1) * 3600000.0, centers[i]);
+
+	double r = RADIUS * M_PI / 180.0;
+
+	// RA/Dec bands
+	UCAC5Bands bands;
+	if (bands.openBand ("u5index.unf"))
+	{
+		perror ("cannot open band index");
+		return 1;
+	}
+	size_t bandsTested = 0;
+	size_t bandsMatched = 0;
+	double t1 = now ();
+	for (int i = 0; i < QUERIES; i++)
+	{
+		double ra = atan2 (centers[i].xyz.y, centers[i].xyz.x);
+		if (ra < 0)
+			ra += 2 * M_PI;
+		double dec = asin (centers[i].xyz.z);
+
+		UCAC5Idx *index = NULL;
+		uint16_t dec_b = 0, ra_b = 0;
+		uint32_t ra_start = 0;
+		int32_t len;
+		while (bands.nextBand (ra, dec, r, dec_b, ra_b, ra_start, len) == 0)
+		{
+			if (index == NULL || index->getBand () != dec_b)
+			{
+				delete index;
+				index = new UCAC5Idx ();
+				if (index->openIdx (dec_b))
+					return 1;
+			}
+			index->select (ra_start, len);
+			bandsTested += len;
+			double d;
+			while (index->nextMatched (&centers[i], 0, r, d) >= 0)
+				bandsMatched++;
+		}
+		delete index;
+	}
+	double bandsTime = now () - t1;
+
+	// HEALPix pixels
+	size_t pixelsTested = 0;
+	size_t pixelsMatched = 0;
+	std::vector <uint32_t> matched;
+	t1 = now ();
+	for (int i = 0; i < QUERIES; i++)
+	{
+		pixelsTested += pixels.cone (centers[i], 0, r, matched);
+		pixelsMatched += matched.size ();
+	}
+	double pixelsTime = now () - t1;
+
+	// brute force check of pixel index on a few queries
+	int failed = 0;
+	double cosr = cos (r);
+	std::vector <uint32_t> all (pixels.getCount ());
+	for (int i = 0; i < 20; i++)
+	{
+		size_t expected = 0;
+		for (size_t j = 0; j < pixels.getCount (); j++)
+		{
+			Vector v;
+			pixels.getVector (j, v);
+			if ((v.xyz.x * centers[i].xyz.x + v.xyz.y * centers[i].xyz.y) + v.xyz.z * centers[i].xyz.z >= cosr)
+				expected++;
+		}
+		pixels.cone (centers[i], 0, r, matched);
+		if (matched.size () != expected)
+		{
+			std::cerr << "query " << i << " pixel index found " << matched.size () << " stars, expected " << expected << std::endl;
+			failed++;
+		}
+	}
+
+	// kernels on the whole index
+	std::vector <double> xs (pixels.getCount ()), ys (pixels.getCount ()), zs (pixels.getCount ());
+	std::vector <Vector> vs (pixels.getCount ());
+	for (size_t j = 0; j < pixels.getCount (); j++)
+	{
+		pixels.getVector (j, vs[j]);
+		xs[j] = vs[j].xyz.x;
+		ys[j] = vs[j].xyz.y;
+		zs[j] = vs[j].xyz.z;
+	}
+	size_t n = pixels.getCount ();
+	size_t kScalar = 0, kSimd = 0, kAoS = 0;
+
+	t1 = now ();
+	for (int i = 0; i < KERNEL_RUNS; i++)
+		kScalar += UCAC5Cone::matchSoAScalar (&xs[0], &ys[0], &zs[0], n, centers[i], cosr, INFINITY, 0, &all[0]);
+	double scalarTime = now () - t1;
+
+	t1 = now ();
+	for (int i = 0; i < KERNEL_RUNS; i++)
+		kSimd += UCAC5Cone::matchSoA (&xs[0], &ys[0], &zs[0], n, centers[i], cosr, INFINITY, 0, &all[0]);
+	double simdTime = now () - t1;
+
+	t1 = now ();
+	for (int i = 0; i < KERNEL_RUNS; i++)
+		kAoS += UCAC5Cone::matchAoS (&vs[0], n, centers[i], cosr, INFINITY, 0, &all[0]);
+	double aosTime = now () - t1;
+
+	if (kScalar != kSimd || kScalar != kAoS)
+	{
+		std::cerr << "kernels disagree: scalar " << kScalar << " " << UCAC5Cone::getKernelName () << " " << kSimd << " AoS " << kAoS << std::endl;
+		failed++;
+	}
+
+	std::cout << QUERIES << " cones of " << RADIUS << " deg radius, " << STARS << " stars:" << std::endl
+		<< std::fixed << std::setprecision (0)
+		<< "  bands:  " << QUERIES / bandsTime << " queries/s, " << bandsTested / bandsTime << " stars tested/s, "
+		<< (double) bandsTested / QUERIES << " tested and " << (double) bandsMatched / QUERIES << " matched per query" << std::endl
+		<< "  pixels: " << QUERIES / pixelsTime << " queries/s, " << pixelsTested / pixelsTime << " stars tested/s, "
+		<< (double) pixelsTested / QUERIES << " tested and " << (double) pixelsMatched / QUERIES << " matched per query" << std::endl
+		<< "kernels, " << KERNEL_RUNS << " runs over " << n << " stars:" << std::endl
+		<< "  scalar: " << KERNEL_RUNS * n / scalarTime << " stars/s" << std::endl
+		<< "  " << UCAC5Cone::getKernelName () << ": " << KERNEL_RUNS * n / simdTime << " stars/s" << std::endl
+		<< "  AoS:    " << KERNEL_RUNS * n / aosTime << " stars/s" << std::endl;
+
+	// cleanup
+	for (int z = 0; z < UCAC5_ZONES; z++)
+	{
+		char fn[20];
+		snprintf (fn, sizeof (fn), "/z%03d", z + 1);
+		unlink ((dir + fn).c_str ());
+		unlink ((dir + fn + ".xyz").c_str ());
+	}
+	unlink ((dir + "/u5index.unf").c_str ());
+	unlink ((dir + "/u5hpx.idx").c_str ());
+	unlink ((dir + "/u5hpx.xyz").c_str ());
+	unlink ((dir + "/u5hpx.ref").c_str ());
+	rmdir (dir.c_str ());
+
+	return failed ? 1 : 0;
+}
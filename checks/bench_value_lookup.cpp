@@ -0,0 +1,69 @@
+/*
+ * Benchmark of value lookup by name - linear search of ValueVector
+ * versus NameIndex used by Connection::getValue and Daemon::getCondValue.
+ * Build and run with make bench.
+ */
+
+#include "valuelist.h"
+#include "nameindex.h"
+
+#include <iostream>
+#include <iomanip>
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#define VALUES    500
+#define LOOKUPS   200000
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main (int argc, char **argv)
+{
+	rts2core::ValueVector values;
+	rts2core::NameIndex <rts2core::Value> valueIndex;
+
+	char name[50];
+	for (int i = 0; i < VALUES; i++)
+	{
+		snprintf (name, 50, "CAM_VALUE_%d", i);
+		rts2core::Value *val = new rts2core::ValueDouble (name, "benchmark value", false);
+		values.push_back (val);
+		valueIndex.insert (val->getName (), val);
+	}
+
+	unsigned long linearCompares = 0;
+	int missed = 0;
+
+	double t1 = now ();
+	for (int i = 0; i < LOOKUPS; i++)
+	{
+		int v = (i * 7919) % VALUES;
+		snprintf (name, 50, "cam_value_%d", v);
+		if (values.getValue (name) == NULL)
+			missed++;
+		linearCompares += v + 1;
+	}
+	double linear = now () - t1;
+
+	t1 = now ();
+	for (int i = 0; i < LOOKUPS; i++)
+	{
+		snprintf (name, 50, "cam_value_%d", (i * 7919) % VALUES);
+		if (valueIndex.find (name) == NULL)
+			missed++;
+	}
+	double indexed = now () - t1;
+
+	std::cout << std::fixed << std::setprecision (3)
+		<< LOOKUPS << " lookups in " << VALUES << " values: linear " << linear * 1e6 / LOOKUPS << " us/lookup, "
+		<< linearCompares << " name compares; index " << indexed * 1e6 / LOOKUPS << " us/lookup, "
+		<< valueIndex.getLookups () << " lookups, " << valueIndex.getCompares () << " name compares" << std::endl;
+
+	return missed ? 1 : 0;
+}
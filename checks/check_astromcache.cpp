@@ -0,0 +1,165 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+
+#include "astromcache.h"
+
+// site and weather parameters
+#define ELONG   (-17.8792 * ERFA_DD2R)
+#define PHI     (28.7606 * ERFA_DD2R)
+#define HM      2332.0
+#define DUT1    0.1
+#define PHPA    780.0
+#define TC      5.0
+#define RH      0.3
+#define WL      0.55
+
+// maximal allowed error of the cache (radians)
+#define MAX_ERR (0.01 * ERFA_DAS2R)
+
+rts2teld::AstromCache *cache = NULL;
+double utc1, utc2;
+
+void setup_astromcache (void)
+{
+	cache = new rts2teld::AstromCache ();
+	ck_assert_int_eq (eraDtf2d ("UTC", 2024, 3, 15, 21, 30, 0, &utc1, &utc2), 0);
+}
+
+void teardown_astromcache (void)
+{
+	delete cache;
+}
+
+/**
+ * Return largest difference of observed positions of set of stars transformed with cached
+ * context and with context freshly computed by eraApco13.
+ */
+static double maxError (double dt)
+{
+	double u2 = utc2 + dt / 86400.0;
+	eraASTROM *cached;
+	eraASTROM fresh;
+	double eoc, eof;
+	ck_assert_int_eq (cache->get (utc1, u2, DUT1, ELONG, PHI, HM, PHPA, TC, RH, WL, cached, eoc), 0);
+	ck_assert_int_eq (eraApco13 (utc1, u2, DUT1, ELONG, PHI, HM, 0, 0, PHPA, TC, RH, WL, &fresh, &eof), 0);
+	ck_assert_dbl_eq (eoc, eof, 1e-9);
+
+	double ret = 0;
+	for (double ra = 0; ra < 360; ra += 15)
+	{
+		for (double dec = -30; dec < 90; dec += 10)
+		{
+			double ri, di, aob[2], zob[2], hob, dob, rob;
+			eraAtciq (ra * ERFA_DD2R, dec * ERFA_DD2R, 0, 0, 0, 0, cached, &ri, &di);
+			eraAtioq (ri, di, cached, aob, zob, &hob, &dob, &rob);
+			eraAtciq (ra * ERFA_DD2R, dec * ERFA_DD2R, 0, 0, 0, 0, &fresh, &ri, &di);
+			eraAtioq (ri, di, &fresh, aob + 1, zob + 1, &hob, &dob, &rob);
+			// refraction model is not valid below horizon
+			if (zob[1] > 85 * ERFA_DD2R)
+				continue;
+			double err = eraSeps (aob[0], M_PI / 2 - zob[0], aob[1], M_PI / 2 - zob[1]);
+			if (err > ret)
+				ret = err;
+		}
+	}
+	return ret;
+}
+
+START_TEST(inside_window)
+{
+	ck_assert (maxError (0) == 0);
+	ck_assert_int_eq (cache->getRebuilds (), 1);
+
+	// only Earth rotation angle is updated
+	double dts[] = {0.5, 1, 10, 30, 59.5};
+	for (size_t i = 0; i < sizeof (dts) / sizeof (dts[0]); i++)
+	{
+		ck_assert (maxError (dts[i]) < MAX_ERR);
+		ck_assert_int_eq (cache->getRebuilds (), 1);
+	}
+
+	// date before the context was built
+	ck_assert (maxError (-30) < MAX_ERR);
+	ck_assert_int_eq (cache->getRebuilds (), 1);
+}
+END_TEST
+
+START_TEST(outside_window)
+{
+	ck_assert (maxError (0) == 0);
+	ck_assert_int_eq (cache->getRebuilds (), 1);
+
+	// context is rebuilt, so it matches eraApco13 exactly
+	ck_assert (maxError (ASTROM_REFRESH + 1) == 0);
+	ck_assert_int_eq (cache->getRebuilds (), 2);
+
+	ck_assert (maxError (3600) == 0);
+	ck_assert_int_eq (cache->getRebuilds (), 3);
+
+	ck_assert (maxError (-ASTROM_REFRESH) == 0);
+	ck_assert_int_eq (cache->getRebuilds (), 4);
+
+	cache->invalidate ();
+	ck_assert (maxError (-ASTROM_REFRESH) == 0);
+	ck_assert_int_eq (cache->getRebuilds (), 5);
+}
+END_TEST
+
+START_TEST(parameters_change)
+{
+	eraASTROM *astrom;
+	double eo;
+
+	ck_assert_int_eq (cache->get (utc1, utc2, DUT1, ELONG, PHI, HM, PHPA, TC, RH, WL, astrom, eo), 0);
+	ck_assert_int_eq (cache->getRebuilds (), 1);
+
+	// small weather changes are ignored
+	ck_assert_int_eq (cache->get (utc1, utc2, DUT1, ELONG, PHI, HM, PHPA + 0.05, TC + 0.05, RH, WL, astrom, eo), 0);
+	ck_assert_int_eq (cache->getRebuilds (), 1);
+
+	ck_assert_int_eq (cache->get (utc1, utc2, DUT1, ELONG, PHI, HM, PHPA + 1, TC, RH, WL, astrom, eo), 0);
+	ck_assert_int_eq (cache->getRebuilds (), 2);
+
+	ck_assert_int_eq (cache->get (utc1, utc2, DUT1, ELONG, PHI, HM, PHPA + 1, TC, RH, 0.6, astrom, eo), 0);
+	ck_assert_int_eq (cache->getRebuilds (), 3);
+
+	ck_assert_int_eq (cache->get (utc1, utc2, DUT1 + 0.01, ELONG, PHI, HM, PHPA + 1, TC, RH, 0.6, astrom, eo), 0);
+	ck_assert_int_eq (cache->getRebuilds (), 4);
+
+	ck_assert_int_eq (cache->get (utc1, utc2, DUT1 + 0.01, ELONG, PHI + 1e-6, HM, PHPA + 1, TC, RH, 0.6, astrom, eo), 0);
+	ck_assert_int_eq (cache->getRebuilds (), 5);
+}
+END_TEST
+
+Suite * astromcache_suite (void)
+{
+	Suite *s;
+	TCase *tc_astromcache;
+
+	s = suite_create ("AstromCache");
+	tc_astromcache = tcase_create ("Cached astrometry context");
+
+	tcase_add_checked_fixture (tc_astromcache, setup_astromcache, teardown_astromcache);
+	tcase_add_test (tc_astromcache, inside_window);
+	tcase_add_test (tc_astromcache, outside_window);
+	tcase_add_test (tc_astromcache, parameters_change);
+	suite_add_tcase (s, tc_astromcache);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = astromcache_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,144 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+
+#include "binnedhistogram.h"
+
+rts2core::BinnedHistogram *hist = NULL;
+
+void setup_binnedhistogram (void)
+{
+	hist = new rts2core::BinnedHistogram (100);
+}
+
+void teardown_binnedhistogram (void)
+{
+	delete hist;
+}
+
+START_TEST(integer)
+{
+	uint16_t data[1000];
+	for (int i = 0; i < 1000; i++)
+		data[i] = 1000 + i % 50;
+	data[10] = 1020;
+	data[11] = 1020;
+
+	ck_assert (std::isnan (hist->getMode ()));
+
+	hist->add (data, 1000);
+	ck_assert_int_eq (hist->getTotal (), 1000);
+	ck_assert_dbl_eq (hist->getBinWidth (), 1, 1e-9);
+	ck_assert_dbl_eq (hist->getBinLow (0), 1000, 1e-9);
+	ck_assert_dbl_eq (hist->getMode (), 1020, 1e-9);
+	ck_assert_dbl_eq (hist->getQuantile (0), 1000, 1e-9);
+	ck_assert_dbl_eq (hist->getQuantile (0.5), 1025, 1e-9);
+	ck_assert_dbl_eq (hist->getQuantile (0.999), 1049, 1e-9);
+
+	// extend range up - bins are merged
+	uint16_t big = 1300;
+	hist->add (&big, 1);
+	ck_assert_int_eq (hist->getTotal (), 1001);
+	ck_assert_dbl_eq (hist->getBinWidth (), 4, 1e-9);
+	ck_assert_dbl_eq (hist->getBinLow (0), 1000, 1e-9);
+	ck_assert_int_eq (hist->getCount (5), 82);
+	ck_assert_int_eq (hist->getCount (75), 1);
+
+	// and down
+	uint16_t small = 900;
+	hist->add (&small, 1);
+	ck_assert_dbl_eq (hist->getBinWidth (), 8, 1e-9);
+	ck_assert_dbl_eq (hist->getBinLow (0), 1400 - 800, 1e-9);
+	uint64_t sum = 0;
+	for (size_t i = 0; i < hist->getBins (); i++)
+		sum += hist->getCount (i);
+	ck_assert_int_eq (sum, 1002);
+
+	// range is learned from the previous frame
+	hist->nextFrame ();
+	ck_assert_int_eq (hist->getTotal (), 0);
+	ck_assert_dbl_eq (hist->getBinLow (0), 900, 1e-9);
+	ck_assert_dbl_eq (hist->getBinWidth (), 5, 1e-9);
+}
+END_TEST
+
+START_TEST(floating)
+{
+	float data[10000];
+	for (int i = 0; i < 10000; i++)
+		data[i] = -50.0 + (i % 1000) * 0.1;
+	for (int i = 0; i < 10000; i += 10)
+		data[i] = 12.345;
+	data[5] = NAN;
+	data[6] = INFINITY;
+
+	hist->add (data, 10000);
+	ck_assert_int_eq (hist->getTotal (), 9998);
+	ck_assert_int_eq (hist->getOutliers (), 2);
+	ck_assert_dbl_eq (hist->getMode (), 12.345, hist->getBinWidth ());
+	// 8998 uniformly distributed values and 1000 values at 12.345
+	ck_assert_dbl_eq (hist->getQuantile (0.5), 5.55, 0.2);
+
+	// 32 bit integers with wide range
+	int32_t idata[5000];
+	for (int i = 0; i < 5000; i++)
+		idata[i] = (i - 2500) * 100000;
+	for (int i = 0; i < 5000; i += 4)
+		idata[i] = 777777;
+	hist->setBins (1000);
+	hist->add (idata, 5000);
+	ck_assert_dbl_eq (hist->getMode (), 777777, hist->getBinWidth ());
+	// 51st value which is not 777777
+	ck_assert_dbl_eq (hist->getQuantile (0.01), (67 - 2500) * 100000, hist->getBinWidth () * 2);
+}
+END_TEST
+
+START_TEST(fixed)
+{
+	uint16_t data[5] = {0, 10, 655, 65535, 1000};
+	hist->setBins (100);
+	hist->setRange (0, 65536);
+	hist->add (data, 5);
+	ck_assert_int_eq (hist->getCount (0), 3);
+	ck_assert_int_eq (hist->getCount (1), 1);
+	ck_assert_int_eq (hist->getCount (99), 1);
+
+	int32_t out[2] = {-1, 70000};
+	hist->add (out, 2);
+	ck_assert_int_eq (hist->getTotal (), 5);
+	ck_assert_int_eq (hist->getOutliers (), 2);
+	ck_assert_dbl_eq (hist->getBinWidth (), 655.36, 1e-9);
+}
+END_TEST
+
+Suite * binnedhistogram_suite (void)
+{
+	Suite *s;
+	TCase *tc_binnedhistogram;
+
+	s = suite_create ("BinnedHistogram");
+	tc_binnedhistogram = tcase_create ("BinnedHistogram tests");
+
+	tcase_add_checked_fixture (tc_binnedhistogram, setup_binnedhistogram, teardown_binnedhistogram);
+	tcase_add_test (tc_binnedhistogram, integer);
+	tcase_add_test (tc_binnedhistogram, floating);
+	tcase_add_test (tc_binnedhistogram, fixed);
+	suite_add_tcase (s, tc_binnedhistogram);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = binnedhistogram_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
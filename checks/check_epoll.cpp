@@ -0,0 +1,376 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "block.h"
+
+#include <vector>
+
+/**
+ * Connection counting calls of receive and received lines.
+ */
+class TestConnection:public rts2core::Connection
+{
+	public:
+		TestConnection (int _sock, rts2core::Block *_master):rts2core::Connection (_sock, _master)
+		{
+			receives = 0;
+			lines = 0;
+		}
+
+		virtual int receive (rts2core::Block *block)
+		{
+			receives++;
+			return rts2core::Connection::receive (block);
+		}
+
+		virtual ~TestConnection () { deletedLines = lines; }
+
+		virtual void processLine () { lines++; }
+
+		int getSock () { return sock; }
+
+		/**
+		 * Close socket and open new one with the same descriptor number.
+		 *
+		 * @return peer socket of the new connection
+		 */
+		int reopen ()
+		{
+			int old = sock;
+			getMaster ()->pollFDClosed (sock);
+			close (sock);
+			int sv[2];
+			ck_assert_int_eq (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+			if (sv[0] != old)
+			{
+				ck_assert_int_eq (dup2 (sv[0], old), old);
+				close (sv[0]);
+			}
+			return sv[1];
+		}
+
+		// lines received by the last deleted connection
+		static int deletedLines;
+
+		int receives;
+		int lines;
+};
+
+int TestConnection::deletedLines = 0;
+
+class TestBlock:public rts2core::Block
+{
+	public:
+		TestBlock (int argc, char **argv):rts2core::Block (argc, argv) { removed = 0; }
+
+		virtual int run () { return 0; }
+
+		void loop (int n)
+		{
+			for (int i = 0; i < n; i++)
+				oneRunLoop ();
+		}
+
+		int removed;
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+
+		virtual void connectionRemoved (rts2core::Connection *conn) { removed++; }
+};
+
+static char *test_argv[] = {(char *) "check_epoll", NULL};
+
+#define CONNS    32
+
+TestBlock *block = NULL;
+std::vector <TestConnection *> conns;
+std::vector <int> peers;
+
+void setup_epoll (void)
+{
+	block->removed = 0;
+	for (int i = 0; i < CONNS; i++)
+	{
+		int sv[2];
+		ck_assert_int_eq (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+		conns.push_back (new TestConnection (sv[0], block));
+		block->addConnection (conns.back ());
+		peers.push_back (sv[1]);
+	}
+	// move connections from added queue to connections
+	block->loop (1);
+}
+
+void teardown_epoll (void)
+{
+	for (std::vector <TestConnection *>::iterator iter = conns.begin (); iter != conns.end (); iter++)
+	{
+		if (*iter == NULL)
+			continue;
+		block->removeConnection (*iter);
+		delete *iter;
+	}
+	conns.clear ();
+	for (std::vector <int>::iterator iter = peers.begin (); iter != peers.end (); iter++)
+		if (*iter >= 0)
+			close (*iter);
+	peers.clear ();
+}
+
+START_TEST(ready_only)
+{
+	for (int i = 0; i < CONNS; i++)
+		conns[i]->receives = 0;
+
+	ck_assert_int_eq (write (peers[3], "a\nb\n", 4), 4);
+	block->loop (3);
+
+	// only connection with data is visited
+	ck_assert_int_eq (conns[3]->lines, 2);
+	ck_assert_int_eq (conns[3]->receives, 1);
+	for (int i = 0; i < CONNS; i++)
+	{
+		if (i != 3)
+			ck_assert_int_eq (conns[i]->receives, 0);
+	}
+}
+END_TEST
+
+START_TEST(output_drain)
+{
+	// peer does not read, reply remains queued
+	std::string line (1000, 'x');
+	for (int i = 0; i < 1000; i++)
+		conns[5]->sendMsg (line.c_str ());
+	block->loop (2);
+	ck_assert (conns[5]->getOutputQueueSize () > 0);
+
+	// read on peer side, queue is drained by main loop without any other activity
+	size_t total = 0;
+	char buf[65536];
+	for (int l = 0; l < 1000 && total < 1000 * 1001; l++)
+	{
+		ssize_t ret = recv (peers[5], buf, sizeof (buf), MSG_DONTWAIT);
+		if (ret > 0)
+			total += ret;
+		block->loop (1);
+	}
+	ck_assert_int_eq (total, 1000 * 1001);
+	ck_assert_int_eq (conns[5]->getOutputQueueSize (), 0);
+}
+END_TEST
+
+START_TEST(binary_queued)
+{
+	// binary data larger than socket buffer are queued, call does not block on non-reading peer
+	size_t chansize = 4 * 1024 * 1024;
+	std::vector <char> data (chansize, 'b');
+	int data_conn = conns[6]->startBinaryData (1, 1, &chansize);
+	ck_assert (data_conn > 0);
+	ck_assert_int_eq (conns[6]->sendBinaryData (data_conn, 0, &data[0], chansize), 0);
+	ck_assert (conns[6]->getOutputQueueSize () > 0);
+	ck_assert_int_eq (conns[6]->getWriteBinaryDataSize (data_conn), 0);
+
+	// peer receives all data, drained by main loop
+	size_t total = 0;
+	char buf[65536];
+	for (int l = 0; l < 10000 && conns[6]->getOutputQueueSize () > 0; l++)
+	{
+		ssize_t ret = recv (peers[6], buf, sizeof (buf), MSG_DONTWAIT);
+		if (ret > 0)
+			total += ret;
+		block->loop (1);
+	}
+	while (true)
+	{
+		ssize_t ret = recv (peers[6], buf, sizeof (buf), MSG_DONTWAIT);
+		if (ret <= 0)
+			break;
+		total += ret;
+	}
+	ck_assert_int_eq (conns[6]->getOutputQueueSize (), 0);
+	// binary header, data header and data
+	ck_assert (total > chansize);
+}
+END_TEST
+
+/**
+ * Slowly reads from socket, counts received data bytes.
+ */
+void *slow_reader (void *arg)
+{
+	int sock = *((int *) arg);
+	size_t received = 0;
+	char buf[65536];
+	struct timeval tv;
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+	while (true)
+	{
+		ssize_t ret = recv (sock, buf, sizeof (buf), 0);
+		if (ret <= 0)
+			break;
+		for (ssize_t i = 0; i < ret; i++)
+		{
+			if (buf[i] == 'b')
+				received++;
+		}
+		usleep (1000);
+	}
+	return (void *) received;
+}
+
+START_TEST(binary_backpressure)
+{
+	size_t limit = block->getOutputQueueLimit ();
+	block->setOutputQueueLimit (1024 * 1024);
+
+	// two blocks, each larger than the queue limit
+	size_t chansize[1] = {8 * 1024 * 1024};
+	std::vector <char> data (4 * 1024 * 1024, 'b');
+	int data_conn = conns[10]->startBinaryData (1, 1, chansize);
+	ck_assert (data_conn > 0);
+
+	pthread_t reader;
+	ck_assert_int_eq (pthread_create (&reader, NULL, slow_reader, &peers[10]), 0);
+
+	// the second block waits until the first one is read by the client
+	ck_assert_int_eq (conns[10]->sendBinaryData (data_conn, 0, &data[0], data.size ()), 0);
+	ck_assert_int_eq (conns[10]->sendBinaryData (data_conn, 0, &data[0], data.size ()), 0);
+	ck_assert (conns[10]->getOutputQueueSize () <= data.size () + 100);
+	ck_assert_int_eq (conns[10]->getWriteBinaryDataSize (data_conn), 0);
+
+	for (int l = 0; l < 10000 && conns[10]->getOutputQueueSize () > 0; l++)
+		block->loop (1);
+	ck_assert_int_eq (conns[10]->getOutputQueueSize (), 0);
+
+	// reader times out when no more data arrive
+	void *received;
+	pthread_join (reader, &received);
+	ck_assert_int_eq ((size_t) received, chansize[0]);
+
+	// slow client was not disconnected
+	ck_assert_int_eq (block->removed, 0);
+
+	block->setOutputQueueLimit (limit);
+}
+END_TEST
+
+START_TEST(peer_closed)
+{
+	close (peers[7]);
+	peers[7] = -1;
+	block->loop (3);
+	// connection was deleted by the block
+	ck_assert_int_eq (block->removed, 1);
+	conns[7] = NULL;
+
+	// other connections still work
+	ck_assert_int_eq (write (peers[8], "c\n", 2), 2);
+	block->loop (2);
+	ck_assert_int_eq (conns[8]->lines, 1);
+}
+END_TEST
+
+START_TEST(removed_connection)
+{
+	block->removeConnection (conns[9]);
+	ck_assert_int_eq (write (peers[9], "d\n", 2), 2);
+	block->loop (2);
+	ck_assert_int_eq (conns[9]->receives, 0);
+	delete conns[9];
+	conns[9] = NULL;
+}
+END_TEST
+
+START_TEST(reopen_same_fd)
+{
+	int sock = conns[11]->getSock ();
+	ck_assert_int_eq (write (peers[11], "h\n", 2), 2);
+	block->loop (2);
+	ck_assert_int_eq (conns[11]->lines, 1);
+
+	close (peers[11]);
+	peers[11] = conns[11]->reopen ();
+	ck_assert_int_eq (conns[11]->getSock (), sock);
+	block->loop (1);
+
+	// new socket with the same number is polled
+	ck_assert_int_eq (write (peers[11], "i\nj\n", 4), 4);
+	block->loop (2);
+	ck_assert_int_eq (conns[11]->lines, 3);
+	ck_assert_int_eq (block->removed, 0);
+}
+END_TEST
+
+START_TEST(regular_file)
+{
+	char fname[] = "/tmp/check_epoll_XXXXXX";
+	int fd = mkstemp (fname);
+	ck_assert (fd >= 0);
+	unlink (fname);
+	ck_assert_int_eq (write (fd, "e\nf\ng\n", 6), 6);
+	lseek (fd, 0, SEEK_SET);
+
+	// regular file cannot be polled by epoll, it is always ready
+	TestConnection *fconn = new TestConnection (fd, block);
+	block->addConnection (fconn);
+	block->removed = 0;
+	block->loop (5);
+	// end of file closes the connection
+	ck_assert_int_eq (block->removed, 1);
+	ck_assert_int_eq (TestConnection::deletedLines, 3);
+}
+END_TEST
+
+Suite * epoll_suite (void)
+{
+	Suite *s;
+	TCase *tc_epoll;
+
+	s = suite_create ("Epoll");
+	tc_epoll = tcase_create ("Epoll reactor");
+
+	tcase_add_checked_fixture (tc_epoll, setup_epoll, teardown_epoll);
+	tcase_add_test (tc_epoll, ready_only);
+	tcase_add_test (tc_epoll, output_drain);
+	tcase_add_test (tc_epoll, binary_queued);
+	tcase_add_test (tc_epoll, binary_backpressure);
+	tcase_add_test (tc_epoll, peer_closed);
+	tcase_add_test (tc_epoll, removed_connection);
+	tcase_add_test (tc_epoll, reopen_same_fd);
+	tcase_add_test (tc_epoll, regular_file);
+	suite_add_tcase (s, tc_epoll);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	// logging needs the first application, so single block is used for all tests
+	block = new TestBlock (1, test_argv);
+	block->setTimeout (USEC_SEC / 100);
+	if (block->setUseEpoll (true))
+		return EXIT_FAILURE;
+
+	s = epoll_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	delete block;
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,380 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "block.h"
+#include "data.h"
+
+#include <iostream>
+#include <sstream>
+
+// exit code of skipped test
+#define SKIP      77
+
+#define SEGMENTS  3
+#define SEGSIZE   10000
+
+/**
+ * Connection counting processed lines.
+ */
+class TestConnection:public rts2core::Connection
+{
+	public:
+		TestConnection (int _sock, rts2core::Block *_master):rts2core::Connection (_sock, _master) { lines = 0; }
+
+		virtual void processLine ()
+		{
+			lines++;
+			rts2core::Connection::processLine ();
+		}
+
+		int lines;
+};
+
+class TestBlock:public rts2core::Block
+{
+	public:
+		TestBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+
+		virtual int run () { return 0; }
+
+		void loop (int n)
+		{
+			for (int i = 0; i < n; i++)
+				oneRunLoop ();
+		}
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+/**
+ * Writer with access to segment locks.
+ */
+class TestWriter:public rts2core::DataSharedWrite
+{
+	public:
+		int lock (int seg) { return lockSegment (seg); }
+};
+
+static char *test_argv[] = {(char *) "check_memfd", NULL};
+
+TestBlock *block = NULL;
+TestWriter *writer = NULL;
+
+/**
+ * Wait for memfd descriptors, as poll loop does.
+ *
+ * @return receiveMemfd result
+ */
+static int waitAttach (rts2core::DataSharedRead *reader)
+{
+	for (int i = 0; i < 500; i++)
+	{
+		struct pollfd pfd;
+		pfd.fd = reader->getAttachSocket ();
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		poll (&pfd, 1, 10);
+		int ret = reader->receiveMemfd ();
+		if (ret <= 0)
+			return ret;
+	}
+	return 1;
+}
+
+/**
+ * Accept single client on writer socket.
+ */
+static int acceptOne (TestWriter *w)
+{
+	struct pollfd pfd;
+	pfd.fd = w->getListenSocket ();
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll (&pfd, 1, 5000) != 1)
+		return -2;
+	return w->acceptClient ();
+}
+
+static void fillSegment (int chan, char c)
+{
+	memset (writer->getChannelData (chan), c, SEGSIZE);
+	writer->dataWritten (chan, SEGSIZE);
+}
+
+void setup_memfd (void)
+{
+	writer = new TestWriter ();
+	ck_assert (writer->createMemfd (SEGMENTS, SEGSIZE, false) != NULL);
+}
+
+void teardown_memfd (void)
+{
+	delete writer;
+	writer = NULL;
+}
+
+START_TEST(fd_passing)
+{
+	int seg = writer->addClient (SEGSIZE, 0, 7);
+	ck_assert_int_eq (seg, 0);
+	// data memfd is sealed, but writer keeps its writable mapping
+	fillSegment (0, 'a');
+
+	rts2core::DataSharedRead *reader = new rts2core::DataSharedRead ();
+	ck_assert_int_eq (reader->attachMemfd (writer->getSocketName (), writer->getMemfdId ()), 0);
+	ck_assert (reader->getAttachSocket () >= 0);
+	// writer has not accepted yet, reader does not wait
+	ck_assert_int_eq (reader->receiveMemfd (), 1);
+
+	ck_assert_int_eq (writer->acceptClient (), 0);
+	ck_assert_int_eq (waitAttach (reader), 0);
+	ck_assert_int_eq (reader->getAttachSocket (), -1);
+
+	rts2core::DataSharedRead *ch = new rts2core::DataSharedRead (reader, seg);
+	ck_assert_int_eq (ch->getRestSize (), 0);
+	char *d = ch->getDataBuff ();
+	for (int i = 0; i < SEGSIZE; i++)
+		ck_assert_int_eq (d[i], 'a');
+
+	// image data cannot be made writable by the client
+	ck_assert_int_ne (mprotect (d, getpagesize (), PROT_READ | PROT_WRITE), 0);
+
+	// data written later are visible to the client
+	seg = writer->addClient (SEGSIZE, 1, 8);
+	ck_assert_int_eq (seg, 1);
+	fillSegment (1, 'b');
+	rts2core::DataSharedRead *ch2 = new rts2core::DataSharedRead (reader, seg);
+	ck_assert_int_eq (ch2->getDataBuff ()[SEGSIZE - 1], 'b');
+
+	delete ch2;
+	delete ch;
+	delete reader;
+}
+END_TEST
+
+START_TEST(attach_detach)
+{
+	int seg = writer->addClient (SEGSIZE, 0, 7);
+	fillSegment (0, 'c');
+
+	for (int r = 0; r < 3; r++)
+	{
+		rts2core::DataSharedRead *reader = new rts2core::DataSharedRead ();
+		ck_assert_int_eq (reader->attachMemfd (writer->getSocketName (), writer->getMemfdId ()), 0);
+		ck_assert_int_eq (acceptOne (writer), 0);
+		ck_assert_int_eq (waitAttach (reader), 0);
+
+		rts2core::DataSharedRead *ch = new rts2core::DataSharedRead (reader, seg);
+		ck_assert_int_eq (ch->getDataBuff ()[0], 'c');
+		delete ch;
+		delete reader;
+	}
+
+	// client releases segment, which can be used again
+	rts2core::DataSharedRead *reader = new rts2core::DataSharedRead ();
+	ck_assert_int_eq (reader->attachMemfd (writer->getSocketName (), writer->getMemfdId ()), 0);
+	ck_assert_int_eq (acceptOne (writer), 0);
+	ck_assert_int_eq (waitAttach (reader), 0);
+	ck_assert_int_eq (writer->addClient (SEGSIZE, 1, 8), 1);
+	ck_assert_int_eq (writer->addClient (SEGSIZE, 2, 9), 2);
+	ck_assert_int_eq (writer->addClient (SEGSIZE, 3, 10), -1);
+	ck_assert_int_eq (reader->removeClient (seg, 7), 0);
+	ck_assert_int_eq (writer->addClient (SEGSIZE, 3, 10), seg);
+	delete reader;
+
+	// wrong memfd identification
+	reader = new rts2core::DataSharedRead ();
+	ck_assert_int_eq (reader->attachMemfd (writer->getSocketName (), writer->getMemfdId () + 1), 0);
+	ck_assert_int_eq (acceptOne (writer), 0);
+	ck_assert_int_eq (waitAttach (reader), -1);
+	delete reader;
+
+	// writer does not exist
+	reader = new rts2core::DataSharedRead ();
+	ck_assert_int_eq (reader->attachMemfd ("rts2-data-none", 1), -1);
+	delete reader;
+}
+END_TEST
+
+START_TEST(other_user)
+{
+	// only root can switch to other user
+	if (geteuid () != 0)
+		return;
+
+	pid_t child = fork ();
+	if (child == 0)
+	{
+		if (setuid (65534))
+			_exit (2);
+		rts2core::DataSharedRead reader;
+		if (reader.attachMemfd (writer->getSocketName (), writer->getMemfdId ()))
+			_exit (3);
+		_exit (waitAttach (&reader) == -1 ? 0 : 1);
+	}
+	ck_assert (child > 0);
+	ck_assert_int_eq (acceptOne (writer), -1);
+	int status;
+	ck_assert_int_eq (waitpid (child, &status, 0), child);
+	ck_assert (WIFEXITED (status));
+	ck_assert_int_eq (WEXITSTATUS (status), 0);
+}
+END_TEST
+
+START_TEST(writer_crash)
+{
+	int pfd[2];
+	ck_assert_int_eq (pipe (pfd), 0);
+
+	pid_t child = fork ();
+	if (child == 0)
+	{
+		close (pfd[0]);
+		TestWriter w;
+		if (w.createMemfd (SEGMENTS, SEGSIZE, false) == NULL || w.addClient (SEGSIZE, 0, 5) != 0)
+			_exit (1);
+		std::ostringstream os;
+		os << w.getSocketName () << " " << w.getMemfdId ();
+		if (write (pfd[1], os.str ().c_str (), os.str ().length ()) < 0)
+			_exit (1);
+		close (pfd[1]);
+		if (acceptOne (&w))
+			_exit (1);
+		// die while holding the segment lock
+		w.lock (0);
+		raise (SIGKILL);
+		_exit (1);
+	}
+	ck_assert (child > 0);
+	close (pfd[1]);
+	char buf[200];
+	ssize_t l = read (pfd[0], buf, sizeof (buf) - 1);
+	close (pfd[0]);
+	ck_assert (l > 0);
+	buf[l] = '\0';
+	char name[200];
+	unsigned long long id;
+	ck_assert_int_eq (sscanf (buf, "%s %llu", name, &id), 2);
+
+	rts2core::DataSharedRead *reader = new rts2core::DataSharedRead ();
+	ck_assert_int_eq (reader->attachMemfd (name, id), 0);
+	ck_assert_int_eq (waitAttach (reader), 0);
+
+	int status;
+	ck_assert_int_eq (waitpid (child, &status, 0), child);
+	ck_assert (WIFSIGNALED (status));
+
+	// lock held by dead writer is recovered, segment stays mapped
+	alarm (10);
+	ck_assert_int_eq (reader->removeClient (0, 5), 0);
+	ck_assert_int_eq (reader->removeClient (0, 5, false), -1);
+	alarm (0);
+	delete reader;
+}
+END_TEST
+
+START_TEST(poll_attach)
+{
+	for (int e = 0; e < 2; e++)
+	{
+		ck_assert_int_eq (block->setUseEpoll (e == 1), 0);
+		int sv[2];
+		ck_assert_int_eq (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+		TestConnection *conn = new TestConnection (sv[0], block);
+		block->addConnection (conn);
+		block->loop (1);
+
+		int seg = writer->addClient (SEGSIZE, e, 11);
+		fillSegment (e, 'd' + e);
+
+		std::ostringstream os;
+		os << PROTO_SHARED_FD " 1 " << writer->getMemfdId () << " " << writer->getSocketName () << " 1 " << seg << "\n" PROTO_TECHNICAL " ready\n";
+		ck_assert_int_eq (write (sv[1], os.str ().c_str (), os.str ().length ()), (ssize_t) os.str ().length ());
+
+		// line following shared data start waits for descriptors, main loop is not blocked
+		double t = getNow ();
+		block->loop (5);
+		ck_assert (getNow () - t < 1);
+		ck_assert_int_eq (conn->lines, 1);
+		ck_assert (!conn->isConnState (CONN_DELETE) && !conn->isConnState (CONN_BROKEN));
+
+		ck_assert_int_eq (writer->acceptClient (), 0);
+		for (int i = 0; i < 50 && conn->lines < 2; i++)
+			block->loop (1);
+		ck_assert_int_eq (conn->lines, 2);
+
+		rts2core::DataAbstractRead *ch = conn->lastDataChannel (0);
+		ck_assert (ch != NULL);
+		ck_assert_int_eq (ch->getDataBuff ()[0], 'd' + e);
+
+		ck_assert_int_eq (((rts2core::DataSharedRead *) ch)->removeActiveClient (11), 0);
+		block->removeConnection (conn);
+		delete conn;
+		close (sv[1]);
+	}
+	ck_assert_int_eq (block->setUseEpoll (false), 0);
+}
+END_TEST
+
+Suite * memfd_suite (void)
+{
+	Suite *s;
+	TCase *tc_memfd;
+
+	s = suite_create ("Memfd");
+	tc_memfd = tcase_create ("Shared data in memfd");
+
+	tcase_add_checked_fixture (tc_memfd, setup_memfd, teardown_memfd);
+	tcase_add_test (tc_memfd, fd_passing);
+	tcase_add_test (tc_memfd, attach_detach);
+	tcase_add_test (tc_memfd, other_user);
+	tcase_add_test (tc_memfd, writer_crash);
+	tcase_add_test (tc_memfd, poll_attach);
+	suite_add_tcase (s, tc_memfd);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	signal (SIGPIPE, SIG_IGN);
+
+	// logging needs the first application, so single block is used for all tests
+	block = new TestBlock (1, test_argv);
+	block->setTimeout (USEC_SEC / 100);
+
+	// skip if memfd is not available
+	writer = new TestWriter ();
+	if (writer->createMemfd (SEGMENTS, SEGSIZE, false) == NULL)
+	{
+		std::cout << "cannot create memfd, skipping memfd check" << std::endl;
+		delete writer;
+		delete block;
+		return SKIP;
+	}
+	delete writer;
+	writer = NULL;
+
+	s = memfd_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	delete block;
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,241 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "multidev.h"
+
+#define EVENT_TICK    RTS2_LOCAL_EVENT + 10000
+#define EVENT_PING    RTS2_LOCAL_EVENT + 10001
+
+// timer period of devices
+#define PERIOD        0.02
+
+// number of devices currently processing an event
+static int processing = 0;
+static pthread_mutex_t processingLock = PTHREAD_MUTEX_INITIALIZER;
+
+static char *test_argv[] = {(char *) "check_multidev", NULL};
+
+/**
+ * Device running periodic timer. Timer handler is busy for given time,
+ * simulating slow I/O, and pings peer device.
+ */
+class TestDevice:public rts2core::Device
+{
+	public:
+		TestDevice (const char *name, double _busy):rts2core::Device (1, test_argv, DEVICE_TYPE_SENSOR, name)
+		{
+			busy = _busy;
+			peer = NULL;
+			reset ();
+		}
+
+		void reset ()
+		{
+			deleteTimers (EVENT_TICK);
+			ticks = 0;
+			maxLateness = 0;
+			minLateness = 0;
+			overlapped = 0;
+			pings = 0;
+			maxPingLatency = 0;
+		}
+
+		void startTimer ()
+		{
+			nextTick = getNow () + PERIOD;
+			addTimer (PERIOD, new rts2core::Event (EVENT_TICK));
+		}
+
+		virtual void postEvent (rts2core::Event *event)
+		{
+			switch (event->getType ())
+			{
+				case EVENT_TICK:
+					{
+						double l = getNow () - nextTick;
+						if (l > maxLateness)
+							maxLateness = l;
+						if (l < minLateness)
+							minLateness = l;
+						ticks++;
+
+						pthread_mutex_lock (&processingLock);
+						processing++;
+						if (processing > 1)
+							overlapped++;
+						pthread_mutex_unlock (&processingLock);
+
+						if (busy > 0)
+							usleep (busy * USEC_SEC);
+						// event argument holds time when the ping was sent
+						if (peer)
+							peer->queEvent (new rts2core::Event (EVENT_PING, new double (getNow ())), peer);
+
+						pthread_mutex_lock (&processingLock);
+						processing--;
+						pthread_mutex_unlock (&processingLock);
+
+						nextTick = getNow () + PERIOD;
+						addTimer (PERIOD, new rts2core::Event (EVENT_TICK));
+					}
+					break;
+				case EVENT_PING:
+					{
+						double *sent = (double *) event->getArg ();
+						double l = getNow () - *sent;
+						delete sent;
+						if (l > maxPingLatency)
+							maxPingLatency = l;
+						pings++;
+					}
+					break;
+			}
+			rts2core::Device::postEvent (event);
+		}
+
+		double busy;
+		TestDevice *peer;
+
+		int ticks;
+		double nextTick;
+		double maxLateness;
+		// negative if timer fired before its time
+		double minLateness;
+		int overlapped;
+
+		int pings;
+		double maxPingLatency;
+};
+
+rts2core::MultiDev *md = NULL;
+TestDevice *slow = NULL;
+TestDevice *fast = NULL;
+
+void setup_multidev (void)
+{
+	slow->reset ();
+	fast->reset ();
+	slow->peer = NULL;
+	// long idle timeout - device must be woken up by timers and queued events
+	slow->setTimeout (USEC_SEC * 10);
+	fast->setTimeout (USEC_SEC * 10);
+}
+
+void teardown_multidev (void)
+{
+	md->stopThreads ();
+}
+
+START_TEST(threaded)
+{
+	md->setThreaded (true);
+	slow->startTimer ();
+	fast->startTimer ();
+	ck_assert_int_eq (md->startThreads (), 0);
+	usleep (USEC_SEC);
+	md->stopThreads ();
+
+	// fast device is not delayed by slow one
+	ck_assert (fast->ticks > 25);
+	ck_assert (fast->maxLateness < 0.05);
+	ck_assert (fast->minLateness >= 0);
+	ck_assert (slow->minLateness >= 0);
+	ck_assert (slow->ticks >= 3);
+	ck_assert (slow->ticks <= 6);
+	ck_assert (fast->overlapped > 0);
+}
+END_TEST
+
+START_TEST(exclusive)
+{
+	md->setThreaded (true, true);
+	slow->startTimer ();
+	fast->startTimer ();
+	ck_assert_int_eq (md->startThreads (), 0);
+	usleep (USEC_SEC);
+	md->stopThreads ();
+
+	// devices take turns, but timers of both are served
+	ck_assert_int_eq (slow->overlapped + fast->overlapped, 0);
+	ck_assert (slow->ticks >= 3);
+	ck_assert (fast->ticks >= 3);
+	ck_assert (fast->maxLateness < 0.3);
+}
+END_TEST
+
+START_TEST(queued_event)
+{
+	md->setThreaded (true);
+	// only slow device has timer, fast one waits with 10 seconds timeout
+	slow->peer = fast;
+	slow->startTimer ();
+	ck_assert_int_eq (md->startThreads (), 0);
+	usleep (USEC_SEC);
+	md->stopThreads ();
+
+	ck_assert (slow->ticks >= 3);
+	// ping sent just before threads were stopped might not be delivered
+	ck_assert (fast->pings >= slow->ticks - 1);
+	ck_assert (fast->maxPingLatency < 0.05);
+	ck_assert_int_eq (fast->ticks, 0);
+}
+END_TEST
+
+START_TEST(single_loop)
+{
+	md->setThreaded (false);
+	fast->startTimer ();
+	// single loop returns for the device timer, not after its 10 seconds timeout
+	double t = getNow ();
+	while (getNow () - t < 0.2)
+		md->runLoop (10);
+	ck_assert (getNow () - t < 1);
+	ck_assert (fast->ticks >= 5);
+}
+END_TEST
+
+Suite * multidev_suite (void)
+{
+	Suite *s;
+	TCase *tc_multidev;
+
+	s = suite_create ("MultiDev");
+	tc_multidev = tcase_create ("Devices in threads");
+
+	tcase_add_checked_fixture (tc_multidev, setup_multidev, teardown_multidev);
+	tcase_add_test (tc_multidev, threaded);
+	tcase_add_test (tc_multidev, exclusive);
+	tcase_add_test (tc_multidev, queued_event);
+	tcase_add_test (tc_multidev, single_loop);
+	suite_add_tcase (s, tc_multidev);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	// devices are created once, as the first application is used for logging
+	md = new rts2core::MultiDev ();
+	slow = new TestDevice ("SLOW", 0.2);
+	fast = new TestDevice ("FAST", 0);
+	md->push_back (slow);
+	md->push_back (fast);
+
+	s = multidev_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	delete md;
+	delete fast;
+	delete slow;
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,108 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "nameindex.h"
+
+rts2core::NameIndex <int> *idx = NULL;
+
+int vals[1000];
+
+void setup_nameindex (void)
+{
+	idx = new rts2core::NameIndex <int> ();
+}
+
+void teardown_nameindex (void)
+{
+	delete idx;
+}
+
+START_TEST(lookup)
+{
+	ck_assert (idx->find ("exposure") == NULL);
+
+	idx->insert ("exposure", &vals[0]);
+	idx->insert ("CCD_TEMP", &vals[1]);
+
+	ck_assert_int_eq (idx->size (), 2);
+	ck_assert (idx->find ("exposure") == &vals[0]);
+	ck_assert (idx->find ("EXPOSURE") == &vals[0]);
+	ck_assert (idx->find ("ccd_temp") == &vals[1]);
+	ck_assert (idx->find ("ccd_tem") == NULL);
+	ck_assert (idx->find ("") == NULL);
+
+	// first inserted value wins
+	idx->insert ("Exposure", &vals[2]);
+	ck_assert_int_eq (idx->size (), 2);
+	ck_assert (idx->find ("exposure") == &vals[0]);
+
+	idx->remove ("EXPOSURE");
+	ck_assert_int_eq (idx->size (), 1);
+	ck_assert (idx->find ("exposure") == NULL);
+	ck_assert (idx->find ("CCD_TEMP") == &vals[1]);
+
+	idx->insert ("exposure", &vals[2]);
+	ck_assert (idx->find ("exposure") == &vals[2]);
+
+	ck_assert_int_eq (idx->getLookups (), 10);
+}
+END_TEST
+
+START_TEST(grow)
+{
+	char name[20];
+	for (int i = 0; i < 1000; i++)
+	{
+		snprintf (name, 20, "value_%d", i);
+		idx->insert (name, &vals[i]);
+	}
+	ck_assert_int_eq (idx->size (), 1000);
+
+	idx->resetCounters ();
+	for (int i = 0; i < 1000; i++)
+	{
+		snprintf (name, 20, "VALUE_%d", i);
+		ck_assert (idx->find (name) == &vals[i]);
+	}
+	ck_assert_int_eq (idx->getLookups (), 1000);
+	// names are compared only on hash match
+	ck_assert_int_eq (idx->getCompares (), 1000);
+
+	idx->clear ();
+	ck_assert_int_eq (idx->size (), 0);
+	ck_assert (idx->find ("value_1") == NULL);
+}
+END_TEST
+
+Suite * nameindex_suite (void)
+{
+	Suite *s;
+	TCase *tc_nameindex;
+
+	s = suite_create ("NameIndex");
+	tc_nameindex = tcase_create ("NameIndex tests");
+
+	tcase_add_checked_fixture (tc_nameindex, setup_nameindex, teardown_nameindex);
+	tcase_add_test (tc_nameindex, lookup);
+	tcase_add_test (tc_nameindex, grow);
+	suite_add_tcase (s, tc_nameindex);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = nameindex_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,196 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+
+#include "pixelstats.h"
+#include "imghdr.h"
+
+#define NPIX  100003
+
+rts2camd::PixelStatistics *pixelstats = NULL;
+
+void setup_pixelstats (void)
+{
+	pixelstats = new rts2camd::PixelStatistics ();
+	srandom (1);
+}
+
+void teardown_pixelstats (void)
+{
+	delete pixelstats;
+}
+
+// compare with straightforward calculation
+template <typename t> void check_type (int dataType, double scale, bool mode, bool async)
+{
+	t *data = new t[NPIX];
+	int counts[65536];
+	memset (counts, 0, sizeof (counts));
+	for (int i = 0; i < NPIX; i++)
+		// peaked distribution, so mode is well defined
+		data[i] = (t) (((random () % 1000) - (random () % 1000)) * scale);
+	// every 20th pixel has the same value, so mode of wide types is well defined
+	t planted = (t) (123 * scale);
+	for (int i = 0; i < NPIX; i += 20)
+		data[i] = planted;
+
+	long double sum = 0, sumSq = 0;
+	double mi = INFINITY, ma = -INFINITY;
+	for (int i = 0; i < NPIX; i++)
+	{
+		sum += data[i];
+		sumSq += (long double) data[i] * data[i];
+		if (data[i] < mi)
+			mi = data[i];
+		if (data[i] > ma)
+			ma = data[i];
+		if (sizeof (t) <= 2)
+			counts[(t) -1 < 0 ? (int) data[i] + 32768 : (int) data[i]]++;
+	}
+
+	rts2camd::ChunkStatistics cs;
+	pixelstats->reset ();
+	if (async)
+	{
+		pixelstats->start ((char *) data, NPIX * sizeof (t), dataType, mode);
+		ck_assert_int_eq (pixelstats->wait (cs), 0);
+	}
+	else
+	{
+		ck_assert_int_eq (pixelstats->calculate ((char *) data, NPIX * sizeof (t), dataType, mode, cs), 0);
+	}
+
+	ck_assert_int_eq (cs.pixels, NPIX);
+	ck_assert_dbl_eq (cs.sum, sum, fabsl (sum) * 1e-12 + 1e-6);
+	ck_assert_dbl_eq (cs.sumSq, sumSq, sumSq * 1e-12);
+	ck_assert_dbl_eq (cs.min, mi, 1e-9);
+	ck_assert_dbl_eq (cs.max, ma, 1e-9);
+
+	if (mode && sizeof (t) <= 2)
+	{
+		int m = 0;
+		for (int i = 1; i < 65536; i++)
+			if (counts[i] > counts[m])
+				m = i;
+		double mv = (t) -1 < 0 ? m - 32768 : m;
+		ck_assert (pixelstats->hasMode ());
+		ck_assert_dbl_eq (pixelstats->getMode (), mv, 1e-9);
+	}
+	else if (mode)
+	{
+		ck_assert (pixelstats->hasMode ());
+		ck_assert_dbl_eq (pixelstats->getMode (), planted, pixelstats->getBinnedHistogram ()->getBinWidth ());
+	}
+	else
+	{
+		ck_assert (!pixelstats->hasMode ());
+	}
+
+	delete[] data;
+}
+
+START_TEST(types)
+{
+	for (int async = 0; async < 2; async++)
+	{
+		check_type <uint8_t> (RTS2_DATA_BYTE, 0.1, true, async);
+		check_type <int8_t> (RTS2_DATA_SBYTE, 0.05, true, async);
+		check_type <int16_t> (RTS2_DATA_SHORT, 30, true, async);
+		check_type <uint16_t> (RTS2_DATA_USHORT, 60, true, async);
+		check_type <uint16_t> (RTS2_DATA_USHORT, 60, false, async);
+		check_type <int32_t> (RTS2_DATA_LONG, 1000, true, async);
+		check_type <uint32_t> (RTS2_DATA_ULONG, 1000, true, async);
+		check_type <int64_t> (RTS2_DATA_LONGLONG, 1000, true, async);
+		check_type <float> (RTS2_DATA_FLOAT, 0.33, true, async);
+		check_type <double> (RTS2_DATA_DOUBLE, 0.33, true, async);
+	}
+}
+END_TEST
+
+START_TEST(extremes)
+{
+	// squares of extreme values overflow signed 32 bit sums
+	int16_t s16[1000];
+	uint16_t u16[1000];
+	for (int i = 0; i < 1000; i++)
+	{
+		s16[i] = i % 2 ? -32768 : 32767;
+		u16[i] = i % 3 ? 65535 : 0;
+	}
+
+	rts2camd::ChunkStatistics cs;
+	pixelstats->reset ();
+	pixelstats->calculate ((char *) s16, sizeof (s16), RTS2_DATA_SHORT, true, cs);
+	ck_assert_dbl_eq (cs.sum, 500.0 * -32768 + 500.0 * 32767, 1e-6);
+	ck_assert_dbl_eq (cs.sumSq, 500.0 * 32768 * 32768 + 500.0 * 32767 * 32767, 1e-3);
+	ck_assert_dbl_eq (cs.min, -32768, 1e-9);
+	ck_assert_dbl_eq (cs.max, 32767, 1e-9);
+	ck_assert_dbl_eq (pixelstats->getMode (), -32768, 1e-9);
+
+	pixelstats->reset ();
+	pixelstats->calculate ((char *) u16, sizeof (u16), RTS2_DATA_USHORT, true, cs);
+	ck_assert_dbl_eq (cs.sum, 666.0 * 65535, 1e-6);
+	ck_assert_dbl_eq (cs.sumSq, 666.0 * 65535 * 65535, 1e-3);
+	ck_assert_dbl_eq (cs.min, 0, 1e-9);
+	ck_assert_dbl_eq (cs.max, 65535, 1e-9);
+	ck_assert_dbl_eq (pixelstats->getMode (), 65535, 1e-9);
+}
+END_TEST
+
+START_TEST(chunks)
+{
+	// mode of data split into chunks must be the same as of the whole image
+	uint16_t data[20000];
+	for (int i = 0; i < 20000; i++)
+		data[i] = i < 10000 ? 100 + i % 7 : 200 + i % 5;
+
+	rts2camd::ChunkStatistics cs;
+	pixelstats->reset ();
+	pixelstats->calculate ((char *) data, 10000 * 2, RTS2_DATA_USHORT, true, cs);
+	ck_assert_dbl_eq (pixelstats->getMode (), 100, 1e-9);
+	pixelstats->calculate ((char *) (data + 10000), 10000 * 2, RTS2_DATA_USHORT, true, cs);
+	ck_assert_dbl_eq (pixelstats->getMode (), 200, 1e-9);
+	ck_assert_dbl_eq (cs.min, 200, 1e-9);
+	ck_assert_dbl_eq (cs.max, 204, 1e-9);
+
+	pixelstats->reset ();
+	ck_assert (!pixelstats->hasMode ());
+	pixelstats->calculate ((char *) data, 3 * 2, RTS2_DATA_USHORT, true, cs);
+	ck_assert_dbl_eq (pixelstats->getMode (), 100, 1e-9);
+	ck_assert_dbl_eq (cs.sum, 303, 1e-9);
+
+	ck_assert_int_eq (pixelstats->calculate ((char *) data, 10, 12345, true, cs), -1);
+}
+END_TEST
+
+Suite * pixelstats_suite (void)
+{
+	Suite *s;
+	TCase *tc_pixelstats;
+
+	s = suite_create ("PixelStatistics");
+	tc_pixelstats = tcase_create ("PixelStatistics tests");
+
+	tcase_add_checked_fixture (tc_pixelstats, setup_pixelstats, teardown_pixelstats);
+	tcase_add_test (tc_pixelstats, types);
+	tcase_add_test (tc_pixelstats, extremes);
+	tcase_add_test (tc_pixelstats, chunks);
+	suite_add_tcase (s, tc_pixelstats);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = pixelstats_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,316 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "redisconn.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// exit code of skipped test
+#define SKIP    77
+
+/**
+ * Block with redis connections, driven by its main loop.
+ */
+class TestBlock:public rts2core::Block
+{
+	public:
+		TestBlock (int argc, char **argv):rts2core::Block (argc, argv) {}
+
+		virtual int run () { return 0; }
+
+		void loop (int n)
+		{
+			for (int i = 0; i < n; i++)
+				oneRunLoop ();
+		}
+
+		std::vector <RedisConn *> redis;
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+
+		virtual void addPollSocks ()
+		{
+			rts2core::Block::addPollSocks ();
+			for (std::vector <RedisConn *>::iterator iter = redis.begin (); iter != redis.end (); iter++)
+				(*iter)->addPollSocks ();
+		}
+
+		virtual void pollSuccess ()
+		{
+			rts2core::Block::pollSuccess ();
+			for (std::vector <RedisConn *>::iterator iter = redis.begin (); iter != redis.end (); iter++)
+				(*iter)->pollSuccess ();
+		}
+
+		virtual int idle ()
+		{
+			for (std::vector <RedisConn *>::iterator iter = redis.begin (); iter != redis.end (); iter++)
+				(*iter)->idle ();
+			return rts2core::Block::idle ();
+		}
+};
+
+/**
+ * Replies received by callback.
+ */
+struct Replies
+{
+	std::vector <std::string> str;
+	std::vector <long long> integer;
+	// number of NULL replies (command cancelled by disconnect)
+	int cancelled;
+};
+
+static void replyCallback (redisAsyncContext *ac, void *r, void *privdata)
+{
+	Replies *replies = (Replies *) privdata;
+	redisReply *reply = (redisReply *) r;
+	if (reply == NULL)
+	{
+		replies->cancelled++;
+		return;
+	}
+	switch (reply->type)
+	{
+		case REDIS_REPLY_STATUS:
+		case REDIS_REPLY_STRING:
+			replies->str.push_back (std::string (reply->str, reply->len));
+			break;
+		case REDIS_REPLY_INTEGER:
+			replies->integer.push_back (reply->integer);
+			break;
+		case REDIS_REPLY_ARRAY:
+			// subscription messages - store last element
+			if (reply->elements == 3 && reply->element[2]->type == REDIS_REPLY_STRING)
+				replies->str.push_back (std::string (reply->element[2]->str, reply->element[2]->len));
+			else if (reply->elements == 3 && reply->element[2]->type == REDIS_REPLY_INTEGER)
+				replies->integer.push_back (reply->element[2]->integer);
+			break;
+	}
+}
+
+static char *test_argv[] = {(char *) "check_redis", NULL};
+
+TestBlock *block = NULL;
+RedisConn *conn = NULL;
+
+int port;
+pid_t server = -1;
+
+/**
+ * Start redis server on test port, wait until it accepts connections.
+ *
+ * @return 0 on success, -1 if server cannot be started
+ */
+static int startServer ()
+{
+	char ports[20];
+	snprintf (ports, sizeof (ports), "%d", port);
+	server = fork ();
+	if (server == 0)
+	{
+		int null = open ("/dev/null", O_WRONLY);
+		dup2 (null, 1);
+		execlp (getenv ("REDIS_SERVER") ? getenv ("REDIS_SERVER") : "redis-server", "redis-server", "--port", ports, "--bind", "127.0.0.1", "--save", "", "--appendonly", "no", (char *) NULL);
+		_exit (SKIP);
+	}
+	if (server < 0)
+		return -1;
+
+	struct sockaddr_in addr;
+	memset (&addr, 0, sizeof (addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons (port);
+	addr.sin_addr.s_addr = inet_addr ("127.0.0.1");
+	for (int i = 0; i < 500; i++)
+	{
+		int status;
+		if (waitpid (server, &status, WNOHANG) == server)
+		{
+			server = -1;
+			return -1;
+		}
+		int s = socket (AF_INET, SOCK_STREAM, 0);
+		int ret = connect (s, (struct sockaddr *) &addr, sizeof (addr));
+		close (s);
+		if (ret == 0)
+			return 0;
+		usleep (10000);
+	}
+	return -1;
+}
+
+static void stopServer ()
+{
+	if (server > 0)
+	{
+		kill (server, SIGKILL);
+		waitpid (server, NULL, 0);
+		server = -1;
+	}
+}
+
+/**
+ * Run main loop until condition is met, at most for 5 seconds.
+ */
+#define LOOP_UNTIL(cond) { for (double _end = getNow () + 5; !(cond) && getNow () < _end;) block->loop (1); }
+
+void setup_redis (void)
+{
+	ck_assert_int_eq (startServer (), 0);
+	conn = new RedisConn (block);
+	conn->setServer ("127.0.0.1", port);
+	conn->setReconnectInterval (0.2);
+	block->redis.push_back (conn);
+	conn->connect ();
+}
+
+void teardown_redis (void)
+{
+	for (std::vector <RedisConn *>::iterator iter = block->redis.begin (); iter != block->redis.end (); iter++)
+		delete *iter;
+	block->redis.clear ();
+	conn = NULL;
+	stopServer ();
+}
+
+START_TEST(set_publish)
+{
+	Replies replies;
+	replies.cancelled = 0;
+	Replies messages;
+	messages.cancelled = 0;
+
+	RedisConn *sub = new RedisConn (block);
+	sub->setServer ("127.0.0.1", port);
+	block->redis.push_back (sub);
+	sub->connect ();
+	const char *subscribe[] = {"SUBSCRIBE", "rts2check"};
+	ck_assert_int_eq (sub->command (2, subscribe, replyCallback, &messages), 0);
+	// subscription confirmation with number of subscribed channels
+	LOOP_UNTIL (messages.integer.size () == 1);
+	ck_assert_int_eq (messages.integer.size (), 1);
+
+	// commands are queued before connection is established and pipelined
+	const char *set[] = {"SET", "rts2:check", "42"};
+	ck_assert_int_eq (conn->command (3, set, replyCallback, &replies), 0);
+	const char *incr[] = {"INCR", "rts2:counter"};
+	for (int i = 0; i < 100; i++)
+		ck_assert_int_eq (conn->command (2, incr), 0);
+	const char *pub[] = {"PUBLISH", "rts2check", "value test"};
+	ck_assert_int_eq (conn->command (3, pub, replyCallback, &replies), 0);
+	const char *get[] = {"GET", "rts2:check"};
+	ck_assert_int_eq (conn->command (2, get, replyCallback, &replies), 0);
+	const char *getc[] = {"GET", "rts2:counter"};
+	ck_assert_int_eq (conn->command (2, getc, replyCallback, &replies), 0);
+
+	LOOP_UNTIL (replies.str.size () == 3 && messages.str.size () == 1);
+	ck_assert (conn->isConnected ());
+	ck_assert_int_eq (replies.str.size (), 3);
+	ck_assert_str_eq (replies.str[0].c_str (), "OK");
+	ck_assert_str_eq (replies.str[1].c_str (), "42");
+	ck_assert_str_eq (replies.str[2].c_str (), "100");
+	// one subscriber received the message
+	ck_assert_int_eq (replies.integer.size (), 1);
+	ck_assert_int_eq (replies.integer[0], 1);
+	ck_assert_int_eq (messages.str.size (), 1);
+	ck_assert_str_eq (messages.str[0].c_str (), "value test");
+
+	// messages will not be used after the test
+	block->redis.pop_back ();
+	delete sub;
+}
+END_TEST
+
+START_TEST(reconnect)
+{
+	Replies replies;
+	replies.cancelled = 0;
+
+	LOOP_UNTIL (conn->isConnected ());
+	ck_assert (conn->isConnected ());
+
+	stopServer ();
+	const char *set[] = {"SET", "rts2:check", "1"};
+	conn->command (3, set, replyCallback, &replies);
+	LOOP_UNTIL (!conn->isOpen ());
+	// loss of connection is detected, command is cancelled
+	ck_assert (!conn->isOpen ());
+	ck_assert_int_eq (replies.cancelled, 1);
+	ck_assert_int_eq (conn->command (3, set), -1);
+
+	// failed reconnection attempts
+	block->loop (20);
+	ck_assert (!conn->isConnected ());
+
+	ck_assert_int_eq (startServer (), 0);
+	LOOP_UNTIL (conn->isConnected ());
+	ck_assert (conn->isConnected ());
+
+	const char *set2[] = {"SET", "rts2:check", "2"};
+	ck_assert_int_eq (conn->command (3, set2, replyCallback, &replies), 0);
+	LOOP_UNTIL (replies.str.size () == 1);
+	ck_assert_int_eq (replies.str.size (), 1);
+	ck_assert_str_eq (replies.str[0].c_str (), "OK");
+}
+END_TEST
+
+Suite * redis_suite (void)
+{
+	Suite *s;
+	TCase *tc_redis;
+
+	s = suite_create ("Redis");
+	tc_redis = tcase_create ("Asynchronous redis connection");
+
+	tcase_add_checked_fixture (tc_redis, setup_redis, teardown_redis);
+	tcase_add_test (tc_redis, set_publish);
+	tcase_add_test (tc_redis, reconnect);
+	suite_add_tcase (s, tc_redis);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	signal (SIGPIPE, SIG_IGN);
+
+	port = 16379 + getpid () % 1000;
+	// skip if redis server is not available
+	if (startServer ())
+	{
+		std::cout << "cannot start redis-server, skipping redis check" << std::endl;
+		return SKIP;
+	}
+	stopServer ();
+
+	// logging needs the first application, so single block is used for all tests
+	block = new TestBlock (1, test_argv);
+	block->setTimeout (USEC_SEC / 100);
+
+	s = redis_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	delete block;
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -11,15 +11,25 @@
 #include <check.h>
 #include <check_utils.h>
 
+// catalogues are written to temporary directory, so source tree is not polluted
+char outdir[] = "/tmp/check_sep_XXXXXX";
+char framout[sizeof (outdir) + 20];
+char imageout[sizeof (outdir) + 20];
+
 void setup_sep (void)
 {
-	unlink ("data/fram.out");
-	unlink ("data/image.out");
+	strcpy (outdir, "/tmp/check_sep_XXXXXX");
+	ck_assert (mkdtemp (outdir) != NULL);
+	snprintf (framout, sizeof (framout), "%s/fram.out", outdir);
+	snprintf (imageout, sizeof (imageout), "%s/image.out", outdir);
 }
 
 
 void teardown_sep (void)
 {
+	unlink (framout);
+	unlink (imageout);
+	rmdir (outdir);
 }
 
 
@@ -426,13 +436,211 @@ check_image(const char *in, const char *out, sep_catalog **catalog)
 START_TEST(SEP1)
 {
 	sep_catalog *catalog;
-	check_image ("data/fram.fits", "data/fram.out", &catalog);
-	check_image ("data/image.fits", "data/image.out", &catalog);
+	check_image ("data/fram.fits", framout, &catalog);
+	check_image ("data/image.fits", imageout, &catalog);
 
 	ck_assert_int_eq (catalog->nobj, 65);
 }
 END_TEST
 
+/* tiled extraction must give the same catalogue as extraction of whole image */
+START_TEST(SEP_TILED)
+{
+	int i, nx, ny, status;
+	float *data;
+	float conv[] = { 1, 2, 1, 2, 4, 2, 1, 2, 1 };
+	sep_bkg *bkg = NULL;
+	sep_catalog *whole = NULL, *tiled = NULL;
+	sep_image im;
+
+	ck_assert_int_eq (read_test_image ("data/image.fits", &data, &nx, &ny), 0);
+
+	im =
+	{
+		data, NULL, NULL, SEP_TFLOAT, 0, 0, nx, ny, 0.0, SEP_NOISE_NONE, 1.0, 0.0
+	};
+	sep_set_threads (3);
+	ck_assert_int_eq (sep_background (&im, 64, 64, 3, 3, 0.0, &bkg), 0);
+	ck_assert_int_eq (sep_bkg_subarray (bkg, im.data, im.dtype), 0);
+
+	status = sep_extract (&im, 1.5 * bkg->globalrms, SEP_THRESH_ABS, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &whole);
+	ck_assert_int_eq (status, 0);
+	status = sep_extract_tiled (&im, 1.5 * bkg->globalrms, SEP_THRESH_ABS, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 7, &tiled);
+	ck_assert_int_eq (status, 0);
+	sep_set_threads (1);
+
+	ck_assert_int_eq (tiled->nobj, whole->nobj);
+	for (i = 0; i < whole->nobj; i++)
+	{
+		ck_assert_int_eq (tiled->npix[i], whole->npix[i]);
+		ck_assert_int_eq (tiled->flag[i], whole->flag[i]);
+		ck_assert_dbl_eq (tiled->x[i], whole->x[i], 1e-6);
+		ck_assert_dbl_eq (tiled->y[i], whole->y[i], 1e-6);
+		ck_assert_dbl_eq (tiled->flux[i], whole->flux[i], 1e-4 * fabs (whole->flux[i]));
+	}
+
+	sep_catalog_free (whole);
+	sep_catalog_free (tiled);
+	sep_bkg_free (bkg);
+	free (data);
+}
+END_TEST
+
+/* image streamed in chunks gives the same catalogue as extraction of its
+ * background-subtracted image, and about the same as full frame background */
+START_TEST(SEP_STREAM)
+{
+	int i, nx, ny, status;
+	size_t off, size, chunk;
+	float *data, *rms;
+	float conv[] = { 1, 2, 1, 2, 4, 2, 1, 2, 1 };
+	sep_bkg *bkg = NULL;
+	sep_stream *stream = NULL;
+	sep_catalog *streamed = NULL, *whole = NULL, *batch = NULL;
+	sep_image im;
+
+	ck_assert_int_eq (read_test_image ("data/image.fits", &data, &nx, &ny), 0);
+
+	sep_set_threads (2);
+	status = sep_stream_new (nx, ny, SEP_TFLOAT, 64, 64, 3, 3, 0.0, 1.5, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 1, &stream);
+	ck_assert_int_eq (status, 0);
+	// chunks do not end on pixel boundaries
+	size = nx * ny * sizeof (float);
+	for (off = 0, chunk = 1001; off < size; off += chunk, chunk = chunk * 3 % 7919)
+	{
+		if (chunk > size - off)
+			chunk = size - off;
+		ck_assert_int_eq (sep_stream_add (stream, (char *) data + off, chunk), 0);
+	}
+	ck_assert_int_eq (sep_stream_finish (stream, &streamed), 0);
+
+	status = sep_extract (sep_stream_image (stream), 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &whole);
+	ck_assert_int_eq (status, 0);
+
+	ck_assert_int_eq (streamed->nobj, whole->nobj);
+	for (i = 0; i < whole->nobj; i++)
+	{
+		ck_assert_int_eq (streamed->npix[i], whole->npix[i]);
+		ck_assert_int_eq (streamed->flag[i], whole->flag[i]);
+		ck_assert_dbl_eq (streamed->x[i], whole->x[i], 1e-6);
+		ck_assert_dbl_eq (streamed->y[i], whole->y[i], 1e-6);
+	}
+
+	// background from the full frame
+	rms = (float *) malloc (nx * ny * sizeof (float));
+	im =
+	{
+		data, rms, NULL, SEP_TFLOAT, SEP_TFLOAT, 0, nx, ny, 0.0, SEP_NOISE_STDDEV, 0.0, 0.0
+	};
+	ck_assert_int_eq (sep_background (&im, 64, 64, 3, 3, 0.0, &bkg), 0);
+	ck_assert_dbl_eq (sep_stream_bkg (stream)->globalrms, bkg->globalrms, 1e-3);
+	ck_assert_int_eq (sep_bkg_subarray (bkg, im.data, im.dtype), 0);
+	ck_assert_int_eq (sep_bkg_rmsarray (bkg, rms, SEP_TFLOAT), 0);
+	status = sep_extract (&im, 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &batch);
+	ck_assert_int_eq (status, 0);
+	ck_assert_int_le (abs (batch->nobj - streamed->nobj), 2);
+
+	sep_stream_free (stream);
+
+	// incomplete image
+	status = sep_stream_new (nx, ny, SEP_TFLOAT, 64, 64, 3, 3, 0.0, 1.5, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 1, &stream);
+	ck_assert_int_eq (status, 0);
+	ck_assert_int_eq (sep_stream_add (stream, data, size / 2), 0);
+	sep_catalog_free (streamed);
+	ck_assert_int_ne (sep_stream_finish (stream, &streamed), 0);
+	ck_assert (streamed == NULL);
+	sep_stream_free (stream);
+	sep_set_threads (1);
+
+	sep_catalog_free (whole);
+	sep_catalog_free (batch);
+	sep_bkg_free (bkg);
+	free (rms);
+	free (data);
+}
+END_TEST
+
+/* threshold of streamed image relative to global rms of the background */
+START_TEST(SEP_STREAM_GLOBALRMS)
+{
+	int i, nx, ny, status;
+	float *data, *rms;
+	float conv[] = { 1, 2, 1, 2, 4, 2, 1, 2, 1 };
+	sep_stream *stream = NULL;
+	sep_catalog *streamed = NULL, *whole = NULL;
+	sep_image *im;
+
+	ck_assert_int_eq (read_test_image ("data/image.fits", &data, &nx, &ny), 0);
+
+	status = sep_stream_new (nx, ny, SEP_TFLOAT, 64, 64, 3, 3, 0.0, 1.5, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, 0, &stream);
+	ck_assert_int_eq (status, 0);
+	for (i = 0; i < ny; i++)
+		ck_assert_int_eq (sep_stream_add (stream, data + i * nx, nx * sizeof (float)), 0);
+	ck_assert_int_eq (sep_stream_finish (stream, &streamed), 0);
+
+	// last rows are thresholded with the global rms of the whole image
+	im = sep_stream_image (stream);
+	rms = (float *) im->noise + (ny - 1) * nx;
+	for (i = 0; i < nx; i++)
+		ck_assert_dbl_eq (rms[i], sep_stream_bkg (stream)->globalrms, 1e-6);
+
+	status = sep_extract (im, 1.5, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &whole);
+	ck_assert_int_eq (status, 0);
+	ck_assert_int_eq (streamed->nobj, whole->nobj);
+	for (i = 0; i < whole->nobj; i++)
+	{
+		ck_assert_dbl_eq (streamed->x[i], whole->x[i], 1e-6);
+		ck_assert_dbl_eq (streamed->y[i], whole->y[i], 1e-6);
+	}
+
+	sep_catalog_free (streamed);
+	sep_catalog_free (whole);
+	sep_stream_free (stream);
+	free (data);
+}
+END_TEST
+
+/* signed 16-bit data give the same background as their float values */
+START_TEST(SEP_INT16)
+{
+	int i, nx, ny;
+	float *data, *fdata;
+	int16_t *sdata;
+	sep_bkg *bkg = NULL, *sbkg = NULL;
+	sep_image im, sim;
+
+	ck_assert_int_eq (read_test_image ("data/image.fits", &data, &nx, &ny), 0);
+
+	// raw values of the test image
+	sdata = (int16_t *) malloc (nx * ny * sizeof (int16_t));
+	fdata = (float *) malloc (nx * ny * sizeof (float));
+	for (i = 0; i < nx * ny; i++)
+	{
+		sdata[i] = (int16_t) lrint ((data[i] - 3713.66692596) / 2.92273835509);
+		fdata[i] = sdata[i];
+	}
+
+	im =
+	{
+		fdata, NULL, NULL, SEP_TFLOAT, 0, 0, nx, ny, 0.0, SEP_NOISE_NONE, 0.0, 0.0
+	};
+	sim =
+	{
+		sdata, NULL, NULL, SEP_TINT16, 0, 0, nx, ny, 0.0, SEP_NOISE_NONE, 0.0, 0.0
+	};
+	ck_assert_int_eq (sep_background (&im, 64, 64, 3, 3, 0.0, &bkg), 0);
+	ck_assert_int_eq (sep_background (&sim, 64, 64, 3, 3, 0.0, &sbkg), 0);
+	ck_assert_dbl_eq (sbkg->global, bkg->global, 1e-6);
+	ck_assert_dbl_eq (sbkg->globalrms, bkg->globalrms, 1e-6);
+
+	sep_bkg_free (bkg);
+	sep_bkg_free (sbkg);
+	free (sdata);
+	free (fdata);
+	free (data);
+}
+END_TEST
+
 /***************************************************************************/
 /* aperture photometry */
 
@@ -475,6 +683,10 @@ sep_suite (void)
 
 	tcase_add_checked_fixture (tc_sep, setup_sep, teardown_sep);
 	tcase_add_test (tc_sep, SEP1);
+	tcase_add_test (tc_sep, SEP_TILED);
+	tcase_add_test (tc_sep, SEP_STREAM);
+	tcase_add_test (tc_sep, SEP_STREAM_GLOBALRMS);
+	tcase_add_test (tc_sep, SEP_INT16);
 	suite_add_tcase (s, tc_sep);
 
 	return s;
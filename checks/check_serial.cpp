@@ -0,0 +1,255 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "block.h"
+#include "connection/serial.h"
+#include "serialsim.h"
+
+#include <vector>
+
+static double now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+struct TransResult
+{
+	rts2core::transStatusT status;
+	std::string reply;
+	double finished;
+};
+
+/**
+ * Transaction recording its result.
+ */
+class TestTransaction:public rts2core::SerialTransaction
+{
+	public:
+		TestTransaction (std::vector <TransResult> *_results, const char *_request, int _rlen, const char *_endChar = NULL, double _timeout = 1):rts2core::SerialTransaction (_request, strlen (_request), _rlen, _endChar, _timeout) { results = _results; }
+
+		virtual void finished (rts2core::transStatusT status, const char *rbuf, int rlen)
+		{
+			TransResult r;
+			r.status = status;
+			r.reply = std::string (rbuf, rlen);
+			r.finished = now ();
+			results->push_back (r);
+		}
+
+	protected:
+		std::vector <TransResult> *results;
+};
+
+class TestBlock:public rts2core::Block
+{
+	public:
+		TestBlock (int argc, char **argv):rts2core::Block (argc, argv) { maxLoop = 0; }
+
+		/**
+		 * Run main loop until given number of transaction results is available.
+		 */
+		void runUntil (std::vector <TransResult> *results, size_t n, double timeout)
+		{
+			double end = now () + timeout;
+			while (results->size () < n && now () < end)
+			{
+				double t = now ();
+				oneRunLoop ();
+				if (now () - t > maxLoop)
+					maxLoop = now () - t;
+			}
+		}
+
+		virtual int run () { return 0; }
+
+		// longest main loop iteration
+		double maxLoop;
+
+	protected:
+		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
+};
+
+static char *test_argv[] = {(char *) "check_serial", NULL};
+
+SerialSim *sim = NULL;
+TestBlock *block = NULL;
+rts2core::ConnSerial *conn = NULL;
+std::vector <TransResult> results;
+
+void setup_serial (void)
+{
+	sim = new SerialSim ();
+	sim->addReply (":GR#", "12:34:56#", 0.2);
+	sim->addReply ("T\r", "21.5\r\n");
+	sim->addReply ("LPS 2 1\n", std::string ("\x06LOO\0\x01", 6) + std::string (94, 'x'));
+	sim->addReply ("LONG\n", std::string (100, 'y'));
+	ck_assert_int_eq (sim->start (), 0);
+
+	block->maxLoop = 0;
+	conn = new rts2core::ConnSerial (sim->getPort (), block, rts2core::BS9600, rts2core::C8, rts2core::NONE, 10);
+	ck_assert_int_eq (conn->init (), 0);
+	block->addConnection (conn);
+	results.clear ();
+}
+
+void teardown_serial (void)
+{
+	block->removeConnection (conn);
+	delete conn;
+	delete sim;
+}
+
+START_TEST(terminator)
+{
+	sim->setSplit (true);
+	conn->queueTransaction (new TestTransaction (&results, ":GR#", 20, "#"));
+	conn->queueTransaction (new TestTransaction (&results, "T\r", 20, "\r\n"));
+	ck_assert_int_eq (conn->transactionsQueued (), 2);
+
+	double t = now ();
+	block->runUntil (&results, 2, 5);
+	ck_assert_int_eq (results.size (), 2);
+	ck_assert_int_eq (results[0].status, rts2core::TRANS_OK);
+	ck_assert_str_eq (results[0].reply.c_str (), "12:34:56");
+	ck_assert_int_eq (results[1].status, rts2core::TRANS_OK);
+	ck_assert_str_eq (results[1].reply.c_str (), "21.5");
+	ck_assert (results[0].finished - t >= 0.2);
+	ck_assert_int_eq (conn->transactionsQueued (), 0);
+
+	// main loop is not blocked while device is thinking
+	ck_assert (block->maxLoop < 0.15);
+}
+END_TEST
+
+START_TEST(fixed_length)
+{
+	sim->setSplit (true);
+	conn->queueTransaction (new TestTransaction (&results, "LPS 2 1\n", 100));
+
+	block->runUntil (&results, 1, 5);
+	ck_assert_int_eq (results.size (), 1);
+	ck_assert_int_eq (results[0].status, rts2core::TRANS_OK);
+	ck_assert_int_eq (results[0].reply.length (), 100);
+	ck_assert_int_eq (results[0].reply[0], 0x06);
+	ck_assert_int_eq (results[0].reply[4], 0);
+	ck_assert_int_eq (results[0].reply[99], 'x');
+}
+END_TEST
+
+START_TEST(timeout)
+{
+	// no reply to the first request, reply too long for the second one
+	conn->queueTransaction (new TestTransaction (&results, "NOREPLY\n", 10, "#", 0.3));
+	conn->queueTransaction (new TestTransaction (&results, "LONG\n", 50, "\n"));
+	conn->queueTransaction (new TestTransaction (&results, "T\r", 20, "\r\n"));
+
+	double t = now ();
+	block->runUntil (&results, 3, 5);
+	ck_assert_int_eq (results.size (), 3);
+	ck_assert_int_eq (results[0].status, rts2core::TRANS_TIMEOUT);
+	ck_assert (results[0].finished - t >= 0.29);
+	ck_assert (results[0].finished - t < 0.5);
+	ck_assert_int_eq (results[1].status, rts2core::TRANS_OVERFLOW);
+	ck_assert_int_eq (results[2].status, rts2core::TRANS_OK);
+	ck_assert_str_eq (results[2].reply.c_str (), "21.5");
+
+	// synchronous exchange works once queue is empty
+	char buf[20];
+	ck_assert_int_eq (conn->writeRead ("T\r", 2, buf, 20, "\r\n"), 6);
+	ck_assert_str_eq (buf, "21.5");
+}
+END_TEST
+
+START_TEST(pending)
+{
+	// connection is deleted in teardown with transaction in progress, its timeout timer must be removed
+	conn->queueTransaction (new TestTransaction (&results, "NOREPLY\n", 10, "#", 0.2));
+	conn->queueTransaction (new TestTransaction (&results, "T\r", 20, "\r\n"));
+	block->runUntil (&results, 1, 0.1);
+	ck_assert_int_eq (results.size (), 0);
+	ck_assert_int_eq (conn->transactionsQueued (), 2);
+}
+END_TEST
+
+/**
+ * Transaction which queues next transaction from its callback.
+ */
+class ChainTransaction:public TestTransaction
+{
+	public:
+		ChainTransaction (std::vector <TransResult> *_results, int _n):TestTransaction (_results, "T\r", 20, "\r\n") { n = _n; }
+
+		virtual void finished (rts2core::transStatusT status, const char *rbuf, int rlen)
+		{
+			TestTransaction::finished (status, rbuf, rlen);
+			if (n > 1)
+				conn->queueTransaction (new ChainTransaction (results, n - 1));
+		}
+
+	private:
+		int n;
+};
+
+START_TEST(chained)
+{
+	// write only transaction finishes once written
+	conn->queueTransaction (new TestTransaction (&results, "RESET\n", 0));
+	conn->queueTransaction (new ChainTransaction (&results, 3));
+
+	block->runUntil (&results, 4, 5);
+	ck_assert_int_eq (results.size (), 4);
+	ck_assert_int_eq (results[0].status, rts2core::TRANS_OK);
+	ck_assert_int_eq (results[0].reply.length (), 0);
+	for (int i = 1; i < 4; i++)
+	{
+		ck_assert_int_eq (results[i].status, rts2core::TRANS_OK);
+		ck_assert_str_eq (results[i].reply.c_str (), "21.5");
+	}
+	ck_assert_int_eq (sim->getAnswered (), 3);
+	ck_assert_int_eq (conn->transactionsQueued (), 0);
+}
+END_TEST
+
+Suite * serial_suite (void)
+{
+	Suite *s;
+	TCase *tc_serial;
+
+	s = suite_create ("Serial");
+	tc_serial = tcase_create ("Serial transactions");
+
+	tcase_add_checked_fixture (tc_serial, setup_serial, teardown_serial);
+	tcase_add_test (tc_serial, terminator);
+	tcase_add_test (tc_serial, fixed_length);
+	tcase_add_test (tc_serial, timeout);
+	tcase_add_test (tc_serial, pending);
+	tcase_add_test (tc_serial, chained);
+	suite_add_tcase (s, tc_serial);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	// logging needs the first application, so single block is used for all tests
+	block = new TestBlock (1, test_argv);
+	block->setTimeout (USEC_SEC / 10);
+
+	s = serial_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	delete block;
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
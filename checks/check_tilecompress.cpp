@@ -0,0 +1,220 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tilecompress.h"
+
+rts2core::TileCompressor *compressor = NULL;
+
+void setup_tilecompress (void)
+{
+	compressor = new rts2core::TileCompressor (4);
+	srandom (1);
+}
+
+void teardown_tilecompress (void)
+{
+	delete compressor;
+}
+
+// reads bits, most significant first
+class BitReader
+{
+	public:
+		BitReader (const unsigned char *_data, size_t _len) { data = _data; len = _len; pos = 0; }
+
+		uint32_t get (int n)
+		{
+			uint32_t ret = 0;
+			for (int i = 0; i < n; i++)
+			{
+				ck_assert (pos / 8 < len);
+				ret = (ret << 1) | ((data[pos / 8] >> (7 - pos % 8)) & 1);
+				pos++;
+			}
+			return ret;
+		}
+
+	private:
+		const unsigned char *data;
+		size_t len;
+		size_t pos;
+};
+
+// straightforward Rice decoder, following FITS tiled image convention
+template <typename t> void rice_decompress (const unsigned char *in, size_t len, t *out, size_t pixels)
+{
+	const int bbits = sizeof (t) * 8;
+	const int fsbits = bbits == 8 ? 3 : (bbits == 16 ? 4 : 5);
+	const int fsmax = bbits == 8 ? 6 : (bbits == 16 ? 14 : 25);
+	const uint32_t mask = bbits == 32 ? 0xffffffff : ((1u << bbits) - 1);
+
+	BitReader br (in, len);
+	uint32_t last = br.get (bbits);
+	for (size_t i = 0; i < pixels; i += RICE_BLOCKSIZE)
+	{
+		size_t thisblock = pixels - i < RICE_BLOCKSIZE ? pixels - i : RICE_BLOCKSIZE;
+		int fs = br.get (fsbits) - 1;
+		for (size_t j = 0; j < thisblock; j++)
+		{
+			uint32_t diff;
+			if (fs < 0)
+				diff = 0;
+			else if (fs == fsmax)
+				diff = br.get (bbits);
+			else
+			{
+				uint32_t top = 0;
+				while (br.get (1) == 0)
+					top++;
+				diff = (top << fs) | br.get (fs);
+			}
+			// undo mapping of negative differences
+			uint32_t d = (diff & 1) ? ~(diff >> 1) : (diff >> 1);
+			last = (last + d) & mask;
+			out[i + j] = (t) last;
+		}
+	}
+}
+
+template <typename t> void check_roundtrip (t *data, long width, long height, long tw, long th)
+{
+	ck_assert_int_eq (compressor->compress (data, sizeof (t), width, height, tw, th), 0);
+
+	long tileW = tw <= 0 ? width : tw;
+	long tileH = th <= 0 ? 1 : th;
+	long tilesX = (width + tileW - 1) / tileW;
+	long tilesY = (height + tileH - 1) / tileH;
+	ck_assert_int_eq (compressor->getTiles (), tilesX * tilesY);
+
+	t *dec = new t[tileW * tileH];
+	for (long ty = 0; ty < tilesY; ty++)
+	{
+		for (long tx = 0; tx < tilesX; tx++)
+		{
+			size_t tile = ty * tilesX + tx;
+			long w = (tx + 1) * tileW > width ? width - tx * tileW : tileW;
+			long h = (ty + 1) * tileH > height ? height - ty * tileH : tileH;
+			ck_assert (compressor->getTileSize (tile) > 0);
+			ck_assert (compressor->getTileSize (tile) <= rts2core::TileCompressor::riceBound (w * h, sizeof (t)));
+			rice_decompress (compressor->getTileData (tile), compressor->getTileSize (tile), dec, w * h);
+			for (long y = 0; y < h; y++)
+				ck_assert (memcmp (dec + y * w, data + (ty * tileH + y) * width + tx * tileW, w * sizeof (t)) == 0);
+		}
+	}
+	delete[] dec;
+}
+
+template <typename t> void check_type (long range)
+{
+	long width = 301, height = 77;
+	t *data = new t[width * height];
+
+	// random data with different spreads
+	for (long i = 0; i < width * height; i++)
+		data[i] = (t) (random () % range);
+	check_roundtrip (data, width, height, 0, 0);
+	check_roundtrip (data, width, height, 64, 16);
+	check_roundtrip (data, width, height, 1000, 1000);
+
+	// full range noise is stored without coding
+	for (long i = 0; i < width * height; i++)
+		data[i] = (t) random ();
+	check_roundtrip (data, width, height, 50, 7);
+
+	// constant image
+	for (long i = 0; i < width * height; i++)
+		data[i] = (t) 42;
+	check_roundtrip (data, width, height, 0, 0);
+	check_roundtrip (data, width, height, 17, 3);
+
+	// large jumps between extreme values
+	for (long i = 0; i < width * height; i++)
+		data[i] = (t) ((i % 3) ? 0 : -1);
+	check_roundtrip (data, width, height, 0, 5);
+
+	delete[] data;
+}
+
+START_TEST(roundtrip)
+{
+	check_type <uint8_t> (4);
+	check_type <uint8_t> (256);
+	check_type <int16_t> (20);
+	check_type <int16_t> (5000);
+	check_type <int32_t> (100);
+	check_type <int32_t> (10000000);
+}
+END_TEST
+
+START_TEST(ratio)
+{
+	// smooth image with small noise compress well
+	long width = 512, height = 512;
+	int16_t *data = new int16_t[width * height];
+	for (long i = 0; i < width * height; i++)
+		data[i] = 1000 + (i % width) / 4 + random () % 8;
+
+	ck_assert_int_eq (compressor->compress (data, 2, width, height, 0, 16), 0);
+	ck_assert_int_eq (compressor->getTiles (), 32);
+	ck_assert (compressor->getCompressedSize () < (size_t) (width * height * 2 / 3));
+
+	ck_assert_int_eq (compressor->compress (data, 3, width, height), -1);
+	ck_assert_int_eq (compressor->compress (data, 2, 0, height), -1);
+
+	// single pixel
+	ck_assert_int_eq (compressor->compress (data, 2, 1, 1), 0);
+	ck_assert_int_eq (compressor->getTiles (), 1);
+	int16_t px;
+	rice_decompress (compressor->getTileData (0), compressor->getTileSize (0), &px, 1);
+	ck_assert_int_eq (px, data[0]);
+
+	delete[] data;
+}
+END_TEST
+
+START_TEST(buffer)
+{
+	int16_t data[1000];
+	unsigned char out[3000];
+	for (int i = 0; i < 1000; i++)
+		data[i] = random ();
+	size_t len = rts2core::TileCompressor::riceCompress (data, 1000, out, sizeof (out));
+	ck_assert (len > 0);
+	// too small output buffer
+	ck_assert_int_eq (rts2core::TileCompressor::riceCompress (data, 1000, out, len - 1), 0);
+}
+END_TEST
+
+Suite * tilecompress_suite (void)
+{
+	Suite *s;
+	TCase *tc_tilecompress;
+
+	s = suite_create ("TileCompressor");
+	tc_tilecompress = tcase_create ("TileCompressor tests");
+
+	tcase_add_checked_fixture (tc_tilecompress, setup_tilecompress, teardown_tilecompress);
+	tcase_add_test (tc_tilecompress, roundtrip);
+	tcase_add_test (tc_tilecompress, ratio);
+	tcase_add_test (tc_tilecompress, buffer);
+	suite_add_tcase (s, tc_tilecompress);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = tilecompress_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,314 @@
+#include <check.h>
+#include <check_utils.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <map>
+
+#include "timerwheel.h"
+
+#define T0  1500000000.0
+
+rts2core::TimerWheel *wheel = NULL;
+
+void setup_timerwheel (void)
+{
+	wheel = new rts2core::TimerWheel ();
+}
+
+void teardown_timerwheel (void)
+{
+	delete wheel;
+}
+
+START_TEST(ordering)
+{
+	double when;
+
+	ck_assert (wheel->empty ());
+	ck_assert (isnan (wheel->nextDeadline ()));
+
+	wheel->add (T0 + 3, new rts2core::Event (3));
+	wheel->add (T0 + 1, new rts2core::Event (1));
+	wheel->add (T0 + 2, new rts2core::Event (2));
+	wheel->add (T0 + 0.5, new rts2core::Event (5));
+
+	ck_assert_int_eq (wheel->size (), 4);
+	ck_assert_dbl_eq (wheel->nextDeadline (), T0 + 0.5, 1e-6);
+
+	wheel->startExpire ();
+	ck_assert (wheel->popExpired (T0, &when) == NULL);
+
+	rts2core::Event *ev = wheel->popExpired (T0 + 2.5, &when);
+	ck_assert (ev != NULL);
+	ck_assert_int_eq (ev->getType (), 5);
+	ck_assert_dbl_eq (when, T0 + 0.5, 1e-6);
+	delete ev;
+
+	ev = wheel->popExpired (T0 + 2.5, &when);
+	ck_assert_int_eq (ev->getType (), 1);
+	delete ev;
+
+	ev = wheel->popExpired (T0 + 2.5, &when);
+	ck_assert_int_eq (ev->getType (), 2);
+	delete ev;
+
+	ck_assert (wheel->popExpired (T0 + 2.5, &when) == NULL);
+	ck_assert_dbl_eq (wheel->nextDeadline (), T0 + 3, 1e-6);
+	ck_assert_int_eq (wheel->size (), 1);
+}
+END_TEST
+
+START_TEST(remove_type)
+{
+	double when;
+
+	for (int i = 0; i < 10; i++)
+		wheel->add (T0 + i, new rts2core::Event (i % 2 ? 1 : 2));
+
+	ck_assert_int_eq (wheel->remove (2), 5);
+	ck_assert_int_eq (wheel->remove (2), 0);
+	ck_assert_int_eq (wheel->remove (3), 0);
+	ck_assert_int_eq (wheel->size (), 5);
+	ck_assert_dbl_eq (wheel->nextDeadline (), T0 + 1, 1e-6);
+
+	wheel->startExpire ();
+	int n = 0;
+	rts2core::Event *ev;
+	while ((ev = wheel->popExpired (T0 + 20, &when)) != NULL)
+	{
+		ck_assert_int_eq (ev->getType (), 1);
+		ck_assert_dbl_eq (when, T0 + 2 * n + 1, 1e-6);
+		delete ev;
+		n++;
+	}
+	ck_assert_int_eq (n, 5);
+	ck_assert (wheel->empty ());
+}
+END_TEST
+
+START_TEST(remove_arg)
+{
+	double when;
+	int a, b;
+
+	for (int i = 0; i < 10; i++)
+		wheel->add (T0 + i, new rts2core::Event (1, i % 2 ? &a : &b));
+	wheel->add (T0 + 0.5, new rts2core::Event (2, &a));
+
+	ck_assert_int_eq (wheel->remove (1, &a), 5);
+	ck_assert_int_eq (wheel->remove (1, &a), 0);
+	ck_assert_int_eq (wheel->size (), 6);
+
+	// timers of other type with the same argument are kept
+	wheel->startExpire ();
+	int n = 0;
+	rts2core::Event *ev;
+	while ((ev = wheel->popExpired (T0 + 20, &when)) != NULL)
+	{
+		if (ev->getType () == 2)
+		{
+			ck_assert (ev->getArg () == &a);
+			ck_assert_dbl_eq (when, T0 + 0.5, 1e-6);
+		}
+		else
+		{
+			ck_assert (ev->getArg () == &b);
+			ck_assert_dbl_eq (when, T0 + 2 * n, 1e-6);
+			n++;
+		}
+		delete ev;
+	}
+	ck_assert_int_eq (n, 5);
+	ck_assert (wheel->empty ());
+}
+END_TEST
+
+START_TEST(cascade)
+{
+	double when;
+
+	// timers spread over all levels of the wheel
+	double offsets[] = {0.0005, 0.2, 1.5, 70, 3600, 86400, 40 * 86400, 200 * 86400};
+	int n = sizeof (offsets) / sizeof (offsets[0]);
+	for (int i = n - 1; i >= 0; i--)
+		wheel->add (T0 + offsets[i], new rts2core::Event (i));
+
+	wheel->startExpire ();
+	// walk time in irregular steps, check timers expire in order and not before their time
+	double now = T0;
+	int expected = 0;
+	while (expected < n)
+	{
+		ck_assert_dbl_eq (wheel->nextDeadline (), T0 + offsets[expected], 1e-6);
+		rts2core::Event *ev = wheel->popExpired (now, &when);
+		if (ev)
+		{
+			ck_assert_int_eq (ev->getType (), expected);
+			ck_assert (when <= now);
+			ck_assert_dbl_eq (when, T0 + offsets[expected], 1e-6);
+			delete ev;
+			expected++;
+		}
+		else
+		{
+			ck_assert (now < T0 + offsets[expected]);
+			double step = (T0 + offsets[expected] - now) / 3;
+			now += step < 0.0001 ? 0.0001 : step;
+		}
+	}
+	ck_assert (wheel->empty ());
+	ck_assert (isnan (wheel->nextDeadline ()));
+}
+END_TEST
+
+START_TEST(expire_guard)
+{
+	double when;
+
+	wheel->add (T0, new rts2core::Event (1));
+	wheel->startExpire ();
+
+	rts2core::Event *ev = wheel->popExpired (T0 + 1, &when);
+	ck_assert (ev != NULL);
+	// timer added during expiry processing is not returned in the same pass
+	wheel->add (T0 + 0.5, ev);
+	ck_assert (wheel->popExpired (T0 + 1, &when) == NULL);
+	ck_assert_int_eq (wheel->size (), 1);
+
+	wheel->startExpire ();
+	ev = wheel->popExpired (T0 + 1, &when);
+	ck_assert (ev != NULL);
+	ck_assert_dbl_eq (when, T0 + 0.5, 1e-6);
+	delete ev;
+}
+END_TEST
+
+START_TEST(random_reference)
+{
+	// compare wheel with reference multimap in random sequence of operations
+	std::multimap <double, int> ref;
+	double when;
+	double now = T0;
+	srandom (42);
+
+	for (int i = 0; i < 20000; i++)
+	{
+		int op = random () % 10;
+		if (op < 5)
+		{
+			// offsets up to few days, so timers are put to all levels
+			double offset;
+			switch (random () % 4)
+			{
+				case 0:
+					offset = (random () % 1000) / 1000.0;
+					break;
+				case 1:
+					offset = (random () % 100000) / 1000.0;
+					break;
+				case 2:
+					offset = (random () % 100000) / 10.0;
+					break;
+				default:
+					offset = (random () % 1000000) / 3.0;
+					break;
+			}
+			int type = random () % 50;
+			wheel->add (now + offset, new rts2core::Event (type));
+			ref.insert (std::pair <double, int> (now + offset, type));
+		}
+		else if (op == 5)
+		{
+			int type = random () % 50;
+			int removed = 0;
+			for (std::multimap <double, int>::iterator iter = ref.begin (); iter != ref.end ();)
+			{
+				if (iter->second == type)
+				{
+					ref.erase (iter++);
+					removed++;
+				}
+				else
+				{
+					iter++;
+				}
+			}
+			ck_assert_int_eq (wheel->remove (type), removed);
+		}
+		else
+		{
+			double block = wheel->getTick () * TIMERWHEEL_SIZE;
+			switch (random () % 4)
+			{
+				case 0:
+					now += (random () % 1000) / 10000.0;
+					break;
+				case 1:
+					now += (random () % 1000) / 10.0;
+					break;
+				case 2:
+					// last tick before block boundary, wheel stops before cascading higher levels
+					now = (floor (now / block) + 1 + random () % 4) * block - wheel->getTick () / 2;
+					break;
+				default:
+					now += random () % 20000;
+					break;
+			}
+			wheel->startExpire ();
+			rts2core::Event *ev;
+			while ((ev = wheel->popExpired (now, &when)) != NULL)
+			{
+				ck_assert (!ref.empty ());
+				ck_assert (ref.begin ()->first <= now);
+				ck_assert_dbl_eq (when, ref.begin ()->first, 1e-9);
+				ck_assert_int_eq (ev->getType (), ref.begin ()->second);
+				ref.erase (ref.begin ());
+				delete ev;
+			}
+			ck_assert (ref.empty () || ref.begin ()->first > now);
+		}
+
+		ck_assert_int_eq (wheel->size (), ref.size ());
+		if (ref.empty ())
+			ck_assert (isnan (wheel->nextDeadline ()));
+		else
+			ck_assert_dbl_eq (wheel->nextDeadline (), ref.begin ()->first, 1e-9);
+	}
+}
+END_TEST
+
+Suite * timerwheel_suite (void)
+{
+	Suite *s;
+	TCase *tc_timerwheel;
+
+	s = suite_create ("TimerWheel");
+	tc_timerwheel = tcase_create ("TimerWheel tests");
+
+	tcase_add_checked_fixture (tc_timerwheel, setup_timerwheel, teardown_timerwheel);
+	tcase_add_test (tc_timerwheel, ordering);
+	tcase_add_test (tc_timerwheel, remove_type);
+	tcase_add_test (tc_timerwheel, remove_arg);
+	tcase_add_test (tc_timerwheel, cascade);
+	tcase_add_test (tc_timerwheel, expire_guard);
+	tcase_add_test (tc_timerwheel, random_reference);
+	suite_add_tcase (s, tc_timerwheel);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = timerwheel_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
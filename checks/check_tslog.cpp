@@ -0,0 +1,199 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "tslog.h"
+
+#define T0  1500000000.0
+
+static char path[] = "/tmp/check_tslogXXXXXX";
+
+void setup_tslog (void)
+{
+	int fd = mkstemp (path);
+	close (fd);
+	unlink (path);
+}
+
+void teardown_tslog (void)
+{
+	unlink (path);
+	strcpy (path + strlen (path) - 6, "XXXXXX");
+}
+
+// regularly sampled temperature with some noise and gaps
+static void fill_samples (std::vector <double> &t, std::vector <double> &v, size_t n)
+{
+	srandom (1);
+	double tt = T0;
+	for (size_t i = 0; i < n; i++)
+	{
+		tt += (i % 500 == 499) ? 3600 : 10;
+		t.push_back (tt + (random () % 1000) / 1e6);
+		v.push_back (i % 97 == 0 ? NAN : round ((15 + 5 * sin (i / 200.0) + (random () % 100) / 1000.0) * 100) / 100);
+	}
+}
+
+START_TEST(encode_decode)
+{
+	std::vector <double> t, v, dt, dv;
+	fill_samples (t, v, TSLOG_BLOCK_SAMPLES);
+
+	std::vector <unsigned char> out;
+	size_t len = rts2core::TimeseriesWriter::encodeBlock (&(t[0]), &(v[0]), t.size (), out);
+	ck_assert_int_eq (len, out.size ());
+	// noisy decimal values do not compress much, but should be still below 16 bytes of raw data
+	ck_assert (len < t.size () * 12);
+
+	// constant value sampled at constant rate
+	std::vector <double> ct, cv;
+	for (size_t i = 0; i < TSLOG_BLOCK_SAMPLES; i++)
+	{
+		ct.push_back (T0 + i * 10);
+		cv.push_back (i < TSLOG_BLOCK_SAMPLES / 2 ? 1 : 0);
+	}
+	std::vector <unsigned char> cout;
+	ck_assert (rts2core::TimeseriesWriter::encodeBlock (&(ct[0]), &(cv[0]), ct.size (), cout) < TSLOG_BLOCK_HEADER + 2 * TSLOG_BLOCK_SAMPLES + 32);
+
+	ck_assert_int_eq (rts2core::TimeseriesReader::decodeBlock (&(out[TSLOG_BLOCK_HEADER]), len - TSLOG_BLOCK_HEADER, t.size (), dt, dv), 0);
+	ck_assert_int_eq (dt.size (), t.size ());
+	for (size_t i = 0; i < t.size (); i++)
+	{
+		ck_assert_dbl_eq (dt[i], t[i], 1e-6);
+		if (isnan (v[i]))
+			ck_assert (isnan (dv[i]));
+		else
+			ck_assert (dv[i] == v[i]);
+	}
+
+	// corrupted data must not be accepted
+	dt.clear ();
+	dv.clear ();
+	ck_assert_int_eq (rts2core::TimeseriesReader::decodeBlock (&(out[TSLOG_BLOCK_HEADER]), len - TSLOG_BLOCK_HEADER - 1, t.size (), dt, dv), -1);
+	ck_assert_int_eq (dt.size (), 0);
+}
+END_TEST
+
+START_TEST(write_scan)
+{
+	std::vector <double> t, v;
+	fill_samples (t, v, 5000);
+
+	rts2core::TimeseriesWriter writer;
+	ck_assert_int_eq (writer.open (path, "C0.CCD_TEMP", 4), 0);
+	for (size_t i = 0; i < t.size (); i++)
+		ck_assert_int_eq (writer.add (t[i], v[i]), 0);
+	writer.close ();
+
+	rts2core::TimeseriesReader reader;
+	ck_assert_int_eq (reader.open (path), 0);
+	ck_assert_str_eq (reader.getName ().c_str (), "C0.CCD_TEMP");
+	ck_assert_int_eq (reader.getType (), 4);
+	ck_assert_int_eq (reader.getSamples (), t.size ());
+
+	// blocks are split by the flush interval on gaps
+	const std::vector <rts2core::TimeseriesBlock> &blocks = reader.getBlocks ();
+	ck_assert (blocks.size () > t.size () / TSLOG_BLOCK_SAMPLES);
+	for (size_t i = 0; i < blocks.size (); i++)
+	{
+		ck_assert (blocks[i].count <= TSLOG_BLOCK_SAMPLES);
+		ck_assert (blocks[i].tmin <= blocks[i].tmax);
+		ck_assert (blocks[i].vmin <= blocks[i].vmax);
+	}
+
+	double from = t[1234] - 1e-7;
+	double to = t[3456] + 1e-7;
+	std::vector <double> st, sv;
+	ck_assert_int_eq (reader.scan (from, to, st, sv), 3456 - 1234 + 1);
+	for (size_t i = 0; i < st.size (); i++)
+	{
+		ck_assert_dbl_eq (st[i], t[1234 + i], 1e-6);
+		if (!isnan (v[1234 + i]))
+			ck_assert (sv[i] == v[1234 + i]);
+	}
+
+	st.clear ();
+	sv.clear ();
+	ck_assert_int_eq (reader.scan (T0 - 100, T0, st, sv), 0);
+}
+END_TEST
+
+START_TEST(append_truncated)
+{
+	rts2core::TimeseriesWriter writer;
+	ck_assert_int_eq (writer.open (path, "T0.DOME_TEMP"), 0);
+	for (int i = 0; i < 100; i++)
+		writer.add (T0 + i, i);
+	writer.close ();
+
+	struct stat st;
+	ck_assert_int_eq (stat (path, &st), 0);
+	off_t size1 = st.st_size;
+
+	// second block, then cut it in half - as when writer crashes
+	ck_assert_int_eq (writer.open (path, "ignored"), 0);
+	for (int i = 100; i < 200; i++)
+		writer.add (T0 + i, i);
+	writer.close ();
+	ck_assert_int_eq (stat (path, &st), 0);
+	ck_assert_int_eq (truncate (path, size1 + (st.st_size - size1) / 2), 0);
+
+	rts2core::TimeseriesReader reader;
+	ck_assert_int_eq (reader.open (path), 0);
+	ck_assert_int_eq (reader.getBlocks ().size (), 1);
+	ck_assert_int_eq (reader.getSamples (), 100);
+
+	// reopen removes partial block
+	ck_assert_int_eq (writer.open (path, "ignored"), 0);
+	ck_assert_int_eq (stat (path, &st), 0);
+	ck_assert_int_eq (st.st_size, size1);
+	for (int i = 200; i < 250; i++)
+		writer.add (T0 + i, i);
+	writer.flush ();
+
+	ck_assert_int_eq (reader.refresh (), 0);
+	ck_assert_str_eq (reader.getName ().c_str (), "T0.DOME_TEMP");
+	ck_assert_int_eq (reader.getBlocks ().size (), 2);
+	ck_assert_int_eq (reader.getSamples (), 150);
+
+	std::vector <double> t, v;
+	ck_assert_int_eq (reader.readBlock (1, t, v), 0);
+	ck_assert_dbl_eq (t[0], T0 + 200, 1e-6);
+	ck_assert_dbl_eq (v[49], 249, 1e-10);
+}
+END_TEST
+
+Suite * tslog_suite (void)
+{
+	Suite *s;
+	TCase *tc_tslog;
+
+	s = suite_create ("TSLog");
+	tc_tslog = tcase_create ("Time-series store tests");
+
+	tcase_add_checked_fixture (tc_tslog, setup_tslog, teardown_tslog);
+	tcase_add_test (tc_tslog, encode_decode);
+	tcase_add_test (tc_tslog, write_scan);
+	tcase_add_test (tc_tslog, append_truncated);
+	suite_add_tcase (s, tc_tslog);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = tslog_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
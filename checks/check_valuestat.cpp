@@ -0,0 +1,201 @@
+#include <check.h>
+#include <check_utils.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <algorithm>
+#include <deque>
+
+#include "valuestat.h"
+
+#define T0  1500000000.0
+
+rts2core::ValueDoubleStat *stat = NULL;
+rts2core::ValueDoubleTimeserie *timeserie = NULL;
+
+void setup_valuestat (void)
+{
+	stat = new rts2core::ValueDoubleStat ("stat", "test statistics", false);
+	timeserie = new rts2core::ValueDoubleTimeserie ("timeserie", "test timeserie", false);
+}
+
+void teardown_valuestat (void)
+{
+	delete stat;
+	delete timeserie;
+}
+
+static double median (std::deque <double> sorted)
+{
+	std::sort (sorted.begin (), sorted.end ());
+	size_t n = sorted.size ();
+	if (n % 2)
+		return sorted[n / 2];
+	return (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+}
+
+// statistics calculated directly from samples
+static void check_stat (const std::deque <double> &v)
+{
+	double sum = 0;
+	for (size_t i = 0; i < v.size (); i++)
+		sum += v[i];
+	double mean = sum / v.size ();
+	double var = 0;
+	for (size_t i = 0; i < v.size (); i++)
+		var += (v[i] - mean) * (v[i] - mean);
+
+	stat->calculate ();
+	ck_assert_int_eq (stat->getNumMes (), v.size ());
+	ck_assert_dbl_eq (stat->getValueDouble (), mean, 1e-9);
+	ck_assert_dbl_eq (stat->getStdev (), sqrt (var / v.size ()), 1e-9);
+	ck_assert_dbl_eq (stat->getMode (), median (v), 1e-12);
+	ck_assert_dbl_eq (stat->getMin (), *std::min_element (v.begin (), v.end ()), 1e-12);
+	ck_assert_dbl_eq (stat->getMax (), *std::max_element (v.begin (), v.end ()), 1e-12);
+}
+
+START_TEST(stat_window)
+{
+	std::deque <double> v;
+	srandom (1);
+	for (int i = 0; i < 5000; i++)
+	{
+		// some duplicate values
+		double val = (random () % 1000) / 10.0 - 30;
+		stat->addValue (val, 200);
+		if (v.size () >= 200)
+			v.pop_front ();
+		v.push_back (val);
+		if (i % 97 == 0 || i < 10)
+			check_stat (v);
+	}
+	check_stat (v);
+
+	stat->clearStat ();
+	v.clear ();
+	stat->addValue (2);
+	stat->addValue (4);
+	v.push_back (2);
+	v.push_back (4);
+	check_stat (v);
+}
+END_TEST
+
+START_TEST(stat_nan)
+{
+	// NaN samples are ignored, count matches samples behind statistics
+	std::deque <double> v;
+	stat->addValue (1, 3);
+	stat->addValue (NAN, 3);
+	stat->addValue (3, 3);
+	v.push_back (1);
+	v.push_back (3);
+	check_stat (v);
+
+	// window holds three valid samples
+	stat->addValue (5, 3);
+	stat->addValue (NAN);
+	stat->addValue (7, 3);
+	v.pop_front ();
+	v.push_back (5);
+	v.push_back (7);
+	check_stat (v);
+
+	timeserie->addValue (1, T0, 3);
+	timeserie->addValue (NAN, T0 + 1, 3);
+	timeserie->addValue (2, NAN, 3);
+	timeserie->addValue (3, T0 + 2, 3);
+	timeserie->calculate ();
+	ck_assert_int_eq (timeserie->getNumMes (), 2);
+	ck_assert_dbl_eq (timeserie->getValueDouble (), 2, 1e-12);
+	ck_assert_dbl_eq (timeserie->getMode (), 2, 1e-12);
+	ck_assert_dbl_eq (timeserie->getBeta (), 1, 1e-12);
+}
+END_TEST
+
+START_TEST(timeserie_window)
+{
+	std::deque <std::pair <double, double> > v;
+	srandom (2);
+	for (int i = 0; i < 3000; i++)
+	{
+		double t = T0 + i * 0.25;
+		double val = 10 + 0.01 * i + (random () % 1000) / 1000.0;
+		timeserie->addValue (val, t, 500);
+		if (v.size () >= 500)
+			v.pop_front ();
+		v.push_back (std::pair <double, double> (val, t));
+
+		// regression of single sample is NaN
+		if (i == 0 || (i % 131 != 0 && i != 2999))
+			continue;
+
+		// previous two pass calculation
+		size_t n = v.size ();
+		double sum = 0, sum2 = 0;
+		std::deque <double> vals;
+		for (size_t j = 0; j < n; j++)
+		{
+			sum += v[j].first;
+			sum2 += v[j].second;
+			vals.push_back (v[j].first);
+		}
+		double mean = sum / n;
+		sum2 /= n;
+		double stdev = 0, alpha = 0, alpha2 = 0, sx = 0;
+		for (size_t j = 0; j < n; j++)
+		{
+			stdev += (v[j].first - mean) * (v[j].first - mean);
+			double x = v[j].second - sum2;
+			sx += x;
+			alpha += x * v[j].first;
+			alpha2 += x * x;
+		}
+		stdev = sqrt (stdev / n);
+		double beta = (alpha - sx * sum / n) / (alpha2 - sx * sx / n);
+		alpha = (sum - beta * alpha) / n;
+
+		timeserie->calculate ();
+		ck_assert_int_eq (timeserie->getNumMes (), n);
+		ck_assert_dbl_eq (timeserie->getValueDouble (), mean, 1e-9);
+		ck_assert_dbl_eq (timeserie->getStdev (), stdev, 1e-9);
+		ck_assert_dbl_eq (timeserie->getBeta (), beta, 1e-9);
+		ck_assert_dbl_eq (timeserie->getAlpha (), alpha, 1e-6);
+		ck_assert_dbl_eq (timeserie->getMode (), median (vals), 1e-12);
+		ck_assert_dbl_eq (timeserie->getMin (), *std::min_element (vals.begin (), vals.end ()), 1e-12);
+		ck_assert_dbl_eq (timeserie->getMax (), *std::max_element (vals.begin (), vals.end ()), 1e-12);
+	}
+}
+END_TEST
+
+Suite * valuestat_suite (void)
+{
+	Suite *s;
+	TCase *tc_valuestat;
+
+	s = suite_create ("ValueStat");
+	tc_valuestat = tcase_create ("Streaming statistics tests");
+
+	tcase_add_checked_fixture (tc_valuestat, setup_valuestat, teardown_valuestat);
+	tcase_add_test (tc_valuestat, stat_window);
+	tcase_add_test (tc_valuestat, stat_nan);
+	tcase_add_test (tc_valuestat, timeserie_window);
+	suite_add_tcase (s, tc_valuestat);
+
+	return s;
+}
+
+int main (void)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = valuestat_suite ();
+	sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -16,6 +16,8 @@ class GemTest:public rts2teld::GEM
 		void test_getHrzFromEqu (struct ln_equ_posn *pos, double JD, struct ln_hrz_posn *hrz) { return getHrzFromEqu (pos, JD, hrz); };
 		void test_getEquFromHrz (struct ln_hrz_posn *hrz, double JD, struct ln_equ_posn *pos) { return getEquFromHrz (hrz, JD, pos); };
 
+		int test_checkTrajectory (double JD, int32_t ac, int32_t dc, int32_t &at, int32_t &dt, int32_t as, int32_t ds, unsigned int steps, double alt_margin, double az_margin, bool ignore_soft_beginning, bool dont_flip) { return checkTrajectory (JD, ac, dc, at, dt, as, ds, steps, alt_margin, az_margin, ignore_soft_beginning, dont_flip); }
+
 		void test_applyRefraction (struct ln_equ_posn *pos, double JD, bool writeValue) { return applyRefraction (pos, JD, writeValue); };
 		/**
 		 * Test movement to given target position, from counts in ac dc parameters.
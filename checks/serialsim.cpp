@@ -0,0 +1,174 @@
+/*
+ * Serial device simulator on pseudo terminal.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "serialsim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+SerialSim::SerialSim ()
+{
+	master = -1;
+	split = false;
+	running = false;
+	answered = 0;
+	pthread_mutex_init (&lock, NULL);
+}
+
+SerialSim::~SerialSim ()
+{
+	stop ();
+	pthread_mutex_destroy (&lock);
+}
+
+void SerialSim::addReply (const std::string &request, const std::string &reply, double delay)
+{
+	Reply r;
+	r.request = request;
+	r.reply = reply;
+	r.delay = delay;
+	replies.push_back (r);
+}
+
+int SerialSim::start ()
+{
+	master = posix_openpt (O_RDWR | O_NOCTTY);
+	if (master < 0)
+		return -1;
+	if (grantpt (master) || unlockpt (master) || ptsname (master) == NULL)
+	{
+		close (master);
+		master = -1;
+		return -1;
+	}
+	port = ptsname (master);
+
+	// raw mode, so replies are not modified on the way to the driver
+	struct termios t;
+	if (tcgetattr (master, &t) == 0)
+	{
+		cfmakeraw (&t);
+		tcsetattr (master, TCSANOW, &t);
+	}
+
+	running = true;
+	if (pthread_create (&thread, NULL, simThread, this))
+	{
+		running = false;
+		close (master);
+		master = -1;
+		return -1;
+	}
+	return 0;
+}
+
+void SerialSim::stop ()
+{
+	if (running)
+	{
+		pthread_mutex_lock (&lock);
+		running = false;
+		pthread_mutex_unlock (&lock);
+		pthread_join (thread, NULL);
+	}
+	if (master >= 0)
+	{
+		close (master);
+		master = -1;
+	}
+}
+
+int SerialSim::getAnswered ()
+{
+	pthread_mutex_lock (&lock);
+	int ret = answered;
+	pthread_mutex_unlock (&lock);
+	return ret;
+}
+
+void *SerialSim::simThread (void *arg)
+{
+	((SerialSim *) arg)->run ();
+	return NULL;
+}
+
+void SerialSim::run ()
+{
+	std::string received;
+	while (true)
+	{
+		pthread_mutex_lock (&lock);
+		bool r = running;
+		pthread_mutex_unlock (&lock);
+		if (!r)
+			break;
+
+		struct pollfd pfd;
+		pfd.fd = master;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll (&pfd, 1, 20) <= 0 || !(pfd.revents & POLLIN))
+			continue;
+
+		char buf[200];
+		int ret = read (master, buf, sizeof (buf));
+		if (ret <= 0)
+		{
+			// slave side is not opened
+			if (ret < 0 && errno == EIO)
+				usleep (10000);
+			continue;
+		}
+		received.append (buf, ret);
+
+		for (std::vector <Reply>::iterator iter = replies.begin (); iter != replies.end (); iter++)
+		{
+			if (received.length () >= iter->request.length () && received.compare (received.length () - iter->request.length (), iter->request.length (), iter->request) == 0)
+			{
+				received.clear ();
+				sendReply (*iter);
+				break;
+			}
+		}
+	}
+}
+
+void SerialSim::sendReply (const Reply &r)
+{
+	if (r.delay > 0)
+		usleep (r.delay * 1e6);
+
+	size_t first = split ? r.reply.length () / 2 : r.reply.length ();
+	if (first > 0 && write (master, r.reply.c_str (), first) != (ssize_t) first)
+		return;
+	if (first < r.reply.length ())
+	{
+		usleep (5000);
+		if (write (master, r.reply.c_str () + first, r.reply.length () - first) != (ssize_t) (r.reply.length () - first))
+			return;
+	}
+
+	pthread_mutex_lock (&lock);
+	answered++;
+	pthread_mutex_unlock (&lock);
+}
@@ -0,0 +1,98 @@
+/*
+ * Serial device simulator on pseudo terminal.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_SERIALSIM__
+#define __RTS2_SERIALSIM__
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+/**
+ * Simulated serial device. Opens pseudo terminal, whose slave side is
+ * opened by driver as serial port, and answers requests from a thread.
+ * Requests and replies are given in a table; request is answered once
+ * received data ends with it.
+ */
+class SerialSim
+{
+	public:
+		SerialSim ();
+		virtual ~SerialSim ();
+
+		/**
+		 * Add reply to the request.
+		 *
+		 * @param request  request string
+		 * @param reply    reply, can be empty if device does not reply
+		 * @param delay    delay in seconds before reply is sent
+		 */
+		void addReply (const std::string &request, const std::string &reply, double delay = 0);
+
+		/**
+		 * Send replies in two parts, separated by a few milliseconds,
+		 * to exercise reassembly of replies from several reads.
+		 */
+		void setSplit (bool _split) { split = _split; }
+
+		/**
+		 * Open pseudo terminal and start simulator thread.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int start ();
+
+		/**
+		 * Stop simulator thread and close pseudo terminal.
+		 */
+		void stop ();
+
+		/**
+		 * Returns path of the pseudo terminal slave, to open as serial port.
+		 */
+		const char *getPort () { return port.c_str (); }
+
+		/**
+		 * Returns number of answered requests.
+		 */
+		int getAnswered ();
+
+	private:
+		struct Reply
+		{
+			std::string request;
+			std::string reply;
+			double delay;
+		};
+		std::vector <Reply> replies;
+
+		int master;
+		std::string port;
+		bool split;
+
+		pthread_t thread;
+		pthread_mutex_t lock;
+		bool running;
+		int answered;
+
+		static void *simThread (void *arg);
+		void run ();
+		void sendReply (const Reply &r);
+};
+
+#endif // !__RTS2_SERIALSIM__
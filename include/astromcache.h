@@ -0,0 +1,95 @@
+/*
+ * Cache of ERFA astrometry context.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_ASTROMCACHE__
+#define __RTS2_ASTROMCACHE__
+
+#include "rts2-config.h"
+
+#ifdef RTS2_LIBERFA
+
+#include "erfa.h"
+
+// time after which astrometry context is fully recalculated (seconds)
+#define ASTROM_REFRESH    60.0
+
+namespace rts2teld
+{
+
+/**
+ * Holds astrometry context for transformation of ICRS coordinates to
+ * observed place. Building the context with eraApco13 requires Earth
+ * ephemeris, precession-nutation and refraction constants, which change
+ * slowly. The context is therefore built once and only Earth rotation
+ * angle is updated with eraAper13 for later dates. Full rebuild is done
+ * when the date moves by more than ASTROM_REFRESH seconds, or when site or
+ * weather parameters change. Error introduced by the cache (mostly from
+ * diurnal aberration) is below 0.01 arcsec.
+ */
+class AstromCache
+{
+	public:
+		AstromCache ();
+
+		/**
+		 * Returns astrometry context for the given date. Parameters are
+		 * the same as of eraApco13.
+		 *
+		 * @param astrom  returned context, valid until next call
+		 * @param eo      returned equation of origins (ERA-GST)
+		 *
+		 * @return eraApco13 status - +1 dubious year, 0 OK, -1 unacceptable date
+		 */
+		int get (double utc1, double utc2, double dut1, double elong, double phi, double hm, double phpa, double tc, double rh, double wl, eraASTROM *&astrom, double &eo);
+
+		/**
+		 * Force full rebuild on the next call.
+		 */
+		void invalidate () { valid = false; }
+
+		/**
+		 * Number of full rebuilds of the context.
+		 */
+		long getRebuilds () { return rebuilds; }
+
+	private:
+		eraASTROM cached;
+		double cachedEo;
+		int cachedStatus;
+		bool valid;
+
+		// parameters used to build the context
+		double cUtc1;
+		double cUtc2;
+		double cDut1;
+		double cElong;
+		double cPhi;
+		double cHm;
+		double cPhpa;
+		double cTc;
+		double cRh;
+		double cWl;
+
+		long rebuilds;
+};
+
+}
+
+#endif // RTS2_LIBERFA
+
+#endif // !__RTS2_ASTROMCACHE__
@@ -0,0 +1,146 @@
+/*
+ * Histogram with fixed number of bins and adaptive range.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_BINNEDHISTOGRAM__
+#define __RTS2_BINNEDHISTOGRAM__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rts2core
+{
+
+/**
+ * Histogram of pixel values with fixed number of equally wide bins, so it
+ * uses constant memory for any data type. Unless fixed range is set, range
+ * is learned from the first added data. If value outside of the range is
+ * added later, neighbouring bins are merged and the range is doubled
+ * until the value fits in. Values which cannot be put to the histogram
+ * (NaN, infinity or outside fixed range) are counted as outliers.
+ *
+ * Mode and quantiles are calculated from the histogram, so their
+ * precision is given by the bin width. For integer data, bins are
+ * aligned to integer values, with bin width of at least 1.
+ */
+class BinnedHistogram
+{
+	public:
+		/**
+		 * @param _nbins  number of bins, rounded up to even number
+		 */
+		BinnedHistogram (size_t _nbins = 4096);
+		~BinnedHistogram ();
+
+		/**
+		 * Set number of bins. Clears histogram and its range.
+		 */
+		void setBins (size_t _nbins);
+
+		size_t getBins () { return nbins; }
+
+		/**
+		 * Set fixed histogram range. Values outside of the range are
+		 * counted as outliers, range is not adapted.
+		 *
+		 * @param _low   lower boundary (included)
+		 * @param _high  upper boundary (excluded)
+		 */
+		void setRange (double _low, double _high);
+
+		/**
+		 * Clear bin counts and forget the range, so it will be learned
+		 * from the next data.
+		 */
+		void clear ();
+
+		/**
+		 * Clear bin counts for next frame. Range is set to the span of
+		 * values added since last clear (or nextFrame) call.
+		 */
+		void nextFrame ();
+
+		/**
+		 * Add data to histogram.
+		 *
+		 * @param data    data array
+		 * @param pixels  number of pixels in data
+		 */
+		template <typename t> void add (const t *data, size_t pixels);
+
+		/**
+		 * Returns count of values in given bin.
+		 */
+		uint64_t getCount (size_t bin) { return counts[bin]; }
+
+		/**
+		 * Returns number of values in histogram bins (without outliers).
+		 */
+		uint64_t getTotal () { return total; }
+
+		uint64_t getOutliers () { return outliers; }
+
+		/**
+		 * Returns lower boundary of the bin.
+		 */
+		double getBinLow (size_t bin) { return low + bin * width; }
+
+		double getBinWidth () { return width; }
+
+		/**
+		 * Returns value with the highest count - center of the bin
+		 * with the highest count, for integer data of width 1 its
+		 * value. NaN if histogram is empty.
+		 */
+		double getMode ();
+
+		/**
+		 * Returns value below which lies given fraction of the values,
+		 * interpolated inside the bin. NaN if histogram is empty.
+		 *
+		 * @param q  fraction (0-1)
+		 */
+		double getQuantile (double q);
+
+	private:
+		size_t nbins;
+		uint64_t *counts;
+		uint64_t total;
+		uint64_t outliers;
+
+		bool rangeSet;
+		bool fixedRange;
+		bool integer;
+		double low;
+		double high;
+		double width;
+
+		// span of values added since last clear
+		double seenMin;
+		double seenMax;
+
+		void learnRange (double mi, double ma);
+
+		/**
+		 * Merge bins until value fits into histogram range.
+		 */
+		void extend (double v);
+};
+
+}
+
+#endif // !__RTS2_BINNEDHISTOGRAM__
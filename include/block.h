@@ -30,10 +30,12 @@
 
 #include <string.h>
 #include <list>
+#include <map>
 #include "status.h"
 
 #include <sstream>
 #include <poll.h>
+#include <pthread.h>
 
 #include "rts2-config.h"
 
@@ -41,8 +43,13 @@
 #include <sys/inotify.h>
 #endif
 
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include "event.h"
 #include "object.h"
+#include "timerwheel.h"
 #include "connection.h"
 #include "networkaddress.h"
 #include "connuser.h"
@@ -87,6 +94,8 @@
 #define PROTO_SHARED_FULL      "J"
 /** Shared memory segment ends prematurely. @ingroup RTS2Protocol */
 #define PROTO_SHARED_KILLED    "K"
+/** Shared memory in memfd, passed over abstract Unix socket. @ingroup RTS2Protocol */
+#define PROTO_SHARED_FD        "G"
 
 
 class Rts2ClientTCPDataConn;
@@ -229,6 +238,23 @@ class Block: public App
 		 */
 		virtual void postEvent (Event * event);
 
+		/**
+		 * Queue event for posting from the block main loop. This is the
+		 * only Block method which can be called from other threads -
+		 * e.g. by other device running in threaded MultiDev. The main
+		 * loop is woken up, and event is posted in its idle call.
+		 *
+		 * @param event  event to post, will be deleted by the receiver
+		 * @param target object receiving the event, NULL to post it to the block
+		 */
+		void queEvent (Event *event, Object *target = NULL);
+
+		/**
+		 * Wake up main loop waiting for file descriptors or timeout.
+		 * Can be called from any thread.
+		 */
+		void wakeup ();
+
 		/**
 		 * Create new connection.
 		 * This function is used in descenadants to override class of connections being created.
@@ -335,6 +361,18 @@ class Block: public App
 			if (new_timeout < idle_timeout)
 				idle_timeout = new_timeout;
 		}
+
+		/**
+		 * Set maximal size of connection output queue. Connection
+		 * which queues more than half of the limit is not read until
+		 * its peer reads the data; connection which exceeds the
+		 * limit is closed.
+		 *
+		 * @param limit  output queue limit in bytes
+		 */
+		void setOutputQueueLimit (size_t limit) { outputQueueLimit = limit; }
+
+		size_t getOutputQueueLimit () { return outputQueueLimit; }
 		void oneRunLoop ();
 
 		/**
@@ -628,6 +666,8 @@ class Block: public App
 			setEndLoop (true);
 		}
 
+		virtual void forkedInstance ();
+
 		virtual int statusInfo (Connection * conn);
 
 		virtual int progress (Connection *conn, double start, double end) { return -1; }
@@ -654,7 +694,7 @@ class Block: public App
 		 */
 		void addTimer (double timer_time, Event *event)
 		{
-			timers[getNow () + timer_time] = event;
+			timers.add (getNow () + timer_time, event);
 		}
 
 		/**
@@ -662,7 +702,15 @@ class Block: public App
 		 *
 		 * @param event_type Type of event.
 		 */
-		void deleteTimers (int event_type);
+		void deleteTimers (int event_type) { timers.remove (event_type); }
+
+		/**
+		 * Remove timers with a given type and argument.
+		 *
+		 * @param event_type Type of event.
+		 * @param arg        Event argument.
+		 */
+		void deleteTimers (int event_type, void *arg) { timers.remove (event_type, arg); }
 
 		/**
 		 * Updates metainformation about given value.
@@ -682,15 +730,65 @@ class Block: public App
 		virtual void fileModified (struct inotify_event *event) {};
 
 		/**
-		 * Add entry to block pole.
+		 * Add entry to block pole. If the descriptor was already
+		 * added in the current loop, events are merged with the
+		 * already requested events.
 		 */
 		void addPollFD (int fd, short events);
 
 		/**
-		 * Returns events associated with the given descriptor.
+		 * Returns events associated with the given descriptor. The
+		 * lookup is constant time - file descriptors are indexed.
 		 */
 		short getPollEvents (int fd);
 
+		/**
+		 * Switch main loop to epoll(7) reactor. The reactor keeps
+		 * persistent interest set of file descriptors in the kernel,
+		 * only changes in requested events are propagated to it. That
+		 * saves a lot of CPU on blocks with hundreds of connections.
+		 *
+		 * @param use  true to use epoll, false to use ppoll
+		 *
+		 * @return 0 on success, -1 if epoll is not available
+		 */
+		int setUseEpoll (bool use);
+
+		/**
+		 * Returns true if the main loop is using epoll.
+		 */
+		bool getUseEpoll () { return epollfd >= 0; }
+
+		/**
+		 * Called before (or just after) polled file descriptor is
+		 * closed. The epoll reactor must be notified about closed
+		 * descriptors, as descriptor number can be reused in the same
+		 * loop for a new socket, which will not be part of kernel
+		 * interest set.
+		 *
+		 * @param fd  closed file descriptor
+		 */
+		void pollFDClosed (int fd);
+
+		/**
+		 * Called when descriptors or events polled by the connection
+		 * might have changed. The epoll reactor recomputes poll
+		 * interest of such connections before the next wait, other
+		 * connections are not visited. ppoll collects interest of all
+		 * connections in every loop, so this is no-op for it.
+		 *
+		 * @param conn  connection which poll interest changed
+		 */
+		void connectionPollChanged (Connection *conn);
+
+		/**
+		 * Remove connection descriptors from epoll interest set.
+		 * Called when connection is removed from the block or deleted.
+		 *
+		 * @param conn  removed connection
+		 */
+		void connectionPollRemoved (Connection *conn);
+
 		/**
 		 * Returns true, if some data awaits on the file descriptor.
 		 */
@@ -712,6 +810,13 @@ class Block: public App
 
 		virtual void childReturned (pid_t child_pid);
 
+		/**
+		 * Called before event of expired timer is posted.
+		 *
+		 * @param lateness  difference between current time and timer time, in seconds
+		 */
+		virtual void timerExpired (double lateness) {}
+
 		/**
 		 * Determine if the device wants to connect to recently added device; returns 0 if we won't connect, 1 if we will connect
 		 */
@@ -805,13 +910,150 @@ class Block: public App
 	private:
 		int port;
 		long int idle_timeout;	 // in usec
+		size_t outputQueueLimit; // in bytes
 
 		struct pollfd *fds;
 		nfds_t pollsize;
 		nfds_t npolls;
 
+		// index of file descriptors in fds array, -1 if descriptor is not polled
+		std::vector <int> pollIndex;
+
+		// epoll file descriptor, -1 if ppoll is used
+		int epollfd;
+
+		// pipe used to wake up main loop from other threads
+		int wakeupPipe[2];
+
+		// events queued from other threads, with their targets
+		std::list <std::pair <Object *, Event *> > queuedEvents;
+		pthread_mutex_t queuedEventsLock;
+
+		// lock held by main loop outside of poll wait, used by MultiDev to serialize devices running in threads; NULL if not used
+		pthread_mutex_t *loopLock;
+
+		/**
+		 * Post events queued from other threads.
+		 */
+		void postQueuedEvents ();
+
+		/**
+		 * Descriptor in epoll interest set. Pointer to the entry is
+		 * stored in epoll_event data, so ready descriptors are
+		 * dispatched directly to their connections.
+		 */
+		struct PollEntry
+		{
+			int fd;
+			// connection owning the descriptor, NULL for descriptors added by addPollSocks
+			Connection *conn;
+			// events requested for the descriptor
+			short events;
+			// events returned in the current loop
+			short revents;
+			// descriptor is registered in kernel interest set
+			bool registered;
+			// descriptor cannot be polled by epoll (regular file), it is always ready
+			bool nonPollable;
+		};
+
+		// epoll entries, indexed by file descriptor
+		std::vector <PollEntry *> pollEntries;
+
+		// descriptors added by addPollSocks and registered in epoll interest set
+		std::vector <int> epollFds;
+
+		// descriptors of connections registered in epoll interest set
+		std::map <Connection *, std::vector <int> > epollConnFds;
+
+		// connections which poll interest shall be recomputed before the next wait
+		std::vector <Connection *> pollChangedConns;
+
+		// connections with ready descriptors, dispatched in pollSuccess
+		std::vector <Connection *> readyConns;
+
+		// entries with events returned in the current loop
+		std::vector <PollEntry *> readyEntries;
+
+		// entries which cannot be polled by epoll
+		std::vector <PollEntry *> nonPollableEntries;
+
+		// when not NULL, addPollFD collects descriptors of single connection to it
+		std::vector <struct pollfd> *pollCollect;
+
+		/**
+		 * Clear list of polled file descriptors.
+		 */
+		void clearPollFDs ();
+
+		/**
+		 * Wait for events with epoll. Synchronize epoll interest set
+		 * with file descriptors added by addPollSocks call, wait for
+		 * events and fill revents of fds array and of connection
+		 * entries. Connections with ready descriptors are put to
+		 * readyConns.
+		 *
+		 * @param tout  wait timeout
+		 *
+		 * @return number of file descriptors with events, -1 on error
+		 */
+		int epollWait (const struct timespec *tout);
+
+		/**
+		 * Returns epoll entry for the descriptor, creates it if needed.
+		 */
+		PollEntry *getPollEntry (int fd);
+
+		/**
+		 * Register descriptor in epoll interest set, or modify its
+		 * events.
+		 *
+		 * @param entry   descriptor entry
+		 * @param events  requested poll events
+		 * @param conn    connection owning the descriptor, NULL for other descriptors
+		 */
+		void epollSet (PollEntry *entry, short events, Connection *conn);
+
+		/**
+		 * Remove descriptor from epoll interest set.
+		 */
+		void epollRemove (int fd);
+
+		/**
+		 * Recompute poll interest of the connection and update epoll
+		 * interest set accordingly.
+		 */
+		void epollConnection (Connection *conn);
+
+		/**
+		 * Recompute poll interest of connections which asked for it.
+		 */
+		void epollUpdateConnections ();
+
+		/**
+		 * Put connection to list of connections dispatched in pollSuccess.
+		 */
+		void epollReady (Connection *conn);
+
+		/**
+		 * Call receive and writable of connections with ready
+		 * descriptors, delete connections which asked for it.
+		 */
+		void epollDispatch ();
+
+		/**
+		 * Drop epoll interest set and all entries.
+		 */
+		void epollReset ();
+
+		/**
+		 * Mark connection as member of block connection lists, so
+		 * its descriptors are polled.
+		 */
+		void activateConnection (Connection *conn);
+
 		// timers - time when they should be executed, event which should be triggered
-		std::map <double, Event*> timers;
+		TimerWheel timers;
 
 		connections_t connections;
 		
@@ -820,9 +1062,6 @@ class Block: public App
 
 		connections_t centraldConns;
 
-		// entries to delete from timers map; delete will happen in idle call
-		std::vector <std::map <double, Event *>::iterator> toDelete;
-
 		// vector which holds connections which were recently added - idle loop will move them to connections
 		connections_t centraldConns_added;
 
@@ -838,12 +1077,6 @@ class Block: public App
 		 * @param err error bits to set
 		 */
 		void valueMaskError (Value *val, int32_t err);
-
-		/**
-                 *
-                 * @return true if timer entry was deleted, false if it was already found in vector to delete.
-		 */
-		bool pushToDelete (const std::map <double, Event *>::iterator &iter);
 };
 
 }
@@ -860,4 +1093,6 @@ void getMasterAddPollFD (int fd, short events);
 
 short getMasterGetEvents (int fd);
 
+void getMasterPollFDClosed (int fd);
+
 #endif							 // !__RTS2_NETBLOCK__
@@ -25,6 +25,7 @@
 
 #include "scriptdevice.h"
 #include "imghdr.h"
+#include "pixelstats.h"
 
 #define MAX_CHIPS  3
 #define MAX_DATA_RETRY 100
@@ -37,6 +38,8 @@
 
 typedef enum {CEIL = -1, ROUND, FLOOR} rounding_t;
 
+struct sep_stream;
+
 /**
  * Camera and CCD interfaces.
  */
@@ -203,6 +206,10 @@ class Camera:public rts2core::ScriptDevice
 		virtual ~ Camera (void);
 
 		virtual int deleteConnection (rts2core::Connection * conn);
+
+		virtual void addPollSocks ();
+		virtual void pollSuccess ();
+
 		/**
 		 * If chip support frame transfer.
 		 *
@@ -1006,9 +1013,14 @@ class Camera:public rts2core::ScriptDevice
 		void startExposureConnImageData () { startImageData (exposureConn); }
 
 		/**
-		 * Runs SEP on stars, find stars centers.
+		 * Runs SEP on stars, find stars centers. Publishes results
+		 * in sep_X, sep_Y and sep_fluxes. If the image was processed
+		 * during readout, only its last rows are extracted; data are
+		 * then used only if streaming failed.
+		 *
+		 * @param data  image data of camera data type
 		 */
-		void findSepStars (uint16_t *data);
+		void findSepStars (void *data);
 
 	private:
 
@@ -1040,6 +1052,10 @@ class Camera:public rts2core::ScriptDevice
 		int sharedMemNum;
 		rts2core::DataSharedWrite *sharedData;
 
+		// shared data are in memfd passed to local clients
+		bool useMemfd;
+		bool memfdHugePages;
+
 		// number of exposures camera takes
 		rts2core::ValueLong *exposureNumber;
 		// exposure number inside script
@@ -1074,8 +1090,14 @@ class Camera:public rts2core::ScriptDevice
 		rts2core::ValueDouble *sum;
 		rts2core::ValueDouble *image_mode;
 
-		uint32_t *modeCount;
-		long long unsigned int modeCountSize;
+		rts2core::ValueDouble *stdev;
+
+		// calculates chunk statistics, histogram and mode
+		PixelStatistics pixelStats;
+		rts2core::ValueBool *statThread;
+		rts2core::ValueInteger *histogramBins;
+
+		long double sumSquares;
 
 		rts2core::ValueLong *computedPix;
 
@@ -1092,6 +1114,31 @@ class Camera:public rts2core::ScriptDevice
 		rts2core::DoubleArray *sepY;
 		rts2core::DoubleArray *sepFluxes;
 
+		/**
+		 * Number of threads and image strips used by SEP.
+		 */
+		rts2core::ValueInteger *sepThreads;
+		rts2core::ValueInteger *sepTiles;
+
+		/**
+		 * Run SEP on image chunks as they are read out.
+		 */
+		rts2core::ValueBool *sepStream;
+		rts2core::ValueDouble *sepLatency;
+
+		/**
+		 * Detection threshold is relative to background rms map. When false,
+		 * global background rms is used.
+		 */
+		rts2core::ValueBool *sepRmsMap;
+
+		// SEP state of image being read out, NULL if not streaming
+		struct sep_stream *sepStreamer;
+		double sepLastData;
+
+		void startSepStream ();
+		void stopSepStream ();
+
 		/**
 		 * Center box. Statistics is not calculated and values
 		 * set to nan if the box is outside WINDOW.
@@ -1122,41 +1169,6 @@ class Camera:public rts2core::ScriptDevice
 		rts2core::ValueDouble *centerAvg;
 		rts2core::ValueDoubleStat *centerAvgStat;
 
-		// update statistics
-		template <typename t> int updateStatistics (t *data, size_t dataSize)
-		{
-			long double tSum = 0;
-			double tMin = min->getValueDouble ();
-			double tMax = max->getValueDouble ();
-			int pixNum = 0;
-			t *tData = data;
-			if (modeCountSize < (((long long unsigned int) 1) << (sizeof (t) * 8)))
-			{
-				delete[] modeCount;
-				modeCountSize = ((long long unsigned int) 1) << (sizeof (t) * 8);
-				modeCount = new uint32_t[modeCountSize];
-				memset (modeCount, 0, modeCountSize * sizeof (uint32_t));
-			}
-			while (((char *) tData) < ((char *) data) + dataSize)
-			{
-				t tD = *tData;
-				tSum += tD;
-				if (tD < tMin)
-					tMin = tD;
-				if (tD > tMax)
-				  	tMax = tD;
-				modeCount[(long) tD]++;
-				tData++;
-				pixNum++;
-			}
-			sum->setValueDouble (sum->getValueDouble () + tSum);
-			if (tMin < min->getValueDouble ())
-				min->setValueDouble (tMin);
-			if (tMax > max->getValueDouble ())
-				max->setValueDouble (tMax);
-			return pixNum;
-		}
-
 		// update center box
 		template <typename t> int updateCenter (t *data, size_t dataSize)
 		{
@@ -22,12 +22,31 @@
 
 #include "device.h"
 
+#include <libnova/ln_types.h>
+#include <string>
+#include <vector>
+
 /**
  * Abstract sensors, SensorWeather with functions to set weather state, and various other sensors.
  */
 namespace rts2catd
 {
 
+/**
+ * Star returned by catalogue search.
+ */
+struct CatStar
+{
+	std::string id;
+	double ra;
+	double dec;
+	double mag;
+	// distance from cone center in degrees, NaN for box search
+	double dist;
+};
+
+typedef std::vector <CatStar> CatStars;
+
 /**
  * Class for a catalogue. Sensor can be any device which produce some information
  * which RTS2 can use.
@@ -35,6 +54,12 @@ namespace rts2catd
  * For special devices, which are ussually to be found in an observatory,
  * please see special classes (Dome, Camera, Telescope etc..).
  *
+ * Catalogue answers cone and box searches, issued with cone and box
+ * commands. Search parameters and found stars are sent as values only to
+ * the connection which issued the command, before the command return, so
+ * clients (including JSON API cmd call) receive their own search results.
+ * Searched area is limited by max_radius and max_area values.
+ *
  * @author Petr Kubanek <petr@kubanek.net>
  */
 class Catd:public rts2core::Device
@@ -44,12 +69,73 @@ class Catd:public rts2core::Device
 		virtual ~Catd (void);
 
 	protected:
-		virtual int searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, int num) = 0;
+		virtual int commandAuthorized (rts2core::Connection * conn);
+
+		virtual int setValue (rts2core::Value * old_value, rts2core::Value * new_value);
+
+		/**
+		 * Search stars inside cone.
+		 *
+		 * @param center  cone center (degrees)
+		 * @param radius  cone radius (degrees)
+		 * @param minMag  brightest magnitude
+		 * @param maxMag  faintest magnitude
+		 * @param num     maximal (positive) number of stars, brightest stars are returned if there are more matches
+		 * @param stars   found stars
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		virtual int searchCone (struct ln_equ_posn *center, double radius, double minMag, double maxMag, int num, CatStars &stars) = 0;
+
+		/**
+		 * Search stars inside RA/Dec box. Box spans from c1 RA eastwards
+		 * to c2 RA. Default implementation searches cone around the box
+		 * and filters its result.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		virtual int searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, double minMag, double maxMag, int num, CatStars &stars);
+
+		/**
+		 * Returns area of RA/Dec box in square degrees.
+		 */
+		static double boxArea (struct ln_equ_posn *c1, struct ln_equ_posn *c2);
+
+		/**
+		 * Keep the brightest num stars.
+		 */
+		static void limitStars (CatStars &stars, int num);
 
 	private:
+		rts2core::ValueRaDec *coneCenter;
+		rts2core::ValueDouble *coneRadius;
 		rts2core::ValueRaDec *corner1;
 		rts2core::ValueRaDec *corner2;
+		rts2core::ValueDouble *magMin;
+		rts2core::ValueDouble *magMax;
+		rts2core::ValueInteger *maxStars;
+		rts2core::ValueDouble *maxRadius;
+		rts2core::ValueDouble *maxArea;
+
 		rts2core::ValueInteger *numStars;
+		rts2core::StringArray *starId;
+		rts2core::DoubleArray *starRa;
+		rts2core::DoubleArray *starDec;
+		rts2core::DoubleArray *starMag;
+		rts2core::DoubleArray *starDist;
+
+		rts2core::ValueDouble *searchDuration;
+		rts2core::ValueLong *searches;
+
+		/**
+		 * Parse optional magnitude limits and number of stars.
+		 */
+		int paramLimits (rts2core::Connection * conn, double &_minMag, double &_maxMag, int &_num);
+
+		/**
+		 * Send found stars to the connection which requested the search.
+		 */
+		void publishStars (rts2core::Connection * conn, CatStars &stars, double startTime);
 };
 
 };
@@ -41,6 +41,7 @@
 #include "message.h"
 #include "logstream.h"
 #include "valuelist.h"
+#include "nameindex.h"
 
 #define MAX_DATA    2000
 
@@ -225,7 +226,9 @@ class Connection:public Object
 		inline int isCommand (const char *cmd) { return !strcmp (cmd, getCommand ()); }
 
 		/**
-		 * Send char message to other side.
+		 * Send char message to other side. Message is appended to
+		 * connection output queue, which is flushed with single
+		 * writev call when the connection becomes writable.
 		 *
 		 * @return -1 on error, 0 on sucess
 		 */
@@ -233,6 +236,29 @@ class Connection:public Object
 		int sendMsg (std::string msg);
 		int sendMsg (std::ostringstream &_os);
 
+		/**
+		 * Write queued output to the connection socket.
+		 *
+		 * @param wait  if true, wait until all queued data are written
+		 *
+		 * @return -1 on error, otherwise number of bytes remaining in the output queue
+		 */
+		int flushOutput (bool wait = false);
+
+		/**
+		 * Notify master block that descriptors or events polled by
+		 * the connection (result of add call) might have changed.
+		 * Connections which change their poll interest outside of
+		 * receive and writable calls must call it, otherwise epoll
+		 * reactor will not notice the change.
+		 */
+		void pollChanged ();
+
+		/**
+		 * Return number of bytes waiting in output queue.
+		 */
+		size_t getOutputQueueSize () { return outLen; }
+
 		/**
 		 * Switch connection to binary connection.
 		 *
@@ -548,6 +574,7 @@ class Connection:public Object
 		virtual void masterStateChanged ();
 
 		friend class ConnError;
+		friend class Block;
 
 
 		// value management functions
@@ -772,6 +799,7 @@ class Connection:public Object
 		inline int isCommandReturn () { return (*(getCommand ()) == '+' || *(getCommand ()) == '-'); }
 
 	private:
+		char *buf_start;	 // points to start of unprocessed data
 		char *full_data_end;	 // points to end of full data
 
 		conn_type_t type;
@@ -806,10 +834,34 @@ class Connection:public Object
 
 		rts2core::DataSharedRead *sharedReadMemory;
 
+		// shared data connection waiting for memfd descriptors, and its segments
+		int pendingDataConn;
+		std::vector <int> pendingSegments;
+
+		// output ring buffer
+		char *outBuf;
+		size_t outSize;
+		size_t outStart;
+		size_t outLen;
+
+		/**
+		 * Append data to output ring buffer, growing it if needed.
+		 */
+		void outAppend (const char *data, size_t len);
+
 		std::map <int, DataAbstractWrite *> writeChannels;
 		// ID of outgoing data connection
 		int dataConn;
 
+		// connection is member of block connection lists, its descriptors are polled
+		bool pollActive;
+		// connection waits in block list of connections with changed poll interest
+		bool pollQueued;
+		// connection waits in block list of connections with ready descriptors
+		bool pollReady;
+		// socket registered in epoll interest set
+		int polledSock;
+
 		// connectionTimeout in seconds
 		int connectionTimeout;
 		conn_state_t conn_state;
@@ -845,6 +897,11 @@ class Connection:public Object
 		 */
 		ValueVector values;
 
+		/**
+		 * Index of connection values by name.
+		 */
+		NameIndex <Value> valueIndex;
+
 		/**
 		 * Time when last information was received.
 		 */
@@ -862,6 +919,24 @@ class Connection:public Object
 		 */
 		void newDataConn (int data_conn);
 
+		/**
+		 * Returns true if processing of received lines waits for memfd descriptors.
+		 */
+		bool memfdPending () { return sharedReadMemory != NULL && sharedReadMemory->getAttachSocket () >= 0; }
+
+		/**
+		 * Receive memfd descriptors, create pending shared data
+		 * connection and process lines received in the meantime.
+		 *
+		 * @return -1 on error, 0 otherwise
+		 */
+		int receiveMemfd ();
+
+		/**
+		 * Stop waiting for memfd descriptors.
+		 */
+		void cancelMemfd ();
+
 		/**
 		 * Called when some data were sucessfully received.
 		 */
@@ -64,7 +64,7 @@ class ConnFork:public ConnNoSend
 		 */
 		virtual void processLine ();
 
-		void setInput (std::string _input) { input = _input; }
+		void setInput (std::string _input) { input = _input; pollChanged (); }
 
 		virtual int add (Block *block);
 
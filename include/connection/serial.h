@@ -22,6 +22,10 @@
 
 #include "connnosend.h"
 #include <termios.h>
+#include <math.h>
+
+#include <list>
+#include <string>
 
 namespace rts2core
 {
@@ -41,6 +45,64 @@ typedef enum {C7, C8} cSizeT;
  */
 typedef enum {NONE, ODD, EVEN} parityT;
 
+/**
+ * Enum for result of serial transaction.
+ */
+typedef enum {TRANS_OK, TRANS_TIMEOUT, TRANS_ERROR, TRANS_OVERFLOW} transStatusT;
+
+/**
+ * Single request/reply exchange queued on serial port.
+ *
+ * Reply is framed either by terminator string, or by its length. Subclasses
+ * implement finished () callback, which is called from Block main loop once
+ * the reply was received, timed out or failed. Transaction is deleted by the
+ * connection after the callback returns.
+ *
+ * @see ConnSerial::queueTransaction
+ *
+ * @ingroup RTS2Block
+ */
+class SerialTransaction
+{
+	public:
+		/**
+		 * Create transaction.
+		 *
+		 * @param _wbuf     Request to write to the port.
+		 * @param _wlen     Length of the request.
+		 * @param _rlen     Reply length. If terminator is specified, maximal length of reply including terminator. 0 for requests without reply.
+		 * @param _endChar  Reply terminator, NULL for replies of fixed length.
+		 * @param _timeout  Timeout in seconds, counted from the start of request write. NAN to use connection VTIME.
+		 */
+		SerialTransaction (const char *_wbuf, int _wlen, int _rlen, const char *_endChar = NULL, double _timeout = NAN);
+		virtual ~SerialTransaction ();
+
+		/**
+		 * Called when transaction finished.
+		 *
+		 * @param status  Result of the transaction.
+		 * @param rbuf    Received reply, without terminator. It is null terminated.
+		 * @param rlen    Length of the received reply (or of data received before error or timeout).
+		 */
+		virtual void finished (transStatusT status, const char *rbuf, int rlen) = 0;
+
+	private:
+		std::string request;
+		std::string terminator;
+		char *reply;
+		int replySize;
+		double replyTimeout;
+
+		// number of bytes written and read
+		size_t written;
+		int received;
+
+		// request write started
+		bool started;
+
+		friend class ConnSerial;
+};
+
 /**
  * Serial connection class.
  *
@@ -68,6 +130,11 @@ class ConnSerial: public ConnNoSend
 		 */
 		ConnSerial (const char *_devName, rts2core::Block * _master, bSpeedT _baudSpeed = BS9600, cSizeT _cSize = C8, parityT _parity = NONE, int _vTime = 40, int _flushSleepTime = -1);
 
+		/**
+		 * Delete all queued transactions, without calling their callbacks.
+		 */
+		virtual ~ConnSerial ();
+
 		/**
 		 * Init serial port.
 		 *
@@ -205,6 +272,28 @@ class ConnSerial: public ConnNoSend
 
 		int writeRead (const char* wbuf, int wlen, char *rbuf, int rlen, const char *endChar);
 
+		/**
+		 * Queue request/reply transaction. Transactions are processed
+		 * in order from Block main loop, without blocking it - the
+		 * connection must be added to block with Block::addConnection
+		 * (and is then owned by the block). Synchronous calls
+		 * (writeRead, readPort,..) must not be used while
+		 * transactions are queued.
+		 *
+		 * @param trans  Transaction. Connection takes ownership of it.
+		 */
+		void queueTransaction (SerialTransaction *trans);
+
+		/**
+		 * Returns number of queued transactions, including the one in progress.
+		 */
+		size_t transactionsQueued () { return transactions.size (); }
+
+		virtual int add (Block *block);
+		virtual int receive (Block *block);
+		virtual int writable (Block *block);
+		virtual void postEvent (Event *event);
+
 	private:
 		struct termios s_termios;
 
@@ -239,6 +328,14 @@ class ConnSerial: public ConnNoSend
 
 		void flushError ();
 
+		std::list <SerialTransaction *> transactions;
+
+		// start transaction at queue head
+		void startTransaction ();
+		// write remaining request bytes, without blocking
+		int writeTransaction ();
+		// finish transaction at queue head, start next one
+		void finishTransaction (transStatusT status);
 };
 
 }
@@ -25,6 +25,7 @@
 #include "logstream.h"
 #include "value.h"
 #include "valuelist.h"
+#include "nameindex.h"
 #include "valuestat.h"
 #include "valueminmax.h"
 #include "valuerectangle.h"
@@ -215,6 +216,8 @@ class Daemon:public Block
 		int autosaveValues ();
 
 	protected:
+		virtual void timerExpired (double lateness);
+
 		/**
 		 * Delete all saved reference of given value.
 		 *
@@ -688,6 +691,8 @@ class Daemon:public Block
 		rts2_status_t state;
 
 		CondValueVector values;
+		// index of values by name, for getCondValue
+		NameIndex <CondValue> valueIndex;
 		// values which do not change, they are send only once at connection
 		// initialization
 		ValueVector constValues;
@@ -695,10 +700,32 @@ class Daemon:public Block
 		ValueTime *info_time;
 		ValueTime *uptime;
 
+		// statistics of timer lateness
+		ValueDoubleStat *timerLateness;
+
+		// rate of value updates broadcasted to connections
+		ValueDouble *broadcastMessages;
+		ValueDouble *broadcastBytes;
+
+		unsigned long broadcastMsgCount;
+		unsigned long broadcastByteCount;
+		double broadcastStart;
+
+		/**
+		 * Format value message once and send it to all connections.
+		 *
+		 * @param value    value which will be send
+		 * @param sendAll  if true, send to connections with getSendAll set; otherwise send to running connections
+		 */
+		void broadcastValue (Value *value, bool sendAll);
+
 		double idleInfoInterval;
 
 		bool doHupIdleLoop;
 
+		// use epoll reactor in main loop
+		bool useEpoll;
+
 		// mode related variable
 		const char *modefile;
 		IniParser *modeconf;
@@ -21,7 +21,11 @@
 #define __RTS2_DATA__
 
 #include <errno.h>
+#include <pthread.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <map>
+#include <string>
 #include <vector>
 
 // maximal number of shared clients
@@ -175,7 +179,7 @@ struct SharedDataHeader
 {
 	// number of data buffers.
 	int nseg;
-	// semaphore associated with data; it has nbuffers values, each associated with a single buffer
+	// semaphore associated with data; it has nbuffers values, each associated with a single buffer. -1 for memfd data, which use robust mutexes following the segments
 	int shared_sem;
 	// shared client IDs, segment sizes - SharedData - follows immediately this field
 };
@@ -205,11 +209,16 @@ struct SharedDataSegment
 class DataAbstractShared
 {
 	public:
-		DataAbstractShared () { data = NULL; shm_id = -1; }
-		DataAbstractShared (DataAbstractShared *d) { data = d->data; shm_id = -1; }
+		DataAbstractShared () { data = NULL; shm_id = -1; memfd = -1; dataFd = -1; memfdId = 0; mapBase = NULL; mapSize = 0; }
+		DataAbstractShared (DataAbstractShared *d) { data = d->data; shm_id = -1; memfd = -1; dataFd = -1; memfdId = d->memfdId; mapBase = NULL; mapSize = 0; }
 
 		int getShmId () { return shm_id; }
 
+		/**
+		 * Return identification (inode number) of memfd holding the control block, 0 for System V shared memory.
+		 */
+		unsigned long long getMemfdId () { return memfdId; }
+
 		/**
 		 * Remove client from reader set.
 		 */
@@ -218,12 +227,26 @@ class DataAbstractShared
 	protected:
 		struct SharedDataSegment *getSegment (int segnum) { return (struct SharedDataSegment *) (((char *) data) + sizeof (struct SharedDataHeader) + segnum * sizeof (struct SharedDataSegment)); }
 
+		// robust mutex of memfd segment
+		pthread_mutex_t *getSegmentMutex (int segnum) { return ((pthread_mutex_t *) getSegment (data->nseg)) + segnum; }
+
 		// semaphore op
 		int lockSegment (int seg);
 		int unlockSegment (int seg);
 
 		struct SharedDataHeader *data;
 		int shm_id;
+
+		// memfd descriptor of control block and its inode number
+		int memfd;
+		unsigned long long memfdId;
+
+		// memfd descriptor of image data, sealed against writes through new mappings
+		int dataFd;
+
+		// memfd mapping
+		void *mapBase;
+		size_t mapSize;
 };
 
 /**
@@ -237,7 +260,7 @@ class DataSharedRead: public DataAbstractRead, public DataAbstractShared
 		/**
 		 * Crate new DataSharedRead structure, prepare it for attach call.
 		 */
-		DataSharedRead () { data = NULL; segment = -1; activeSegment = NULL; shm_id = -1; }
+		DataSharedRead () { data = NULL; segment = -1; activeSegment = NULL; shm_id = -1; attachSock = -1; attachStart = 0; }
 
 
 		/**
@@ -246,12 +269,42 @@ class DataSharedRead: public DataAbstractRead, public DataAbstractShared
 		 * @param _data   
 		 * @param _seg
 		 */
-		DataSharedRead (DataSharedRead *_data, int _seg) { data = _data->data; segment = _seg; activeSegment = getSegment (_seg); shm_id = -1; }
+		DataSharedRead (DataSharedRead *_data, int _seg):DataAbstractShared (_data) { segment = _seg; activeSegment = getSegment (_seg); attachSock = -1; attachStart = 0; }
 
 		virtual ~DataSharedRead ();
 
 		int attach (int _shm_id);
 
+		/**
+		 * Connect to writer socket to receive memfd descriptors. The
+		 * call does not wait for the descriptors, they are received by
+		 * receiveMemfd once getAttachSocket becomes readable.
+		 *
+		 * @param sockname  abstract Unix socket name on which writer passes memfd descriptors
+		 * @param id        expected inode number of control block memfd
+		 *
+		 * @return -1 on error, 0 when connection to writer was started
+		 */
+		int attachMemfd (const char *sockname, unsigned long long id);
+
+		/**
+		 * Socket on which memfd descriptors are expected, -1 if no attach is in progress.
+		 */
+		int getAttachSocket () { return attachSock; }
+
+		/**
+		 * Returns true if writer did not pass memfd descriptors in time.
+		 */
+		bool attachExpired ();
+
+		/**
+		 * Receive memfd descriptors and map them. Control structures
+		 * are mapped read-write, image data read-only.
+		 *
+		 * @return -1 on error, 1 when descriptors were not received yet, 0 when data are mapped
+		 */
+		int receiveMemfd ();
+
 		virtual int readDataSize (Connection *conn) { return 0; }
 		virtual ssize_t addData (char *_data, ssize_t _data_size) { return -1; }
 		virtual int getData (int sock) { return -1; }
@@ -267,6 +320,13 @@ class DataSharedRead: public DataAbstractRead, public DataAbstractShared
 		// shared data segment
 		struct SharedDataSegment *activeSegment;
 		int segment;
+
+		// memfd attach in progress
+		int attachSock;
+		double attachStart;
+		std::string attachName;
+
+		void closeAttach ();
 };
 
 /**
@@ -318,12 +378,12 @@ class DataSharedWrite:public DataAbstractWrite, public DataAbstractShared
 		/**
 		 * Fill empty shared data structure. This constructor needs to be followed by create call.
 		 */
-		DataSharedWrite ():DataAbstractWrite (), DataAbstractShared () {}
+		DataSharedWrite ():DataAbstractWrite (), DataAbstractShared () { listenSock = -1; }
 
 		/**
 		 * Shallow copy from existing data connection.
 		 */
-		DataSharedWrite (DataSharedWrite *d):DataAbstractWrite (), DataAbstractShared (d) { chan2seg = d->chan2seg; }
+		DataSharedWrite (DataSharedWrite *d):DataAbstractWrite (), DataAbstractShared (d) { chan2seg = d->chan2seg; listenSock = -1; sockName = d->sockName; }
 
 		virtual ~DataSharedWrite ();
 
@@ -332,6 +392,35 @@ class DataSharedWrite:public DataAbstractWrite, public DataAbstractShared
 		 */
 		struct SharedDataHeader *create (int numseg, size_t segsize);
 
+		/**
+		 * Create shared data in memfd, which is passed to local clients
+		 * over abstract Unix socket. Segments does not need System V
+		 * shared memory limits and are freed by kernel when the last
+		 * process holding them exits. Control block and image data are
+		 * in separate memfds; image data memfd is sealed, so clients
+		 * cannot map it writable.
+		 *
+		 * @param numseg     number of segments
+		 * @param segsize    segment size
+		 * @param hugepages  back segments with huge pages
+		 */
+		struct SharedDataHeader *createMemfd (int numseg, size_t segsize, bool hugepages);
+
+		/**
+		 * Listening socket on which memfd descriptor is passed, -1 for System V shared memory.
+		 */
+		int getListenSocket () { return listenSock; }
+
+		const char *getSocketName () { return sockName.c_str (); }
+
+		/**
+		 * Accept client on listening socket, send it memfd descriptors.
+		 * Clients running under other user than the daemon are refused.
+		 *
+		 * @return -1 on error or refused client, 0 on success
+		 */
+		int acceptClient ();
+
 		virtual size_t getDataSize ();
 		virtual size_t getChannelSize (int chan) { return chan2seg[chan]->size - chan2seg[chan]->bytesSoFar; }
 		virtual void dataWritten (int chan, size_t size) { chan2seg[chan]->bytesSoFar += size; }
@@ -352,6 +441,11 @@ class DataSharedWrite:public DataAbstractWrite, public DataAbstractShared
 	private:
 		// maps channels to segments
 		std::map <int, struct SharedDataSegment *> chan2seg;
+
+		int listenSock;
+		std::string sockName;
+
+		void closeMemfd ();
 };
 
 /**
@@ -377,6 +471,16 @@ class DataChannels:public std::vector <DataAbstractRead *>
 		 */
 		void initSharedFromConnection (Connection *conn, DataSharedRead *shm);
 
+		/**
+		 * Read number of shared channels and their segments from connection.
+		 */
+		static void segmentsFromConnection (Connection *conn, std::vector <int> &segs);
+
+		/**
+		 * Initialize shared channels in given segments.
+		 */
+		void initShared (DataSharedRead *shm, std::vector <int> &segs);
+
 		/**
 		 * Read data for given channel.
 		 *
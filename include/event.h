@@ -99,6 +99,9 @@
 /** Timeout for closign sequence. */
 #define EVENT_CLOSE_TIMEOUT              27
 
+/** Timeout of serial port transaction. */
+#define EVENT_SERIAL_TIMEOUT             28
+
 // events number below that number shoudl be considered RTS2-reserved
 #define RTS2_LOCAL_EVENT         1000
 
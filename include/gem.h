@@ -143,6 +143,13 @@ class GEM: public Telescope
 		int checkMoveDEC (double JD, int32_t c_ac, int32_t &c_dc, int32_t &ac, int32_t &dc, int32_t move_d);
 
 	private:
+		/**
+		 * Convert counts to RA&Dec coordinates, using already computed local sidereal time.
+		 *
+		 * @param ls      local sidereal time (degrees)
+		 */
+		void counts2skyLst (int32_t ac, int32_t dc, double ls, double &ra, double &dec, int &flip, double &un_ra, double &un_dec);
+
 		int normalizeCountValues (int32_t ac, int32_t dc, int32_t &t_ac, int32_t &t_dc, double JD);
 
 };
@@ -23,17 +23,77 @@
 #include "device.h"
 
 #include <list>
+#include <vector>
+#include <pthread.h>
 
 namespace rts2core
 {
 
+/**
+ * List of devices running in a single process. Devices are by default
+ * served from single loop, polling file descriptors of all devices. In
+ * threaded mode, each device runs its own main loop in a separate
+ * thread, so slow I/O of one device does not delay others. Devices can
+ * then post events to each other only with Block::queEvent.
+ */
 class MultiDev: public std::list < Device* >
 {
 	public:
+		MultiDev ();
+		virtual ~MultiDev ();
+
 		void initMultidev (int debug = 0);
 		virtual int run (int debug = 0);
 		void multiLoop ();
 		void runLoop (float tmout);
+
+		/**
+		 * Run devices in threads.
+		 *
+		 * @param _threaded   if true, each device runs in its own thread
+		 * @param _exclusive  if true, only one device at time processes its events; device threads
+		 *                    only wait for I/O and timers in parallel. Use it if devices share
+		 *                    communication link or other data.
+		 */
+		void setThreaded (bool _threaded, bool _exclusive = false) { threaded = _threaded; exclusive = _exclusive; }
+
+		bool getThreaded () { return threaded; }
+
+		/**
+		 * Start device threads. Devices must be initialized.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int startThreads ();
+
+		/**
+		 * Stop and join device threads.
+		 */
+		void stopThreads ();
+
+		/**
+		 * Run devices in threads until master application loop ends.
+		 */
+		void threadLoop ();
+
+	private:
+		bool threaded;
+		bool exclusive;
+
+		std::vector <pthread_t> threads;
+		volatile bool stopping;
+
+		// held by device processing its events in exclusive mode
+		pthread_mutex_t exclusiveLock;
+
+		struct DeviceThread
+		{
+			MultiDev *md;
+			Device *dev;
+		};
+		std::vector <DeviceThread> deviceThreads;
+
+		static void *deviceThread (void *arg);
 };
 
 /**
@@ -59,12 +119,18 @@ class MultiBase:public Daemon
 
 	protected:
 		virtual int processOption (int opt);
+
+		/**
+		 * True if devices shall run in threads (--threads option).
+		 */
+		bool getThreads () { return threads; }
 		virtual bool isRunning (rts2core::Connection *conn) { return false; }
 		virtual rts2core::Connection *createClientConnection (rts2core::NetworkAddress * in_addr) { return NULL; }
 
 	private:
 		rts2core::MultiDev md;
 		const char *multi_name;
+		bool threads;
 };
 
 }
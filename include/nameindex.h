@@ -0,0 +1,186 @@
+/*
+ * Hash index of objects by case-insensitive name.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_NAMEINDEX__
+#define __RTS2_NAMEINDEX__
+
+#include <ctype.h>
+#include <stdint.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+
+// initial number of buckets, must be power of 2
+#define NAMEINDEX_BUCKETS    64
+
+namespace rts2core
+{
+
+/**
+ * Hash index of pointers by name. Names are compared case-insensitive,
+ * as Value::isValue does. Lookup and insert take constant time, so the
+ * index can replace linear search over lists with hundreds of values.
+ * The index does not own the pointers.
+ *
+ * Number of lookups and of name comparisons is recorded, so the
+ * efficiency of the index can be checked in benchmarks.
+ */
+template <class T> class NameIndex
+{
+	public:
+		NameIndex ():buckets (NAMEINDEX_BUCKETS)
+		{
+			entries = 0;
+			lookups = 0;
+			compares = 0;
+		}
+
+		/**
+		 * Add entry to the index. When entry with the same name is
+		 * already present, the old entry is kept - lookup returns
+		 * entry inserted first, as linear search from list begin does.
+		 *
+		 * @param name  name of the entry
+		 * @param ptr   pointer returned by lookup
+		 */
+		void insert (const std::string &name, T *ptr)
+		{
+			uint32_t h = hash (name.c_str ());
+			std::vector <Entry> &bucket = buckets[h & (buckets.size () - 1)];
+			for (typename std::vector <Entry>::iterator iter = bucket.begin (); iter != bucket.end (); iter++)
+			{
+				if (iter->hash == h && !strcasecmp (iter->name.c_str (), name.c_str ()))
+					return;
+			}
+			bucket.push_back (Entry (name, h, ptr));
+			entries++;
+			if (entries > 2 * buckets.size ())
+				rehash (4 * buckets.size ());
+		}
+
+		/**
+		 * Remove entry with given name.
+		 */
+		void remove (const char *name)
+		{
+			uint32_t h = hash (name);
+			std::vector <Entry> &bucket = buckets[h & (buckets.size () - 1)];
+			for (typename std::vector <Entry>::iterator iter = bucket.begin (); iter != bucket.end (); iter++)
+			{
+				if (iter->hash == h && !strcasecmp (iter->name.c_str (), name))
+				{
+					bucket.erase (iter);
+					entries--;
+					return;
+				}
+			}
+		}
+
+		/**
+		 * Find entry by name.
+		 *
+		 * @return entry pointer, NULL if entry with given name is not in the index
+		 */
+		T *find (const char *name)
+		{
+			lookups++;
+			uint32_t h = hash (name);
+			std::vector <Entry> &bucket = buckets[h & (buckets.size () - 1)];
+			for (typename std::vector <Entry>::iterator iter = bucket.begin (); iter != bucket.end (); iter++)
+			{
+				if (iter->hash != h)
+					continue;
+				compares++;
+				if (!strcasecmp (iter->name.c_str (), name))
+					return iter->ptr;
+			}
+			return NULL;
+		}
+
+		void clear ()
+		{
+			buckets.clear ();
+			buckets.resize (NAMEINDEX_BUCKETS);
+			entries = 0;
+		}
+
+		size_t size () { return entries; }
+
+		/**
+		 * Number of find calls.
+		 */
+		unsigned long getLookups () { return lookups; }
+
+		/**
+		 * Number of name comparisons performed in find calls.
+		 */
+		unsigned long getCompares () { return compares; }
+
+		void resetCounters ()
+		{
+			lookups = 0;
+			compares = 0;
+		}
+
+	private:
+		struct Entry
+		{
+			Entry (const std::string &_name, uint32_t _hash, T *_ptr):name (_name)
+			{
+				hash = _hash;
+				ptr = _ptr;
+			}
+
+			std::string name;
+			uint32_t hash;
+			T *ptr;
+		};
+
+		std::vector <std::vector <Entry> > buckets;
+		size_t entries;
+
+		unsigned long lookups;
+		unsigned long compares;
+
+		// FNV-1a of lowercase name
+		static uint32_t hash (const char *name)
+		{
+			uint32_t h = 2166136261u;
+			for (; *name; name++)
+			{
+				h ^= (unsigned char) tolower (*name);
+				h *= 16777619u;
+			}
+			return h;
+		}
+
+		void rehash (size_t newSize)
+		{
+			std::vector <std::vector <Entry> > nb (newSize);
+			for (typename std::vector <std::vector <Entry> >::iterator biter = buckets.begin (); biter != buckets.end (); biter++)
+			{
+				for (typename std::vector <Entry>::iterator iter = biter->begin (); iter != biter->end (); iter++)
+					nb[iter->hash & (newSize - 1)].push_back (*iter);
+			}
+			buckets.swap (nb);
+		}
+};
+
+}
+
+#endif // !__RTS2_NAMEINDEX__
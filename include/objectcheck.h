@@ -62,6 +62,19 @@ class ObjectCheck
 		 */
 		int is_good (const struct ln_hrz_posn *hrz, int hardness = 0);
 
+		/**
+		 * Check array of horizontal positions against horizon.
+		 *
+		 * @param alt           altitudes of positions
+		 * @param az            azimuths of positions
+		 * @param n             number of positions
+		 * @param good          filled with is_good result for each position
+		 * @param hardness      how many limits to ignore
+		 *
+		 * @return index of the first position below horizon, n if all positions are above horizon
+		 */
+		size_t is_good (const double *alt, const double *az, size_t n, char *good, int hardness = 0);
+
 		int is_good_with_margin (struct ln_hrz_posn *hrz, double alt_margin, double az_margin, int hardness = 0);
 
 		double getHorizonHeight (const struct ln_hrz_posn *hrz, int hardness);
@@ -85,6 +98,9 @@ class ObjectCheck
 
 		horizon_t horizon;
 
+		// index of the first horizon entry with azimuth above given integer degree
+		std::vector <size_t> azIndex;
+
 		int load_horizon (const char *horizon_file);
 
 		double getHorizonHeightAz (double az, horizon_t::iterator iter1, horizon_t::iterator iter2);
@@ -60,6 +60,10 @@
 
 #define OPT_DEFAULTS        1015
 
+#define OPT_EPOLL           1016
+#define OPT_OUTPUT_QUEUE    1017
+#define OPT_THREADS         1018
+
 /**
  * Start of local option number playground.
  */
@@ -0,0 +1,162 @@
+/*
+ * Pixel statistics of camera readout data.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_PIXELSTATS__
+#define __RTS2_PIXELSTATS__
+
+#include "binnedhistogram.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rts2camd
+{
+
+/**
+ * Statistics of single readout chunk.
+ */
+struct ChunkStatistics
+{
+	size_t pixels;
+	long double sum;
+	long double sumSq;
+	double min;
+	double max;
+};
+
+/**
+ * Calculates statistics (sum, sum of squares, minimum, maximum) of readout
+ * chunks. For 8 and 16 bit data, histogram is updated in the same pass and
+ * image mode is tracked incrementally - only histogram bins between chunk
+ * minimum and maximum are searched for the new mode. For wider data types,
+ * mode is calculated from BinnedHistogram with fixed number of bins.
+ *
+ * 16 bit data are processed with AVX2 or SSE2 instructions, selected at
+ * runtime by the CPU capabilities. Data are processed in blocks which fit
+ * into the CPU cache, histogram of the block is updated right after its
+ * sums were calculated.
+ *
+ * Calculation can be run on worker thread (see start and wait methods),
+ * so it overlaps with the data transfer.
+ */
+class PixelStatistics
+{
+	public:
+		PixelStatistics ();
+		~PixelStatistics ();
+
+		/**
+		 * Clear histogram and mode.
+		 */
+		void reset ();
+
+		/**
+		 * Calculate statistics of the data chunk.
+		 *
+		 * @param data      chunk data
+		 * @param dataSize  size of data in bytes
+		 * @param dataType  RTS2_DATA_xxx type of data
+		 * @param mode      if true, histogram and mode are updated
+		 * @param stats     returned chunk statistics
+		 *
+		 * @return -1 on unknown data type, 0 on success
+		 */
+		int calculate (const char *data, size_t dataSize, int dataType, bool mode, ChunkStatistics &stats);
+
+		/**
+		 * Start calculation on worker thread. Data must not be changed
+		 * until wait returns. If worker thread cannot be started,
+		 * statistics are calculated before return.
+		 */
+		void start (const char *data, size_t dataSize, int dataType, bool mode);
+
+		/**
+		 * Wait for calculation started with start.
+		 *
+		 * @return calculate return value
+		 */
+		int wait (ChunkStatistics &stats);
+
+		/**
+		 * Returns true if the mode was calculated.
+		 */
+		bool hasMode () { return modeNum > 0 || binned.getTotal () > 0; }
+
+		/**
+		 * Returns mode (most frequent pixel value) of all data
+		 * processed since last reset. For data wider than 16 bits,
+		 * mode is calculated from binned histogram.
+		 */
+		double getMode () { return modeNum > 0 ? (double) modeIdx - histogramOffset : binned.getMode (); }
+
+		/**
+		 * Set number of bins of histogram used for data wider than 16 bits.
+		 */
+		void setHistogramBins (size_t nbins) { binned.setBins (nbins); }
+
+		/**
+		 * Binned histogram of data wider than 16 bits.
+		 */
+		rts2core::BinnedHistogram *getBinnedHistogram () { return &binned; }
+
+	private:
+		uint32_t *histogram;
+		size_t histogramSize;
+		// value of pixel in the first histogram bin is -histogramOffset
+		int histogramOffset;
+
+		// mode count and histogram index
+		uint32_t modeNum;
+		uint32_t modeIdx;
+
+		// histogram for wider data types, range is adapted from the previous frame
+		rts2core::BinnedHistogram binned;
+
+		// worker thread
+		pthread_t worker;
+		bool workerRunning;
+		bool workerExit;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+
+		// pending job
+		const char *jobData;
+		size_t jobSize;
+		int jobType;
+		bool jobMode;
+		bool jobPending;
+		int jobRet;
+		ChunkStatistics jobStats;
+
+		void allocHistogram (size_t size, int offset);
+
+		/**
+		 * Search histogram bins between from and to (inclusive) for new mode.
+		 */
+		void updateMode (uint32_t from, uint32_t to);
+
+		template <typename t> void calculateGeneric (const t *data, size_t pixels, bool mode, ChunkStatistics &stats);
+		void calculate16 (const int16_t *data, size_t pixels, bool sign, bool mode, ChunkStatistics &stats);
+
+		static void *workerThread (void *arg);
+};
+
+}
+
+#endif // !__RTS2_PIXELSTATS__
@@ -128,6 +128,30 @@ class CameraMissingExcetion:public rts2core::Error
 		}
 };
 
+/**
+ * Row of targets table. Used to construct targets fetched by a single
+ * query, instead of querying database for each target. NULL values are
+ * replaced with defaults used by Target::load.
+ */
+struct TargetRow
+{
+	int tar_id;
+	char type_id;
+	std::string tar_name;
+	std::string tar_info;
+	float tar_priority;
+	float tar_bonus;
+	time_t tar_bonus_time;
+	time_t tar_next_observable;
+	bool tar_enabled;
+	int tar_telescope_mode;
+	// position and proper motion, NAN if not set
+	double tar_ra;
+	double tar_dec;
+	double tar_pm_ra;
+	double tar_pm_dec;
+};
+
 /**
  * Class for one observation target.
  *
@@ -182,6 +206,35 @@ class Target:public Rts2Target
 		// load target data from give target id
 		void loadTarget (int in_tar_id);
 
+		/**
+		 * Load target from already fetched row of targets table.
+		 * Targets which need data from other tables return false and
+		 * must be loaded with load () call.
+		 *
+		 * @param row  targets table row
+		 *
+		 * @return true if target was loaded, false if load () must be called
+		 *
+		 * @throw rts2core::Error and descendants on error
+		 */
+		virtual bool loadFromRow (const TargetRow &row);
+
+		/**
+		 * Cache script for a camera. TargetSet::loadScripts caches
+		 * scripts for the duration of an operation on the set, so
+		 * getDBScript does not query database for each target. Cache
+		 * is dropped by clearScriptCache and by load.
+		 *
+		 * @param camera_name  camera name
+		 * @param script       script, NULL to only mark scripts as cached
+		 */
+		void cacheScript (const char *camera_name, const char *script);
+
+		/**
+		 * Drop cached scripts, getDBScript will query database.
+		 */
+		void clearScriptCache () { scripts.clear (); scriptsCached = false; }
+
 		virtual int save (bool overwrite);
 		virtual int saveWithID (bool overwrite, int tar_id);
 
@@ -878,6 +931,10 @@ class Target:public Rts2Target
 
 		Labels labels;
 
+		// scripts from scripts table, indexed by camera name; used only when scriptsCached is true
+		std::map <std::string, std::string> scripts;
+		bool scriptsCached;
+
 		// which constraints were sucessfully loaded
 		int constraintsLoaded;
 
@@ -901,6 +958,7 @@ class ConstTarget:public Target
 		ConstTarget (int in_tar_id, struct ln_lnlat_posn *in_obs, double in_altitude);
 		ConstTarget (int in_tar_id, struct ln_lnlat_posn *in_obs, double in_altitude, struct ln_equ_posn *pos);
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row);
 		virtual int saveWithID (bool overwrite, int tar_id);
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 
@@ -957,6 +1015,8 @@ class FlatTarget:public ConstTarget
 		FlatTarget (int in_tar_id, struct ln_lnlat_posn *in_obs, double in_altitude);
 		virtual bool getScript (const char *deviceName, std::string & buf);
 		virtual void load ();
+		// generic flat target is replaced by the best flat field
+		virtual bool loadFromRow (const TargetRow &row) { return row.tar_id == TARGET_FLAT ? false : ConstTarget::loadFromRow (row); }
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 		virtual int considerForObserving (double JD);
 		virtual int isContinues () { return 1; }
@@ -1009,6 +1069,7 @@ class CalibrationTarget:public ConstTarget
 	public:
 		CalibrationTarget (int in_tar_id, struct ln_lnlat_posn *in_obs, double in_altitude);
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row) { return false; }
 		virtual int beforeMove ();
 		virtual int endObservation (int in_next_id);
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
@@ -1055,6 +1116,7 @@ class ModelTarget:public ConstTarget
 		ModelTarget (int in_tar_id, struct ln_lnlat_posn *in_obs, double in_altitude);
 		virtual ~ ModelTarget (void);
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row) { return false; }
 		virtual int beforeMove ();
 		virtual moveType afterSlewProcessed ();
 		virtual int endObservation (int in_next_id);
@@ -1114,6 +1176,7 @@ class TargetSwiftFOV:public Target
 		virtual ~ TargetSwiftFOV (void);
 
 		virtual void load ();	 // find Swift pointing for observation
+		virtual bool loadFromRow (const TargetRow &row) { return false; }
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 		virtual int getRST (struct ln_rst_time *rst, double JD, double horizon);
 		virtual moveType afterSlewProcessed ();
@@ -1139,6 +1202,7 @@ class TargetIntegralFOV:public Target
 		virtual ~ TargetIntegralFOV (void);
 
 		virtual void load ();	 // find Swift pointing for observation
+		virtual bool loadFromRow (const TargetRow &row) { return false; }
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 		virtual int getRST (struct ln_rst_time *rst, double JD, double horizon);
 		virtual moveType afterSlewProcessed ();
@@ -1183,6 +1247,7 @@ class TargetPlan:public Target
 		virtual ~ TargetPlan (void);
 
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row) { return false; }
 		virtual void load (double JD);
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 		virtual int getRST (struct ln_rst_time *rst, double JD, double horizon);
@@ -1226,6 +1291,16 @@ Rts2InfoValStream & operator << (Rts2InfoValStream & _os, rts2db::Target & targe
  */
 rts2db::Target *createTarget (int tar_id, struct ln_lnlat_posn *obs, double altitude);
 
+/**
+ * Construct target object of given type. Target is not loaded from the database.
+ *
+ * @param type_id     target type
+ * @param tar_id      target ID
+ * @param obs         observer position
+ * @param altitude    observator altitude
+ */
+rts2db::Target *constructTarget (char type_id, int tar_id, struct ln_lnlat_posn *obs, double altitude);
+
 /**
  * Create target by name.
  *
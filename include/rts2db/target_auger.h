@@ -45,6 +45,7 @@ class TargetAuger:public rts2db::ConstTarget
 		virtual ~ TargetAuger (void);
 
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row) { return false; }
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 
 		/**
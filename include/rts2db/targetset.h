@@ -114,7 +114,11 @@ class TargetSet:public std::map <int, Target * >
 		virtual ~TargetSet (void);
 
 		/**
-		 * Load target set from database.
+		 * Load target set from database. Targets are fetched by a
+		 * single query; only targets which need data from other
+		 * tables (GRBs, plans,..) query database for each target.
+		 * Scripts are not loaded, call loadScripts if they are needed
+		 * for all targets.
 		 *
 		 * @throw SqlError if target set cannot be loaded.
 		 */
@@ -182,6 +186,22 @@ class TargetSet:public std::map <int, Target * >
 		void setTargetBonusTime (time_t * new_time);
 		void setNextObservable (time_t * time_ch);
 		void setTargetScript (const char *device_name, const char *script);
+
+		/**
+		 * Load scripts of all targets in the set with a single query
+		 * and cache them in targets, so getScript does not query
+		 * database for each target. Cache is not refreshed when
+		 * scripts table changes, so clearScripts shall be called once
+		 * the operation on the set is finished.
+		 */
+		void loadScripts ();
+
+		/**
+		 * Drop scripts cached by loadScripts, targets will query
+		 * database for their scripts again.
+		 */
+		void clearScripts ();
+
 		void setTargetProperMotion (struct ln_equ_posn *pm);
 		void setTargetPIName (const char *pi);
 		void setTargetProgramName (const char *program);
@@ -39,6 +39,7 @@ class TLETarget:public Target
 		TLETarget (std::string _tar_info):Target () { setTargetInfo (_tar_info); }
 		TLETarget ():Target () { }
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row);
 
 		/**
 		 * Get orbit from TLE, separated with |
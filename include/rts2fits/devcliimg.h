@@ -25,6 +25,7 @@
 #include "command.h"
 
 #include "image.h"
+#include "fitswriter.h"
 #include "cameraimage.h"
 #include "valuerectangle.h"
 
@@ -68,6 +69,13 @@ class DevClientCameraImage:public rts2core::DevClientCamera
 			writeRTS2Values = write_rts2;
 		}
 
+		/**
+		 * Set writer for image data. If writer is set, images are
+		 * written to disk in background and processImage is called
+		 * after image data were written.
+		 */
+		void setFitsWriter (FitsWriter *_writer) { fitsWriter = _writer; }
+
 	protected:
 
 		/**
@@ -156,6 +164,16 @@ class DevClientCameraImage:public rts2core::DevClientCamera
 		// current image
 		CameraImage *actualImage;
 
+		FitsWriter *fitsWriter;
+
+		// images passed to fitsWriter, waiting to be processed
+		std::list <Image *> writingImages;
+
+		/**
+		 * Process image after its data were written by fitsWriter.
+		 */
+		void processWrittenImage (Image *image);
+
 		// number of exposure
 		int expNum;
 
@@ -0,0 +1,96 @@
+/*
+ * Tile compression of FITS images.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_FITSCOMPRESS__
+#define __RTS2_FITSCOMPRESS__
+
+#include <fitsio.h>
+#include <string>
+
+namespace rts2image
+{
+
+/**
+ * Settings and implementation of tile compressed image output.
+ *
+ * Compression is selected by cfitsio compression suffix at the end of
+ * the image path, e.g. %c/%f.fits[compress] or %c/%f.fits[compress H 256,256].
+ * Compression letter is R (RICE_1, default), G (GZIP_1), P (PLIO_1) or
+ * H (HCOMPRESS_1), optionally followed by tile width and height. Default
+ * tile is single image row.
+ *
+ * Integer images compressed with RICE_1 are compressed by TileCompressor,
+ * which processes tiles in parallel on all CPUs. Other algorithms and
+ * floating point images are compressed by cfitsio. Floating point images
+ * are compressed losslessly.
+ *
+ * Compressed image is stored in binary table extension. Image in primary
+ * HDU is replaced by empty primary HDU holding the image headers, so they
+ * can be read from the first HDU as before.
+ */
+class FitsCompression
+{
+	public:
+		FitsCompression ();
+
+		/**
+		 * Parse compression suffix. The suffix is removed from file name.
+		 *
+		 * @param fileName  file name, possibly with compression suffix
+		 */
+		void parse (std::string &fileName);
+
+		/**
+		 * True if output should be compressed.
+		 */
+		bool isCompressed () { return type != 0; }
+
+		/**
+		 * Suffix used to specify compression in file name.
+		 */
+		const std::string &getSuffix () { return suffix; }
+
+		/**
+		 * Copy all HDUs to output file, compressing images.
+		 *
+		 * @param in      input file
+		 * @param out     newly created output file
+		 * @param status  cfitsio status
+		 *
+		 * @return cfitsio status
+		 */
+		int copyFile (fitsfile *in, fitsfile *out, int *status);
+
+	private:
+		// cfitsio compression type, 0 for no compression
+		int type;
+		long tile[2];
+		std::string suffix;
+
+		int compressImage (fitsfile *in, fitsfile *out, int bitpix, long *naxes, bool primary, int *status);
+		int compressRice (fitsfile *in, fitsfile *out, int bitpix, long *naxes, bool primary, int *status);
+
+		/**
+		 * Copy keywords, which do not describe data structure or compression.
+		 */
+		int copyKeys (fitsfile *in, fitsfile *out, bool scaling, int *status);
+};
+
+}
+
+#endif // !__RTS2_FITSCOMPRESS__
@@ -21,6 +21,7 @@
 #include "error.h"
 #include "valuearray.h"
 #include "iniparser.h"
+#include "rts2fits/fitscompress.h"
 
 #include <fitsio.h>
 
@@ -91,6 +92,8 @@ class TableData:public std::list <ColumnData *>
 		double date;
 };
 
+class FitsWriterJob;
+
 /**
  * Class representing FITS file. This class represents FITS file. Usually you
  * will be looking for rts2image::Image class for image, or for Rts2FitsTable for
@@ -328,6 +331,13 @@ class FitsFile: public rts2core::Expander
 
 		bool isMemImage () { return memFile; }
 
+		/**
+		 * Pass FITS file handle and memory file buffers to the writer
+		 * job. The job will copy memory file to disk and close it, this
+		 * instance is closed.
+		 */
+		void detachFile (FitsWriterJob *job);
+
 	private:
 		/**
 		 * Pointer to fits file.
@@ -340,6 +350,9 @@ class FitsFile: public rts2core::Expander
 		bool memFile;
 		bool memOverwrite;
 
+		// output compression, parsed from file name
+		FitsCompression compression;
+
 		size_t *memsize;
 		void **imgbuf;
 };
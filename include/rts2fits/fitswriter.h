@@ -0,0 +1,191 @@
+/*
+ * Background writer of FITS image data.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_FITSWRITER__
+#define __RTS2_FITSWRITER__
+
+#include "connnosend.h"
+#include "rts2fits/fitscompress.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <fitsio.h>
+
+/**
+ * Posted to master block when image data were written to disk. Event
+ * argument is the Image which was closed.
+ */
+#define EVENT_FITS_WRITTEN            RTS2_LOCAL_EVENT + 538
+
+namespace rts2image
+{
+
+class Image;
+
+/**
+ * Pixel data waiting to be written to FITS HDU.
+ */
+struct PendingData
+{
+	// HDU number (1 is the primary HDU)
+	int hdu;
+	int dataType;
+	long pixels;
+	// buffer owned by the job and its size in bytes
+	char *data;
+	size_t size;
+	// keys for average and standard deviation, empty if statistics should not be written
+	std::string averageKey;
+	std::string stdevKey;
+};
+
+/**
+ * Image close operation performed by FitsWriter. Holds FITS file handle
+ * with headers already written, pixel data of the image HDUs and memory
+ * file buffers. Job owns all of them, so the image can be deleted while
+ * the job is processed.
+ */
+class FitsWriterJob
+{
+	public:
+		FitsWriterJob ();
+		~FitsWriterJob ();
+
+		// image which was closed, used only to identify job in EVENT_FITS_WRITTEN
+		Image *image;
+
+		fitsfile *ffile;
+		std::string fileName;
+
+		// memory file buffers - if set, ffile is memory file which will be copied to fileName
+		void **imgbuf;
+		size_t *memsize;
+		bool overwrite;
+		// compression of the memory file copy
+		FitsCompression compression;
+
+		std::vector <PendingData> data;
+
+		// number of pixel data bytes
+		size_t bytes;
+		// time spend writing the image
+		double duration;
+		// cfitsio status, 0 on success
+		int status;
+		std::string error;
+
+		/**
+		 * Write pixel data, statistics and close the file.
+		 *
+		 * @return 0 on success, -1 on error
+		 */
+		int write ();
+};
+
+/**
+ * Pool of threads writing FITS pixel data and closing images, so disk
+ * writes do not block main loop.
+ *
+ * cfitsio file handles cannot be used from multiple threads at the same
+ * time. Image headers are therefore written from the main thread as
+ * before. When the image is closed, its FITS handle together with pixel
+ * data is passed to the pool. Each handle is used by single worker
+ * thread only, so workers do not share any cfitsio state.
+ *
+ * Completion is signalled through a pipe, which is the connection socket.
+ * The connection must be added to the master block with addConnection.
+ * When the master main loop reads the pipe, EVENT_FITS_WRITTEN is posted
+ * to the master for every finished job.
+ */
+class FitsWriter:public rts2core::ConnNoSend
+{
+	public:
+		/**
+		 * @param _master   master block
+		 * @param _threads  number of writer threads
+		 */
+		FitsWriter (rts2core::Block *_master, int _threads = 1);
+
+		/**
+		 * Waits until all queued images are written.
+		 */
+		virtual ~FitsWriter ();
+
+		/**
+		 * Create completion pipe and start writer threads.
+		 *
+		 * @return -1 on error or when cfitsio is not reentrant, 0 on success
+		 */
+		virtual int init ();
+
+		virtual int receive (rts2core::Block *block);
+
+		/**
+		 * Queue job for writing. Ownership of the job is passed to the writer.
+		 */
+		void queue (FitsWriterJob *job);
+
+		/**
+		 * Returns number of images queued or being written.
+		 */
+		int getQueueSize ();
+
+		/**
+		 * Write throughput of the last written image in MB/s.
+		 */
+		double getThroughput () { return throughput; }
+
+		/**
+		 * Returns number of bytes written since start.
+		 */
+		double getBytesWritten () { return bytesWritten; }
+
+		/**
+		 * Write pixels to the current HDU.
+		 *
+		 * @return -1 on unknown data type, 0 otherwise. Errors are reported in status.
+		 */
+		static int writePixels (fitsfile *ffile, int dataType, long pixels, char *data, int *status);
+
+	private:
+		int numThreads;
+		std::vector <pthread_t> threads;
+
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		bool exitThreads;
+
+		std::deque <FitsWriterJob *> waiting;
+		std::deque <FitsWriterJob *> finished;
+		// jobs being written by threads
+		int running;
+
+		// write end of completion pipe
+		int notifyFd;
+
+		double throughput;
+		double bytesWritten;
+
+		static void *writerThread (void *arg);
+};
+
+}
+
+#endif // !__RTS2_FITSWRITER__
@@ -31,6 +31,7 @@
 #include "rts2fits/fitsfile.h"
 #include "rts2fits/channel.h"
 
+#include "binnedhistogram.h"
 #include "libnova_cpp.h"
 #include "devclient.h"
 #include "expander.h"
@@ -98,6 +99,8 @@ typedef enum
 { EXPOSURE_START, INFO_CALLED, EXPOSURE_END, TRIGGERED }
 imageWriteWhich_t;
 
+class FitsWriter;
+
 const void * getScaledData (int dataType, const void *data, size_t numpix, long smin, long smax, scaling_type scaling, int newType);
 
 /**
@@ -263,13 +266,34 @@ class Image:public FitsFile
 
 		int writeData (char *in_data, char *fullTop, int nchan);
 
+		/**
+		 * Set writer for image data. When writer is set, pixel data
+		 * passed to writeData are not written immediately, but are kept
+		 * until the file is closed. See writeInBackground.
+		 */
+		void setFitsWriter (FitsWriter *_writer) { writer = _writer; }
+
+		/**
+		 * Next closeFile call passes the file with pending pixel data
+		 * to the writer, which writes and closes it in background.
+		 * Without this call, pending data are written by closeFile.
+		 */
+		void writeInBackground () { backgroundClose = true; }
+
+		/**
+		 * Returns true if the file was passed to the writer. EVENT_FITS_WRITTEN
+		 * with this image as argument is posted when it is written.
+		 */
+		bool isWriteQueued () { return writeQueued; }
+
 		/**
 		 * Fill image header structure.
 		 */
 		void getImgHeader (struct imghdr *im_h, int chan);
 
 		/**
-		 * Build image histogram.
+		 * Build image histogram. Pixel values from 0 to 65535 are
+		 * distributed to nbins bins.
 		 *
 		 * @param histogram array for calculated histogram
 		 * @param nbins     number of histogram bins
@@ -277,7 +301,8 @@ class Image:public FitsFile
 		void getHistogram (long *histogram, long nbins);
 
 		/**
-		 * Build channel histogram.
+		 * Build channel histogram. Pixel values from 0 to 65535 are
+		 * distributed to nbins bins.
 		 *
 		 * @param chan      channel number
 		 * @param histogram array for calculated histogram
@@ -285,6 +310,14 @@ class Image:public FitsFile
 		 */
 		void getChannelHistogram (int chan, long *histogram, long nbins);
 
+		/**
+		 * Add channel pixels to histogram. Works for all data types.
+		 *
+		 * @param chan      channel number
+		 * @param hist      histogram
+		 */
+		void getChannelHistogram (int chan, rts2core::BinnedHistogram &hist);
+
 
 		template <typename bt, typename dt> void getChannelGrayscaleByteBuffer (int chan, bt * &buf, bt black, dt low, dt high, long s, size_t offset, bool invert_y);
 
@@ -791,6 +824,12 @@ class Image:public FitsFile
 
 		std::map <int, TableData *> arrayGroups;
 
+		// background writer and pixel data waiting for it
+		FitsWriter *writer;
+		FitsWriterJob *writerJob;
+		bool backgroundClose;
+		bool writeQueued;
+
 		void initData ();
 
 		/**
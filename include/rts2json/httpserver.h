@@ -34,6 +34,7 @@ namespace rts2json
 {
 
 class AsyncAPI;
+class PreviewCache;
 
 /**
  * Interface for HTTP server. Declares methods needed by user authorization.
@@ -93,6 +94,11 @@ class HTTPServer
 		 */
 		virtual int getDefaultChannel () { return 0; }
 
+		/**
+		 * Return cache for JPEG previews, NULL if previews are not cached.
+		 */
+		virtual PreviewCache *getPreviewCache () { return NULL; }
+
 		/**
 		 * Verify user credentials.
 		 */
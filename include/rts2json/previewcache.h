@@ -0,0 +1,181 @@
+/*
+ * Cache of JPEG image previews.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_PREVIEWCACHE__
+#define __RTS2_PREVIEWCACHE__
+
+#include <list>
+#include <map>
+#include <string>
+#include <pthread.h>
+#include <sys/types.h>
+
+namespace rts2json
+{
+
+/**
+ * Identifies rendered preview. Includes modification time and size of the
+ * image file, so previews of changed files are not found.
+ */
+class PreviewKey
+{
+	public:
+		/**
+		 * @param _kind           type of the rendering (full image, preview,..)
+		 * @param _path           absolute path to image file
+		 * @param _quantiles      quantiles used to scale pixel values
+		 * @param _chan           displayed channel
+		 * @param _colourVariant  colour map
+		 * @param _label          label (before expansion)
+		 * @param _size           preview size, 0 for full image
+		 */
+		PreviewKey (const char *_kind, const std::string &_path, float _quantiles, int _chan, int _colourVariant, const char *_label, int _size);
+
+		/**
+		 * Read modification time and size of the image file.
+		 *
+		 * @return -1 if file cannot be accessed, 0 on success
+		 */
+		int statFile ();
+
+		const std::string &getPath () { return path; }
+
+		/**
+		 * Modification time and size of the file.
+		 */
+		const std::string &getStamp () { return stamp; }
+
+		void setSize (int _size) { size = _size; }
+
+		/**
+		 * Returns key string, unique for the rendering.
+		 */
+		std::string str ();
+
+	private:
+		std::string kind;
+		std::string path;
+		std::string stamp;
+		float quantiles;
+		int chan;
+		int colourVariant;
+		std::string label;
+		int size;
+};
+
+/**
+ * Cache of JPEG previews. Previews are held in memory, least recently used
+ * previews are dropped when size of the cache exceeds its limit. If cache
+ * directory is specified, previews are also stored in files, so they
+ * survive restart and do not count to memory limit once dropped.
+ *
+ * When image file modification time or size change, all previews of the
+ * file are removed.
+ */
+class PreviewCache
+{
+	public:
+		/**
+		 * @param _maxSize   maximal size of previews held in memory (bytes)
+		 */
+		PreviewCache (size_t _maxSize = 32 * 1024 * 1024);
+		~PreviewCache ();
+
+		void setMaxSize (size_t _maxSize);
+
+		/**
+		 * Set directory for preview files. Empty string disables disk cache.
+		 */
+		void setCacheDir (const char *_cacheDir) { cacheDir = _cacheDir ? _cacheDir : ""; }
+
+		/**
+		 * Find preview in the cache.
+		 *
+		 * @param key               preview key, statFile must be called before
+		 * @param response          newly allocated buffer with the preview
+		 * @param response_length   length of the preview
+		 *
+		 * @return true if preview was found
+		 */
+		bool find (PreviewKey &key, char* &response, size_t &response_length);
+
+		/**
+		 * Add preview to the cache.
+		 */
+		void add (PreviewKey &key, const void *data, size_t len);
+
+		size_t getSize () { return size; }
+		long getHits () { return hits; }
+		long getMisses () { return misses; }
+
+	private:
+		struct entry
+		{
+			std::string path;
+			std::string data;
+		};
+
+		struct fileStamp
+		{
+			fileStamp () { previews = 0; }
+			std::string stamp;
+			// number of previews of the file held in memory
+			int previews;
+		};
+
+		typedef std::list <std::pair <std::string, entry> > lru_t;
+
+		// most recently used entries are at the front
+		lru_t lru;
+		std::map <std::string, lru_t::iterator> entries;
+		// file stamps of images with cached previews, removed with the last preview of the image
+		std::map <std::string, fileStamp> stamps;
+
+		size_t maxSize;
+		size_t size;
+		std::string cacheDir;
+
+		long hits;
+		long misses;
+
+		pthread_mutex_t mutex;
+
+		/**
+		 * Drop previews of outdated file.
+		 */
+		void checkStamp (PreviewKey &key);
+
+		/**
+		 * Remove entry from memory cache.
+		 *
+		 * @return iterator to the next entry
+		 */
+		lru_t::iterator removeEntry (lru_t::iterator iter);
+
+		void dropLast ();
+
+		std::string diskDir (const std::string &path);
+		std::string diskFile (PreviewKey &key);
+
+		bool readDisk (PreviewKey &key, const std::string &k, std::string &data);
+		void writeDisk (PreviewKey &key, const std::string &k, const void *data, size_t len);
+};
+
+}
+
+#endif // !__RTS2_PREVIEWCACHE__
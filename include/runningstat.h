@@ -0,0 +1,113 @@
+/*
+ * Streaming statistics of sliding window of samples.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_RUNNINGSTAT__
+#define __RTS2_RUNNINGSTAT__
+
+#include <set>
+#include <stddef.h>
+
+namespace rts2core
+{
+
+/**
+ * Running statistics of (value, time) samples. Mean, variance and
+ * linear regression of values on time are kept with Welford updates,
+ * which can be reversed when sample leaves the window. Median, minimum
+ * and maximum are kept in two ordered halves of the samples. Adding or
+ * removing sample costs O(log n).
+ *
+ * Samples with NaN value or time are ignored.
+ *
+ * Reversed updates accumulate rounding errors. Owner of the sample
+ * window should rebuild the statistics from samples when getRemovals
+ * exceeds number of samples.
+ */
+class RunningStat
+{
+	public:
+		RunningStat () { clear (); }
+
+		void clear ();
+
+		/**
+		 * Add sample.
+		 *
+		 * @param y  sample value
+		 * @param t  sample time
+		 */
+		void add (double y, double t = 0);
+
+		/**
+		 * Remove sample, previously added with add call.
+		 */
+		void remove (double y, double t = 0);
+
+		/**
+		 * Number of samples in the statistics.
+		 */
+		size_t size () { return n; }
+
+		/**
+		 * Number of removals since last clear.
+		 */
+		size_t getRemovals () { return removals; }
+
+		double getMean ();
+
+		/**
+		 * Population standard deviation of values.
+		 */
+		double getStdev ();
+
+		double getMedian ();
+
+		double getMin ();
+
+		double getMax ();
+
+		/**
+		 * Slope of values linear regression on time.
+		 */
+		double getSlope ();
+
+		/**
+		 * Sum of products of time and value deviations from their means.
+		 */
+		double getCoMoment ();
+
+	private:
+		// lower half of samples, holds the median for odd number of samples
+		std::multiset <double> lower;
+		std::multiset <double> upper;
+
+		size_t n;
+		size_t removals;
+
+		double meanY;
+		double meanT;
+		double m2Y;
+		double m2T;
+		double cTY;
+
+		void balance ();
+};
+
+}
+
+#endif // !__RTS2_RUNNINGSTAT__
@@ -20,6 +20,8 @@
 *
 *%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 
+#include <pthread.h>
+
 #define	UNKNOWN	        -1    /* flag for LUTZ */
 #define	CLEAN_ZONE      10.0  /* zone (in sigma) to consider for processing */
 #define CLEAN_STACKSIZE 3000  /* replaces prefs.clean_stacksize  */
@@ -75,10 +77,11 @@ typedef struct
 } arraybuffer;
 
 
-/* globals */
-extern int plistexist_cdvalue, plistexist_thresh, plistexist_var;
-extern int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
-extern int plistsize;
+/* pixel list layout; set by plistinit() at the start of each extraction,
+ * kept per thread so extractions can run concurrently */
+extern SEP_TLS int plistexist_cdvalue, plistexist_thresh, plistexist_var;
+extern SEP_TLS int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
+extern SEP_TLS int plistsize;
 
 typedef struct
 {
@@ -132,22 +135,75 @@ typedef struct
 } objliststruct;
 
 
+/* buffers used by lutz() */
+typedef struct
+{
+  infostruct  *info, *store;
+  char	      *marker;
+  pixstatus   *psstack;
+  int         *start, *end, *discan;
+  int         xmin, ymin, xmax, ymax;
+} lutzbuffers;
+
+/* deblending work space, allocated once per extraction */
+typedef struct
+{
+  objliststruct *objlist;
+  short	        *son, *ok;
+  lutzbuffers   lutz;
+} deblendctx;
+
+/* strip of image rows, extracted by extract_strip() */
+typedef struct
+{
+  int           y0, y1;      /* first row and row after the last one */
+  objliststruct objlist;     /* objects completed inside the strip */
+  int           *keys;       /* position (y*(w+1)+x) of object completion */
+  objliststruct seamlist;    /* fragments touching strip seams */
+  int           *seamkeys;
+  PIXTYPE       lastthresh;  /* threshold at the end of extraction */
+} extractstrip;
+
+/* parameters of extraction, and strips extracted by threads */
+typedef struct
+{
+  sep_image       *image;
+  float           thresh;
+  int             thresh_type, minarea;
+  float           *conv;
+  int             convw, convh, filter_type;
+  int             deblend_nthresh;
+  double          deblend_cont;
+  extractstrip    *strips;
+  int             nstrips;
+  pthread_mutex_t lock;
+  int             nextstrip;
+  int             status;
+  int             stream;      /* image rows are added during extraction */
+  int             rows;        /* rows available to streaming extraction */
+  pthread_cond_t  rowscond;    /* signalled when rows are added */
+  char            errdetail[512];
+} extractjobs;
+
+
 int analysemthresh(int objnb, objliststruct *objlist, int minarea,
 		   PIXTYPE thresh);
 void preanalyse(int, objliststruct *);
 void analyse(int, objliststruct *, int, double);
 
-int  lutzalloc(int, int);
-void lutzfree(void);
-int  lutz(pliststruct *plistin,
+int  lutzalloc(int, int, lutzbuffers *);
+void lutzfree(lutzbuffers *);
+int  lutz(lutzbuffers *buffers, pliststruct *plistin,
 	  int *objrootsubmap, int subx, int suby, int subw,
 	  objstruct *objparent, objliststruct *objlist, int minarea);
 
 void update(infostruct *, infostruct *, pliststruct *);
 
-int  allocdeblend(int);
-void freedeblend(void);
-int  deblend(objliststruct *, int, objliststruct *, int, double, int);
+int  *createsubmap(objliststruct *, int, int *, int *, int *, int *);
+int  allocdeblend(int, int, int, deblendctx *);
+void freedeblend(deblendctx *);
+int  deblend(deblendctx *, objliststruct *, int, objliststruct *, int, double,
+             int);
 
 /*int addobjshallow(objstruct *, objliststruct *);
 int rmobjshallow(int, objliststruct *);
@@ -155,6 +211,10 @@ void mergeobjshallow(objstruct *, objstruct *);
 */
 int addobjdeep(int, objliststruct *, objliststruct *);
 
+void *extract_worker(void *);
+int  collect_strips(extractjobs *, int, double, sep_catalog **);
+void free_strips(extractjobs *);
+
 int convolve(arraybuffer *buf, int y, float *conv, int convw, int convh,
              PIXTYPE *out);
 int matched_filter(arraybuffer *imbuf, arraybuffer *nbuf, int y,
@@ -25,6 +25,7 @@
 /* datatype codes */
 #define SEP_TBYTE        11  /* 8-bit unsigned byte */
 #define SEP_TUINT16      15  /* 16-bit unsigned */
+#define SEP_TINT16       21  /* 16-bit signed */
 #define SEP_TINT         31  /* native int type */
 #define SEP_TFLOAT       42
 #define SEP_TDOUBLE      82
@@ -231,12 +232,70 @@ int sep_extract(sep_image *image,
 		double clean_param,   /* clean parameter               [1.0] */
                 sep_catalog **catalog); /* OUTPUT catalog                    */
 
+/* sep_extract_tiled()
+ *
+ * Same as sep_extract(), but the image is split into `ntiles` horizontal
+ * strips extracted in parallel by up to sep_get_threads() threads.
+ * Objects crossing strip boundaries are merged before deblending, so the
+ * catalog is the same as from sep_extract(). Each strip uses its own pixel
+ * stack of sep_get_extract_pixstack() pixels.
+ */
+int sep_extract_tiled(sep_image *image, float thresh, int thresh_type,
+		      int minarea, float *conv, int convw, int convh,
+		      int filter_type, int deblend_nthresh,
+		      double deblend_cont, int clean_flag, double clean_param,
+		      int ntiles,         /* number of strips                 */
+		      sep_catalog **catalog);
+
+/*----------------------- streaming extraction ------------------------------*/
+
+/* sep_stream
+ *
+ * Background estimation and extraction of an image received in chunks of
+ * rows, as from a camera during readout. Background meshes are computed as
+ * soon as their rows arrive, and rows are extracted by a thread of the
+ * stream once the background around them is known, so only the last rows
+ * remain to be processed when the image is complete. Until the last row
+ * arrives, the background is interpolated over the meshes received so far,
+ * so results can differ slightly from sep_background() followed by
+ * sep_extract().
+ */
+typedef struct sep_stream sep_stream;
+
+/* create stream for w x h image of dtype. Parameters are the same as of
+ * sep_background() and sep_extract(); thresh is relative to the background
+ * rms map when rms_map is set, otherwise to the global background rms of
+ * the meshes received so far. */
+int sep_stream_new(int w, int h, int dtype, int bw, int bh, int fw, int fh,
+		   double fthresh, float thresh, int minarea, float *conv,
+		   int convw, int convh, int filter_type, int deblend_nthresh,
+		   double deblend_cont, int clean_flag, double clean_param,
+		   int rms_map, sep_stream **stream);
+
+/* add next size bytes of the image; chunks need not end at row or pixel
+ * boundaries */
+int sep_stream_add(sep_stream *stream, void *data, size_t size);
+
+/* extract remaining rows once the whole image was added */
+int sep_stream_finish(sep_stream *stream, sep_catalog **catalog);
+
+/* background-subtracted image (with background rms map or global rms as
+ * noise) and the background, complete after sep_stream_finish() */
+sep_image *sep_stream_image(sep_stream *stream);
+sep_bkg *sep_stream_bkg(sep_stream *stream);
+
+void sep_stream_free(sep_stream *stream);
 
 
 /* set and get the size of the pixel stack used in extract() */
 void sep_set_extract_pixstack(size_t val);
 size_t sep_get_extract_pixstack(void);
 
+/* set and get the number of threads used by sep_background(),
+ * sep_extract_tiled() and sep_stream [1] */
+void sep_set_threads(int n);
+int sep_get_threads(void);
+
 /* free memory associated with a catalog */
 void sep_catalog_free(sep_catalog *catalog);
 
@@ -31,6 +31,14 @@
 #define LINE_NOT_IN_BUF     8
 #define RELTHRESH_NO_NOISE  9
 #define UNKNOWN_NOISE_TYPE  10
+#define STREAM_INCOMPLETE   11
+
+/* thread local storage of state shared by extraction functions */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define SEP_TLS _Thread_local
+#else
+#define SEP_TLS __thread
+#endif
 
 #define	BIG 1e+30  /* a huge number (< biggest value a float can store) */
 #define	PI  3.1415926535898
@@ -83,3 +91,8 @@ int get_converter(int dtype, converter *f, int *size);
 int get_array_converter(int dtype, array_converter *f, int *size);
 int get_array_writer(int dtype, array_writer *f, int *size);
 int get_array_subtractor(int dtype, array_writer *f, int *size);
+
+/* steps of sep_background(), used separately by sep_stream */
+int bkg_alloc(int w, int h, int bw, int bh, sep_bkg **bkg);
+int bkg_meshrows(sep_image *image, sep_bkg *bkg, int j0, int j1);
+int bkg_finish(sep_bkg *bkg, int fw, int fh, double fthresh);
@@ -27,6 +27,7 @@
 
 #include "device.h"
 #include "objectcheck.h"
+#include "astromcache.h"
 
 // pointing models
 #define POINTING_RADEC          0
@@ -1092,6 +1093,11 @@ class Telescope:public rts2core::Device
 		int moveInfoCount;
 		int moveInfoMax;
 
+#ifdef RTS2_LIBERFA
+		// astrometry context used by applyCorrections
+		AstromCache astromCache;
+#endif
+
 		rts2core::ValueSelection *tracking;
 		rts2core::ValueDoubleStat *trackingFrequency;
 		rts2core::ValueInteger *trackingFSize;
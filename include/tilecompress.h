@@ -0,0 +1,121 @@
+/*
+ * Parallel Rice compression of image tiles.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_TILECOMPRESS__
+#define __RTS2_TILECOMPRESS__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// number of pixels coded with the same Rice parameter, as used by cfitsio
+#define RICE_BLOCKSIZE    32
+
+namespace rts2core
+{
+
+/**
+ * Compress image divided into rectangular tiles with Rice algorithm.
+ * Tiles are compressed in parallel on worker threads. Output of the Rice
+ * coder is bit-compatible with RICE_1 compression of the FITS tiled image
+ * convention, so the tiles can be stored as rows of COMPRESSED_DATA
+ * column of the compressed image HDU.
+ *
+ * Tiles are numbered from the lower left corner, first along the image
+ * rows. Tiles at the image edges can be smaller than the tile size.
+ */
+class TileCompressor
+{
+	public:
+		/**
+		 * @param _threads  number of worker threads, 0 for number of online CPUs
+		 */
+		TileCompressor (int _threads = 0);
+		~TileCompressor ();
+
+		int getThreads () { return threads; }
+
+		/**
+		 * Compress image.
+		 *
+		 * @param data        image data in host byte order - 8 bit unsigned, 16 or 32 bit signed integers
+		 * @param bytepix     bytes per pixel (1, 2 or 4)
+		 * @param width       image width
+		 * @param height      image height
+		 * @param tileWidth   tile width, 0 for image width
+		 * @param tileHeight  tile height, 0 for single row
+		 *
+		 * @return -1 on invalid parameters, 0 on success
+		 */
+		int compress (const void *data, int bytepix, long width, long height, long tileWidth = 0, long tileHeight = 0);
+
+		size_t getTiles () { return tiles.size (); }
+
+		const unsigned char *getTileData (size_t i) { return &(tiles[i][0]); }
+
+		size_t getTileSize (size_t i) { return tiles[i].size (); }
+
+		/**
+		 * Returns sum of sizes of all compressed tiles.
+		 */
+		size_t getCompressedSize ();
+
+		/**
+		 * Maximal size of compressed data.
+		 */
+		static size_t riceBound (size_t pixels, int bytepix, int nblock = RICE_BLOCKSIZE);
+
+		/**
+		 * Compress data with Rice algorithm.
+		 *
+		 * @param data     data to compress
+		 * @param pixels   number of pixels
+		 * @param out      output buffer
+		 * @param outSize  size of output buffer
+		 * @param nblock   number of pixels coded with the same parameter
+		 *
+		 * @return size of compressed data, 0 if output buffer is too small
+		 */
+		template <typename t> static size_t riceCompress (const t *data, size_t pixels, unsigned char *out, size_t outSize, int nblock = RICE_BLOCKSIZE);
+
+	private:
+		int threads;
+
+		std::vector <std::vector <unsigned char> > tiles;
+
+		// parameters of the current compress call
+		const char *imgData;
+		int imgBytepix;
+		long imgWidth;
+		long imgHeight;
+		long tWidth;
+		long tHeight;
+		long tilesX;
+
+		size_t nextTile;
+		pthread_mutex_t mutex;
+
+		void compressTiles ();
+
+		static void *compressThread (void *arg);
+};
+
+}
+
+#endif // !__RTS2_TILECOMPRESS__
@@ -0,0 +1,185 @@
+/*
+ * Hierarchical timer wheel.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_TIMERWHEEL__
+#define __RTS2_TIMERWHEEL__
+
+#include "event.h"
+
+#include <map>
+#include <stdint.h>
+
+// number of wheel levels
+#define TIMERWHEEL_LEVELS   4
+// bits per level
+#define TIMERWHEEL_BITS     8
+#define TIMERWHEEL_SIZE     (1 << TIMERWHEEL_BITS)
+#define TIMERWHEEL_MASK     (TIMERWHEEL_SIZE - 1)
+
+namespace rts2core
+{
+
+/**
+ * Single timer held in TimerWheel.
+ */
+struct TimerEntry
+{
+	double when;
+	uint64_t expires;
+	uint64_t seq;
+	Event *event;
+	// slot (or due) list
+	TimerEntry *next;
+	TimerEntry **pprev;
+	// list of timers with the same event type
+	TimerEntry *typeNext;
+	TimerEntry **typePprev;
+	// slot level, -1 for due list
+	int level;
+	int slot;
+};
+
+/**
+ * Hierarchical timer wheel. Holds events which shall be posted at given
+ * time. Adding and removing a timer is O(1); timers of given event type
+ * are kept in separate list, so they can be removed without scanning
+ * all timers.
+ *
+ * Timer time is rounded to ticks. Wheel has TIMERWHEEL_LEVELS levels of
+ * TIMERWHEEL_SIZE slots; timers from higher levels are cascaded to lower
+ * levels as time advances. Timers which are due are moved to due list,
+ * ordered by their time.
+ */
+class TimerWheel
+{
+	public:
+		/**
+		 * @param _tick  tick length in seconds
+		 */
+		TimerWheel (double _tick = 0.001);
+
+		/**
+		 * Delete all pending timers and their events.
+		 */
+		~TimerWheel ();
+
+		/**
+		 * Add timer.
+		 *
+		 * @param when   time (ctime, seconds from 1.1.1970) when event shall be posted
+		 * @param event  event to post
+		 */
+		void add (double when, Event *event);
+
+		/**
+		 * Remove and delete all timers with given event type.
+		 *
+		 * @param event_type  type of event
+		 *
+		 * @return number of deleted timers
+		 */
+		int remove (int event_type);
+
+		/**
+		 * Remove and delete timers with given event type and argument.
+		 *
+		 * @param event_type  type of event
+		 * @param arg         event argument
+		 *
+		 * @return number of deleted timers
+		 */
+		int remove (int event_type, void *arg);
+
+		/**
+		 * Mark start of processing of expired timers. Only timers added
+		 * before this call will be returned by popExpired, so timer
+		 * which adds itself with zero interval will not loop forever.
+		 */
+		void startExpire () { expireSeq = seq; }
+
+		/**
+		 * Return earliest timer which is due at given time. Timer is removed from the wheel.
+		 *
+		 * @param now   current time
+		 * @param when  returned timer time
+		 *
+		 * @return event of the timer, NULL if no timer is due
+		 */
+		Event *popExpired (double now, double *when);
+
+		/**
+		 * Return time of the earliest timer.
+		 *
+		 * @return time of the earliest timer, NAN if there isn't any timer
+		 */
+		double nextDeadline ();
+
+		size_t size () { return count; }
+
+		bool empty () { return count == 0; }
+
+		double getTick () { return tick; }
+
+	private:
+		double tick;
+		// current tick; all slots for ticks lower than current were processed
+		uint64_t current;
+		uint64_t seq;
+		uint64_t expireSeq;
+		// number of all timers, number of timers in wheel slots (not in due list)
+		size_t count;
+		size_t inWheel;
+		// time of the last popExpired call
+		double lastNow;
+
+		TimerEntry *slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SIZE];
+		// occupancy bitmaps of slots
+		uint64_t occupied[TIMERWHEEL_LEVELS][TIMERWHEEL_SIZE / 64];
+
+		// due timers, ordered by time
+		TimerEntry *due;
+
+		std::map <int, TimerEntry *> types;
+
+		// cached earliest deadline
+		double next;
+		bool nextValid;
+
+		uint64_t toTick (double t);
+
+		void insert (TimerEntry *entry);
+		void insertDue (TimerEntry *entry);
+		void unlink (TimerEntry *entry);
+
+		/**
+		 * Advance wheel up to given tick, moving timers to due list.
+		 */
+		void advance (uint64_t to);
+		void cascade (int level, int slot);
+
+		/**
+		 * Find first occupied slot at given level, starting at from.
+		 *
+		 * @return slot index, -1 if all slots are empty
+		 */
+		int firstOccupied (int level, int from);
+};
+
+}
+
+#endif // !__RTS2_TIMERWHEEL__
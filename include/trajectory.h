@@ -0,0 +1,106 @@
+/*
+ * Block evaluation of telescope trajectory steps.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_TRAJECTORY__
+#define __RTS2_TRAJECTORY__
+
+#include "objectcheck.h"
+
+#include <stdint.h>
+
+// number of trajectory steps evaluated at once
+#define TRAJECTORY_BLOCK    64
+
+namespace rts2teld
+{
+
+/**
+ * Block of trajectory steps. Axis positions along the path from current
+ * to target counts do not depend on the horizon checks, so they are
+ * generated for the whole block first. The mount code then fills
+ * horizontal coordinates of the steps in arrays, the block is checked
+ * against horizon in one pass, and checkTrajectory logic runs over the
+ * precomputed values.
+ */
+class TrajectoryBlock
+{
+	public:
+		/**
+		 * @param _a   current counts on the first axis
+		 * @param _d   current counts on the second axis
+		 * @param _at  target counts on the first axis
+		 * @param _dt  target counts on the second axis
+		 * @param _as  step size (counts) on the first axis
+		 * @param _ds  step size (counts) on the second axis
+		 */
+		TrajectoryBlock (int32_t _a, int32_t _d, int32_t _at, int32_t _dt, int32_t _as, int32_t _ds);
+
+		/**
+		 * Generate next block of step counts. Stops after step which reached target on both axes.
+		 *
+		 * @param maxSteps   maximal number of steps to generate
+		 *
+		 * @return number of steps in the block
+		 */
+		size_t fill (size_t maxSteps);
+
+		/**
+		 * Convert hour angles and declinations of the block steps to
+		 * horizontal coordinates (libnova convention, azimuth measured from south).
+		 *
+		 * @param lat  observer latitude (degrees)
+		 */
+		void hadec2hrz (double lat);
+
+		/**
+		 * Fill good array with hard horizon check results.
+		 *
+		 * @return index of first step below horizon, size if all steps are above horizon
+		 */
+		size_t checkHorizon (ObjectCheck *horizon) { return horizon->is_good (alt, az, size, good); }
+
+		size_t size;
+
+		int32_t n_a[TRAJECTORY_BLOCK];
+		int32_t n_d[TRAJECTORY_BLOCK];
+		// true if the step reached target on both axes
+		bool last[TRAJECTORY_BLOCK];
+
+		// hour angle and declination (degrees), filled by mount code
+		double ha[TRAJECTORY_BLOCK];
+		double dec[TRAJECTORY_BLOCK];
+		int flip[TRAJECTORY_BLOCK];
+
+		double alt[TRAJECTORY_BLOCK];
+		double az[TRAJECTORY_BLOCK];
+		char good[TRAJECTORY_BLOCK];
+
+	private:
+		int32_t t_a;
+		int32_t t_d;
+		int32_t at;
+		int32_t dt;
+		int32_t as;
+		int32_t ds;
+		int32_t step_a;
+		int32_t step_d;
+};
+
+}
+
+#endif // !__RTS2_TRAJECTORY__
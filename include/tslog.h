@@ -0,0 +1,204 @@
+/*
+ * Binary columnar time-series store.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_TSLOG__
+#define __RTS2_TSLOG__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// maximal number of samples stored in a single block
+#define TSLOG_BLOCK_SAMPLES   1024
+
+// number of seconds after which partially filled block is written to the disk
+#define TSLOG_FLUSH_INTERVAL  3600
+
+// size of file header
+#define TSLOG_HEADER_SIZE     64
+
+// size of block header
+#define TSLOG_BLOCK_HEADER    48
+
+namespace rts2core
+{
+
+/**
+ * Index entry of a single block of time-series file.
+ */
+struct TimeseriesBlock
+{
+	size_t offset;
+	uint32_t count;
+	uint32_t size;
+	double tmin;
+	double tmax;
+	// minimal and maximal value, NaN values are ignored
+	double vmin;
+	double vmax;
+};
+
+/**
+ * Append-only writer of time-series file. File holds samples of a single
+ * value - pairs of time (ctime with microseconds resolution) and double
+ * value. Samples are collected in memory and written as compressed blocks.
+ * Each block carries its time and value extremes, so readers can skip
+ * blocks outside of the requested range without decompressing them.
+ *
+ * Times are delta-of-delta coded as variable length integers, values are
+ * XORed with the previous value and only non-zero bytes of the result are
+ * stored. Regularly sampled, slowly changing values are thus stored in few
+ * bytes per sample.
+ *
+ * Block is written by a single write call to file opened with O_APPEND. A
+ * truncated block left after crash is removed when file is reopened.
+ */
+class TimeseriesWriter
+{
+	public:
+		TimeseriesWriter ();
+		~TimeseriesWriter ();
+
+		/**
+		 * Open file for appending. Creates file with header if it does
+		 * not exist.
+		 *
+		 * @param path   file path
+		 * @param name   name of the series, stored in header of new file
+		 * @param type   RTS2 value type, stored in header of new file
+		 *
+		 * @return -1 on error (with errno set), 0 on success
+		 */
+		int open (const char *path, const char *name, int32_t type = 0);
+
+		/**
+		 * Flush pending samples and close the file.
+		 */
+		void close ();
+
+		bool isOpen () { return fd >= 0; }
+
+		/**
+		 * Add sample. Block is written when it is full, or when
+		 * oldest pending sample is older than flush interval.
+		 *
+		 * @return -1 on write error, 0 on success
+		 */
+		int add (double t, double v);
+
+		/**
+		 * Write pending samples as a new block.
+		 *
+		 * @return -1 on write error, 0 on success
+		 */
+		int flush ();
+
+		size_t getPending () { return times.size (); }
+
+		void setFlushInterval (double _flushInterval) { flushInterval = _flushInterval; }
+
+		/**
+		 * Encode samples into block, including block header.
+		 *
+		 * @return size of the block
+		 */
+		static size_t encodeBlock (const double *t, const double *v, size_t count, std::vector <unsigned char> &out);
+
+	private:
+		int fd;
+		double flushInterval;
+
+		std::vector <double> times;
+		std::vector <double> values;
+		std::vector <unsigned char> buf;
+};
+
+/**
+ * Reader of time-series files. File is mapped to memory, block headers are
+ * read to the index on open.
+ */
+class TimeseriesReader
+{
+	public:
+		TimeseriesReader ();
+		~TimeseriesReader ();
+
+		/**
+		 * Map file and read its block index. Truncated trailing block is
+		 * ignored.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int open (const char *path);
+
+		void close ();
+
+		/**
+		 * Re-read block index, picking blocks appended since the file was opened.
+		 */
+		int refresh ();
+
+		const std::string &getName () { return name; }
+
+		int32_t getType () { return type; }
+
+		const std::vector <TimeseriesBlock> &getBlocks () { return blocks; }
+
+		/**
+		 * Total number of samples in the file.
+		 */
+		size_t getSamples ();
+
+		/**
+		 * Decompress a single block, append its samples to the vectors.
+		 *
+		 * @return -1 on corrupted block, 0 on success
+		 */
+		int readBlock (size_t i, std::vector <double> &t, std::vector <double> &v);
+
+		/**
+		 * Append samples with from <= t <= to to the vectors. Blocks
+		 * outside of the range are not decompressed.
+		 *
+		 * @return number of samples added
+		 */
+		size_t scan (double from, double to, std::vector <double> &t, std::vector <double> &v);
+
+		/**
+		 * Decode block payload.
+		 *
+		 * @return -1 on corrupted data, 0 on success
+		 */
+		static int decodeBlock (const unsigned char *data, size_t size, uint32_t count, std::vector <double> &t, std::vector <double> &v);
+
+	private:
+		std::string path;
+		std::string name;
+		int32_t type;
+
+		int fd;
+		unsigned char *map;
+		size_t mapSize;
+
+		std::vector <TimeseriesBlock> blocks;
+};
+
+}
+
+#endif // !__RTS2_TSLOG__
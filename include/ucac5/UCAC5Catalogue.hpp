@@ -0,0 +1,138 @@
+/*
+ * UCAC5 catalogue with persistent mappings of zone files.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __UCAC5CATALOGUE__
+#define __UCAC5CATALOGUE__
+
+#include "ucac5/UCAC5Record.hpp"
+#include "ucac5/UCAC5PixelIdx.hpp"
+#include "gtp/Vector.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+// number of declination zones (0.2 deg each)
+#define UCAC5_ZONES      900
+
+// number of RA bins in index (0.25 deg each)
+#define UCAC5_RA_BINS    1440
+
+/**
+ * Star matched by catalogue query.
+ */
+struct UCAC5Match
+{
+	const struct ucac5 *star;
+	// distance from query center, in degrees
+	double dist;
+};
+
+/**
+ * UCAC5 catalogue. Band index (u5index.unf) is mapped when catalogue is
+ * opened, zone files (zNNN) and their unit vector indices (zNNN.xyz,
+ * produced by ucac5-idx) are mapped on first access and kept mapped until
+ * the catalogue is destroyed. Queries can be run from multiple threads.
+ *
+ * When HEALPix pixel index (built by ucac5-idx -p) is present in catalogue
+ * directory, cone searches use it instead of RA/Dec bins of u5index.unf.
+ *
+ * Magnitude limits are applied to Gaia G magnitude. Queries keep the
+ * brightest matches in a heap bounded by the requested number of stars,
+ * so memory used by a query does not depend on the size of the searched area.
+ */
+class UCAC5Catalogue
+{
+	public:
+		UCAC5Catalogue();
+		~UCAC5Catalogue();
+
+		/**
+		 * Open catalogue.
+		 *
+		 * @param _base     directory with u5index.unf and zone files
+		 * @param usePixels use HEALPix pixel index if it is available
+		 *
+		 * @return -1 on error (with errno set), 0 on success
+		 */
+		int open(const char *_base, bool usePixels = true);
+
+		bool hasPixelIdx() { return pixelIdx.isOpen(); }
+
+		/**
+		 * Search stars inside cone.
+		 *
+		 * @param ra       center RA (degrees)
+		 * @param dec      center Dec (degrees)
+		 * @param radius   cone radius (degrees)
+		 * @param minMag   minimal (brightest) G magnitude
+		 * @param maxMag   maximal (faintest) G magnitude
+		 * @param num      maximal number of returned stars, must be positive
+		 * @param matches  brightest matched stars, sorted by magnitude
+		 *
+		 * @return -1 on error (errno is EINVAL for zero num), otherwise number of returned stars
+		 */
+		int cone(double ra, double dec, double radius, double minMag, double maxMag, size_t num, std::vector <UCAC5Match> &matches);
+
+		/**
+		 * Search stars inside RA/Dec box. Box spans from ra1 eastwards to ra2,
+		 * wrapping through 0h when ra1 > ra2.
+		 *
+		 * @return -1 on error (errno is EINVAL for zero num), otherwise number of returned stars
+		 */
+		int box(double ra1, double dec1, double ra2, double dec2, double minMag, double maxMag, size_t num, std::vector <UCAC5Match> &matches);
+
+		/**
+		 * Number of zones mapped to memory.
+		 */
+		int getMappedZones();
+
+	private:
+		struct Zone
+		{
+			bool mapped;
+			const struct ucac5 *stars;
+			const Vector *xyz;
+			size_t count;
+			size_t starsSize;
+			size_t xyzSize;
+		};
+
+		std::string base;
+
+		const uint32_t *index;
+		size_t indexSize;
+
+		UCAC5PixelIdx pixelIdx;
+
+		Zone zones[UCAC5_ZONES];
+		pthread_mutex_t zonesMutex;
+
+		/**
+		 * Return mapped zone, map it if it was not yet accessed.
+		 */
+		const Zone *getZone(int z);
+
+		int conePixels(const Vector &c, double radius, int16_t minG, int16_t maxG, size_t num, std::vector <UCAC5Match> &matches);
+
+		int mapFile(const char *fn, const void **data, size_t &size);
+};
+
+#endif // !__UCAC5CATALOGUE__
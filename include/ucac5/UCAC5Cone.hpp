@@ -0,0 +1,65 @@
+/*
+ * Cone match kernels for UCAC5 unit vector indices.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __UCAC5CONE__
+#define __UCAC5CONE__
+
+#include "gtp/Vector.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Tests blocks of unit vectors against cone (or annulus). Vector matches
+ * when its dot product with cone center d satisfies cosMax <= d <= cosMin,
+ * where cosMax is cosine of the outer and cosMin cosine of the inner
+ * radius. Dot products are summed in the same order in all kernels.
+ *
+ * Indices of matched vectors, incremented by base, are written to matched,
+ * which must have space for n entries.
+ */
+class UCAC5Cone
+{
+	public:
+		/**
+		 * Match vectors stored in separate x, y and z arrays, using the
+		 * best kernel supported by CPU.
+		 *
+		 * @return number of matched vectors
+		 */
+		static size_t matchSoA(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched);
+
+		/**
+		 * Scalar version of matchSoA.
+		 */
+		static size_t matchSoAScalar(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched);
+
+		/**
+		 * Match array of vectors (zNNN.xyz index files).
+		 *
+		 * @return number of matched vectors
+		 */
+		static size_t matchAoS(const Vector *v, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched);
+
+		/**
+		 * Name of kernel used by matchSoA.
+		 */
+		static const char *getKernelName();
+};
+
+#endif // !__UCAC5CONE__
@@ -0,0 +1,82 @@
+/*
+ * HEALPix nested pixelisation of the sphere.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __UCAC5HEALPIX__
+#define __UCAC5HEALPIX__
+
+#include "gtp/Vector.h"
+
+#include <stdint.h>
+#include <vector>
+
+// maximal supported order (nside = 2^order)
+#define HEALPIX_MAX_ORDER    13
+
+/**
+ * Range of pixels, from first (inclusive) to last (exclusive).
+ */
+struct HealpixRange
+{
+	uint32_t first;
+	uint32_t last;
+};
+
+/**
+ * HEALPix equal area hierarchical pixelisation, nested scheme. In nested
+ * scheme pixel p of order o is divided into pixels 4p..4p+3 of order o+1,
+ * so all pixels inside a coarse pixel form a continuous range.
+ */
+class UCAC5Healpix
+{
+	public:
+		static uint32_t npix(int order) { return 12u << (2 * order); }
+
+		/**
+		 * Return pixel containing unit vector.
+		 */
+		static uint32_t vec2pix(int order, const Vector &v);
+
+		/**
+		 * Return unit vector of pixel center.
+		 */
+		static void pix2vec(int order, uint32_t pix, Vector &v);
+
+		/**
+		 * Upper bound of angular distance (radians) between pixel center and any point inside pixel.
+		 */
+		static double maxPixRad(int order);
+
+		/**
+		 * Return sorted ranges of pixels of given order which might
+		 * contain points closer than radius to the center. Pixels fully
+		 * inside the cone are found at coarser orders and returned as
+		 * single range.
+		 *
+		 * @param order   order of returned pixels
+		 * @param c       cone center (unit vector)
+		 * @param radius  cone radius (radians)
+		 * @param ranges  returned ranges, adjacent ranges are merged
+		 */
+		static void queryDisc(int order, const Vector &c, double radius, std::vector <HealpixRange> &ranges);
+
+	private:
+		static void queryPixel(int order, int o, uint32_t pix, const Vector &c, double radius, std::vector <HealpixRange> &ranges);
+		static void addRange(std::vector <HealpixRange> &ranges, uint32_t first, uint32_t last);
+};
+
+#endif // !__UCAC5HEALPIX__
@@ -9,8 +9,12 @@
 
 #include "gtp/Vector.h"
 
+#include <stdint.h>
 #include <sys/types.h>
 
+// number of index vectors tested in one kernel call
+#define UCAC5IDX_BLOCK    256
+
 class UCAC5Idx
 {
 	public:
@@ -24,10 +28,11 @@ class UCAC5Idx
 		int getBand() { return band; }
 
 		/**
-		 * Returns index of the next matching star
+		 * Returns index of the next matching star. Selected vectors are
+		 * tested by blocks, matches are returned from the block buffer.
 		 */
 		int nextMatched (Vector *fc, double minRad, double maxRad, double &d);
-	
+
 	private:
 		int band;
 		int fd;
@@ -35,6 +40,10 @@ class UCAC5Idx
 		size_t dataSize;
 		Vector *current;
 		Vector *currentEnd;
+
+		uint32_t matched[UCAC5IDX_BLOCK];
+		size_t matchedCount;
+		size_t matchedPos;
 };
 
 #endif // !__UCAC5IDX__
@@ -0,0 +1,117 @@
+/*
+ * HEALPix pixel index of UCAC5 catalogue.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __UCAC5PIXELIDX__
+#define __UCAC5PIXELIDX__
+
+#include "ucac5/UCAC5Healpix.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// default order of index pixels, ~0.23 deg pixels with ~140 UCAC5 stars
+#define UCAC5_PIXEL_ORDER    8
+
+/**
+ * Position of star in zone files.
+ */
+struct UCAC5Ref
+{
+	uint16_t zone;
+	uint16_t reserved;
+	uint32_t offset;
+};
+
+/**
+ * Equal area index of UCAC5 stars, built by ucac5-idx -p. Stars are
+ * ordered by nested HEALPix pixel, so any cone is covered by few continuous
+ * ranges of index, independently of its declination. Index consists of
+ * three files in catalogue directory:
+ *
+ * - u5hpx.idx - header and offset of the first star of each pixel
+ * - u5hpx.xyz - unit vectors of stars, stored as x, y and z arrays for vectorized cone matching
+ * - u5hpx.ref - zone and offset of star in zone file
+ *
+ * Files are in native byte order, as the zNNN.xyz files. Index can be
+ * queried from multiple threads.
+ */
+class UCAC5PixelIdx
+{
+	public:
+		UCAC5PixelIdx();
+		~UCAC5PixelIdx();
+
+		/**
+		 * Map index files.
+		 *
+		 * @return -1 on error (with errno set), 0 on success
+		 */
+		int open(const char *base);
+
+		bool isOpen() { return offsets != NULL; }
+
+		int getOrder() { return order; }
+
+		size_t getCount() { return count; }
+
+		/**
+		 * Find stars inside cone (annulus).
+		 *
+		 * @param c        cone center (unit vector)
+		 * @param minRad   inner radius (radians)
+		 * @param maxRad   outer radius (radians)
+		 * @param matched  positions of matched stars in the index
+		 *
+		 * @return number of tested stars
+		 */
+		size_t cone(const Vector &c, double minRad, double maxRad, std::vector <uint32_t> &matched);
+
+		const UCAC5Ref &getRef(uint32_t i) { return refs[i]; }
+
+		void getVector(uint32_t i, Vector &v) { v.xyz.x = x[i]; v.xyz.y = y[i]; v.xyz.z = z[i]; }
+
+		/**
+		 * Build index from zone files.
+		 *
+		 * @param base   catalogue directory
+		 * @param order  HEALPix order of index pixels
+		 *
+		 * @return -1 on error (with errno set), 0 on success
+		 */
+		static int build(const char *base, int _order = UCAC5_PIXEL_ORDER);
+
+	private:
+		int order;
+		size_t count;
+
+		const uint32_t *offsets;
+		const double *x;
+		const double *y;
+		const double *z;
+		const UCAC5Ref *refs;
+
+		void *idxData;
+		size_t idxSize;
+		void *xyzData;
+		size_t xyzSize;
+		void *refData;
+		size_t refSize;
+};
+
+#endif // !__UCAC5PIXELIDX__
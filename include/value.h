@@ -488,7 +488,24 @@ class Value
 		 *
 		 * @param connection Connection on which value will be send.
 		 */
-		virtual void send (Connection * connection);
+		void send (Connection * connection) { sendMessage (connection, getSendMessage ()); }
+
+		/**
+		 * Returns protocol message with actual value. When value is
+		 * send to more connections, message is formated only once
+		 * and then passed to sendMessage for every connection.
+		 */
+		virtual std::string getSendMessage ();
+
+		/**
+		 * Sends already formated value message over connection.
+		 *
+		 * @param connection Connection on which value will be send.
+		 * @param msg        message returned by getSendMessage
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		virtual int sendMessage (Connection * connection, const std::string &msg);
 
 		/**
 		 * Reset value change bit, so changes will be recorded from now on.
@@ -561,7 +578,8 @@ class ValueString:public Value
 		virtual int setValueInteger (int in_value);
 		virtual const char *getValue ();
 		std::string getValueString () { return value; }
-		virtual void send (Connection * connection);
+		virtual std::string getSendMessage ();
+		virtual int sendMessage (Connection * connection, const std::string &msg);
 		virtual void setFromValue (Value * newValue);
 		virtual bool isEqual (Value *other_value);
 		virtual int checkNotNull ();
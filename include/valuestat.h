@@ -21,6 +21,7 @@
 #define __RTS2_VALUESTAT__
 
 #include "value.h"
+#include "runningstat.h"
 
 #include <deque>
 
@@ -52,7 +53,7 @@ class ValueDoubleStat:public ValueDouble
 		virtual int setValue (Connection * connection);
 		virtual const char *getValue ();
 		virtual const char *getDisplayValue ();
-		virtual void send (Connection * connection);
+		virtual std::string getSendMessage ();
 		virtual void setFromValue (Value * newValue);
 
 		int getNumMes () { return numMes; }
@@ -77,16 +78,19 @@ class ValueDoubleStat:public ValueDouble
 
 		double getStdev () { return stdev; }
 
-		std::deque < double >&getMesList () { return valueList; }
+		const std::deque < double >&getMesList () { return valueList; }
 
 		/**
-		 * Add value to the measurement values.
+		 * Add value to the measurement values. NaN values are ignored.
 		 *
 		 * @param in_val Value which will be added.
 		 */
 		void addValue (double in_val)
 		{
+			if (std::isnan (in_val))
+				return;
 			valueList.push_back (in_val);
+			runStat.add (in_val);
 			changed ();
 		}
 
@@ -99,8 +103,15 @@ class ValueDoubleStat:public ValueDouble
 		 */
 		void addValue (double in_val, size_t maxQueSize)
 		{
+			if (std::isnan (in_val))
+				return;
 			while (valueList.size () >= maxQueSize)
+			{
+				runStat.remove (valueList.front ());
 				valueList.pop_front ();
+			}
+			if (runStat.getRemovals () > maxQueSize)
+				rebuildStat ();
 			addValue (in_val);
 		}
 		std::deque <double>::iterator valueBegin () { return valueList.begin (); }
@@ -112,6 +123,11 @@ class ValueDoubleStat:public ValueDouble
 		double max;
 		double stdev;
 		std::deque < double >valueList;
+
+		// statistics updated with every added and removed value
+		RunningStat runStat;
+
+		void rebuildStat ();
 };
 
 /**
@@ -139,7 +155,7 @@ class ValueDoubleTimeserie:public ValueDouble
 		virtual int setValue (Connection * connection);
 		virtual const char *getValue ();
 		virtual const char *getDisplayValue ();
-		virtual void send (Connection * connection);
+		virtual std::string getSendMessage ();
 		virtual void setFromValue (Value * newValue);
 
 		int getNumMes () { return numMes; }
@@ -166,16 +182,20 @@ class ValueDoubleTimeserie:public ValueDouble
 
 		double getBeta () { return beta; }
 
-		std::deque < std::pair <double, double> >& getMesList () { return valueList; }
+		const std::deque < std::pair <double, double> >& getMesList () { return valueList; }
 
 		/**
-		 * Add value to the measurement values.
+		 * Add value to the measurement values. Values with NaN value
+		 * or time are ignored.
 		 *
 		 * @param in_val Value which will be added.
 		 */
 		void addValue (double in_val, double in_time)
 		{
+			if (std::isnan (in_val) || std::isnan (in_time))
+				return;
 			valueList.push_back (std::pair <double, double> (in_val, in_time) );
+			runStat.add (in_val, in_time);
 			changed ();
 		}
 
@@ -188,8 +208,15 @@ class ValueDoubleTimeserie:public ValueDouble
 		 */
 		void addValue (double in_val, double in_time, size_t maxQueSize)
 		{
+			if (std::isnan (in_val) || std::isnan (in_time))
+				return;
 			while (valueList.size () >= maxQueSize)
+			{
+				runStat.remove (valueList.front ().first, valueList.front ().second);
 				valueList.pop_front ();
+			}
+			if (runStat.getRemovals () > maxQueSize)
+				rebuildStat ();
 			addValue (in_val, in_time);
 		}
 		std::deque <std::pair <double, double> >::iterator valueBegin () { return valueList.begin (); }
@@ -205,6 +232,11 @@ class ValueDoubleTimeserie:public ValueDouble
 		double alpha;
 		double beta;
 		std::deque < std::pair <double, double> > valueList;
+
+		// statistics updated with every added and removed value
+		RunningStat runStat;
+
+		void rebuildStat ();
 };
 
 }
@@ -38,6 +38,9 @@ namespace XmlRpc
 			//! Close the owned fd. If deleteOnClose was specified at construction, the object is deleted.
 			virtual void close();
 
+			//! Specify function called before any source file descriptor is closed.
+			static void setCloseFd(void (*closeFD) (int)) { _closeFD = closeFD; }
+
 			//! Return true to continue monitoring this source
 			virtual unsigned handleEvent(unsigned eventType) = 0;
 
@@ -62,6 +65,9 @@ namespace XmlRpc
 
 			// In the client, keep connections open if you intend to make multiple calls.
 			bool _keepOpen;
+
+			// Called before file descriptor is closed, so the polling loop can forget it.
+			static void (*_closeFD) (int);
 	};
 }								 // namespace XmlRpc
 #endif							 //_XMLRPCSOURCE_H_
@@ -0,0 +1,248 @@
+/*
+ * Histogram with fixed number of bins and adaptive range.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "binnedhistogram.h"
+
+#include <cmath>
+#include <limits>
+#include <string.h>
+
+using namespace rts2core;
+
+BinnedHistogram::BinnedHistogram (size_t _nbins)
+{
+	counts = NULL;
+	nbins = 0;
+	setBins (_nbins);
+}
+
+BinnedHistogram::~BinnedHistogram ()
+{
+	delete[] counts;
+}
+
+void BinnedHistogram::setBins (size_t _nbins)
+{
+	if (_nbins < 2)
+		_nbins = 2;
+	// merging of bins needs even number of bins
+	_nbins += _nbins % 2;
+	if (_nbins != nbins)
+	{
+		delete[] counts;
+		nbins = _nbins;
+		counts = new uint64_t[nbins];
+	}
+	fixedRange = false;
+	clear ();
+}
+
+void BinnedHistogram::setRange (double _low, double _high)
+{
+	memset (counts, 0, nbins * sizeof (uint64_t));
+	total = 0;
+	outliers = 0;
+	seenMin = NAN;
+	seenMax = NAN;
+
+	low = _low;
+	high = _high;
+	width = (high - low) / nbins;
+	integer = false;
+	rangeSet = true;
+	fixedRange = true;
+}
+
+void BinnedHistogram::clear ()
+{
+	memset (counts, 0, nbins * sizeof (uint64_t));
+	total = 0;
+	outliers = 0;
+	seenMin = NAN;
+	seenMax = NAN;
+	if (!fixedRange)
+		rangeSet = false;
+}
+
+void BinnedHistogram::nextFrame ()
+{
+	double mi = seenMin;
+	double ma = seenMax;
+	clear ();
+	if (!fixedRange && !std::isnan (mi))
+		learnRange (mi, ma);
+}
+
+template <typename t> void BinnedHistogram::add (const t *data, size_t pixels)
+{
+	if (pixels == 0)
+		return;
+
+	double mi = seenMin;
+	double ma = seenMax;
+
+	if (!rangeSet)
+	{
+		integer = std::numeric_limits <t>::is_integer;
+		double dmi = INFINITY;
+		double dma = -INFINITY;
+		for (size_t i = 0; i < pixels; i++)
+		{
+			double d = data[i];
+			if (!std::isfinite (d))
+				continue;
+			if (d < dmi)
+				dmi = d;
+			if (d > dma)
+				dma = d;
+		}
+		// no finite value
+		if (dmi > dma)
+		{
+			outliers += pixels;
+			return;
+		}
+		learnRange (dmi, dma);
+	}
+
+	double inv = 1 / width;
+	uint64_t added = 0;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		double d = data[i];
+		if (!(d >= low && d < high))
+		{
+			if (fixedRange || !std::isfinite (d))
+			{
+				outliers++;
+				continue;
+			}
+			extend (d);
+			inv = 1 / width;
+		}
+		size_t b = (size_t) ((d - low) * inv);
+		// guard against rounding errors
+		if (b >= nbins)
+			b = nbins - 1;
+		counts[b]++;
+		added++;
+		if (!(d >= mi))
+			mi = d;
+		if (!(d <= ma))
+			ma = d;
+	}
+	total += added;
+	seenMin = mi;
+	seenMax = ma;
+}
+
+double BinnedHistogram::getMode ()
+{
+	if (total == 0)
+		return NAN;
+	size_t m = 0;
+	for (size_t i = 1; i < nbins; i++)
+	{
+		if (counts[i] > counts[m])
+			m = i;
+	}
+	if (integer)
+		return low + m * width + floor ((width - 1) / 2);
+	return low + (m + 0.5) * width;
+}
+
+double BinnedHistogram::getQuantile (double q)
+{
+	if (total == 0)
+		return NAN;
+	double target = q * total;
+	uint64_t cum = 0;
+	size_t i;
+	for (i = 0; i < nbins - 1; i++)
+	{
+		if (cum + counts[i] > target)
+			break;
+		cum += counts[i];
+	}
+	double frac = counts[i] > 0 ? (target - cum) / counts[i] : 0;
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+	if (integer)
+	{
+		double off = floor (frac * width);
+		if (off > width - 1)
+			off = width - 1;
+		return low + i * width + off;
+	}
+	return low + (i + frac) * width;
+}
+
+void BinnedHistogram::learnRange (double mi, double ma)
+{
+	if (integer)
+	{
+		low = floor (mi);
+		width = ceil ((floor (ma) - low + 1) / nbins);
+		if (width < 1)
+			width = 1;
+	}
+	else
+	{
+		low = mi;
+		double span = ma - mi;
+		if (span <= 0)
+			span = fabs (mi) > 0 ? fabs (mi) * 1e-3 : 1;
+		// maximum must be inside the last bin
+		width = span / (nbins - 1);
+	}
+	high = low + nbins * width;
+	rangeSet = true;
+}
+
+void BinnedHistogram::extend (double v)
+{
+	size_t half = nbins / 2;
+	while (v >= high)
+	{
+		for (size_t i = 0; i < half; i++)
+			counts[i] = counts[2 * i] + counts[2 * i + 1];
+		memset (counts + half, 0, half * sizeof (uint64_t));
+		width *= 2;
+		high = low + nbins * width;
+	}
+	while (v < low)
+	{
+		for (size_t i = nbins - 1; i >= half; i--)
+			counts[i] = counts[2 * i - nbins] + counts[2 * i - nbins + 1];
+		memset (counts, 0, half * sizeof (uint64_t));
+		width *= 2;
+		low = high - nbins * width;
+	}
+}
+
+template void BinnedHistogram::add (const uint8_t *data, size_t pixels);
+template void BinnedHistogram::add (const int8_t *data, size_t pixels);
+template void BinnedHistogram::add (const int16_t *data, size_t pixels);
+template void BinnedHistogram::add (const uint16_t *data, size_t pixels);
+template void BinnedHistogram::add (const int32_t *data, size_t pixels);
+template void BinnedHistogram::add (const uint32_t *data, size_t pixels);
+template void BinnedHistogram::add (const int64_t *data, size_t pixels);
+template void BinnedHistogram::add (const float *data, size_t pixels);
+template void BinnedHistogram::add (const double *data, size_t pixels);
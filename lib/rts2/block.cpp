@@ -51,16 +51,41 @@ const char *type_names[] =
 //* Size of pollfd descriptors allocated
 #define POLLS_SIZE    200
 
+//* Maximal number of events returned from single epoll_wait call
+#define EPOLL_EVENTS  256
+
+// default limit of connection output queue (in bytes)
+#define OUTPUT_QUEUE_LIMIT  (16 * 1024 * 1024)
+
 using namespace rts2core;
 
 Block::Block (int in_argc, char **in_argv):App (in_argc, in_argv)
 {
 	idle_timeout = USEC_SEC * 10;
+	outputQueueLimit = OUTPUT_QUEUE_LIMIT;
 
 	pollsize = POLLS_SIZE;
 	fds = new struct pollfd[pollsize];
 	npolls = 0;
 
+	epollfd = -1;
+	pollCollect = NULL;
+
+	if (pipe (wakeupPipe) == 0)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			fcntl (wakeupPipe[i], F_SETFL, O_NONBLOCK);
+			fcntl (wakeupPipe[i], F_SETFD, FD_CLOEXEC);
+		}
+	}
+	else
+	{
+		wakeupPipe[0] = wakeupPipe[1] = -1;
+	}
+	pthread_mutex_init (&queuedEventsLock, NULL);
+	loopLock = NULL;
+
 	signal (SIGPIPE, SIG_IGN);
 
 	masterState = SERVERD_HARD_OFF;
@@ -92,6 +117,15 @@ Block::~Block (void)
 		delete *iu;
 	delete[] fds;
 	blockUsers.clear ();
+	epollReset ();
+	for (std::list <std::pair <Object *, Event *> >::iterator ie = queuedEvents.begin (); ie != queuedEvents.end (); ie++)
+		delete ie->second;
+	pthread_mutex_destroy (&queuedEventsLock);
+	if (wakeupPipe[0] >= 0)
+	{
+		close (wakeupPipe[0]);
+		close (wakeupPipe[1]);
+	}
 }
 
 void Block::setPort (int in_port)
@@ -107,7 +141,17 @@ int Block::getPort (void)
 void Block::addPollSocks ()
 {
 	connections_t::iterator iter;
-	npolls = 0;
+	clearPollFDs ();
+	if (wakeupPipe[0] >= 0)
+		addPollFD (wakeupPipe[0], POLLIN);
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	// connection descriptors are kept in epoll interest set
+	if (epollfd >= 0)
+	{
+		epollUpdateConnections ();
+		return;
+	}
+#endif
 	for (iter = connections.begin (); iter != connections.end (); iter++)
 		(*iter)->add (this);
 	for (iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
@@ -141,6 +185,47 @@ void Block::postEvent (Event * event)
 	return App::postEvent (event);
 }
 
+void Block::queEvent (Event *event, Object *target)
+{
+	pthread_mutex_lock (&queuedEventsLock);
+	queuedEvents.push_back (std::pair <Object *, Event *> (target, event));
+	pthread_mutex_unlock (&queuedEventsLock);
+	wakeup ();
+}
+
+void Block::wakeup ()
+{
+	if (wakeupPipe[1] < 0)
+		return;
+	char c = 0;
+	// pipe full is fine - main loop will be woken up anyway
+	if (write (wakeupPipe[1], &c, 1) < 0 && errno != EAGAIN)
+		logStream (MESSAGE_ERROR) << "cannot wake up main loop: " << strerror (errno) << sendLog;
+}
+
+void Block::postQueuedEvents ()
+{
+	if (wakeupPipe[0] >= 0)
+	{
+		char buf[64];
+		while (read (wakeupPipe[0], buf, sizeof (buf)) > 0)
+			;
+	}
+
+	std::list <std::pair <Object *, Event *> > events;
+	pthread_mutex_lock (&queuedEventsLock);
+	events.swap (queuedEvents);
+	pthread_mutex_unlock (&queuedEventsLock);
+
+	for (std::list <std::pair <Object *, Event *> >::iterator iter = events.begin (); iter != events.end (); iter++)
+	{
+		if (iter->first != NULL)
+			iter->first->postEvent (iter->second);
+		else
+			postEvent (iter->second);
+	}
+}
+
 Connection * Block::createConnection (int in_sock)
 {
 	return new Connection (in_sock, this);
@@ -161,6 +246,7 @@ void Block::removeConnection (Connection *_conn)
 		else
 			iter++;
 	}
+	connectionPollRemoved (_conn);
 
 	for (iter = connections_added.begin (); iter != connections_added.end ();)
 	{
@@ -174,7 +260,10 @@ void Block::removeConnection (Connection *_conn)
 void Block::addCentraldConnection (Connection *_conn, bool added)
 {
 	if (added)
+	{
 	  	centraldConns.push_back (_conn);
+		activateConnection (_conn);
+	}
 	else
 		centraldConns_added.push_back (_conn);
 }
@@ -269,40 +358,46 @@ int Block::idle ()
 	}
 	connections_t::iterator iter;
 	for (iter = connections.begin (); iter != connections.end (); iter++)
+	{
 		(*iter)->idle ();
+		// socket was replaced without notification
+		if ((*iter)->polledSock != (*iter)->sock)
+			connectionPollChanged (*iter);
+	}
 	for (iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
+	{
 		(*iter)->idle ();
+		if ((*iter)->polledSock != (*iter)->sock)
+			connectionPollChanged (*iter);
+	}
 
 	// add from connection queue..
 	for (iter = connections_added.begin (); iter != connections_added.end (); iter = connections_added.erase (iter))
 	{
 		connections.push_back (*iter);
+		activateConnection (*iter);
 	}
 
 	for (iter = centraldConns_added.begin (); iter != centraldConns_added.end (); iter = centraldConns_added.erase (iter))
 	{
 		centraldConns.push_back (*iter);
+		activateConnection (*iter);
 	}
 
-	// test for any pending timers..
-	std::map <double, Event *>::iterator iter_t = timers.begin ();
-	while (iter_t != timers.end () && iter_t->first < getNow ())
-	{
-		if (pushToDelete (iter_t))
-		{
-			Event *sec = iter_t->second;
-		 	if (sec->getArg () != NULL)
-			  	((Object *)sec->getArg ())->postEvent (sec);
-			else
-				postEvent (sec);
-		}
-		iter_t++;
-	}
+	postQueuedEvents ();
 
-	// delete timers queue for delete
-	for (std::vector <std::map <double, Event *>::iterator>::iterator iter_d = toDelete.begin (); iter_d != toDelete.end (); iter_d = toDelete.erase (iter_d))
+	// post expired timers; timer is never posted before its time
+	double now = getNow ();
+	double t_time;
+	Event *sec;
+	timers.startExpire ();
+	while ((sec = timers.popExpired (now, &t_time)) != NULL)
 	{
-		timers.erase (*iter_d);
+		timerExpired (now > t_time ? now - t_time : 0);
+		if (sec->getArg () != NULL)
+			((Object *)sec->getArg ())->postEvent (sec);
+		else
+			postEvent (sec);
 	}
 
 	return 0;
@@ -315,6 +410,14 @@ void Block::pollSuccess ()
 
 	connections_t::iterator iter;
 
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (epollfd >= 0)
+	{
+		epollDispatch ();
+		return;
+	}
+#endif
+
 	for (iter = connections.begin (); iter != connections.end ();)
 	{
 		conn = *iter;
@@ -379,7 +482,12 @@ void Block::oneRunLoop ()
 	struct timespec read_tout;
 	double t_diff;
 
-	if (timers.begin () != timers.end () && (USEC_SEC * (t_diff = (timers.begin ()->first - getNow ()))) < idle_timeout)
+	if (loopLock)
+		pthread_mutex_lock (loopLock);
+
+	double next_timer = timers.nextDeadline ();
+
+	if (!std::isnan (next_timer) && (USEC_SEC * (t_diff = (next_timer - getNow ()))) < idle_timeout)
 	{
 		if (t_diff <= 0)
 		{
@@ -407,9 +515,27 @@ void Block::oneRunLoop ()
 	}
 
 	addPollSocks ();
-	if (ppoll (fds, npolls, &read_tout, NULL) > 0)
+
+	if (loopLock)
+		pthread_mutex_unlock (loopLock);
+
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (epollfd >= 0)
+		ret = epollWait (&read_tout);
+	else
+#endif
+	ret = ppoll (fds, npolls, &read_tout, NULL);
+
+	if (loopLock)
+		pthread_mutex_lock (loopLock);
+
+	if (ret > 0)
 		pollSuccess ();
 	ret = idle ();
+
+	if (loopLock)
+		pthread_mutex_unlock (loopLock);
+
 	if (ret == -1)
 		endRunLoop ();
 }
@@ -504,10 +630,38 @@ std::map <Connection *, std::vector <Value *> > Block::failedValues ()
 
 void Block::addPollFD (int fd, short events)
 {
+	if (fd < 0)
+		return;
+	if (pollCollect)
+	{
+		for (std::vector <struct pollfd>::iterator iter = pollCollect->begin (); iter != pollCollect->end (); iter++)
+		{
+			if (iter->fd == fd)
+			{
+				iter->events |= events;
+				return;
+			}
+		}
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = events;
+		pfd.revents = 0;
+		pollCollect->push_back (pfd);
+		return;
+	}
+	if ((size_t) fd >= pollIndex.size ())
+		pollIndex.resize (fd + 1, -1);
+	// descriptor is already polled, merge events
+	if (pollIndex[fd] >= 0)
+	{
+		fds[pollIndex[fd]].events |= events;
+		return;
+	}
 	if (npolls == pollsize)
 	{
 		struct pollfd *npollfds;
-		npollfds = new struct pollfd[npolls + POLLS_SIZE];
+		pollsize += POLLS_SIZE;
+		npollfds = new struct pollfd[pollsize];
 		memcpy ((void *) npollfds, (void *) fds, sizeof (struct pollfd) * npolls);
 		delete[] fds;
 		fds = npollfds;
@@ -515,19 +669,459 @@ void Block::addPollFD (int fd, short events)
 	fds[npolls].fd = fd;
 	fds[npolls].events = events;
 	fds[npolls].revents = 0;
+	pollIndex[fd] = npolls;
 	npolls++;
 }
 
 short Block::getPollEvents (int fd)
 {
-	for (nfds_t i = 0; i < npolls; i++)
+	if (fd < 0)
+		return 0;
+	if ((size_t) fd < pollIndex.size () && pollIndex[fd] >= 0)
+		return fds[pollIndex[fd]].revents;
+	// descriptors of connections are not in fds array with epoll reactor
+	if ((size_t) fd < pollEntries.size () && pollEntries[fd] != NULL)
+		return pollEntries[fd]->revents;
+	return 0;
+}
+
+int Block::setUseEpoll (bool use)
+{
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (use == getUseEpoll ())
+		return 0;
+	epollReset ();
+	if (use)
+	{
+		epollfd = epoll_create1 (EPOLL_CLOEXEC);
+		if (epollfd < 0)
+		{
+			logStream (MESSAGE_ERROR) << "cannot create epoll descriptor: " << strerror (errno) << sendLog;
+			return -1;
+		}
+		// register already existing connections
+		connections_t::iterator iter;
+		for (iter = connections.begin (); iter != connections.end (); iter++)
+			connectionPollChanged (*iter);
+		for (iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
+			connectionPollChanged (*iter);
+	}
+	return 0;
+#else
+	if (use)
 	{
-		if (fds[i].fd == fd)
-			return fds[i].revents;
+		logStream (MESSAGE_ERROR) << "epoll is not available on this system" << sendLog;
+		return -1;
 	}
 	return 0;
+#endif
+}
+
+void Block::pollFDClosed (int fd)
+{
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (epollfd < 0 || fd < 0 || (size_t) fd >= pollEntries.size () || pollEntries[fd] == NULL)
+		return;
+	Connection *conn = pollEntries[fd]->conn;
+	epollRemove (fd);
+	if (conn)
+	{
+		std::map <Connection *, std::vector <int> >::iterator iter = epollConnFds.find (conn);
+		if (iter != epollConnFds.end ())
+			iter->second.erase (std::remove (iter->second.begin (), iter->second.end (), fd), iter->second.end ());
+		connectionPollChanged (conn);
+	}
+#endif
+}
+
+void Block::connectionPollChanged (Connection *conn)
+{
+	if (epollfd < 0 || !conn->pollActive || conn->pollQueued)
+		return;
+	conn->pollQueued = true;
+	pollChangedConns.push_back (conn);
+}
+
+void Block::connectionPollRemoved (Connection *conn)
+{
+	conn->pollActive = false;
+	conn->polledSock = -1;
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	std::map <Connection *, std::vector <int> >::iterator iter = epollConnFds.find (conn);
+	if (iter != epollConnFds.end ())
+	{
+		for (std::vector <int>::iterator fi = iter->second.begin (); fi != iter->second.end (); fi++)
+		{
+			if (pollEntries[*fi]->conn == conn)
+				epollRemove (*fi);
+		}
+		epollConnFds.erase (iter);
+	}
+#endif
+	// lists are walked by index, connection is only cleared from them
+	if (conn->pollQueued)
+		std::replace (pollChangedConns.begin (), pollChangedConns.end (), conn, (Connection *) NULL);
+	if (conn->pollReady)
+		std::replace (readyConns.begin (), readyConns.end (), conn, (Connection *) NULL);
+	conn->pollQueued = false;
+	conn->pollReady = false;
+}
+
+void Block::activateConnection (Connection *conn)
+{
+	conn->pollActive = true;
+	connectionPollChanged (conn);
+}
+
+void Block::forkedInstance ()
+{
+	// epoll interest set is shared with the parent process, child shall not touch it
+	if (epollfd >= 0)
+	{
+		close (epollfd);
+		epollfd = -1;
+		epollReset ();
+	}
+	App::forkedInstance ();
+}
+
+void Block::clearPollFDs ()
+{
+	for (nfds_t i = 0; i < npolls; i++)
+		pollIndex[fds[i].fd] = -1;
+	npolls = 0;
 }
 
+void Block::epollReset ()
+{
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	if (epollfd >= 0)
+	{
+		close (epollfd);
+		epollfd = -1;
+	}
+#endif
+	for (std::vector <PollEntry *>::iterator iter = pollEntries.begin (); iter != pollEntries.end (); iter++)
+		delete *iter;
+	pollEntries.clear ();
+	epollFds.clear ();
+	epollConnFds.clear ();
+	for (std::vector <Connection *>::iterator iter = pollChangedConns.begin (); iter != pollChangedConns.end (); iter++)
+		if (*iter)
+			(*iter)->pollQueued = false;
+	pollChangedConns.clear ();
+	for (std::vector <Connection *>::iterator iter = readyConns.begin (); iter != readyConns.end (); iter++)
+		if (*iter)
+			(*iter)->pollReady = false;
+	readyConns.clear ();
+	readyEntries.clear ();
+	nonPollableEntries.clear ();
+}
+
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+Block::PollEntry *Block::getPollEntry (int fd)
+{
+	if ((size_t) fd >= pollEntries.size ())
+		pollEntries.resize (fd + 1, NULL);
+	if (pollEntries[fd] == NULL)
+	{
+		PollEntry *entry = new PollEntry;
+		entry->fd = fd;
+		entry->conn = NULL;
+		entry->events = 0;
+		entry->revents = 0;
+		entry->registered = false;
+		entry->nonPollable = false;
+		pollEntries[fd] = entry;
+	}
+	return pollEntries[fd];
+}
+
+void Block::epollSet (PollEntry *entry, short events, Connection *conn)
+{
+	int ret;
+	struct epoll_event ev;
+
+	entry->conn = conn;
+	// descriptors which cannot be polled are tracked once and reported as ready
+	if (entry->nonPollable || (entry->registered && entry->events == events))
+	{
+		entry->events = events;
+		return;
+	}
+
+	ev.events = 0;
+	if (events & POLLIN)
+		ev.events |= EPOLLIN;
+	if (events & POLLPRI)
+		ev.events |= EPOLLPRI;
+	if (events & POLLOUT)
+		ev.events |= EPOLLOUT;
+	if (events & POLLRDHUP)
+		ev.events |= EPOLLRDHUP;
+	ev.data.ptr = entry;
+
+	if (entry->registered)
+	{
+		ret = epoll_ctl (epollfd, EPOLL_CTL_MOD, entry->fd, &ev);
+		// descriptor was closed and reopened
+		if (ret && errno == ENOENT)
+			ret = epoll_ctl (epollfd, EPOLL_CTL_ADD, entry->fd, &ev);
+	}
+	else
+	{
+		ret = epoll_ctl (epollfd, EPOLL_CTL_ADD, entry->fd, &ev);
+		// descriptor was not closed through pollFDClosed
+		if (ret && errno == EEXIST)
+			ret = epoll_ctl (epollfd, EPOLL_CTL_MOD, entry->fd, &ev);
+	}
+
+	entry->events = events;
+	if (ret == 0)
+	{
+		entry->registered = true;
+		return;
+	}
+
+	entry->registered = false;
+	// regular files cannot be polled by epoll, but are always ready for poll
+	if (errno == EPERM)
+	{
+		entry->nonPollable = true;
+		nonPollableEntries.push_back (entry);
+		return;
+	}
+	logStream (MESSAGE_ERROR) << "cannot add descriptor " << entry->fd << " to epoll: " << strerror (errno) << sendLog;
+	entry->revents = POLLNVAL;
+	readyEntries.push_back (entry);
+	if (conn)
+		epollReady (conn);
+}
+
+void Block::epollRemove (int fd)
+{
+	PollEntry *entry = pollEntries[fd];
+	if (entry->registered)
+		epoll_ctl (epollfd, EPOLL_CTL_DEL, fd, NULL);
+	if (entry->nonPollable)
+		nonPollableEntries.erase (std::remove (nonPollableEntries.begin (), nonPollableEntries.end (), entry), nonPollableEntries.end ());
+	entry->conn = NULL;
+	entry->events = 0;
+	entry->revents = 0;
+	entry->registered = false;
+	entry->nonPollable = false;
+}
+
+void Block::epollConnection (Connection *conn)
+{
+	std::vector <struct pollfd> polled;
+	pollCollect = &polled;
+	conn->add (this);
+	pollCollect = NULL;
+
+	// add might end in connection error, which deletes it from lists
+	if (!conn->pollActive)
+		return;
+
+	conn->polledSock = conn->sock;
+
+	std::vector <int> &old = epollConnFds[conn];
+	for (std::vector <int>::iterator iter = old.begin (); iter != old.end (); iter++)
+	{
+		bool found = false;
+		for (std::vector <struct pollfd>::iterator pi = polled.begin (); pi != polled.end (); pi++)
+		{
+			if (pi->fd == *iter)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found && pollEntries[*iter]->conn == conn)
+			epollRemove (*iter);
+	}
+
+	old.clear ();
+	for (std::vector <struct pollfd>::iterator pi = polled.begin (); pi != polled.end (); pi++)
+	{
+		epollSet (getPollEntry (pi->fd), pi->events, conn);
+		old.push_back (pi->fd);
+	}
+	if (old.empty ())
+		epollConnFds.erase (conn);
+
+	// connections marked for deletion are deleted in pollSuccess
+	if (conn->isConnState (CONN_DELETE))
+		epollReady (conn);
+}
+
+void Block::epollUpdateConnections ()
+{
+	std::vector <Connection *> changed;
+	changed.swap (pollChangedConns);
+	for (std::vector <Connection *>::iterator iter = changed.begin (); iter != changed.end (); iter++)
+	{
+		// connection was removed
+		if (*iter == NULL)
+			continue;
+		(*iter)->pollQueued = false;
+		if ((*iter)->pollActive)
+			epollConnection (*iter);
+	}
+}
+
+void Block::epollReady (Connection *conn)
+{
+	if (conn->pollReady)
+		return;
+	conn->pollReady = true;
+	readyConns.push_back (conn);
+}
+
+void Block::epollDispatch ()
+{
+	// connections can be deleted from receive calls of other connections, so list is walked by index
+	for (size_t i = 0; i < readyConns.size (); i++)
+	{
+		Connection *conn = readyConns[i];
+		if (conn == NULL)
+			continue;
+		readyConns[i] = NULL;
+		conn->pollReady = false;
+		if (conn->receive (this) == -1 || conn->writable (this) == -1)
+		{
+			// delete connection only when it really requested to be deleted..
+			if (!deleteConnection (conn))
+			{
+				connections_t::iterator iter = std::find (connections.begin (), connections.end (), conn);
+				if (iter != connections.end ())
+				{
+					connections.erase (iter);
+				}
+				else
+				{
+					iter = std::find (centraldConns.begin (), centraldConns.end (), conn);
+					if (iter != centraldConns.end ())
+						centraldConns.erase (iter);
+				}
+				connectionRemoved (conn);
+				delete conn;
+				continue;
+			}
+		}
+		// receive and writable change output queue and state
+		connectionPollChanged (conn);
+	}
+	readyConns.clear ();
+}
+
+int Block::epollWait (const struct timespec *tout)
+{
+	int nready = 0;
+
+	// clear events of the previous loop
+	for (std::vector <PollEntry *>::iterator iter = readyEntries.begin (); iter != readyEntries.end (); iter++)
+		(*iter)->revents = 0;
+	readyEntries.clear ();
+
+	// connections marked for deletion and descriptors which failed to register
+	for (std::vector <Connection *>::iterator iter = readyConns.begin (); iter != readyConns.end (); iter++)
+	{
+		if (*iter)
+			nready++;
+	}
+
+	// remove descriptors added by addPollSocks which are no longer polled
+	for (std::vector <int>::iterator iter = epollFds.begin (); iter != epollFds.end ();)
+	{
+		int fd = *iter;
+		if ((size_t) fd >= pollIndex.size ())
+			pollIndex.resize (fd + 1, -1);
+		PollEntry *entry = pollEntries[fd];
+		if (entry->conn == NULL && pollIndex[fd] >= 0)
+		{
+			iter++;
+			continue;
+		}
+		if (entry->conn == NULL)
+			epollRemove (fd);
+		iter = epollFds.erase (iter);
+	}
+
+	// register new descriptors and descriptors with changed events
+	for (nfds_t i = 0; i < npolls; i++)
+	{
+		fds[i].revents = 0;
+		PollEntry *entry = getPollEntry (fds[i].fd);
+		// descriptor is owned by connection
+		if (entry->conn)
+			continue;
+		if (!entry->registered && !entry->nonPollable && std::find (epollFds.begin (), epollFds.end (), fds[i].fd) == epollFds.end ())
+			epollFds.push_back (fds[i].fd);
+		epollSet (entry, fds[i].events, NULL);
+		if (entry->revents)
+		{
+			fds[i].revents = entry->revents;
+			nready++;
+		}
+	}
+
+	// regular files are ready for poll
+	for (std::vector <PollEntry *>::iterator iter = nonPollableEntries.begin (); iter != nonPollableEntries.end (); iter++)
+	{
+		PollEntry *entry = *iter;
+		entry->revents = entry->events & (POLLIN | POLLOUT);
+		if (entry->revents == 0)
+			continue;
+		readyEntries.push_back (entry);
+		if ((size_t) entry->fd < pollIndex.size () && pollIndex[entry->fd] >= 0)
+			fds[pollIndex[entry->fd]].revents = entry->revents;
+		if (entry->conn)
+			epollReady (entry->conn);
+		nready++;
+	}
+
+	// ready descriptors, do not wait
+	int timeout = 0;
+	if (nready == 0)
+		timeout = (tout->tv_sec * 1000) + (tout->tv_nsec + 999999) / 1000000;
+
+	struct epoll_event events[EPOLL_EVENTS];
+	int ret = epoll_wait (epollfd, events, EPOLL_EVENTS, timeout);
+	if (ret < 0)
+	{
+		if (errno != EINTR)
+			logStream (MESSAGE_ERROR) << "epoll_wait failed: " << strerror (errno) << sendLog;
+		return nready > 0 ? nready : ret;
+	}
+
+	for (int i = 0; i < ret; i++)
+	{
+		PollEntry *entry = (PollEntry *) events[i].data.ptr;
+		short revents = 0;
+		if (events[i].events & EPOLLIN)
+			revents |= POLLIN;
+		if (events[i].events & EPOLLPRI)
+			revents |= POLLPRI;
+		if (events[i].events & EPOLLOUT)
+			revents |= POLLOUT;
+		if (events[i].events & EPOLLRDHUP)
+			revents |= POLLRDHUP;
+		if (events[i].events & EPOLLERR)
+			revents |= POLLERR;
+		if (events[i].events & EPOLLHUP)
+			revents |= POLLHUP;
+		entry->revents = revents;
+		readyEntries.push_back (entry);
+		if (entry->conn)
+			epollReady (entry->conn);
+		else if ((size_t) entry->fd < pollIndex.size () && pollIndex[entry->fd] >= 0)
+			fds[pollIndex[entry->fd]].revents = revents;
+	}
+	return nready + ret;
+}
+#endif
+
 bool Block::centralServerInState (rts2_status_t state)
 {
 	for (connections_t::iterator iter = centraldConns.begin (); iter != centraldConns.end (); iter++)
@@ -988,19 +1582,6 @@ bool Block::commandOriginatorPending (Object * object, Connection * exclude_conn
 	return false;
 }
 
-void Block::deleteTimers (int event_type)
-{
-	for (std::map <double, Event *>::iterator iter = timers.begin (); iter != timers.end (); )
-	{
-		if (iter->second->getType () == event_type)
-		{
-			if (pushToDelete (iter))
-				delete (iter->second);
-		}
-		iter++;
-	}
-}
-
 void Block::valueMaskError (Value *val, int32_t err)
 {
   	if ((val->getFlags () & RTS2_VALUE_ERRORMASK) != err)
@@ -1010,17 +1591,6 @@ void Block::valueMaskError (Value *val, int32_t err)
 	}
 }
 
-bool Block::pushToDelete (const std::map <double, Event *>::iterator &iter)
-{
-	// only push unique iterators
-	if (std::find (toDelete.begin (), toDelete.end (), iter) == toDelete.end ())
-	{
-		toDelete.push_back (iter);
-		return true;
-	}
-	return false;
-}
-
 bool isCentraldName (const char *_name)
 {
 	return !strcmp (_name, "..") || !strcmp (_name, "centrald");
@@ -1036,3 +1606,8 @@ short getMasterGetEvents (int fd)
 	return ((Block *) getMasterApp ())->getPollEvents (fd);
 }
 
+void getMasterPollFDClosed (int fd)
+{
+	((Block *) getMasterApp ())->pollFDClosed (fd);
+}
+
@@ -47,6 +47,8 @@
 #define OPT_CHANNELS_DELTAS   OPT_LOCAL + 410
 #define OPT_TRIMS_XY          OPT_LOCAL + 411
 #define OPT_TRIMS_END         OPT_LOCAL + 412
+#define OPT_WITHMEMFD         OPT_LOCAL + 413
+#define OPT_MEMFD_HUGE        OPT_LOCAL + 414
 #define OPT_WCS_AUXS          OPT_LOCAL + 420
 #define OPT_COMMENTS          OPT_LOCAL + 421
 #define OPT_HISTORIES         OPT_LOCAL + 422
@@ -165,8 +167,7 @@ long Camera::isExposing ()
 
 int Camera::endExposure (int ret)
 {
-	if (modeCount)
-		memset (modeCount, 0, modeCountSize * sizeof (uint32_t));
+	pixelStats.reset ();
 	if (exposureConn)
 	{
 		logStream (MESSAGE_INFO) << "end exposure for " << exposureConn->getName () << sendLog;
@@ -224,6 +225,20 @@ int Camera::deleteConnection (rts2core::Connection * conn)
 	return rts2core::ScriptDevice::deleteConnection (conn);
 }
 
+void Camera::addPollSocks ()
+{
+	rts2core::ScriptDevice::addPollSocks ();
+	if (sharedData && sharedData->getListenSocket () >= 0)
+		addPollFD (sharedData->getListenSocket (), POLLIN | POLLPRI);
+}
+
+void Camera::pollSuccess ()
+{
+	if (sharedData && sharedData->getListenSocket () >= 0 && isForRead (sharedData->getListenSocket ()))
+		sharedData->acceptClient ();
+	rts2core::ScriptDevice::pollSuccess ();
+}
+
 int Camera::endReadout ()
 {
 	// that will do anything only if the end was not marked
@@ -353,7 +368,11 @@ int Camera::sendFirstLine (int chan, int pchan)
 
 	focusingHeader->channel = htons (pchan);
 
+	if (chan == 0)
+		startSepStream ();
+
 	sum->setValueDouble (0);
+	sumSquares = 0;
 	average->setValueDouble (0);
 	max->setValueDouble (-LONG_MAX);
 	min->setValueDouble (LONG_MAX);
@@ -434,6 +453,8 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 
 	sharedData = NULL;
 	sharedMemNum = -1;
+	useMemfd = false;
+	memfdHugePages = false;
 
 	currentImageData = -1;
 	currentImageTransfer = TCPIP;
@@ -468,10 +489,14 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 	createValue (min, "min", "minimal pixel value", false);
 	createValue (sum, "sum", "sum of pixels readed out", false);
 	createValue (image_mode, "image_mode", "mode (most often pixel value)", false);
+	createValue (stdev, "stdev", "standard deviation of pixel values", false);
+	sumSquares = 0;
+
+	createValue (statThread, "stat_thread", "calculate statistics in separate thread, while data are send", false, RTS2_VALUE_WRITABLE);
+	statThread->setValueBool (true);
 
-	// mode histogram
-	modeCount = NULL;
-	modeCountSize = 0;
+	createValue (histogramBins, "histogram_bins", "number of histogram bins used to calculate mode of 32 bit and floating point data", false, RTS2_VALUE_WRITABLE);
+	histogramBins->setValueInteger (4096);
 
 	createValue (computedPix, "computed", "number of pixels so far computed", false);
 
@@ -488,6 +513,20 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 
 	sepFind->setValueBool (false);
 
+	createValue (sepThreads, "sep_threads", "number of threads used by SEP", false, RTS2_VALUE_WRITABLE);
+	long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+	sepThreads->setValueInteger (ncpu > 0 ? ncpu : 1);
+	createValue (sepTiles, "sep_tiles", "number of image strips extracted in parallel by SEP", false, RTS2_VALUE_WRITABLE);
+	sepTiles->setValueInteger (sepThreads->getValueInteger () * 2);
+	createValue (sepStream, "sep_stream", "run SEP on image chunks during readout", false, RTS2_VALUE_WRITABLE);
+	sepStream->setValueBool (true);
+	createValue (sepLatency, "sep_latency", "[s] time from end of readout to SEP results", false);
+	createValue (sepRmsMap, "sep_rms_map", "SEP detection threshold relative to background rms map instead of global rms", false, RTS2_VALUE_WRITABLE);
+	sepRmsMap->setValueBool (false);
+
+	sepStreamer = NULL;
+	sepLastData = NAN;
+
 	createValue (slitPosX, "slitposx", "[pixels] slit position along dithering axis", true, RTS2_VALUE_WRITABLE);
 	slitPosX->setValueDouble (-1);
 	createValue (slitPosY, "slitposy", "[pixels] slit position along dithering axis", true, RTS2_VALUE_WRITABLE);
@@ -578,6 +617,8 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 	addOption (OPT_WCS_CDELT, "wcs", 1, "WCS CD matrix (CRPIX1:CRPIX2:CDELT1:CDELT2:CROTA in default, unbinned configuration)");
 	addOption (OPT_WCS_MULTI, "wcs-multi", 1, "letter for multiple WCS (A-Z)");
 	addOption (OPT_WITHSHM, "with-shm", 2, "use given numbers of segments of shared memory");
+	addOption (OPT_WITHMEMFD, "with-memfd", 2, "pass data to local clients in given number of memfd segments (default 10)");
+	addOption (OPT_MEMFD_HUGE, "memfd-huge", 0, "back memfd segments with huge pages");
 
 	// detector sizes, channel starting points and offsets
 	addOption (OPT_DETSIZE, "detsize", 1, "detector size - X:Y:W:H");
@@ -589,13 +630,12 @@ Camera::Camera (int in_argc, char **in_argv, rounding_t binning_rounding):rts2co
 
 Camera::~Camera ()
 {
+	stopSepStream ();
 	delete sharedData;
 	delete fhd;
 
 	delete[] dataBuffers;
 	delete[] dataWritten;
-
-	delete[] modeCount;
 }
 
 int Camera::willConnect (rts2core::NetworkAddress * in_addr)
@@ -891,6 +931,21 @@ int Camera::processOption (int in_opt)
 			else
 				sharedMemNum = atoi (optarg);
 			break;
+		case OPT_WITHMEMFD:
+			useMemfd = true;
+			if (optarg == NULL)
+				sharedMemNum = 10;
+			else
+				sharedMemNum = atoi (optarg);
+			if (sharedMemNum <= 0)
+			{
+				std::cerr << "invalid number of memfd segments: " << optarg << std::endl;
+				return -1;
+			}
+			break;
+		case OPT_MEMFD_HUGE:
+			memfdHugePages = true;
+			break;
 
 		case OPT_DETSIZE:
 			{
@@ -970,61 +1025,100 @@ int Camera::sendImage (char *data, size_t dataSize)
 
 int Camera::sendReadoutData (char *data, size_t dataSize, int chan)
 {
-	std::cerr << "Camera::sendReadoutData " << dataSize << " chan " << chan << " exposureConn " << exposureConn << std::endl;
-	// calculated..
-	if (calculateStatistics->getValueInteger () != STATISTIC_NO)
+	bool calculate = calculateStatistics->getValueInteger () != STATISTIC_NO;
+	bool async = statThread->getValueBool ();
+	ChunkStatistics cs;
+	int sret = 0;
+	// statistics are calculated in parallel with data transfer
+	if (calculate)
+	{
+		bool mode = calculateStatistics->getValueInteger () != STATISTIC_NOMODE;
+		if (async)
+			pixelStats.start (data, dataSize, getDataType (), mode);
+		else
+			sret = pixelStats.calculate (data, dataSize, getDataType (), mode, cs);
+	}
+
+	if (calculateCenter->getValueBool ())
 	{
-		int totPix;
-		// update sum. min and max
 		switch (getDataType ())
 		{
 			case RTS2_DATA_BYTE:
-				totPix = updateStatistics ((uint8_t *) data, dataSize);
+				updateCenter ((uint8_t *) data, dataSize);
 				break;
 			case RTS2_DATA_SHORT:
-				totPix = updateStatistics ((int16_t *) data, dataSize);
+				updateCenter ((int16_t *) data, dataSize);
 				break;
 			case RTS2_DATA_LONG:
-				totPix = updateStatistics ((int32_t *) data, dataSize);
+				updateCenter ((int32_t *) data, dataSize);
 				break;
 			case RTS2_DATA_LONGLONG:
-				totPix = updateStatistics ((int64_t *) data, dataSize);
+				updateCenter ((int64_t *) data, dataSize);
 				break;
 			case RTS2_DATA_FLOAT:
-				totPix = updateStatistics ((float *) data, dataSize);
+				updateCenter ((float *) data, dataSize);
 				break;
 			case RTS2_DATA_DOUBLE:
-				totPix = updateStatistics ((double *) data, dataSize);
+				updateCenter ((double *) data, dataSize);
 				break;
 			case RTS2_DATA_SBYTE:
-				totPix = updateStatistics ((int8_t *) data, dataSize);
+				updateCenter ((int8_t *) data, dataSize);
 				break;
 			case RTS2_DATA_USHORT:
-				totPix = updateStatistics ((uint16_t *) data, dataSize);
+				updateCenter ((uint16_t *) data, dataSize);
 				break;
 			case RTS2_DATA_ULONG:
-				totPix = updateStatistics ((uint32_t *) data, dataSize);
+				updateCenter ((uint32_t *) data, dataSize);
 				break;
 		}
-		computedPix->setValueLong (computedPix->getValueLong () + totPix);
-		average->setValueDouble (sum->getValueDouble () / computedPix->getValueLong ());
+	}
 
-		// find maximal mode value
-		if (modeCount != NULL)
+	if (sepStreamer && chan == 0)
+	{
+		sepLastData = getNow ();
+		if (sep_stream_add (sepStreamer, data, dataSize))
 		{
-			uint32_t modeNum = 0;
-			for (unsigned int i = 0; i < modeCountSize; i++)
-			{
-				if (modeCount[i] > modeNum)
-				{
-					image_mode->setValueInteger (i);
-					modeNum = modeCount[i];
-				}
-			}
+			logStream (MESSAGE_WARNING) << "SEP: cannot process image chunk, stars will be found after readout" << sendLog;
+			stopSepStream ();
+		}
+	}
+
+	if (currentImageTransfer == SHARED)
+		sharedData->dataWritten (chan, dataSize);
+
+	dataWritten[chan] += dataSize;
+
+	int ret = 0;
+	if (exposureConn && currentImageTransfer == TCPIP)
+		ret = exposureConn->sendBinaryData (currentImageData, chan, data, dataSize);
+
+	if (calculate)
+	{
+		if (async)
+			sret = pixelStats.wait (cs);
+		if (sret == 0 && cs.pixels > 0)
+		{
+			// update sum. min and max
+			sum->setValueDouble (sum->getValueDouble () + cs.sum);
+			sumSquares += cs.sumSq;
+			if (cs.min < min->getValueDouble ())
+				min->setValueDouble (cs.min);
+			if (cs.max > max->getValueDouble ())
+				max->setValueDouble (cs.max);
+			computedPix->setValueLong (computedPix->getValueLong () + cs.pixels);
+		}
+		long double n = computedPix->getValueLong ();
+		average->setValueDouble (sum->getValueDouble () / n);
+		stdev->setValueDouble (sqrt (fabs ((sumSquares - sum->getValueDouble () * (long double) sum->getValueDouble () / n) / n)));
+
+		if (pixelStats.hasMode ())
+		{
+			image_mode->setValueDouble (pixelStats.getMode ());
 			sendValueAll (image_mode);
 		}
 
 		sendValueAll (average);
+		sendValueAll (stdev);
 		sendValueAll (max);
 		sendValueAll (min);
 		sendValueAll (sum);
@@ -1042,48 +1136,7 @@ int Camera::sendReadoutData (char *data, size_t dataSize, int chan)
 	if (calculateStatistics->getValueInteger () == STATISTIC_ONLY)
 		calculateDataSize -= dataSize;
 
-	if (calculateCenter->getValueBool ())
-	{
-		switch (getDataType ())
-		{
-			case RTS2_DATA_BYTE:
-				updateCenter ((uint8_t *) data, dataSize);
-				break;
-			case RTS2_DATA_SHORT:
-				updateCenter ((int16_t *) data, dataSize);
-				break;
-			case RTS2_DATA_LONG:
-				updateCenter ((int32_t *) data, dataSize);
-				break;
-			case RTS2_DATA_LONGLONG:
-				updateCenter ((int64_t *) data, dataSize);
-				break;
-			case RTS2_DATA_FLOAT:
-				updateCenter ((float *) data, dataSize);
-				break;
-			case RTS2_DATA_DOUBLE:
-				updateCenter ((double *) data, dataSize);
-				break;
-			case RTS2_DATA_SBYTE:
-				updateCenter ((int8_t *) data, dataSize);
-				break;
-			case RTS2_DATA_USHORT:
-				updateCenter ((uint16_t *) data, dataSize);
-				break;
-			case RTS2_DATA_ULONG:
-				updateCenter ((uint32_t *) data, dataSize);
-				break;
-		}
-	}
-
-	if (currentImageTransfer == SHARED)
-		sharedData->dataWritten (chan, dataSize);
-
-	dataWritten[chan] += dataSize;
-
-	if (exposureConn && currentImageTransfer == TCPIP)
-		return exposureConn->sendBinaryData (currentImageData, chan, data, dataSize);
-	return 0;
+	return ret;
 }
 
 void Camera::addBinning2D (int bin_v, int bin_h)
@@ -1199,8 +1252,32 @@ int Camera::initValues ()
 	initBinnings ();
 	initDataTypes ();
 
+	// memfd segments, passed to local clients over Unix socket; falls back to System V shared memory
+	if (useMemfd)
+	{
+		size_t dataBufferSize = getWidth () * getHeight () * maxPixelByteSize () + sizeof (imghdr);
+		sharedData = new rts2core::DataSharedWrite ();
+		if (memfdHugePages && sharedData->createMemfd (sharedMemNum, dataBufferSize, true) == NULL)
+		{
+			logStream (MESSAGE_WARNING) << "cannot create memfd backed by huge pages, trying normal pages" << sendLog;
+			delete sharedData;
+			sharedData = new rts2core::DataSharedWrite ();
+			memfdHugePages = false;
+		}
+		if (memfdHugePages || sharedData->createMemfd (sharedMemNum, dataBufferSize, false) != NULL)
+		{
+			logStream (MESSAGE_DEBUG) << "creating memfd with " << sharedMemNum << " segments" << (memfdHugePages ? " in huge pages" : "") << ", socket " << sharedData->getSocketName () << sendLog;
+		}
+		else
+		{
+			logStream (MESSAGE_WARNING) << "cannot create memfd, using System V shared memory" << sendLog;
+			delete sharedData;
+			sharedData = NULL;
+		}
+	}
+
 	// init shared memory segment
-	if (sharedMemNum >= 0)
+	if (sharedMemNum >= 0 && sharedData == NULL)
 	{
 		size_t dataBufferSize = getWidth () * getHeight () * maxPixelByteSize ();
 		// autoscale shared memory
@@ -1439,6 +1516,17 @@ int Camera::setValue (rts2core::Value * old_value, rts2core::Value * new_value)
 		setExposure (new_value->getValueDouble ());
 		return 0;
 	}
+	if (old_value == histogramBins)
+	{
+		if (new_value->getValueInteger () < 2)
+			return -2;
+		pixelStats.setHistogramBins (new_value->getValueInteger ());
+		return 0;
+	}
+	if (old_value == sepThreads || old_value == sepTiles)
+	{
+		return new_value->getValueInteger () < 1 ? -2 : 0;
+	}
 	return rts2core::ScriptDevice::setValue (old_value, new_value);
 }
 
@@ -1553,65 +1641,183 @@ void Camera::changeMasterState (rts2_status_t old_state, rts2_status_t new_state
 	rts2core::ScriptDevice::changeMasterState (old_state, new_state);
 }
 
-void Camera::findSepStars (uint16_t *data)
+// 3x3 convolution kernel used by SEP detection
+static float sepConv[] = {1,2,1, 2,4,2, 1,2,1};
+
+/**
+ * Returns SEP data type matching RTS2 data type, -1 if SEP cannot process the type.
+ */
+static int sepDataType (int dataType)
+{
+	switch (dataType)
+	{
+		case RTS2_DATA_BYTE:
+			return SEP_TBYTE;
+		case RTS2_DATA_SHORT:
+			return SEP_TINT16;
+		case RTS2_DATA_USHORT:
+			return SEP_TUINT16;
+		case RTS2_DATA_LONG:
+			return SEP_TINT;
+		case RTS2_DATA_FLOAT:
+			return SEP_TFLOAT;
+		case RTS2_DATA_DOUBLE:
+			return SEP_TDOUBLE;
+		default:
+			return -1;
+	}
+}
+
+template <typename t> static void sepCopy (t *data, float *fdata, size_t n)
 {
-	if (sepFind->getValueBool () == false)
+	for (size_t i = 0; i < n; i++)
+		fdata[i] = data[i];
+}
+
+void Camera::startSepStream ()
+{
+	stopSepStream ();
+	if (sepFind->getValueBool () == false || sepStream->getValueBool () == false)
 		return;
 
-	sepX->clear ();
-	sepY->clear ();
-	sepFluxes->clear ();
+	int dtype = sepDataType (getDataType ());
+	if (dtype < 0)
+		return;
 
-	sep_image im = {data, NULL, NULL, SEP_TUINT16, 0, 0, getUsedWidthBinned (), getUsedHeightBinned (), 0.0, SEP_NOISE_NONE, 1.0, 0.0};
-	sep_bkg *bkg = NULL;
-	int status = sep_background (&im, 64, 64, 3, 3, 0.0, &bkg);
+	sep_set_threads (sepThreads->getValueInteger ());
+	int status = sep_stream_new (getUsedWidthBinned (), getUsedHeightBinned (), dtype, 64, 64, 3, 3, 0.0, 1.5, 5, sepConv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, sepRmsMap->getValueBool (), &sepStreamer);
 	if (status)
 	{
-		logStream (MESSAGE_ERROR) << "SEP: unable to estimate background:" << status << sendLog;
-		return;
+		char errtext[512];
+		sep_get_errmsg (status, errtext);
+		logStream (MESSAGE_WARNING) << "SEP: cannot start streaming: " << errtext << sendLog;
 	}
+}
 
-	uint16_t *imback = (uint16_t *) malloc (getUsedWidthBinned () * getUsedHeightBinned () * sizeof (uint16_t));
-	status = sep_bkg_array (bkg, imback, SEP_TUINT16);
-	if (status)
+void Camera::stopSepStream ()
+{
+	sep_stream_free (sepStreamer);
+	sepStreamer = NULL;
+}
+
+void Camera::findSepStars (void *data)
+{
+	if (sepFind->getValueBool () == false)
 	{
-		logStream (MESSAGE_ERROR) << "SEP: cannot construct background array:" << status << sendLog;
+		stopSepStream ();
 		return;
 	}
 
-	status = sep_bkg_subarray (bkg, im.data, im.dtype);
-	if (status)
+	sepX->clear ();
+	sepY->clear ();
+	sepFluxes->clear ();
+
+	int dtype = sepDataType (getDataType ());
+	if (dtype < 0)
 	{
-		logStream (MESSAGE_ERROR) << "SEP: cannot subtract background:" << status << sendLog;
+		logStream (MESSAGE_ERROR) << "SEP: cannot find stars, unsupported data type " << getDataType () << sendLog;
+		stopSepStream ();
 		return;
 	}
 
-	float conv[] = {1,2,1, 2,4,2, 1,2,1};
+	sep_set_threads (sepThreads->getValueInteger ());
+
+	int w = getUsedWidthBinned ();
+	int h = getUsedHeightBinned ();
+	size_t n = (size_t) w * h;
 	sep_catalog *catalog = NULL;
+	sep_image *im;
+	// background-subtracted copy of data, camera data are kept as they were read
+	sep_image copy = {NULL, NULL, NULL, SEP_TFLOAT, SEP_TFLOAT, 0, w, h, 0.0, SEP_NOISE_STDDEV, 0.0, 0.0};
+	int status;
 
-	im.noise = &(bkg->globalrms);  /* set image noise level */
+	if (sepStreamer && sep_stream_finish (sepStreamer, &catalog) == 0)
+	{
+		im = sep_stream_image (sepStreamer);
+		status = 0;
+	}
+	else
+	{
+		sepLastData = getNow ();
+		sep_image raw = {data, NULL, NULL, dtype, 0, 0, w, h, 0.0, SEP_NOISE_NONE, 0.0, 0.0};
+		sep_bkg *bkg = NULL;
+		status = sep_background (&raw, 64, 64, 3, 3, 0.0, &bkg);
+		if (status == 0)
+		{
+			float *fdata = new float[n];
+			switch (dtype)
+			{
+				case SEP_TBYTE:
+					sepCopy ((uint8_t *) data, fdata, n);
+					break;
+				case SEP_TINT16:
+					sepCopy ((int16_t *) data, fdata, n);
+					break;
+				case SEP_TUINT16:
+					sepCopy ((uint16_t *) data, fdata, n);
+					break;
+				case SEP_TINT:
+					sepCopy ((int *) data, fdata, n);
+					break;
+				case SEP_TFLOAT:
+					sepCopy ((float *) data, fdata, n);
+					break;
+				case SEP_TDOUBLE:
+					sepCopy ((double *) data, fdata, n);
+					break;
+			}
+			copy.data = fdata;
+			status = sep_bkg_subarray (bkg, copy.data, SEP_TFLOAT);
+			// detection threshold is relative to the background rms map, or to the global rms
+			if (sepRmsMap->getValueBool ())
+			{
+				copy.noise = new float[n];
+				if (status == 0)
+					status = sep_bkg_rmsarray (bkg, copy.noise, SEP_TFLOAT);
+			}
+			else
+			{
+				copy.noiseval = sep_bkg_globalrms (bkg);
+			}
+			if (status == 0)
+				status = sep_extract_tiled (&copy, 1.5, SEP_THRESH_REL, 5, sepConv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, sepTiles->getValueInteger (), &catalog);
+		}
+		sep_bkg_free (bkg);
+		im = &copy;
+	}
 
-	status = sep_extract(&im, 1.5*bkg->globalrms, SEP_THRESH_REL, 5, conv, 3, 3, SEP_FILTER_CONV, 32, 0.005, 1, 1.0, &catalog);
 	if (status)
 	{
-		logStream (MESSAGE_ERROR) << "SEP: cannot extract sources:" << status << sendLog;
-		return;
+		char errtext[512];
+		char errdetail[512];
+		sep_get_errmsg (status, errtext);
+		sep_get_errdetail (errdetail);
+		logStream (MESSAGE_ERROR) << "SEP: cannot find stars: " << errtext << " " << errdetail << sendLog;
 	}
+	else
+	{
+		for (int i = 0; i < catalog->nobj; i++)
+		{
+			// aperture photometry on background-subtracted image
+			double flux, fluxerr, area;
+			short flag;
+			sep_sum_circle (im, catalog->x[i], catalog->y[i], 5.0, 5, 0, &flux, &fluxerr, &area, &flag);
+			sepX->addValue (catalog->x[i]);
+			sepY->addValue (catalog->y[i]);
+			sepFluxes->addValue (flux);
+		}
+		sepLatency->setValueDouble (getNow () - sepLastData);
 
-	/* aperture photometry */
-	double *flux, *fluxerr, *fluxt, *fluxerrt, *area, *areat;
-	short *flag, *flagt;
-
-	im.noise = &(bkg->globalrms);  /* set image noise level */
-	im.ndtype = SEP_TUINT16;
-	fluxt = flux = (double *)malloc(catalog->nobj * sizeof(double));
-	fluxerrt = fluxerr = (double *)malloc(catalog->nobj * sizeof(double));
-	areat = area = (double *)malloc(catalog->nobj * sizeof(double));
-	flagt = flag = (short *)malloc(catalog->nobj * sizeof(short));
-	for (int i=0; i<catalog->nobj; i++, fluxt++, fluxerrt++, flagt++, areat++)
-		sep_sum_circle(&im, catalog->x[i], catalog->y[i], 5.0, 5, 0, fluxt, fluxerrt, areat, flagt);
-
+		sendValueAll (sepX);
+		sendValueAll (sepY);
+		sendValueAll (sepFluxes);
+		sendValueAll (sepLatency);
+	}
 
+	sep_catalog_free (catalog);
+	delete[] (float *) copy.data;
+	delete[] (float *) copy.noise;
+	stopSepStream ();
 }
 
 int Camera::camStartExposure (bool careBlock)
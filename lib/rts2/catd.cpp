@@ -19,13 +19,255 @@
 
 #include "catd.h"
 
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+
+// default maximal number of returned stars
+#define DEFAULT_MAX_STARS   1000
+// default limits of searched area
+#define DEFAULT_MAX_RADIUS  5.0
+#define DEFAULT_MAX_AREA    100.0
+
 using namespace rts2catd;
 
+static bool brighterStar (const CatStar &a, const CatStar &b)
+{
+	return a.mag < b.mag;
+}
+
+static double angularDistance (double ra1, double dec1, double ra2, double dec2)
+{
+	ra1 *= M_PI / 180.0;
+	dec1 *= M_PI / 180.0;
+	ra2 *= M_PI / 180.0;
+	dec2 *= M_PI / 180.0;
+	double sd = sin ((dec2 - dec1) / 2.0);
+	double sr = sin ((ra2 - ra1) / 2.0);
+	double h = sd * sd + cos (dec1) * cos (dec2) * sr * sr;
+	if (h > 1)
+		h = 1;
+	return 2 * asin (sqrt (h)) * 180.0 / M_PI;
+}
+
 Catd::Catd (int argc, char **argv, const char *cn):rts2core::Device (argc, argv, DEVICE_TYPE_CAT, cn)
 {
+	createValue (coneCenter, "center", "center of the last cone search", false);
+	createValue (coneRadius, "radius", "radius of the last cone search", false, RTS2_DT_DEG_DIST);
+	createValue (corner1, "corner1", "first corner of the last box search", false);
+	createValue (corner2, "corner2", "second corner of the last box search", false);
+
+	createValue (magMin, "min_mag", "default brightest magnitude of returned stars (nan for no limit)", false, RTS2_VALUE_WRITABLE);
+	magMin->setValueDouble (NAN);
+	createValue (magMax, "max_mag", "default faintest magnitude of returned stars (nan for no limit)", false, RTS2_VALUE_WRITABLE);
+	magMax->setValueDouble (NAN);
+	createValue (maxStars, "max_stars", "default maximal number of returned stars", false, RTS2_VALUE_WRITABLE);
+	maxStars->setValueInteger (DEFAULT_MAX_STARS);
+	createValue (maxRadius, "max_radius", "maximal radius of cone search", false, RTS2_VALUE_WRITABLE | RTS2_DT_DEG_DIST);
+	maxRadius->setValueDouble (DEFAULT_MAX_RADIUS);
+	createValue (maxArea, "max_area", "maximal area of box search (square degrees)", false, RTS2_VALUE_WRITABLE);
+	maxArea->setValueDouble (DEFAULT_MAX_AREA);
 
+	createValue (numStars, "num_stars", "number of stars found by the last search", false);
+	createValue (starId, "star_id", "catalogue IDs of found stars", false);
+	createValue (starRa, "star_ra", "RA of found stars", false, RTS2_DT_RA);
+	createValue (starDec, "star_dec", "DEC of found stars", false, RTS2_DT_DEC);
+	createValue (starMag, "star_mag", "magnitudes of found stars", false);
+	createValue (starDist, "star_dist", "distance of found stars from the cone center", false, RTS2_DT_DEG_DIST);
+
+	createValue (searchDuration, "search_duration", "duration of the last search", false, RTS2_DT_TIMEINTERVAL);
+	createValue (searches, "searches", "number of searches", false);
+	searches->setValueLong (0);
 }
 
 Catd::~Catd ()
 {
 }
+
+int Catd::commandAuthorized (rts2core::Connection * conn)
+{
+	if (conn->isCommand ("cone"))
+	{
+		struct ln_equ_posn c;
+		double r, minMag, maxMag;
+		int _num;
+		if (conn->paramNextDouble (&c.ra) || conn->paramNextDouble (&c.dec) || conn->paramNextDouble (&r) || paramLimits (conn, minMag, maxMag, _num))
+			return -2;
+		if (r < 0 || r > 180 || c.dec < -90 || c.dec > 90)
+			return -2;
+		if (r > maxRadius->getValueDouble ())
+		{
+			conn->sendCommandEnd (DEVDEM_E_PARAMSVAL, "cone radius exceeds max_radius");
+			return -1;
+		}
+
+		double t = getNow ();
+		CatStars stars;
+		if (searchCone (&c, r, minMag, maxMag, _num, stars))
+		{
+			conn->sendCommandEnd (DEVDEM_E_HW, "cone search failed");
+			return -1;
+		}
+
+		rts2core::ValueRaDec center (coneCenter->getName ());
+		rts2core::ValueDouble radius (coneRadius->getName ());
+		center.setValueRaDec (c.ra, c.dec);
+		radius.setValueDouble (r);
+		center.send (conn);
+		radius.send (conn);
+		publishStars (conn, stars, t);
+		return 0;
+	}
+	else if (conn->isCommand ("box"))
+	{
+		struct ln_equ_posn c1, c2;
+		double minMag, maxMag;
+		int _num;
+		if (conn->paramNextDouble (&c1.ra) || conn->paramNextDouble (&c1.dec) || conn->paramNextDouble (&c2.ra) || conn->paramNextDouble (&c2.dec) || paramLimits (conn, minMag, maxMag, _num))
+			return -2;
+		if (c1.dec < -90 || c1.dec > 90 || c2.dec < -90 || c2.dec > 90)
+			return -2;
+		if (boxArea (&c1, &c2) > maxArea->getValueDouble ())
+		{
+			conn->sendCommandEnd (DEVDEM_E_PARAMSVAL, "box area exceeds max_area");
+			return -1;
+		}
+
+		double t = getNow ();
+		CatStars stars;
+		if (searchCataloge (&c1, &c2, minMag, maxMag, _num, stars))
+		{
+			conn->sendCommandEnd (DEVDEM_E_HW, "box search failed");
+			return -1;
+		}
+
+		rts2core::ValueRaDec cor1 (corner1->getName ());
+		rts2core::ValueRaDec cor2 (corner2->getName ());
+		cor1.setValueRaDec (c1.ra, c1.dec);
+		cor2.setValueRaDec (c2.ra, c2.dec);
+		cor1.send (conn);
+		cor2.send (conn);
+		publishStars (conn, stars, t);
+		return 0;
+	}
+	return rts2core::Device::commandAuthorized (conn);
+}
+
+int Catd::setValue (rts2core::Value * old_value, rts2core::Value * new_value)
+{
+	if (old_value == maxStars)
+		return new_value->getValueInteger () > 0 ? 0 : -2;
+	if (old_value == maxRadius || old_value == maxArea)
+		return new_value->getValueDouble () > 0 ? 0 : -2;
+	return rts2core::Device::setValue (old_value, new_value);
+}
+
+int Catd::searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, double minMag, double maxMag, int num, CatStars &stars)
+{
+	double ra1 = ln_range_degrees (c1->ra);
+	double width = fabs (c2->ra - c1->ra) >= 360.0 ? 360.0 : ln_range_degrees (c2->ra - ra1);
+	double decMin = std::min (c1->dec, c2->dec);
+	double decMax = std::max (c1->dec, c2->dec);
+
+	struct ln_equ_posn c;
+	c.ra = ln_range_degrees (ra1 + width / 2.0);
+	c.dec = (decMin + decMax) / 2.0;
+
+	// box edges sampled to find radius of the cone containing the box
+	double r = 0;
+	for (int i = 0; i <= 8; i++)
+	{
+		double ra = ra1 + i * width / 8.0;
+		double dec = decMin + i * (decMax - decMin) / 8.0;
+		r = std::max (r, angularDistance (c.ra, c.dec, ra, decMin));
+		r = std::max (r, angularDistance (c.ra, c.dec, ra, decMax));
+		r = std::max (r, angularDistance (c.ra, c.dec, ra1, dec));
+		r = std::max (r, angularDistance (c.ra, c.dec, ra1 + width, dec));
+	}
+
+	// all stars of the cone are needed for filtering, number of stars is bounded by the box area limit
+	CatStars coneStars;
+	int ret = searchCone (&c, std::min (r * 1.01, 180.0), minMag, maxMag, INT_MAX, coneStars);
+	if (ret)
+		return ret;
+
+	stars.clear ();
+	for (CatStars::iterator iter = coneStars.begin (); iter != coneStars.end (); iter++)
+	{
+		if (iter->dec < decMin || iter->dec > decMax || ln_range_degrees (iter->ra - ra1) > width)
+			continue;
+		stars.push_back (*iter);
+		stars.back ().dist = NAN;
+	}
+	limitStars (stars, num);
+	return 0;
+}
+
+double Catd::boxArea (struct ln_equ_posn *c1, struct ln_equ_posn *c2)
+{
+	double width = fabs (c2->ra - c1->ra) >= 360.0 ? 360.0 : ln_range_degrees (c2->ra - c1->ra);
+	return width * fabs (sin (c2->dec * M_PI / 180.0) - sin (c1->dec * M_PI / 180.0)) * 180.0 / M_PI;
+}
+
+void Catd::limitStars (CatStars &stars, int num)
+{
+	if (stars.size () <= (size_t) num)
+		return;
+	std::partial_sort (stars.begin (), stars.begin () + num, stars.end (), brighterStar);
+	stars.resize (num);
+}
+
+int Catd::paramLimits (rts2core::Connection * conn, double &minMag, double &maxMag, int &_num)
+{
+	minMag = magMin->getValueDouble ();
+	maxMag = magMax->getValueDouble ();
+	_num = maxStars->getValueInteger ();
+	if (!conn->paramEnd ())
+	{
+		if (conn->paramNextDouble (&minMag) || conn->paramNextDouble (&maxMag))
+			return -1;
+		if (!conn->paramEnd () && conn->paramNextInteger (&_num))
+			return -1;
+		if (!conn->paramEnd ())
+			return -1;
+	}
+	if (_num <= 0)
+		return -1;
+	if (isnan (minMag))
+		minMag = -INFINITY;
+	if (isnan (maxMag))
+		maxMag = INFINITY;
+	return 0;
+}
+
+void Catd::publishStars (rts2core::Connection * conn, CatStars &stars, double startTime)
+{
+	// results are sent only to the connection which requested the search, device values hold their names and meta information
+	rts2core::ValueInteger num (numStars->getName ());
+	rts2core::StringArray ids (starId->getName ());
+	rts2core::DoubleArray ras (starRa->getName ());
+	rts2core::DoubleArray decs (starDec->getName ());
+	rts2core::DoubleArray mags (starMag->getName ());
+	rts2core::DoubleArray dists (starDist->getName ());
+	for (CatStars::iterator iter = stars.begin (); iter != stars.end (); iter++)
+	{
+		ids.addValue (iter->id);
+		ras.addValue (iter->ra);
+		decs.addValue (iter->dec);
+		mags.addValue (iter->mag);
+		dists.addValue (iter->dist);
+	}
+	num.setValueInteger (stars.size ());
+
+	num.send (conn);
+	ids.send (conn);
+	ras.send (conn);
+	decs.send (conn);
+	mags.send (conn);
+	dists.send (conn);
+
+	searchDuration->setValueDouble (getNow () - startTime);
+	searches->inc ();
+	sendValueAll (searchDuration);
+	sendValueAll (searches);
+}
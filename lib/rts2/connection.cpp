@@ -35,6 +35,10 @@
 #include <iostream>
 #include <iomanip>
 
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
 #include <errno.h>
 #include <syslog.h>
 #include <unistd.h>
@@ -43,11 +47,54 @@
 #include <sys/shm.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
 using namespace rts2core;
 
+/**
+ * Parse integer number in base 10. The whole string must be a number.
+ * Uses std::from_chars if available, falls back to strtoll.
+ *
+ * @return 0 on success, -1 if string is not a number
+ */
+template <typename T> static int parseInteger (const char *str, T *num)
+{
+#ifdef __cpp_lib_to_chars
+	const char *end = str + strlen (str);
+	std::from_chars_result res = std::from_chars (str, end, *num);
+	if (res.ec == std::errc () && res.ptr == end)
+		return 0;
+#endif
+	char *num_end;
+	*num = strtoll (str, &num_end, 10);
+	if (*num_end)
+		return -1;
+	return 0;
+}
+
+/**
+ * Parse floating point number. Characters after the number are ignored.
+ * Uses std::from_chars if available, falls back to strtod for numbers
+ * it does not accept (leading +, hexadecimal numbers,..).
+ *
+ * @return 0 on success, -1 if string does not start with a number
+ */
+template <typename T> static int parseFloat (const char *str, T *num)
+{
+#ifdef __cpp_lib_to_chars
+	std::from_chars_result res = std::from_chars (str, str + strlen (str), *num);
+	if (res.ec == std::errc ())
+		return 0;
+#endif
+	char *num_end;
+	*num = strtod (str, &num_end);
+	if (num_end == str)
+		return -1;
+	return 0;
+}
+
 ConnError::ConnError (Connection *conn, const char *_msg): Error (_msg)
 {
 	conn->connectionError (-1);
@@ -67,6 +114,7 @@ Connection::Connection (Block * in_master):Object ()
 	sock = -1;
 	master = in_master;
 	buf_top = buf;
+	buf_start = buf;
 	full_data_end = NULL;
 
 	key = 0;
@@ -100,6 +148,17 @@ Connection::Connection (Block * in_master):Object ()
 	dataConn = 0;
 
 	sharedReadMemory = NULL;
+	pendingDataConn = -1;
+
+	outBuf = NULL;
+	outSize = 0;
+	outStart = 0;
+	outLen = 0;
+
+	pollActive = false;
+	pollQueued = false;
+	pollReady = false;
+	polledSock = -1;
 }
 
 Connection::Connection (int in_sock, Block * in_master):Object ()
@@ -110,6 +169,7 @@ Connection::Connection (int in_sock, Block * in_master):Object ()
 	sock = in_sock;
 	master = in_master;
 	buf_top = buf;
+	buf_start = buf;
 	full_data_end = NULL;
 
 	key = 0;
@@ -142,27 +202,66 @@ Connection::Connection (int in_sock, Block * in_master):Object ()
 	dataConn = 0;
 
 	sharedReadMemory = NULL;
+	pendingDataConn = -1;
+
+	outBuf = NULL;
+	outSize = 0;
+	outStart = 0;
+	outLen = 0;
+
+	pollActive = false;
+	pollQueued = false;
+	pollReady = false;
+	polledSock = -1;
 }
 
 Connection::~Connection (void)
 {
+	if (master)
+		master->connectionPollRemoved (this);
+	if (sock >= 0)
+	{
+		// try to deliver what remains in output queue
+		if (outLen > 0)
+			flushOutput ();
+	}
 	if (sock >= 0)
+	{
+		if (master)
+			master->pollFDClosed (sock);
 		close (sock);
+	}
 	delete serverState;
 	delete bopState;
 	queClear ();
 	delete[]buf;
+	delete[]outBuf;
 	delete sharedReadMemory;
 	delete otherDevice;
+	for (std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.begin (); iter != writeChannels.end (); iter++)
+		delete iter->second;
+	for (std::map <int, DataChannels *>::iterator iter = readChannels.begin (); iter != readChannels.end (); iter++)
+		delete iter->second;
 }
 
 int Connection::add (Block *block)
 {
 	if (sock >= 0)
 	{
-		short events = POLLIN | POLLPRI;
+		short events = 0;
 		if (isConnState (CONN_INPROGRESS))
 			events |= POLLOUT;
+		// write what was queued during the last loop iteration
+		else if (outLen > 0 && flushOutput () > 0)
+			events |= POLLOUT;
+		if (sock < 0)
+			return -1;
+		// lines following shared data start are not read until memfd is attached
+		if (memfdPending ())
+			block->addPollFD (sharedReadMemory->getAttachSocket (), POLLIN);
+		// do not read requests from peer which does not read our replies
+		else if (master == NULL || outLen < master->getOutputQueueLimit () / 2)
+			events |= POLLIN | POLLPRI;
 		block->addPollFD (sock, events);
 	}
 	return 0;
@@ -639,6 +738,11 @@ int Connection::idle ()
 			connectionError (-1);
 		}
 	}
+	if (sharedReadMemory && sharedReadMemory->attachExpired ())
+	{
+		logStream (MESSAGE_ERROR) << "memfd descriptors were not received in time" << sendLog;
+		connectionError (-2);
+	}
 	if (otherDevice != NULL)
 		otherDevice->idle ();
 	return 0;
@@ -660,6 +764,13 @@ int Connection::authorizationFailed ()
 
 void Connection::checkBufferSize ()
 {
+	// move unprocessed data to start of the buffer, if there is not enough space for next read
+	if (buf_start != buf && (size_t) (buf_top - buf) + MAX_DATA / 2 > buf_size)
+	{
+		memmove (buf, buf_start, buf_top - buf_start + 1);
+		buf_top -= buf_start - buf;
+		buf_start = buf;
+	}
 	// increase buffer if it's too small
 	if (((int) buf_size) == (buf_top - buf))
 	{
@@ -669,6 +780,7 @@ void Connection::checkBufferSize ()
 		buf_size += MAX_DATA;
 		delete[]buf;
 		buf = new_buf;
+		buf_start = buf;
 	}
 }
 
@@ -685,6 +797,7 @@ int Connection::acceptConn ()
 	}
 	else
 	{
+		master->pollFDClosed (sock);
 		close (sock);
 		sock = new_sock;
 		#ifdef DEBUG_EXTRA
@@ -958,6 +1071,55 @@ void Connection::processLine ()
 			}
 		}
 	}
+	else if (isCommand (PROTO_SHARED_FD))
+	{
+		int dC;
+		long long memfdId;
+		char *sockname;
+		std::vector <int> segs;
+		if (paramNextInteger (&dC) || paramNextLongLong (&memfdId) || paramNextString (&sockname))
+		{
+			connectionError (-2);
+			ret = -2;
+		}
+		else
+		{
+			ret = -1;
+			DataChannels::segmentsFromConnection (this, segs);
+			if (sharedReadMemory && (unsigned long long) memfdId != sharedReadMemory->getMemfdId ())
+			{
+				// unmap existing memory, receive and map new one
+				delete sharedReadMemory;
+				sharedReadMemory = NULL;
+			}
+
+			if (sharedReadMemory == NULL)
+			{
+				sharedReadMemory = new DataSharedRead ();
+				if (sharedReadMemory->attachMemfd (sockname, memfdId))
+				{
+					delete sharedReadMemory;
+					sharedReadMemory = NULL;
+					connectionError (-2);
+					ret = -2;
+				}
+				else
+				{
+					// descriptors are received from the poll loop
+					pendingDataConn = dC;
+					pendingSegments = segs;
+					pollChanged ();
+				}
+			}
+			else
+			{
+				DataChannels * chann = new DataChannels ();
+				chann->initShared (sharedReadMemory, segs);
+				readChannels[dC] = chann;
+				newDataConn (dC);
+			}
+		}
+	}
 	else if (isCommand (PROTO_SHARED_FULL) || isCommand (PROTO_SHARED_KILLED))
 	{
 		int dC;
@@ -1039,60 +1201,60 @@ bool Connection::receivedData (Block *block)
 
 void Connection::processBuffer ()
 {
+	char *line_end;
 	if (full_data_end)
 		return;
 	full_data_end = buf_top;
-	buf_top = buf;
-	command_start = buf;
+	buf_top = buf_start;
+	command_start = buf_start;
 	while (*buf_top)
 	{
-		while (isspace (*buf_top) || (*buf_top && *buf_top == '\n'))
+		while (isspace (*buf_top))
 			buf_top++;
 		command_start = buf_top;
 		// find command end..
-		while (*buf_top && *buf_top != '\n' && *buf_top != '\r')
-			buf_top++;
-
-		if (*buf_top == '\r' && *(buf_top + 1) == '\n')
+		line_end = (char *) memchr (buf_top, '\n', full_data_end - buf_top);
+		if (line_end == NULL)
 		{
-			*buf_top = '\0';
-			buf_top++;
-		}
-		// weird error on when we get \r in one and \n in next read
-		if (*buf_top == '\r' && !*(buf_top + 1))
-		{
-			// we get to 0, while will ends, and we get out, waiting for \n in next packet
-			buf_top++;
+			// wait for rest of the line in next read
+			buf_top = full_data_end;
 			break;
 		}
 
-		if (*buf_top == '\n')
-		{
-			// mark end of line..
-			*buf_top = '\0';
-			buf_top++;
+		// mark end of line..
+		if (line_end > buf_top && *(line_end - 1) == '\r')
+			*(line_end - 1) = '\0';
+		*line_end = '\0';
+		buf_top = line_end + 1;
 
-			command_buf_top = command_start;
+		command_buf_top = command_start;
 
-			processLine ();
-			// binary read just started
-			if (activeReadData >= 0)
-			{
-				long readSize = full_data_end - buf_top;
-				readSize = readChannels[activeReadData]->addData (activeReadChannel, buf_top, readSize);
-				dataReceived ();
-				// move binary data away
-				memmove (buf_top, buf_top + readSize, (full_data_end - buf_top) - readSize + 1);
-				full_data_end -= readSize;
-			}
-			command_start = buf_top;
+		processLine ();
+		// binary read just started
+		if (activeReadData >= 0)
+		{
+			long readSize = full_data_end - buf_top;
+			readSize = readChannels[activeReadData]->addData (activeReadChannel, buf_top, readSize);
+			dataReceived ();
+			// skip binary data
+			buf_top += readSize;
 		}
+		command_start = buf_top;
+		// rest of the lines is processed after memfd is attached
+		if (memfdPending ())
+			break;
 	}
-	if (buf != command_start)
+	// unprocessed data are moved to buffer start only when buffer runs out of space
+	if (command_start == full_data_end)
 	{
-		memmove (buf, command_start, (full_data_end - command_start) + 1);
-		// move buffer to the end..
-		buf_top -= command_start - buf;
+		buf_start = buf;
+		buf_top = buf;
+		*buf_top = '\0';
+	}
+	else
+	{
+		buf_start = command_start;
+		buf_top = full_data_end;
 	}
 	full_data_end = NULL;
 }
@@ -1103,6 +1265,12 @@ int Connection::receive (Block *block)
 	// connections market for deletion
 	if (isConnState (CONN_DELETE))
 		return -1;
+	if (memfdPending ())
+	{
+		if (block->getPollEvents (sharedReadMemory->getAttachSocket ()))
+			return receiveMemfd ();
+		return 0;
+	}
 	if ((sock >= 0) && (block->getPollEvents (sock) & (POLLIN | POLLPRI)))
 	{
 		if (isConnState (CONN_CONNECTING))
@@ -1138,7 +1306,7 @@ int Connection::receive (Block *block)
 		std::cout << "Connection::receive name " << getName ()
 			<< " [" << getCentraldId () << ":" << sock << "]"
 			<< " reas: " << buf_top
-			<< " full_buf: " << buf
+			<< " full_buf: " << buf_start
 			<< " size: " << data_size
 			<< " commandInProgress " << commandInProgress
 			<< " runningCommand " << runningCommand
@@ -1154,6 +1322,11 @@ int Connection::receive (Block *block)
 
 int Connection::writable (Block *block)
 {
+	if (sock >= 0 && outLen > 0 && !isConnState (CONN_INPROGRESS) && (block->getPollEvents (sock) & POLLOUT))
+	{
+		if (flushOutput () < 0)
+			return -1;
+	}
 	if (sock >=0 && (block->getPollEvents (sock) & POLLOUT) && isConnState (CONN_INPROGRESS))
 	{
 		int err = 0;
@@ -1570,8 +1743,7 @@ int Connection::commandReturn ()
 
 int Connection::sendMsg (const char *msg)
 {
-	int len;
-	int ret;
+	size_t len;
 	if (sock == -1)
 	{
 		#ifdef DEBUG_ALL
@@ -1579,44 +1751,137 @@ int Connection::sendMsg (const char *msg)
 		#endif
 		return -1;
 	}
-	len = strlen (msg) + 1;
-	char *mbuf = new char[len + 1];
-	strcpy (mbuf, msg);
+	len = strlen (msg);
 	#ifdef DEBUG_ALL
 	std::cout << "Connection::sendMsg will send " << msg << std::endl;
 	#endif
-	strcat (mbuf, "\n");
-	// ignore EINTR
-	do
+	if (master && outLen + len + 1 > master->getOutputQueueLimit ())
 	{
-		ret = write (sock, mbuf, len);
-	} while (ret == -1 && errno == EINTR);
-
-	if (ret != len)
-	{
-		syslog (LOG_ERR, "Cannot send msg: %s to sock %i with len %i, ret %i errno %i message %m",
-			msg, sock, len, ret, errno);
-		#ifdef DEBUG_EXTRA
-		logStream (MESSAGE_ERROR)
-			<< "Connection::sendMsg [" << getCentraldId () << ":" << conn_state << "] error "
-			<< sock << " state: " << ret << " sending " << msg << ":" << strerror (errno)
-			<< sendLog;
-		#endif
-		connectionError (ret);
-		delete[] mbuf;
-		return -1;
+		// try to make some space
+		if (flushOutput () < 0)
+			return -1;
+		if (outLen + len + 1 > master->getOutputQueueLimit ())
+		{
+			// cannot use logStream, as it might end in this connection
+			syslog (LOG_ERR, "Output queue of connection %s to sock %i exceeded %lu bytes, closing connection",
+				getName (), sock, (unsigned long) master->getOutputQueueLimit ());
+			connectionError (-1);
+			return -1;
+		}
 	}
+	outAppend (msg, len);
+	outAppend ("\n", 1);
 	#ifdef DEBUG_ALL
 	std::cout << "Connection::sendMsg " << getName ()
-		<< " [" << getCentraldId () << ":" << sock << "] send " << ret << ": " << msg
+		<< " [" << getCentraldId () << ":" << sock << "] queued " << len + 1 << ": " << msg
 		<< std::endl;
 	#endif
-
-	delete[] mbuf;
-	successfullSend ();
 	return 0;
 }
 
+int Connection::flushOutput (bool wait)
+{
+	if (sock < 0)
+		return -1;
+	while (outLen > 0)
+	{
+		struct iovec iov[2];
+		int iovcnt = 1;
+		ssize_t ret;
+
+		iov[0].iov_base = outBuf + outStart;
+		if (outStart + outLen > outSize)
+		{
+			iov[0].iov_len = outSize - outStart;
+			iov[1].iov_base = outBuf;
+			iov[1].iov_len = outLen - iov[0].iov_len;
+			iovcnt = 2;
+		}
+		else
+		{
+			iov[0].iov_len = outLen;
+		}
+
+		struct msghdr mh;
+		memset (&mh, 0, sizeof (mh));
+		mh.msg_iov = iov;
+		mh.msg_iovlen = iovcnt;
+
+		ret = sendmsg (sock, &mh, MSG_DONTWAIT | MSG_NOSIGNAL);
+		// pipes and other non-socket descriptors
+		if (ret == -1 && errno == ENOTSOCK)
+			ret = writev (sock, iov, iovcnt);
+		if (ret == -1)
+		{
+			// ignore EINTR
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				if (!wait)
+					break;
+				struct pollfd pfd;
+				pfd.fd = sock;
+				pfd.events = POLLOUT;
+				pfd.revents = 0;
+				if (poll (&pfd, 1, -1) >= 0 || errno == EINTR)
+					continue;
+			}
+			syslog (LOG_ERR, "Cannot send output queue to sock %i with len %lu, errno %i message %m",
+				sock, (unsigned long) outLen, errno);
+			#ifdef DEBUG_EXTRA
+			logStream (MESSAGE_ERROR)
+				<< "Connection::flushOutput [" << getCentraldId () << ":" << conn_state << "] error "
+				<< sock << " sending " << outLen << " bytes: " << strerror (errno)
+				<< sendLog;
+			#endif
+			connectionError (-1);
+			return -1;
+		}
+		outStart = (outStart + ret) % outSize;
+		outLen -= ret;
+		successfullSend ();
+	}
+	if (outLen == 0)
+		outStart = 0;
+	return outLen;
+}
+
+void Connection::outAppend (const char *data, size_t len)
+{
+	size_t first;
+	if (outLen + len > outSize)
+	{
+		size_t newSize = outSize > 0 ? outSize : MAX_DATA;
+		while (newSize < outLen + len)
+			newSize *= 2;
+		char *newBuf = new char[newSize];
+		// copy queued data to start of the new buffer
+		if (outLen > 0)
+		{
+			first = std::min (outLen, outSize - outStart);
+			memcpy (newBuf, outBuf + outStart, first);
+			memcpy (newBuf + first, outBuf, outLen - first);
+		}
+		delete[] outBuf;
+		outBuf = newBuf;
+		outSize = newSize;
+		outStart = 0;
+	}
+	size_t end = (outStart + outLen) % outSize;
+	first = std::min (len, outSize - end);
+	memcpy (outBuf + end, data, first);
+	memcpy (outBuf, data + first, len - first);
+	outLen += len;
+	pollChanged ();
+}
+
+void Connection::pollChanged ()
+{
+	if (master)
+		master->connectionPollChanged (this);
+}
+
 int Connection::sendMsg (std::string msg)
 {
 	return sendMsg (msg.c_str ());
@@ -1644,48 +1909,40 @@ int Connection::startBinaryData (int dataType, int channum, size_t *chansize)
 
 int Connection::sendBinaryData (int data_conn, int chan, char *data, size_t dataSize)
 {
-	char *binaryWriteTop, *binaryWriteBuff;
-	binaryWriteTop = binaryWriteBuff = data;
-	char *binaryEnd = data + dataSize;
+	if (sock == -1)
+		return -1;
+
+	if (dataSize > getWriteBinaryDataSize (data_conn))
+	{
+		logStream (MESSAGE_ERROR) << "Attemp to send too much data on channel " << chan << " - "
+			<< dataSize << " bytes, but there are only " << getWriteBinaryDataSize (data_conn) << " bytes remain to be send" << sendLog;
+		dataSize = getWriteBinaryDataSize (data_conn);
+	}
 
 	std::ostringstream _os;
 	_os << PROTO_DATA " " << data_conn << " " << chan << " " << dataSize;
-	int ret;
-	ret = sendMsg (_os);
-	if (ret)
-		return ret;
+	std::string header = _os.str ();
 
-	while (binaryWriteTop < binaryEnd)
+	// binary data are queued together with the header, so the client never sees header without data.
+	// Image data are not counted against the output queue limit, otherwise clients would be disconnected
+	// in the middle of an image. Instead the call waits until the client reads what was queued before.
+	if (master && outLen > 0 && outLen + header.length () + 1 + dataSize > master->getOutputQueueLimit ())
 	{
-		if (dataSize > getWriteBinaryDataSize (data_conn))
-		{
-			logStream (MESSAGE_ERROR) << "Attemp to send too much data on channel " << chan << " - "
-				<< dataSize << " bytes, but there are only " << getWriteBinaryDataSize (data_conn) << " bytes remain to be send" << sendLog;
-			dataSize = getWriteBinaryDataSize (data_conn);
-		}
-		ret = send (sock, binaryWriteTop, dataSize, 0);
-		if (ret == -1)
-		{
-			if (errno != EINTR)
-			{
-				connectionError (ret);
-				return -1;
-			}
-		}
-		else
+		if (flushOutput (true) < 0)
+			return -1;
+	}
+	outAppend (header.c_str (), header.length ());
+	outAppend ("\n", 1);
+	outAppend (data, dataSize);
+
+	std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.find (data_conn);
+	if (iter != writeChannels.end ())
+	{
+		((*iter).second)->dataWritten (chan, dataSize);
+		if (((*iter).second)->getDataSize () <= 0)
 		{
-			binaryWriteTop += ret;
-			dataSize -= ret;
-			std::map <int, DataAbstractWrite *>::iterator iter = writeChannels.find (data_conn);
-			if (iter != writeChannels.end ())
-			{
-				((*iter).second)->dataWritten (chan, ret);
-				if (((*iter).second)->getDataSize () <= 0)
-				{
-					delete ((*iter).second);
-					writeChannels.erase (iter);
-				}
-			}
+			delete ((*iter).second);
+			writeChannels.erase (iter);
 		}
 	}
 	return 0;
@@ -1704,7 +1961,10 @@ int Connection::startSharedData (DataSharedWrite *data, int channum, int *segnum
 {
 	std::ostringstream _os;
 	dataConn++;
-	_os << PROTO_SHARED " " << dataConn << " " << data->getShmId () << " " << channum;
+	if (data->getListenSocket () >= 0)
+		_os << PROTO_SHARED_FD " " << dataConn << " " << data->getMemfdId () << " " << data->getSocketName () << " " << channum;
+	else
+		_os << PROTO_SHARED " " << dataConn << " " << data->getShmId () << " " << channum;
 	for (int i = 0; i < channum; i++)
 		_os << " " << segnums[i];
 	int ret;
@@ -1771,13 +2031,20 @@ void Connection::connConnected ()
 
 void Connection::connectionError (int last_data_size)
 {
+	cancelMemfd ();
 	activeReadData = -1;
+	outStart = 0;
+	outLen = 0;
 	if (canDelete ())
 		setConnState (CONN_DELETE);
 	else
 		setConnState (CONN_BROKEN);
 	if (sock >= 0)
+	{
+		if (master)
+			master->pollFDClosed (sock);
 		close (sock);
+	}
 	sock = -1;
 	if (strlen (getName ()) && master)
 		master->deleteAddress (getCentraldNum (), getName ());
@@ -1900,6 +2167,7 @@ void Connection::setConnState (conn_state_t new_conn_state)
 		// state change finished..
 	}
 	conn_state = new_conn_state;
+	pollChanged ();
 	if (new_conn_state == CONN_AUTH_FAILED)
 	{
 		connectionError (-1);
@@ -1968,67 +2236,46 @@ int Connection::paramNextStringNull (char **str)
 int Connection::paramNextInteger (int *num)
 {
 	char *str_num;
-	char *num_end;
 	if (paramNextString (&str_num, ","))
 		return -1;
-	*num = strtol (str_num, &num_end, 10);
-	if (*num_end)
-		return -1;
-	return 0;
+	return parseInteger (str_num, num);
 }
 
 int Connection::paramNextLong (long int *num)
 {
 	char *str_num;
-	char *num_end;
 	if (paramNextString (&str_num, ","))
 		return -1;
-	*num = strtol (str_num, &num_end, 10);
-	if (*num_end)
-		return -1;
-	return 0;
+	return parseInteger (str_num, num);
 }
 
 int Connection::paramNextLongLong (long long int *num)
 {
 	char *str_num;
-	char *num_end;
 	if (paramNextString (&str_num, ","))
 		return -1;
-	*num = strtoll (str_num, &num_end, 10);
-	if (*num_end)
-		return -1;
-	return 0;
+	return parseInteger (str_num, num);
 }
 
 int Connection::paramNextSizeT (size_t * num)
 {
 	char *str_num;
-	char *num_end;
 	if (paramNextString (&str_num))
 		return -1;
-	*num = strtol (str_num, &num_end, 10);
-	if (*num_end)
-		return -1;
-	return 0;
+	return parseInteger (str_num, num);
 }
 
 int Connection::paramNextSSizeT (ssize_t * num)
 {
 	char *str_num;
-	char *num_end;
 	if (paramNextString (&str_num))
 		return -1;
-	*num = strtol (str_num, &num_end, 10);
-	if (*num_end)
-		return -1;
-	return 0;
+	return parseInteger (str_num, num);
 }
 
 int Connection::paramNextDouble (double *num)
 {
 	char *str_num;
-	int ret;
 	if (paramNextString (&str_num, ","))
 		return -1;
 	if (!strcasecmp (str_num, "nan"))
@@ -2036,10 +2283,7 @@ int Connection::paramNextDouble (double *num)
 		*num = NAN;
 		return 0;
 	}
-	ret = sscanf (str_num, "%lf", num);
-	if (ret != 1)
-		return -1;
-	return 0;
+	return parseFloat (str_num, num);
 }
 
 int Connection::paramNextDoubleTime (double *num)
@@ -2117,13 +2361,9 @@ int Connection::paramNextDoubleTime (double *num)
 int Connection::paramNextFloat (float *num)
 {
 	char *str_num;
-	int ret;
 	if (paramNextString (&str_num, ","))
 		return -1;
-	ret = sscanf (str_num, "%f", num);
-	if (ret != 1)
-		return -1;
-	return 0;
+	return parseFloat (str_num, num);
 }
 
 int Connection::paramNextHMS (double *num)
@@ -2170,6 +2410,45 @@ void Connection::newDataConn (int data_conn)
 		otherDevice->newDataConn (data_conn);
 }
 
+int Connection::receiveMemfd ()
+{
+	int fd = sharedReadMemory->getAttachSocket ();
+	int ret = sharedReadMemory->receiveMemfd ();
+	if (ret > 0)
+		return 0;
+	if (master)
+		master->pollFDClosed (fd);
+	if (ret < 0)
+	{
+		delete sharedReadMemory;
+		sharedReadMemory = NULL;
+		connectionError (-2);
+		return -1;
+	}
+	DataChannels * chann = new DataChannels ();
+	chann->initShared (sharedReadMemory, pendingSegments);
+	readChannels[pendingDataConn] = chann;
+	newDataConn (pendingDataConn);
+	pendingDataConn = -1;
+	pendingSegments.clear ();
+
+	processBuffer ();
+	pollChanged ();
+	return 0;
+}
+
+void Connection::cancelMemfd ()
+{
+	if (!memfdPending ())
+		return;
+	if (master)
+		master->pollFDClosed (sharedReadMemory->getAttachSocket ());
+	delete sharedReadMemory;
+	sharedReadMemory = NULL;
+	pendingDataConn = -1;
+	pendingSegments.clear ();
+}
+
 void Connection::dataReceived ()
 {
 	std::map <int, DataChannels *>::iterator iter = readChannels.find (activeReadData);
@@ -2192,7 +2471,7 @@ void Connection::dataReceived ()
 
 Value * Connection::getValue (const char *value_name)
 {
-	return values.getValue (value_name);
+	return valueIndex.find (value_name);
 }
 
 Value * Connection::getValueType (const char *value_name, int value_type)
@@ -2220,12 +2499,13 @@ void Connection::addValue (Value * value, const ValueVector::iterator eiter)
 	if (value->isValue (RTS2_VALUE_INFOTIME))
 		info_time = (ValueTime *) value;
 	values.insert (eiter, value);
+	valueIndex.insert (value->getName (), value);
 }
 
 int Connection::metaInfo (int rts2Type, std::string m_name, std::string desc)
 {
 	// if value exists, update it
-	Value *existing_value = values.getValue (m_name.c_str ());
+	Value *existing_value = valueIndex.find (m_name.c_str ());
 	ValueVector::iterator eiter;
 	if (existing_value)
 	{
@@ -2235,6 +2515,7 @@ int Connection::metaInfo (int rts2Type, std::string m_name, std::string desc)
 			existing_value->setDescription (desc);
 			return -1;
 		}
+		valueIndex.remove (m_name.c_str ());
 		eiter = values.removeValue (m_name.c_str ());
 	}
 	else
@@ -27,6 +27,26 @@
 
 using namespace rts2core;
 
+SerialTransaction::SerialTransaction (const char *_wbuf, int _wlen, int _rlen, const char *_endChar, double _timeout):request (_wbuf, _wlen)
+{
+	if (_endChar)
+		terminator = std::string (_endChar);
+	replySize = _rlen;
+	reply = new char[replySize + 1];
+	reply[0] = '\0';
+	replyTimeout = _timeout;
+
+	written = 0;
+	received = 0;
+
+	started = false;
+}
+
+SerialTransaction::~SerialTransaction ()
+{
+	delete[] reply;
+}
+
 int ConnSerial::setAttr ()
 {
 	if (tcsetattr (sock, TCSANOW, &s_termios) < 0)
@@ -68,6 +88,15 @@ ConnSerial::ConnSerial (const char *_devName, rts2core::Block * _master, bSpeedT
 	logTrafficAsHex = false;
 }
 
+ConnSerial::~ConnSerial ()
+{
+	for (std::list <SerialTransaction *>::iterator iter = transactions.begin (); iter != transactions.end (); iter++)
+		delete *iter;
+	transactions.clear ();
+	if (getMaster ())
+		getMaster ()->deleteTimers (EVENT_SERIAL_TIMEOUT, this);
+}
+
 const char * ConnSerial::getBaudSpeed ()
 {
 	switch (baudSpeed)
@@ -520,6 +549,11 @@ std::string ConnSerial::getModemBits ()
 int ConnSerial::writeRead (const char* wbuf, int wlen, char *rbuf, int rlen)
 {
 	int ret;
+	if (!transactions.empty ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot exchange data while " << transactions.size () << " transactions are queued" << sendLog;
+		return -1;
+	}
 	ret = writePort (wbuf, wlen);
 	if (ret < 0)
 		return -1;
@@ -529,6 +563,11 @@ int ConnSerial::writeRead (const char* wbuf, int wlen, char *rbuf, int rlen)
 int ConnSerial::writeRead (const char* wbuf, int wlen, char *rbuf, int rlen, char endChar)
 {
 	int ret;
+	if (!transactions.empty ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot exchange data while " << transactions.size () << " transactions are queued" << sendLog;
+		return -1;
+	}
 	ret = writePort (wbuf, wlen);
 	if (ret < 0)
 		return -1;
@@ -538,6 +577,11 @@ int ConnSerial::writeRead (const char* wbuf, int wlen, char *rbuf, int rlen, cha
 int ConnSerial::writeRead (const char* wbuf, int wlen, char *rbuf, int rlen, const char *endChar)
 {
 	int ret;
+	if (!transactions.empty ())
+	{
+		logStream (MESSAGE_ERROR) << "cannot exchange data while " << transactions.size () << " transactions are queued" << sendLog;
+		return -1;
+	}
 	ret = writePort (wbuf, wlen);
 	if (ret < 0)
 		return -1;
@@ -553,3 +597,181 @@ int ConnSerial::flushPortO ()
 {
 	return tcflush (sock, TCOFLUSH);
 }
+
+void ConnSerial::queueTransaction (SerialTransaction *trans)
+{
+	transactions.push_back (trans);
+	if (transactions.size () == 1)
+		startTransaction ();
+}
+
+int ConnSerial::add (Block *block)
+{
+	if (sock < 0)
+		return 0;
+	short events = POLLIN | POLLPRI;
+	if (!transactions.empty () && transactions.front ()->written < transactions.front ()->request.length ())
+		events |= POLLOUT;
+	block->addPollFD (sock, events);
+	return 0;
+}
+
+int ConnSerial::receive (Block *block)
+{
+	if (sock < 0 || !block->isForRead (sock))
+		return 0;
+
+	if (transactions.empty ())
+	{
+		// unsolicited data, or late reply of transaction which timed out
+		char rbuf[200];
+		int ret = read (sock, rbuf, sizeof (rbuf));
+		if (ret > 0 && debugComm)
+		{
+			LogStream ls = logStream (MESSAGE_DEBUG);
+			ls << "ignoring data received outside of transaction '";
+			logBuffer (ls, rbuf, ret);
+			ls << "'" << sendLog;
+		}
+		return ret > 0 ? ret : 0;
+	}
+
+	SerialTransaction *trans = transactions.front ();
+	// reply shall not be read before request is written
+	if (trans->written < trans->request.length ())
+		return 0;
+
+	int ret = read (sock, trans->reply + trans->received, trans->replySize - trans->received);
+	if (ret < 0)
+	{
+		if (errno == EINTR || errno == EAGAIN)
+			return 0;
+		logStream (MESSAGE_ERROR) << "cannot read from serial port " << strerror (errno) << sendLog;
+		finishTransaction (TRANS_ERROR);
+		return 0;
+	}
+	if (ret == 0)
+		return 0;
+
+	int from = trans->received;
+	trans->received += ret;
+	trans->reply[trans->received] = '\0';
+
+	if (trans->terminator.empty ())
+	{
+		if (trans->received >= trans->replySize)
+			finishTransaction (TRANS_OK);
+		return ret;
+	}
+
+	// look for terminator in newly received data
+	int elen = trans->terminator.length ();
+	from = from >= elen ? from - elen + 1 : 0;
+	for (char *end = trans->reply + from; end + elen <= trans->reply + trans->received; end++)
+	{
+		if (memcmp (end, trans->terminator.c_str (), elen) == 0)
+		{
+			if (end + elen < trans->reply + trans->received && debugComm)
+				logStream (MESSAGE_DEBUG) << "ignoring " << (trans->reply + trans->received - end - elen) << " bytes received after terminator" << sendLog;
+			*end = '\0';
+			trans->received = end - trans->reply;
+			finishTransaction (TRANS_OK);
+			return ret;
+		}
+	}
+	if (trans->received >= trans->replySize)
+	{
+		LogStream ls = logStream (MESSAGE_ERROR);
+		ls << "reply does not fit to " << trans->replySize << " bytes, readed '";
+		logBuffer (ls, trans->reply, trans->received);
+		ls << "'" << sendLog;
+		finishTransaction (TRANS_OVERFLOW);
+	}
+	return ret;
+}
+
+int ConnSerial::writable (Block *block)
+{
+	if (sock >= 0 && !transactions.empty () && block->isForWrite (sock))
+	{
+		if (writeTransaction () < 0)
+			finishTransaction (TRANS_ERROR);
+	}
+	return 0;
+}
+
+void ConnSerial::postEvent (Event *event)
+{
+	// timer of finished transaction is deleted, so the event belongs to the running one
+	if (event->getType () == EVENT_SERIAL_TIMEOUT && event->getArg () == this && !transactions.empty ())
+	{
+		SerialTransaction *trans = transactions.front ();
+		LogStream ls = logStream (MESSAGE_ERROR);
+		ls << "serial transaction timeout, request '";
+		logBuffer (ls, trans->request.c_str (), trans->request.length ());
+		ls << "', readed '";
+		logBuffer (ls, trans->reply, trans->received);
+		ls << "'" << sendLog;
+		finishTransaction (TRANS_TIMEOUT);
+	}
+	ConnNoSend::postEvent (event);
+}
+
+void ConnSerial::startTransaction ()
+{
+	SerialTransaction *trans = transactions.front ();
+	if (debugComm)
+	{
+		LogStream ls = logStream (MESSAGE_DEBUG);
+		ls << "starting transaction '";
+		logBuffer (ls, trans->request.c_str (), trans->request.length ());
+		ls << "'" << sendLog;
+	}
+	trans->started = true;
+	// request might not be written at once, wait for POLLOUT
+	pollChanged ();
+	getMaster ()->addTimer (std::isnan (trans->replyTimeout) ? getVTime () / 10.0 : trans->replyTimeout, new Event (EVENT_SERIAL_TIMEOUT, this));
+	if (writeTransaction () < 0)
+		finishTransaction (TRANS_ERROR);
+}
+
+int ConnSerial::writeTransaction ()
+{
+	SerialTransaction *trans = transactions.front ();
+	if (trans->written < trans->request.length ())
+	{
+		int old_flags = fcntl (sock, F_GETFL, 0);
+		fcntl (sock, F_SETFL, old_flags | O_NONBLOCK);
+		int ret = write (sock, trans->request.c_str () + trans->written, trans->request.length () - trans->written);
+		fcntl (sock, F_SETFL, old_flags);
+		if (ret < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			logStream (MESSAGE_ERROR) << "cannot write to serial port " << strerror (errno) << sendLog;
+			return -1;
+		}
+		trans->written += ret;
+	}
+	// request without reply
+	if (trans->written == trans->request.length () && trans->replySize == 0)
+		finishTransaction (TRANS_OK);
+	return 0;
+}
+
+void ConnSerial::finishTransaction (transStatusT status)
+{
+	SerialTransaction *trans = transactions.front ();
+	transactions.pop_front ();
+	getMaster ()->deleteTimers (EVENT_SERIAL_TIMEOUT, this);
+	pollChanged ();
+	if (status != TRANS_OK)
+		tcflush (sock, TCIFLUSH);
+
+	trans->finished (status, trans->reply, trans->received);
+	delete trans;
+
+	// callback might queue new transaction, which was already started
+	if (!transactions.empty () && !transactions.front ()->started)
+		startTransaction ();
+}
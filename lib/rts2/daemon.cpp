@@ -74,6 +74,7 @@ Daemon::Daemon (int _argc, char **_argv, int _init_state):rts2core::Block (_argc
 	watched_child = -1;
 
 	doHupIdleLoop = false;
+	useEpoll = false;
 
 	modefile = NULL;
 	modeconf = NULL;
@@ -94,6 +95,14 @@ Daemon::Daemon (int _argc, char **_argv, int _init_state):rts2core::Block (_argc
 	uptime = new ValueTime ("uptime", "daemon uptime", false);
 	uptime->setNow ();
 
+	createValue (timerLateness, "timer_lateness", "[s] lateness of expired timers", false);
+
+	createValue (broadcastMessages, "broadcast_messages", "[1/s] value updates broadcasted to connections", false);
+	createValue (broadcastBytes, "broadcast_bytes", "[B/s] bytes of value updates broadcasted to connections", false);
+	broadcastMsgCount = 0;
+	broadcastByteCount = 0;
+	broadcastStart = getNow ();
+
 	idleInfoInterval = -1;
 
 	addOption ('i', NULL, 0, "run in interactive mode, don't loose console");
@@ -105,6 +114,10 @@ Daemon::Daemon (int _argc, char **_argv, int _init_state):rts2core::Block (_argc
 	addOption (OPT_MODEFILE, "modefile", 1, "file holding device modes");
 	addOption (OPT_AUTOSAVE, "autosave", 1, "autosave file");
 	addOption (OPT_DEFAULTS, "defaults", 1, "file with default values");
+#ifdef RTS2_HAVE_SYS_EPOLL_H
+	addOption (OPT_EPOLL, "epoll", 0, "use epoll reactor instead of ppoll in the main loop");
+#endif
+	addOption (OPT_OUTPUT_QUEUE, "output-queue-limit", 1, "close connections with more than given number of bytes waiting to be sent (default 16MB)");
 }
 
 Daemon::~Daemon (void)
@@ -150,6 +163,12 @@ int Daemon::processOption (int in_opt)
 		case OPT_VALUEFILE:
 			valueFile = optarg;
 			break;
+		case OPT_EPOLL:
+			useEpoll = true;
+			break;
+		case OPT_OUTPUT_QUEUE:
+			setOutputQueueLimit (atol (optarg));
+			break;
 		default:
 			return rts2core::Block::processOption (in_opt);
 	}
@@ -391,6 +410,8 @@ int Daemon::init ()
 		listen_sock = -1;
 		return -1;
 	}
+	if (useEpoll)
+		return setUseEpoll (true);
 	return 0;
 }
 
@@ -535,6 +556,12 @@ int Daemon::idle ()
 	return rts2core::Block::idle ();
 }
 
+void Daemon::timerExpired (double lateness)
+{
+	// keep statistics of the last 100 timers
+	timerLateness->addValue (lateness, 100);
+}
+
 void Daemon::setInfoTime (struct tm *_date)
 {
 	static char p_tz[100];
@@ -706,7 +733,9 @@ void Daemon::pollSuccess ()
 
 void Daemon::addValue (Value * value, int queCondition)
 {
-	values.push_back (new CondValue (value, queCondition));
+	CondValue *c_val = new CondValue (value, queCondition);
+	values.push_back (c_val);
+	valueIndex.insert (value->getName (), c_val);
 }
 
 Value * Daemon::getOwnValue (const char *v_name)
@@ -719,14 +748,7 @@ Value * Daemon::getOwnValue (const char *v_name)
 
 CondValue * Daemon::getCondValue (const char *v_name)
 {
-	CondValueVector::iterator iter;
-	for (iter = values.begin (); iter != values.end (); iter++)
-	{
-		CondValue *val = *iter;
-		if (val->getValue ()->isValue (v_name))
-			return val;
-	}
-	return NULL;
+	return valueIndex.find (v_name);
 }
 
 CondValue * Daemon::getCondValue (const Value *val)
@@ -1000,6 +1022,18 @@ int Daemon::sendBaseInfo (Connection * conn)
 
 int Daemon::info ()
 {
+	timerLateness->calculate ();
+
+	double now = getNow ();
+	if (now > broadcastStart)
+	{
+		broadcastMessages->setValueDouble (broadcastMsgCount / (now - broadcastStart));
+		broadcastBytes->setValueDouble (broadcastByteCount / (now - broadcastStart));
+		broadcastMsgCount = 0;
+		broadcastByteCount = 0;
+		broadcastStart = now;
+	}
+
 	updateInfoTime ();
 	return 0;
 }
@@ -1040,15 +1074,22 @@ int Daemon::infoAll ()
 	{
 		return -1;
 	}
-	connections_t::iterator iter;
-	for (iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
-		sendInfo (*iter);
-	for (iter = getCentraldConns ()->begin (); iter != getCentraldConns ()->end (); iter++)
-		sendInfo (*iter);
+	// format every changed value once, send it to all connections
+	CondValueVector::iterator iter;
+	for (iter = values.begin (); iter != values.end (); iter++)
+	{
+		Value *val = (*iter)->getValue ();
+		if (val->needSend ())
+			broadcastValue (val, false);
+	}
+	if (info_time->needSend ())
+		broadcastValue (info_time, false);
+	if (uptime->needSend ())
+		broadcastValue (uptime, false);
 
-	for (CondValueVector::iterator iter2 = values.begin (); iter2 != values.end (); iter2++)
+	for (iter = values.begin (); iter != values.end (); iter++)
 	{
-		Value *val = (*iter2)->getValue ();
+		Value *val = (*iter)->getValue ();
 		val->resetNeedSend ();
 	}
 
@@ -1087,17 +1128,33 @@ void Daemon::sendValueAll (Value * value)
 {
 	if (value->needSend ())
 	{
-		connections_t::iterator iter;
-		for (iter = getConnections ()->begin (); iter != getConnections ()->end (); iter++)
-			if ((*iter)->getSendAll ())
-				value->send (*iter);
-		for (iter = getCentraldConns ()->begin (); iter != getCentraldConns ()->end (); iter++)
-			if ((*iter)->getSendAll ())
-				value->send (*iter);
+		broadcastValue (value, true);
 		value->resetNeedSend ();
 	}
 }
 
+void Daemon::broadcastValue (Value *value, bool sendAll)
+{
+	std::string msg;
+	connections_t *conns[2] = { getConnections (), getCentraldConns () };
+	for (int i = 0; i < 2; i++)
+	{
+		for (connections_t::iterator iter = conns[i]->begin (); iter != conns[i]->end (); iter++)
+		{
+			if (sendAll ? !(*iter)->getSendAll () : !isRunning (*iter))
+				continue;
+			// format message only if there is at least one connection which will receive it
+			if (msg.empty ())
+				msg = value->getSendMessage ();
+			if (value->sendMessage (*iter, msg) == 0)
+			{
+				broadcastMsgCount++;
+				broadcastByteCount += msg.length () + 1;
+			}
+		}
+	}
+}
+
 void Daemon::sendProgressAll (double start, double end, Connection *except)
 {
 	connections_t::iterator iter;
@@ -20,14 +20,49 @@
 #include "connection.h"
 #include "data.h"
 
+#include <fcntl.h>
+#include <sstream>
+#include <stddef.h>
+#include <stdio.h>
 #include <strings.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
+#include <sys/mman.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// how long client waits for memfd descriptor
+#define MEMFD_RECV_TIMEOUT     10
 
 using namespace rts2core;
 
+/**
+ * Size of memfd control block - header, segments and their mutexes - rounded to page size.
+ */
+static size_t memfdControlSize (int numseg, size_t align)
+{
+	size_t s = sizeof (struct SharedDataHeader) + numseg * (sizeof (struct SharedDataSegment) + sizeof (pthread_mutex_t));
+	return ((s + align - 1) / align) * align;
+}
+
+/**
+ * Fill abstract Unix socket address.
+ */
+static socklen_t memfdSocketAddr (const char *sockname, struct sockaddr_un *addr)
+{
+	memset (addr, 0, sizeof (struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+	size_t l = strlen (sockname);
+	if (l > sizeof (addr->sun_path) - 1)
+		l = sizeof (addr->sun_path) - 1;
+	// leading 0 denotes abstract socket, which disappears with the last process holding it
+	memcpy (addr->sun_path + 1, sockname, l);
+	return offsetof (struct sockaddr_un, sun_path) + l + 1;
+}
+
 int DataRead::readDataSize (Connection *conn)
 {
 	return conn->paramNextSSizeT (&binaryReadChunkSize);
@@ -55,6 +90,19 @@ int DataAbstractShared::removeClient (int segnum, int client_id, bool verbose)
 
 int DataAbstractShared::lockSegment (int segnum)
 {
+	if (data->shared_sem < 0)
+	{
+		int ret = pthread_mutex_lock (getSegmentMutex (segnum));
+		// process holding the lock died, segment structure is consistent as only client IDs are changed under the lock
+		if (ret == EOWNERDEAD)
+			ret = pthread_mutex_consistent (getSegmentMutex (segnum));
+		if (ret)
+		{
+			logStream (MESSAGE_ERROR) << "cannot lock segment " << segnum << ": " << strerror (ret) << sendLog;
+			return -1;
+		}
+		return 0;
+	}
 	struct sembuf so;
 	so.sem_num = segnum;
 	so.sem_op = -1;
@@ -69,6 +117,16 @@ int DataAbstractShared::lockSegment (int segnum)
 
 int DataAbstractShared::unlockSegment (int segnum)
 {
+	if (data->shared_sem < 0)
+	{
+		int ret = pthread_mutex_unlock (getSegmentMutex (segnum));
+		if (ret)
+		{
+			logStream (MESSAGE_ERROR) << "cannot unlock segment " << segnum << ": " << strerror (ret) << sendLog;
+			return -1;
+		}
+		return 0;
+	}
 	struct sembuf so;
 	so.sem_num = segnum;
 	so.sem_op = 1;
@@ -83,6 +141,13 @@ int DataAbstractShared::unlockSegment (int segnum)
 
 DataSharedRead::~DataSharedRead ()
 {
+	closeAttach ();
+	if (mapBase)
+		munmap (mapBase, mapSize);
+	if (memfd >= 0)
+		close (memfd);
+	if (dataFd >= 0)
+		close (dataFd);
 }
 
 int DataSharedRead::attach (int _shm_id)
@@ -97,6 +162,127 @@ int DataSharedRead::attach (int _shm_id)
 	return 0;
 }
 
+int DataSharedRead::attachMemfd (const char *sockname, unsigned long long id)
+{
+	closeAttach ();
+	attachSock = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (attachSock < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot create socket for memfd transfer: " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	// connection to listening abstract socket is established immediately, or fails when writer backlog is full
+	struct sockaddr_un addr;
+	socklen_t addrlen = memfdSocketAddr (sockname, &addr);
+	if (connect (attachSock, (struct sockaddr *) &addr, addrlen))
+	{
+		logStream (MESSAGE_ERROR) << "cannot connect to memfd socket " << sockname << ": " << strerror (errno) << sendLog;
+		closeAttach ();
+		return -1;
+	}
+	attachStart = getNow ();
+	attachName = sockname;
+	memfdId = id;
+	return 0;
+}
+
+bool DataSharedRead::attachExpired ()
+{
+	return attachSock >= 0 && getNow () > attachStart + MEMFD_RECV_TIMEOUT;
+}
+
+int DataSharedRead::receiveMemfd ()
+{
+	char b;
+	struct iovec iov;
+	iov.iov_base = &b;
+	iov.iov_len = 1;
+
+	union
+	{
+		char buf[CMSG_SPACE (2 * sizeof (int))];
+		struct cmsghdr align;
+	} cbuf;
+
+	struct msghdr msg;
+	memset (&msg, 0, sizeof (msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf.buf;
+	msg.msg_controllen = sizeof (cbuf.buf);
+
+	ssize_t ret = recvmsg (attachSock, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+	if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return 1;
+	closeAttach ();
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+	if (ret != 1 || cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+	{
+		logStream (MESSAGE_ERROR) << "cannot receive memfd descriptors from " << attachName << sendLog;
+		return -1;
+	}
+	int fds[2];
+	if (cmsg->cmsg_len != CMSG_LEN (sizeof (fds)))
+	{
+		// close whatever was received
+		for (int *fd = (int *) CMSG_DATA (cmsg); (char *) (fd + 1) <= ((char *) cmsg) + cmsg->cmsg_len; fd++)
+			close (*fd);
+		logStream (MESSAGE_ERROR) << "received wrong number of memfd descriptors from " << attachName << sendLog;
+		return -1;
+	}
+	memcpy (fds, CMSG_DATA (cmsg), sizeof (fds));
+	memfd = fds[0];
+	dataFd = fds[1];
+
+	struct stat st, dst;
+	struct SharedDataHeader hdr;
+	if (fstat (memfd, &st) || (unsigned long long) st.st_ino != memfdId || fstat (dataFd, &dst) || pread (memfd, &hdr, sizeof (hdr), 0) != sizeof (hdr) || hdr.nseg <= 0)
+	{
+		logStream (MESSAGE_ERROR) << "received invalid memfd descriptor from " << attachName << sendLog;
+		return -1;
+	}
+
+	// image data can be in huge pages, control block size is rounded to their size
+	size_t align = dst.st_blksize > getpagesize () ? dst.st_blksize : getpagesize ();
+	size_t ctrlSize = memfdControlSize (hdr.nseg, align);
+	size_t dataSize = dst.st_size;
+	if ((size_t) st.st_size < ctrlSize)
+	{
+		logStream (MESSAGE_ERROR) << "memfd from " << attachName << " too small" << sendLog;
+		return -1;
+	}
+
+	// reserve continuous address range aligned to (huge) page, so segment offsets can be used, then map control block read-write and data read-only into it
+	mapSize = ctrlSize + dataSize + align;
+	mapBase = mmap (NULL, mapSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mapBase == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot reserve address space for memfd: " << strerror (errno) << sendLog;
+		mapBase = NULL;
+		return -1;
+	}
+	char *base = (char *) ((((size_t) mapBase) + align - 1) / align * align);
+	if (mmap (base, ctrlSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED
+		|| (dataSize > 0 && mmap (base + ctrlSize, dataSize, PROT_READ, MAP_SHARED | MAP_FIXED, dataFd, 0) == MAP_FAILED))
+	{
+		logStream (MESSAGE_ERROR) << "cannot map memfd: " << strerror (errno) << sendLog;
+		munmap (mapBase, mapSize);
+		mapBase = NULL;
+		return -1;
+	}
+
+	data = (struct SharedDataHeader *) base;
+	return 0;
+}
+
+void DataSharedRead::closeAttach ()
+{
+	if (attachSock >= 0)
+		close (attachSock);
+	attachSock = -1;
+}
 
 int DataSharedRead::confirmClient (int segnum, int client_id)
 {
@@ -189,6 +375,181 @@ struct SharedDataHeader *DataSharedWrite::create (int numseg, size_t segsize)
 	return data;
 }
 
+struct SharedDataHeader *DataSharedWrite::createMemfd (int numseg, size_t segsize, bool hugepages)
+{
+#ifdef RTS2_HAVE_MEMFD_CREATE
+	memfd = memfd_create ("rts2-control", MFD_CLOEXEC);
+	dataFd = memfd_create ("rts2-data", MFD_CLOEXEC | MFD_ALLOW_SEALING | (hugepages ? MFD_HUGETLB : 0));
+	if (memfd < 0 || dataFd < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cannot create memfd: " << strerror (errno) << sendLog;
+		closeMemfd ();
+		return NULL;
+	}
+	struct stat st, dst;
+	if (fstat (memfd, &st) || fstat (dataFd, &dst))
+	{
+		logStream (MESSAGE_ERROR) << "cannot stat memfd: " << strerror (errno) << sendLog;
+		closeMemfd ();
+		return NULL;
+	}
+	// huge pages filesystem reports huge page size as its block size
+	size_t align = dst.st_blksize > getpagesize () ? dst.st_blksize : getpagesize ();
+	size_t ctrlSize = memfdControlSize (numseg, align);
+	size_t segstride = ((segsize + align - 1) / align) * align;
+	size_t dataSize = numseg * segstride;
+
+	if (ftruncate (memfd, ctrlSize) || ftruncate (dataFd, dataSize))
+	{
+		logStream (MESSAGE_ERROR) << "cannot resize memfd to " << ctrlSize + dataSize << " bytes: " << strerror (errno) << sendLog;
+		closeMemfd ();
+		return NULL;
+	}
+
+	// data follows control block, as segment offsets are counted from the header
+	mapSize = ctrlSize + dataSize + align;
+	mapBase = mmap (NULL, mapSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mapBase == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot reserve address space for memfd: " << strerror (errno) << sendLog;
+		mapBase = NULL;
+		closeMemfd ();
+		return NULL;
+	}
+	char *base = (char *) ((((size_t) mapBase) + align - 1) / align * align);
+	if (mmap (base, ctrlSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED
+		|| mmap (base + ctrlSize, dataSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, dataFd, 0) == MAP_FAILED)
+	{
+		logStream (MESSAGE_ERROR) << "cannot map memfd: " << strerror (errno) << sendLog;
+		closeMemfd ();
+		return NULL;
+	}
+
+	// existing writable mapping is kept, clients cannot create new one, nor resize the data
+	if (fcntl (dataFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE | F_SEAL_SEAL))
+	{
+		logStream (MESSAGE_ERROR) << "cannot seal memfd: " << strerror (errno) << sendLog;
+		closeMemfd ();
+		return NULL;
+	}
+	memfdId = st.st_ino;
+
+	std::ostringstream os;
+	os << "rts2-data-" << getpid () << "-" << memfdId;
+	sockName = os.str ();
+
+	listenSock = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	struct sockaddr_un addr;
+	socklen_t addrlen = memfdSocketAddr (sockName.c_str (), &addr);
+	if (listenSock < 0 || bind (listenSock, (struct sockaddr *) &addr, addrlen) || listen (listenSock, 10))
+	{
+		logStream (MESSAGE_ERROR) << "cannot listen on memfd socket " << sockName << ": " << strerror (errno) << sendLog;
+		closeMemfd ();
+		return NULL;
+	}
+
+	data = (struct SharedDataHeader *) base;
+	data->nseg = numseg;
+	data->shared_sem = -1;
+
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init (&attr);
+	pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+
+	struct SharedDataSegment *seg = getSegment (0);
+	for (int i = 0; i < numseg; i++, seg++)
+	{
+		memset (seg->client_ids, 0, sizeof (int) * MAX_SHARED_CLIENTS);
+		seg->size = segsize;
+		seg->bytesSoFar = 0;
+		seg->offset = ctrlSize + i * segstride;
+		pthread_mutex_init (getSegmentMutex (i), &attr);
+	}
+	pthread_mutexattr_destroy (&attr);
+
+	return data;
+#else
+	logStream (MESSAGE_ERROR) << "memfd_create is not available on this system" << sendLog;
+	return NULL;
+#endif
+}
+
+int DataSharedWrite::acceptClient ()
+{
+	int client = accept4 (listenSock, NULL, NULL, SOCK_CLOEXEC);
+	if (client < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+		logStream (MESSAGE_ERROR) << "cannot accept memfd client: " << strerror (errno) << sendLog;
+		return -1;
+	}
+
+	// abstract socket is reachable by any local user, data are passed only to processes of daemon user
+	struct ucred cred;
+	memset (&cred, 0, sizeof (cred));
+	socklen_t credlen = sizeof (cred);
+	if (getsockopt (client, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) || cred.uid != geteuid ())
+	{
+		logStream (MESSAGE_ERROR) << "refusing memfd client pid " << cred.pid << " uid " << cred.uid << sendLog;
+		close (client);
+		return -1;
+	}
+
+	char b = 0;
+	struct iovec iov;
+	iov.iov_base = &b;
+	iov.iov_len = 1;
+
+	union
+	{
+		char buf[CMSG_SPACE (2 * sizeof (int))];
+		struct cmsghdr align;
+	} cbuf;
+	memset (&cbuf, 0, sizeof (cbuf));
+
+	struct msghdr msg;
+	memset (&msg, 0, sizeof (msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf.buf;
+	msg.msg_controllen = sizeof (cbuf.buf);
+
+	int fds[2] = {memfd, dataFd};
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN (sizeof (fds));
+	memcpy (CMSG_DATA (cmsg), fds, sizeof (fds));
+
+	int ret = sendmsg (client, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+	close (client);
+	if (ret != 1)
+	{
+		logStream (MESSAGE_ERROR) << "cannot send memfd descriptors: " << strerror (errno) << sendLog;
+		return -1;
+	}
+	return 0;
+}
+
+void DataSharedWrite::closeMemfd ()
+{
+	if (listenSock >= 0)
+		close (listenSock);
+	listenSock = -1;
+	if (mapBase)
+		munmap (mapBase, mapSize);
+	mapBase = NULL;
+	if (memfd >= 0)
+		close (memfd);
+	memfd = -1;
+	if (dataFd >= 0)
+		close (dataFd);
+	dataFd = -1;
+	data = NULL;
+}
+
 DataSharedWrite::~DataSharedWrite ()
 {
 	if (shm_id > 0)
@@ -196,6 +557,7 @@ DataSharedWrite::~DataSharedWrite ()
 		semctl (data->shared_sem, IPC_RMID, 0);
 		shmdt (data);
 	}
+	closeMemfd ();
 }
 
 size_t DataSharedWrite::getDataSize ()
@@ -263,6 +625,13 @@ void DataChannels::initFromConnection (Connection *conn)
 }
 
 void DataChannels::initSharedFromConnection (Connection *conn, DataSharedRead *shm)
+{
+	std::vector <int> segs;
+	segmentsFromConnection (conn, segs);
+	initShared (shm, segs);
+}
+
+void DataChannels::segmentsFromConnection (Connection *conn, std::vector <int> &segs)
 {
 	int channum;
 	if (conn->paramNextInteger (&channum))
@@ -272,12 +641,18 @@ void DataChannels::initSharedFromConnection (Connection *conn, DataSharedRead *s
 		int seg;
 		if (conn->paramNextInteger (&seg))
 			throw Error ("cannot parse channel segment or size");
-		push_back (new DataSharedRead (shm, seg));
+		segs.push_back (seg);
 	}
 	if (!conn->paramEnd ())
 		throw Error ("too much parameters in PROTO_SHARED command");
 }
 
+void DataChannels::initShared (DataSharedRead *shm, std::vector <int> &segs)
+{
+	for (std::vector <int>::iterator iter = segs.begin (); iter != segs.end (); iter++)
+		push_back (new DataSharedRead (shm, *iter));
+}
+
 size_t DataChannels::getRestSize ()
 {
 	long ret = 0;
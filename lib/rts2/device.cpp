@@ -283,6 +283,7 @@ void DevConnectionMaster::connectionError (int last_data_size)
 {
 	if (sock > 0)
 	{
+		master->pollFDClosed (sock);
 		close (sock);
 		sock = -1;
 	}
@@ -620,6 +621,8 @@ int Device::processOption (int in_opt)
 			if (multidevPart == false)
 				device_name = optarg;
 			break;
+		case OPT_THREADS:
+			break;
 		default:
 			return Daemon::processOption (in_opt);
 	}
@@ -750,6 +753,8 @@ void Device::setMulti ()
 	multidevPart = true;
 	setNotDaemonize ();
 	setNoLock ();
+	// processed by MultiBase, devices share its command line
+	addOption (OPT_THREADS, "threads", 0, "run devices in threads");
 }
 
 void Device::initAutoSave ()
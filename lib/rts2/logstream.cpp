@@ -22,9 +22,13 @@
 
 #include <iomanip>
 #include <iostream>
+#include <pthread.h>
 
 using namespace rts2core;
 
+// serialize messages from devices running in threads; recursive, as message delivery can log errors
+static pthread_mutex_t logLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
 void LogStream::logArr (const char *arr, int len)
 {
 	bool lastIsHex = false;
@@ -57,18 +61,22 @@ void LogStream::logArrAsHex (const char *arr, int len)
 
 void LogStream::sendLog ()
 {
+	pthread_mutex_lock (&logLock);
 	if (masterApp != NULL)
 		masterApp->sendMessage (messageType, ls.str ().c_str ());
 	else
 		std::cerr << "log " << ls.str () << std::endl;
+	pthread_mutex_unlock (&logLock);
 }
 
 void LogStream::sendLogNoEndl ()
 {
+	pthread_mutex_lock (&logLock);
 	if (masterApp != NULL)
 		masterApp->sendMessageNoEndl (messageType, ls.str ().c_str ());
 	else
 		std::cerr << "log " << ls.str ();
+	pthread_mutex_unlock (&logLock);
 }
 
 LogStream & sendLog (LogStream & _ls)
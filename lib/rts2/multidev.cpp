@@ -19,10 +19,24 @@
 
 #include "multidev.h"
 
+#include <math.h>
 #include <signal.h>
 
 using namespace rts2core;
 
+MultiDev::MultiDev ()
+{
+	threaded = false;
+	exclusive = false;
+	stopping = false;
+	pthread_mutex_init (&exclusiveLock, NULL);
+}
+
+MultiDev::~MultiDev ()
+{
+	stopThreads ();
+	pthread_mutex_destroy (&exclusiveLock);
+}
 
 void MultiDev::initMultidev (int debug)
 {
@@ -41,7 +55,10 @@ void MultiDev::initMultidev (int debug)
 int MultiDev::run (int debug)
 {
 	initMultidev (debug);
-	multiLoop ();
+	if (threaded)
+		threadLoop ();
+	else
+		multiLoop ();
 	return -1;
 }
 
@@ -57,18 +74,24 @@ void MultiDev::runLoop (float tmout)
 {
 	MultiDev::iterator iter;
 
-	struct timespec read_tout;
-	read_tout.tv_sec = int (tmout);
-	read_tout.tv_nsec = (tmout - read_tout.tv_sec) * NSEC_SEC;
-
 	nfds_t polls = 0;
 
+	double now = getNow ();
+
 	for (iter = begin (); iter != end (); iter++)
 	{
 		(*iter)->addPollSocks ();
 		polls += (*iter)->npolls;
+		// do not sleep past the first device timer
+		double next_timer = (*iter)->timers.nextDeadline ();
+		if (!isnan (next_timer) && next_timer - now < tmout)
+			tmout = next_timer > now ? next_timer - now : 0;
 	}
 
+	struct timespec read_tout;
+	read_tout.tv_sec = int (tmout);
+	read_tout.tv_nsec = (tmout - read_tout.tv_sec) * NSEC_SEC;
+
 	struct pollfd allpolls[polls + 1];
 	int pollsa[size ()];
 	int i = 0, j = 0;
@@ -99,15 +122,89 @@ void MultiDev::runLoop (float tmout)
 	}
 }
 
+int MultiDev::startThreads ()
+{
+	stopping = false;
+	deviceThreads.resize (size ());
+	threads.resize (size ());
+
+	// signals are handled by the main thread
+	sigset_t mask, oldmask;
+	sigemptyset (&mask);
+	sigaddset (&mask, SIGHUP);
+	sigaddset (&mask, SIGINT);
+	sigaddset (&mask, SIGTERM);
+	pthread_sigmask (SIG_BLOCK, &mask, &oldmask);
+
+	MultiDev::iterator iter;
+	size_t i = 0;
+	for (iter = begin (); iter != end (); iter++, i++)
+	{
+		(*iter)->loopLock = exclusive ? &exclusiveLock : NULL;
+		deviceThreads[i].md = this;
+		deviceThreads[i].dev = *iter;
+		if (pthread_create (&(threads[i]), NULL, deviceThread, &(deviceThreads[i])))
+		{
+			logStream (MESSAGE_ERROR) << "cannot start thread for device " << (*iter)->getDeviceName () << sendLog;
+			threads.resize (i);
+			pthread_sigmask (SIG_SETMASK, &oldmask, NULL);
+			stopThreads ();
+			return -1;
+		}
+	}
+
+	pthread_sigmask (SIG_SETMASK, &oldmask, NULL);
+	return 0;
+}
+
+void MultiDev::stopThreads ()
+{
+	if (threads.empty ())
+		return;
+	stopping = true;
+	MultiDev::iterator iter;
+	size_t i = 0;
+	for (iter = begin (); iter != end () && i < threads.size (); iter++, i++)
+		(*iter)->wakeup ();
+	for (i = 0; i < threads.size (); i++)
+		pthread_join (threads[i], NULL);
+	threads.clear ();
+	for (iter = begin (); iter != end (); iter++)
+		(*iter)->loopLock = NULL;
+}
+
+void MultiDev::threadLoop ()
+{
+	if (startThreads ())
+		return;
+	// wait for signal ending the main loop; wake up regularly, as device threads can end it as well
+	struct timespec tout;
+	tout.tv_sec = 1;
+	tout.tv_nsec = 0;
+	while (getMasterApp ()->getEndLoop () == false)
+		ppoll (NULL, 0, &tout, NULL);
+	stopThreads ();
+}
+
+void *MultiDev::deviceThread (void *arg)
+{
+	DeviceThread *dt = (DeviceThread *) arg;
+	while (dt->md->stopping == false && getMasterApp ()->getEndLoop () == false)
+		dt->dev->oneRunLoop ();
+	return NULL;
+}
+
 MultiBase::MultiBase (int argc, char **argv, const char *default_name):rts2core::Daemon (argc, argv)
 {
 	multi_name = default_name;
+	threads = false;
 
 	addOption (OPT_NOAUTH, "noauth", 0, "allow unauthorized connections");
 	addOption (OPT_NOTCHECKNULL, "notcheck", 0, "ignore if some recomended values are not set");
 	addOption (OPT_LOCALHOST, "localhost", 1, "hostname, if it different from return of gethostname()");
 	addOption (OPT_SERVER, "server", 1, "hostname (and possibly port number, separated by :) of central server");
 	addOption ('d', NULL, 1, "multidev name (lock file suffix)");
+	addOption (OPT_THREADS, "threads", 0, "run each device main loop in its own thread");
 }
 
 void MultiBase::addDevice (Device *dev)
@@ -141,6 +238,7 @@ int MultiBase::run ()
 	int ret = init ();
 	if (ret)
 		return ret;
+	md.setThreaded (threads);
 	return md.run ();
 }
 
@@ -157,6 +255,9 @@ int MultiBase::processOption (int opt)
 		case 'd':
 			multi_name = optarg;
 			break;
+		case OPT_THREADS:
+			threads = true;
+			break;
 		default:
 			return Daemon::processOption (opt);
 	}
@@ -157,6 +157,16 @@ int ObjectCheck::load_horizon (const char *horizon_file)
 	// sort horizon file
 	sort (horizon.begin (), horizon.end (), RAcomp);
 
+	// build azimuth index, so lookups do not need to walk whole horizon
+	azIndex.resize (360);
+	size_t i = 0;
+	for (int d = 0; d < 360; d++)
+	{
+		while (i < horizon.size () && horizon[i].hrz.az <= d)
+			i++;
+		azIndex[d] = i;
+	}
+
 	return 0;
 }
 
@@ -165,6 +175,21 @@ int ObjectCheck::is_good (const struct ln_hrz_posn *hrz, int hardness)
 	return hrz->alt > getHorizonHeight (hrz, hardness);
 }
 
+size_t ObjectCheck::is_good (const double *alt, const double *az, size_t n, char *good, int hardness)
+{
+	size_t first = n;
+	struct ln_hrz_posn hrz;
+	for (size_t i = 0; i < n; i++)
+	{
+		hrz.alt = alt[i];
+		hrz.az = az[i];
+		good[i] = is_good (&hrz, hardness);
+		if (good[i] == 0 && first == n)
+			first = i;
+	}
+	return first;
+}
+
 int ObjectCheck::is_good_with_margin (struct ln_hrz_posn *hrz, double alt_margin, double az_margin, int hardness)
 {
 	// check margin one..
@@ -200,6 +225,19 @@ double ObjectCheck::getHorizonHeight (const struct ln_hrz_posn *hrz, int hardnes
 	if (horizon.size () == 0)
 		return 0;
 
+	if (hrz->az >= 0 && hrz->az < 360 && azIndex.size () == 360)
+	{
+		// find first entry with azimuth above hrz->az, starting from the index
+		size_t i = azIndex[(int) hrz->az];
+		while (i < horizon.size () && horizon[i].hrz.az <= hrz->az)
+			i++;
+		if (i == 0)
+			return getHorizonHeightAz (hrz->az, horizon.begin (), --horizon.end ());
+		if (i == horizon.size ())
+			return getHorizonHeightAz (hrz->az, --horizon.end (), horizon.begin ());
+		return getHorizonHeightAz (hrz->az, horizon.begin () + (i - 1), horizon.begin () + i);
+	}
+
 	horizon_t::iterator iter = horizon.begin ();
 
 	if (hrz->az < (*iter).hrz.az)
@@ -0,0 +1,464 @@
+/*
+ * Pixel statistics of camera readout data.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "pixelstats.h"
+#include "imghdr.h"
+
+#include <math.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define PIXELSTATS_X86
+#include <immintrin.h>
+#endif
+
+// pixels processed in one block - block is kept in cache for histogram update.
+// 16 bit sums are kept in 32 bit integers inside block, so it must be smaller than 2^19
+#define PIXELSTATS_BLOCK     8192
+
+using namespace rts2camd;
+
+/**
+ * Sums of block of 16 bit data. Data are xored with flip, so unsigned
+ * data are processed as signed.
+ */
+struct Stats16
+{
+	int64_t sum;
+	uint64_t sumSq;
+	int16_t min;
+	int16_t max;
+};
+
+typedef void (*stats16_t) (const int16_t *data, size_t pixels, uint16_t flip, Stats16 &s);
+
+static void stats16Scalar (const int16_t *data, size_t pixels, uint16_t flip, Stats16 &s)
+{
+	int64_t sum = 0;
+	uint64_t sumSq = 0;
+	int16_t tMin = s.min;
+	int16_t tMax = s.max;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		int16_t v = data[i] ^ flip;
+		sum += v;
+		sumSq += (int32_t) v * v;
+		if (v < tMin)
+			tMin = v;
+		if (v > tMax)
+			tMax = v;
+	}
+	s.sum += sum;
+	s.sumSq += sumSq;
+	s.min = tMin;
+	s.max = tMax;
+}
+
+#ifdef PIXELSTATS_X86
+
+#ifdef __SSE2__
+static void stats16SSE2 (const int16_t *data, size_t pixels, uint16_t flip, Stats16 &s)
+{
+	const __m128i vflip = _mm_set1_epi16 (flip);
+	const __m128i ones = _mm_set1_epi16 (1);
+	const __m128i lo32 = _mm_set1_epi64x (0xffffffffLL);
+	__m128i vmin = _mm_set1_epi16 (s.min);
+	__m128i vmax = _mm_set1_epi16 (s.max);
+	__m128i vsum = _mm_setzero_si128 ();
+	__m128i vsq = _mm_setzero_si128 ();
+
+	size_t i = 0;
+	for (; i + 8 <= pixels; i += 8)
+	{
+		__m128i v = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (data + i)), vflip);
+		vmin = _mm_min_epi16 (vmin, v);
+		vmax = _mm_max_epi16 (vmax, v);
+		vsum = _mm_add_epi32 (vsum, _mm_madd_epi16 (v, ones));
+		// sum of two squares fits into unsigned 32 bit integer
+		__m128i sq = _mm_madd_epi16 (v, v);
+		vsq = _mm_add_epi64 (vsq, _mm_add_epi64 (_mm_and_si128 (sq, lo32), _mm_srli_epi64 (sq, 32)));
+	}
+
+	int16_t mi[8], ma[8];
+	int32_t su[4];
+	uint64_t sq[2];
+	_mm_storeu_si128 ((__m128i *) mi, vmin);
+	_mm_storeu_si128 ((__m128i *) ma, vmax);
+	_mm_storeu_si128 ((__m128i *) su, vsum);
+	_mm_storeu_si128 ((__m128i *) sq, vsq);
+	for (int j = 0; j < 8; j++)
+	{
+		if (mi[j] < s.min)
+			s.min = mi[j];
+		if (ma[j] > s.max)
+			s.max = ma[j];
+	}
+	s.sum += (int64_t) su[0] + su[1] + su[2] + su[3];
+	s.sumSq += sq[0] + sq[1];
+
+	stats16Scalar (data + i, pixels - i, flip, s);
+}
+#endif // __SSE2__
+
+__attribute__ ((target ("avx2")))
+static void stats16AVX2 (const int16_t *data, size_t pixels, uint16_t flip, Stats16 &s)
+{
+	const __m256i vflip = _mm256_set1_epi16 (flip);
+	const __m256i ones = _mm256_set1_epi16 (1);
+	const __m256i lo32 = _mm256_set1_epi64x (0xffffffffLL);
+	__m256i vmin = _mm256_set1_epi16 (s.min);
+	__m256i vmax = _mm256_set1_epi16 (s.max);
+	__m256i vsum = _mm256_setzero_si256 ();
+	__m256i vsq = _mm256_setzero_si256 ();
+
+	size_t i = 0;
+	for (; i + 16 <= pixels; i += 16)
+	{
+		__m256i v = _mm256_xor_si256 (_mm256_loadu_si256 ((const __m256i *) (data + i)), vflip);
+		vmin = _mm256_min_epi16 (vmin, v);
+		vmax = _mm256_max_epi16 (vmax, v);
+		vsum = _mm256_add_epi32 (vsum, _mm256_madd_epi16 (v, ones));
+		__m256i sq = _mm256_madd_epi16 (v, v);
+		vsq = _mm256_add_epi64 (vsq, _mm256_add_epi64 (_mm256_and_si256 (sq, lo32), _mm256_srli_epi64 (sq, 32)));
+	}
+
+	int16_t mi[16], ma[16];
+	int32_t su[8];
+	uint64_t sq[4];
+	_mm256_storeu_si256 ((__m256i *) mi, vmin);
+	_mm256_storeu_si256 ((__m256i *) ma, vmax);
+	_mm256_storeu_si256 ((__m256i *) su, vsum);
+	_mm256_storeu_si256 ((__m256i *) sq, vsq);
+	for (int j = 0; j < 16; j++)
+	{
+		if (mi[j] < s.min)
+			s.min = mi[j];
+		if (ma[j] > s.max)
+			s.max = ma[j];
+	}
+	for (int j = 0; j < 8; j++)
+		s.sum += su[j];
+	s.sumSq += sq[0] + sq[1] + sq[2] + sq[3];
+
+	stats16Scalar (data + i, pixels - i, flip, s);
+}
+
+#endif // PIXELSTATS_X86
+
+static stats16_t selectStats16 ()
+{
+#ifdef PIXELSTATS_X86
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx2"))
+		return stats16AVX2;
+#ifdef __SSE2__
+	return stats16SSE2;
+#endif
+#endif
+	return stats16Scalar;
+}
+
+static const stats16_t stats16 = selectStats16 ();
+
+/**
+ * Update histogram. Signed data are passed as unsigned, with xorIdx set to
+ * flip the sign bit.
+ */
+template <typename t> static inline void updateHistogram (const t *data, size_t pixels, t xorIdx, uint32_t *histogram)
+{
+	for (size_t i = 0; i < pixels; i++)
+		histogram[(t) (data[i] ^ xorIdx)]++;
+}
+
+PixelStatistics::PixelStatistics ()
+{
+	histogram = NULL;
+	histogramSize = 0;
+	histogramOffset = 0;
+	modeNum = 0;
+	modeIdx = 0;
+
+	workerRunning = false;
+	workerExit = false;
+	pthread_mutex_init (&mutex, NULL);
+	pthread_cond_init (&cond, NULL);
+
+	jobPending = false;
+	jobRet = 0;
+}
+
+PixelStatistics::~PixelStatistics ()
+{
+	if (workerRunning)
+	{
+		pthread_mutex_lock (&mutex);
+		workerExit = true;
+		pthread_cond_broadcast (&cond);
+		pthread_mutex_unlock (&mutex);
+		pthread_join (worker, NULL);
+	}
+	pthread_mutex_destroy (&mutex);
+	pthread_cond_destroy (&cond);
+
+	delete[] histogram;
+}
+
+void PixelStatistics::reset ()
+{
+	binned.nextFrame ();
+	if (histogram && modeNum > 0)
+		memset (histogram, 0, histogramSize * sizeof (uint32_t));
+	modeNum = 0;
+	modeIdx = 0;
+}
+
+int PixelStatistics::calculate (const char *data, size_t dataSize, int dataType, bool mode, ChunkStatistics &stats)
+{
+	switch (dataType)
+	{
+		case RTS2_DATA_BYTE:
+			calculateGeneric ((const uint8_t *) data, dataSize / sizeof (uint8_t), mode, stats);
+			break;
+		case RTS2_DATA_SBYTE:
+			calculateGeneric ((const int8_t *) data, dataSize / sizeof (int8_t), mode, stats);
+			break;
+		case RTS2_DATA_SHORT:
+			calculate16 ((const int16_t *) data, dataSize / sizeof (int16_t), true, mode, stats);
+			break;
+		case RTS2_DATA_USHORT:
+			calculate16 ((const int16_t *) data, dataSize / sizeof (int16_t), false, mode, stats);
+			break;
+		case RTS2_DATA_LONG:
+			calculateGeneric ((const int32_t *) data, dataSize / sizeof (int32_t), mode, stats);
+			break;
+		case RTS2_DATA_ULONG:
+			calculateGeneric ((const uint32_t *) data, dataSize / sizeof (uint32_t), mode, stats);
+			break;
+		case RTS2_DATA_LONGLONG:
+			calculateGeneric ((const int64_t *) data, dataSize / sizeof (int64_t), mode, stats);
+			break;
+		case RTS2_DATA_FLOAT:
+			calculateGeneric ((const float *) data, dataSize / sizeof (float), mode, stats);
+			break;
+		case RTS2_DATA_DOUBLE:
+			calculateGeneric ((const double *) data, dataSize / sizeof (double), mode, stats);
+			break;
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+void PixelStatistics::start (const char *data, size_t dataSize, int dataType, bool mode)
+{
+	pthread_mutex_lock (&mutex);
+	jobData = data;
+	jobSize = dataSize;
+	jobType = dataType;
+	jobMode = mode;
+	if (!workerRunning)
+	{
+		workerExit = false;
+		workerRunning = (pthread_create (&worker, NULL, PixelStatistics::workerThread, this) == 0);
+	}
+	if (!workerRunning)
+	{
+		pthread_mutex_unlock (&mutex);
+		jobRet = calculate (data, dataSize, dataType, mode, jobStats);
+		return;
+	}
+	jobPending = true;
+	pthread_cond_broadcast (&cond);
+	pthread_mutex_unlock (&mutex);
+}
+
+int PixelStatistics::wait (ChunkStatistics &stats)
+{
+	pthread_mutex_lock (&mutex);
+	while (jobPending)
+		pthread_cond_wait (&cond, &mutex);
+	stats = jobStats;
+	int ret = jobRet;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+void PixelStatistics::updateMode (uint32_t from, uint32_t to)
+{
+	for (uint32_t i = from; i <= to; i++)
+	{
+		if (histogram[i] >= modeNum && (histogram[i] > modeNum || i < modeIdx))
+		{
+			modeNum = histogram[i];
+			modeIdx = i;
+		}
+	}
+}
+
+void PixelStatistics::allocHistogram (size_t size, int offset)
+{
+	if (histogramSize != size || histogramOffset != offset)
+	{
+		delete[] histogram;
+		histogram = new uint32_t[size];
+		memset (histogram, 0, size * sizeof (uint32_t));
+		histogramSize = size;
+		histogramOffset = offset;
+		modeNum = 0;
+		modeIdx = 0;
+	}
+}
+
+template <typename t> void PixelStatistics::calculateGeneric (const t *data, size_t pixels, bool mode, ChunkStatistics &stats)
+{
+	stats.pixels = pixels;
+	stats.sum = 0;
+	stats.sumSq = 0;
+	stats.min = INFINITY;
+	stats.max = -INFINITY;
+
+	// exact histogram for 8 bit data, binned for the others
+	bool hist = mode && sizeof (t) == 1;
+	bool bhist = mode && sizeof (t) > 1;
+	uint8_t xorIdx = 0;
+	if (hist)
+	{
+		int offset = (t) -1 < 0 ? 128 : 0;
+		xorIdx = offset;
+		allocHistogram (256, offset);
+	}
+
+	for (size_t b = 0; b < pixels; b += PIXELSTATS_BLOCK)
+	{
+		size_t len = pixels - b < PIXELSTATS_BLOCK ? pixels - b : PIXELSTATS_BLOCK;
+		const t *d = data + b;
+		// independent accumulators, so the loop can be vectorized
+		double sum[4] = {0, 0, 0, 0};
+		double sumSq[4] = {0, 0, 0, 0};
+		t tMin[4], tMax[4];
+		for (int j = 0; j < 4; j++)
+			tMin[j] = tMax[j] = d[0];
+		size_t i = 0;
+		for (; i + 4 <= len; i += 4)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				t v = d[i + j];
+				sum[j] += v;
+				sumSq[j] += (double) v * v;
+				if (v < tMin[j])
+					tMin[j] = v;
+				if (v > tMax[j])
+					tMax[j] = v;
+			}
+		}
+		for (; i < len; i++)
+		{
+			t v = d[i];
+			sum[0] += v;
+			sumSq[0] += (double) v * v;
+			if (v < tMin[0])
+				tMin[0] = v;
+			if (v > tMax[0])
+				tMax[0] = v;
+		}
+		for (int j = 0; j < 4; j++)
+		{
+			stats.sum += sum[j];
+			stats.sumSq += sumSq[j];
+			if (tMin[j] < stats.min)
+				stats.min = tMin[j];
+			if (tMax[j] > stats.max)
+				stats.max = tMax[j];
+		}
+
+		if (hist)
+			updateHistogram ((const uint8_t *) d, len, xorIdx, histogram);
+		else if (bhist)
+			binned.add (d, len);
+	}
+
+	// only bins between chunk minimum and maximum were changed
+	if (hist && pixels > 0)
+		updateMode (stats.min + histogramOffset, stats.max + histogramOffset);
+}
+
+void PixelStatistics::calculate16 (const int16_t *data, size_t pixels, bool sign, bool mode, ChunkStatistics &stats)
+{
+	// unsigned data are xored with 0x8000 to be processed as signed, bias is then added to the results
+	uint16_t flip = sign ? 0 : 0x8000;
+	int64_t bias = sign ? 0 : 32768;
+	if (mode)
+		allocHistogram (65536, sign ? 32768 : 0);
+
+	Stats16 s;
+	s.sum = 0;
+	s.sumSq = 0;
+	s.min = INT16_MAX;
+	s.max = INT16_MIN;
+
+	for (size_t b = 0; b < pixels; b += PIXELSTATS_BLOCK)
+	{
+		size_t len = pixels - b < PIXELSTATS_BLOCK ? pixels - b : PIXELSTATS_BLOCK;
+		stats16 (data + b, len, flip, s);
+		if (mode)
+			updateHistogram ((const uint16_t *) (data + b), len, (uint16_t) (flip ^ 0x8000), histogram);
+	}
+
+	stats.pixels = pixels;
+	if (pixels == 0)
+	{
+		stats.sum = 0;
+		stats.sumSq = 0;
+		stats.min = INFINITY;
+		stats.max = -INFINITY;
+		return;
+	}
+	if (mode)
+		updateMode (s.min + 32768, s.max + 32768);
+	// sum (v + bias)^2 = sum v^2 + 2 * bias * sum v + n * bias^2
+	stats.sum = (long double) s.sum + (long double) pixels * bias;
+	stats.sumSq = (long double) s.sumSq + 2.0L * bias * s.sum + (long double) pixels * bias * bias;
+	stats.min = s.min + bias;
+	stats.max = s.max + bias;
+}
+
+void *PixelStatistics::workerThread (void *arg)
+{
+	PixelStatistics *ps = (PixelStatistics *) arg;
+	pthread_mutex_lock (&(ps->mutex));
+	while (true)
+	{
+		while (!ps->jobPending && !ps->workerExit)
+			pthread_cond_wait (&(ps->cond), &(ps->mutex));
+		if (ps->workerExit)
+			break;
+		pthread_mutex_unlock (&(ps->mutex));
+
+		ChunkStatistics cs;
+		int ret = ps->calculate (ps->jobData, ps->jobSize, ps->jobType, ps->jobMode, cs);
+
+		pthread_mutex_lock (&(ps->mutex));
+		ps->jobStats = cs;
+		ps->jobRet = ret;
+		ps->jobPending = false;
+		pthread_cond_broadcast (&(ps->cond));
+	}
+	pthread_mutex_unlock (&(ps->mutex));
+	return NULL;
+}
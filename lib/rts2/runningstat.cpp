@@ -0,0 +1,169 @@
+/*
+ * Streaming statistics of sliding window of samples.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "runningstat.h"
+
+#include <math.h>
+
+using namespace rts2core;
+
+void RunningStat::clear ()
+{
+	lower.clear ();
+	upper.clear ();
+	n = 0;
+	removals = 0;
+	meanY = meanT = 0;
+	m2Y = m2T = cTY = 0;
+}
+
+void RunningStat::add (double y, double t)
+{
+	if (isnan (y) || isnan (t))
+		return;
+
+	n++;
+	double dt = t - meanT;
+	double dy = y - meanY;
+	meanT += dt / n;
+	meanY += dy / n;
+	m2T += dt * (t - meanT);
+	m2Y += dy * (y - meanY);
+	cTY += dt * (y - meanY);
+
+	if (lower.empty () || y <= *(lower.rbegin ()))
+		lower.insert (y);
+	else
+		upper.insert (y);
+	balance ();
+}
+
+void RunningStat::remove (double y, double t)
+{
+	if (isnan (y) || isnan (t))
+		return;
+	removals++;
+
+	std::multiset <double>::iterator iter;
+	if (!lower.empty () && y <= *(lower.rbegin ()))
+	{
+		iter = lower.find (y);
+		if (iter == lower.end ())
+			return;
+		lower.erase (iter);
+	}
+	else
+	{
+		iter = upper.find (y);
+		if (iter == upper.end ())
+			return;
+		upper.erase (iter);
+	}
+	balance ();
+
+	if (n == 1)
+	{
+		n = 0;
+		meanY = meanT = 0;
+		m2Y = m2T = cTY = 0;
+		return;
+	}
+
+	// reverse Welford update
+	n--;
+	double newT = meanT + (meanT - t) / n;
+	double newY = meanY + (meanY - y) / n;
+	m2T -= (t - newT) * (t - meanT);
+	m2Y -= (y - newY) * (y - meanY);
+	cTY -= (t - newT) * (y - meanY);
+	meanT = newT;
+	meanY = newY;
+	if (m2Y < 0)
+		m2Y = 0;
+	if (m2T < 0)
+		m2T = 0;
+}
+
+double RunningStat::getMean ()
+{
+	if (n == 0)
+		return NAN;
+	return meanY;
+}
+
+double RunningStat::getStdev ()
+{
+	if (n == 0)
+		return NAN;
+	return sqrt (m2Y / n);
+}
+
+double RunningStat::getMedian ()
+{
+	if (lower.empty ())
+		return NAN;
+	if (lower.size () > upper.size ())
+		return *(lower.rbegin ());
+	return (*(lower.rbegin ()) + *(upper.begin ())) / 2.0;
+}
+
+double RunningStat::getMin ()
+{
+	if (lower.empty ())
+		return NAN;
+	return *(lower.begin ());
+}
+
+double RunningStat::getMax ()
+{
+	if (lower.empty ())
+		return NAN;
+	if (upper.empty ())
+		return *(lower.rbegin ());
+	return *(upper.rbegin ());
+}
+
+double RunningStat::getSlope ()
+{
+	if (n == 0)
+		return NAN;
+	return cTY / m2T;
+}
+
+double RunningStat::getCoMoment ()
+{
+	if (n == 0)
+		return NAN;
+	return cTY;
+}
+
+void RunningStat::balance ()
+{
+	if (lower.size () > upper.size () + 1)
+	{
+		std::multiset <double>::iterator iter = --lower.end ();
+		upper.insert (*iter);
+		lower.erase (iter);
+	}
+	else if (upper.size () > lower.size ())
+	{
+		std::multiset <double>::iterator iter = upper.begin ();
+		lower.insert (*iter);
+		upper.erase (iter);
+	}
+}
@@ -0,0 +1,287 @@
+/*
+ * Parallel Rice compression of image tiles.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "tilecompress.h"
+
+#include <string.h>
+#include <unistd.h>
+
+using namespace rts2core;
+
+/**
+ * Writes bits to the buffer, most significant bit first.
+ */
+class RiceBitWriter
+{
+	public:
+		RiceBitWriter (unsigned char *_out, size_t _outSize)
+		{
+			p = _out;
+			end = _out + _outSize;
+			acc = 0;
+			nacc = 0;
+			overflow = false;
+		}
+
+		/**
+		 * Write n (<= 32) lowest bits of value.
+		 */
+		void put (uint32_t value, int n)
+		{
+			acc = (acc << n) | (value & (n == 32 ? 0xffffffff : ((1u << n) - 1)));
+			nacc += n;
+			while (nacc >= 8)
+			{
+				nacc -= 8;
+				if (p == end)
+				{
+					overflow = true;
+					return;
+				}
+				*p++ = acc >> nacc;
+			}
+		}
+
+		/**
+		 * Write value coded as number of zeros followed by 1.
+		 */
+		void putUnary (uint32_t top)
+		{
+			while (top >= 32)
+			{
+				put (0, 32);
+				top -= 32;
+			}
+			put (1, top + 1);
+		}
+
+		/**
+		 * Write remaining bits, padded with zeros.
+		 */
+		void flush ()
+		{
+			if (nacc > 0)
+				put (0, 8 - nacc);
+		}
+
+		unsigned char *p;
+		unsigned char *end;
+		bool overflow;
+
+	private:
+		uint64_t acc;
+		int nacc;
+};
+
+TileCompressor::TileCompressor (int _threads)
+{
+	threads = _threads;
+	if (threads <= 0)
+		threads = sysconf (_SC_NPROCESSORS_ONLN);
+	if (threads <= 0)
+		threads = 1;
+	pthread_mutex_init (&mutex, NULL);
+}
+
+TileCompressor::~TileCompressor ()
+{
+	pthread_mutex_destroy (&mutex);
+}
+
+int TileCompressor::compress (const void *data, int bytepix, long width, long height, long tileWidth, long tileHeight)
+{
+	if ((bytepix != 1 && bytepix != 2 && bytepix != 4) || width <= 0 || height <= 0)
+		return -1;
+
+	imgData = (const char *) data;
+	imgBytepix = bytepix;
+	imgWidth = width;
+	imgHeight = height;
+	tWidth = (tileWidth <= 0 || tileWidth > width) ? width : tileWidth;
+	tHeight = (tileHeight <= 0) ? 1 : (tileHeight > height ? height : tileHeight);
+
+	tilesX = (width + tWidth - 1) / tWidth;
+	long tilesY = (height + tHeight - 1) / tHeight;
+
+	tiles.clear ();
+	tiles.resize (tilesX * tilesY);
+	nextTile = 0;
+
+	int nt = threads;
+	if ((size_t) nt > tiles.size ())
+		nt = tiles.size ();
+
+	std::vector <pthread_t> th;
+	for (int i = 1; i < nt; i++)
+	{
+		pthread_t t;
+		if (pthread_create (&t, NULL, compressThread, this))
+			break;
+		th.push_back (t);
+	}
+
+	// calling thread works as well
+	compressTiles ();
+
+	for (std::vector <pthread_t>::iterator iter = th.begin (); iter != th.end (); iter++)
+		pthread_join (*iter, NULL);
+
+	return 0;
+}
+
+size_t TileCompressor::getCompressedSize ()
+{
+	size_t ret = 0;
+	for (std::vector <std::vector <unsigned char> >::iterator iter = tiles.begin (); iter != tiles.end (); iter++)
+		ret += iter->size ();
+	return ret;
+}
+
+size_t TileCompressor::riceBound (size_t pixels, int bytepix, int nblock)
+{
+	// normal coding takes at most 2 bits per pixel more than raw data
+	return pixels * bytepix + pixels / 4 + pixels / nblock + bytepix + 8;
+}
+
+template <typename t> size_t TileCompressor::riceCompress (const t *data, size_t pixels, unsigned char *out, size_t outSize, int nblock)
+{
+	const int bbits = sizeof (t) * 8;
+	const int fsbits = bbits == 8 ? 3 : (bbits == 16 ? 4 : 5);
+	const int fsmax = bbits == 8 ? 6 : (bbits == 16 ? 14 : 25);
+	const uint32_t mask = bbits == 32 ? 0xffffffff : ((1u << bbits) - 1);
+
+	if (pixels == 0)
+		return 0;
+
+	RiceBitWriter bw (out, outSize);
+	std::vector <uint32_t> diff (nblock);
+
+	uint32_t last = (uint32_t) data[0] & mask;
+	bw.put (last, bbits);
+
+	for (size_t i = 0; i < pixels; i += nblock)
+	{
+		size_t thisblock = pixels - i < (size_t) nblock ? pixels - i : nblock;
+		double pixelsum = 0;
+		for (size_t j = 0; j < thisblock; j++)
+		{
+			uint32_t next = (uint32_t) data[i + j] & mask;
+			// difference in bbits two's complement, mapped to unsigned value
+			uint32_t d = (next - last) & mask;
+			diff[j] = ((d << 1) ^ (0 - (d >> (bbits - 1)))) & mask;
+			pixelsum += diff[j];
+			last = next;
+		}
+
+		double dpsum = (pixelsum - (thisblock / 2) - 1) / thisblock;
+		if (dpsum < 0)
+			dpsum = 0;
+		uint32_t psum = ((uint32_t) dpsum) >> 1;
+		int fs;
+		for (fs = 0; psum > 0; fs++)
+			psum >>= 1;
+
+		if (fs >= fsmax)
+		{
+			// high entropy - store differences without coding
+			bw.put (fsmax + 1, fsbits);
+			for (size_t j = 0; j < thisblock; j++)
+				bw.put (diff[j], bbits);
+		}
+		else if (fs == 0 && pixelsum == 0)
+		{
+			// all differences are zero
+			bw.put (0, fsbits);
+		}
+		else
+		{
+			bw.put (fs + 1, fsbits);
+			for (size_t j = 0; j < thisblock; j++)
+			{
+				bw.putUnary (diff[j] >> fs);
+				if (fs > 0)
+					bw.put (diff[j], fs);
+			}
+		}
+		if (bw.overflow)
+			return 0;
+	}
+	bw.flush ();
+	if (bw.overflow)
+		return 0;
+	return bw.p - out;
+}
+
+void TileCompressor::compressTiles ()
+{
+	std::vector <char> tileBuf (tWidth * tHeight * imgBytepix);
+	while (true)
+	{
+		pthread_mutex_lock (&mutex);
+		size_t tile = nextTile++;
+		pthread_mutex_unlock (&mutex);
+		if (tile >= tiles.size ())
+			break;
+
+		long x = (tile % tilesX) * tWidth;
+		long y = (tile / tilesX) * tHeight;
+		long w = x + tWidth > imgWidth ? imgWidth - x : tWidth;
+		long h = y + tHeight > imgHeight ? imgHeight - y : tHeight;
+
+		// copy tile to continuous buffer
+		const char *src = imgData;
+		if (w != imgWidth)
+		{
+			for (long r = 0; r < h; r++)
+				memcpy (&(tileBuf[r * w * imgBytepix]), imgData + ((y + r) * imgWidth + x) * imgBytepix, w * imgBytepix);
+			src = &(tileBuf[0]);
+		}
+		else
+		{
+			src = imgData + y * imgWidth * imgBytepix;
+		}
+
+		size_t pixels = w * h;
+		std::vector <unsigned char> &out = tiles[tile];
+		out.resize (riceBound (pixels, imgBytepix));
+		size_t len = 0;
+		switch (imgBytepix)
+		{
+			case 1:
+				len = riceCompress ((const uint8_t *) src, pixels, &(out[0]), out.size ());
+				break;
+			case 2:
+				len = riceCompress ((const int16_t *) src, pixels, &(out[0]), out.size ());
+				break;
+			case 4:
+				len = riceCompress ((const int32_t *) src, pixels, &(out[0]), out.size ());
+				break;
+		}
+		out.resize (len);
+	}
+}
+
+void *TileCompressor::compressThread (void *arg)
+{
+	((TileCompressor *) arg)->compressTiles ();
+	return NULL;
+}
+
+template size_t TileCompressor::riceCompress (const uint8_t *data, size_t pixels, unsigned char *out, size_t outSize, int nblock);
+template size_t TileCompressor::riceCompress (const int16_t *data, size_t pixels, unsigned char *out, size_t outSize, int nblock);
+template size_t TileCompressor::riceCompress (const int32_t *data, size_t pixels, unsigned char *out, size_t outSize, int nblock);
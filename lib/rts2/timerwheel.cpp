@@ -0,0 +1,356 @@
+/*
+ * Hierarchical timer wheel.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "timerwheel.h"
+
+#include <cmath>
+#include <string.h>
+
+// maximal distance (in ticks) of timer from current tick; timers further away are put to the last slot and recascaded
+#define TIMERWHEEL_MAX_DELTA   ((1ULL << (TIMERWHEEL_LEVELS * TIMERWHEEL_BITS)) - 1)
+
+using namespace rts2core;
+
+TimerWheel::TimerWheel (double _tick)
+{
+	tick = _tick;
+	current = 0;
+	seq = 0;
+	expireSeq = ~0ULL;
+	count = 0;
+	inWheel = 0;
+	lastNow = NAN;
+
+	memset (slots, 0, sizeof (slots));
+	memset (occupied, 0, sizeof (occupied));
+	due = NULL;
+
+	next = NAN;
+	nextValid = true;
+}
+
+TimerWheel::~TimerWheel ()
+{
+	for (std::map <int, TimerEntry *>::iterator iter = types.begin (); iter != types.end (); iter++)
+	{
+		TimerEntry *entry = iter->second;
+		while (entry)
+		{
+			TimerEntry *n = entry->typeNext;
+			delete entry->event;
+			delete entry;
+			entry = n;
+		}
+	}
+}
+
+void TimerWheel::add (double when, Event *event)
+{
+	TimerEntry *entry = new TimerEntry;
+	entry->when = when;
+	entry->expires = toTick (when);
+	entry->seq = seq++;
+	entry->event = event;
+
+	// empty wheel - start counting from the last known time
+	if (inWheel == 0)
+	{
+		uint64_t start = std::isnan (lastNow) ? entry->expires : toTick (lastNow);
+		if (start > current)
+			current = start;
+	}
+
+	insert (entry);
+
+	TimerEntry *&head = types[event->getType ()];
+	entry->typeNext = head;
+	if (head)
+		head->typePprev = &(entry->typeNext);
+	head = entry;
+	entry->typePprev = &head;
+
+	if (count == 0)
+	{
+		next = when;
+		nextValid = true;
+	}
+	else if (nextValid && when < next)
+	{
+		next = when;
+	}
+	count++;
+}
+
+int TimerWheel::remove (int event_type)
+{
+	std::map <int, TimerEntry *>::iterator iter = types.find (event_type);
+	if (iter == types.end ())
+		return 0;
+	int ret = 0;
+	while (iter->second)
+	{
+		TimerEntry *entry = iter->second;
+		unlink (entry);
+		delete entry->event;
+		delete entry;
+		ret++;
+	}
+	return ret;
+}
+
+int TimerWheel::remove (int event_type, void *arg)
+{
+	std::map <int, TimerEntry *>::iterator iter = types.find (event_type);
+	if (iter == types.end ())
+		return 0;
+	int ret = 0;
+	TimerEntry *entry = iter->second;
+	while (entry)
+	{
+		TimerEntry *typeNext = entry->typeNext;
+		if (entry->event->getArg () == arg)
+		{
+			unlink (entry);
+			delete entry->event;
+			delete entry;
+			ret++;
+		}
+		entry = typeNext;
+	}
+	return ret;
+}
+
+Event *TimerWheel::popExpired (double now, double *when)
+{
+	lastNow = now;
+	uint64_t to = toTick (now);
+	if (to >= current)
+		advance (to);
+
+	for (TimerEntry *entry = due; entry != NULL && entry->when <= now; entry = entry->next)
+	{
+		// added during processing of expired timers
+		if (entry->seq >= expireSeq)
+			continue;
+		Event *ret = entry->event;
+		*when = entry->when;
+		unlink (entry);
+		delete entry;
+		return ret;
+	}
+	return NULL;
+}
+
+double TimerWheel::nextDeadline ()
+{
+	if (nextValid)
+		return next;
+
+	next = NAN;
+	if (due)
+		next = due->when;
+
+	for (int l = 0; l < TIMERWHEEL_LEVELS && inWheel > 0; l++)
+	{
+		int cur = (current >> (l * TIMERWHEEL_BITS)) & TIMERWHEEL_MASK;
+		// slot of current tick holds either timers not yet cascaded, which are
+		// the earliest at this level, or timers one full turn ahead, which are
+		// the latest. Check it together with the next occupied slot.
+		int s = firstOccupied (l, cur);
+		for (int pass = 0; pass < 2 && s >= 0; pass++)
+		{
+			for (TimerEntry *entry = slots[l][s]; entry != NULL; entry = entry->next)
+			{
+				if (std::isnan (next) || entry->when < next)
+					next = entry->when;
+			}
+			if (s != cur)
+				break;
+			s = firstOccupied (l, (cur + 1) & TIMERWHEEL_MASK);
+			if (s == cur)
+				break;
+		}
+	}
+	nextValid = true;
+	return next;
+}
+
+uint64_t TimerWheel::toTick (double t)
+{
+	if (t <= 0)
+		return 0;
+	return (uint64_t) floor (t / tick);
+}
+
+void TimerWheel::insert (TimerEntry *entry)
+{
+	// already expired
+	if (entry->expires < current)
+	{
+		insertDue (entry);
+		return;
+	}
+
+	uint64_t delta = entry->expires - current;
+	uint64_t expires = entry->expires;
+	if (delta > TIMERWHEEL_MAX_DELTA)
+	{
+		delta = TIMERWHEEL_MAX_DELTA;
+		expires = current + delta;
+	}
+
+	int l;
+	for (l = 0; l < TIMERWHEEL_LEVELS - 1; l++)
+	{
+		if (delta < (1ULL << ((l + 1) * TIMERWHEEL_BITS)))
+			break;
+	}
+	int s = (expires >> (l * TIMERWHEEL_BITS)) & TIMERWHEEL_MASK;
+
+	entry->level = l;
+	entry->slot = s;
+	entry->next = slots[l][s];
+	if (entry->next)
+		entry->next->pprev = &(entry->next);
+	slots[l][s] = entry;
+	entry->pprev = &(slots[l][s]);
+	occupied[l][s / 64] |= 1ULL << (s % 64);
+	inWheel++;
+}
+
+void TimerWheel::insertDue (TimerEntry *entry)
+{
+	TimerEntry **p = &due;
+	while (*p && (*p)->when <= entry->when)
+		p = &((*p)->next);
+	entry->level = -1;
+	entry->slot = -1;
+	entry->next = *p;
+	if (entry->next)
+		entry->next->pprev = &(entry->next);
+	*p = entry;
+	entry->pprev = p;
+}
+
+void TimerWheel::unlink (TimerEntry *entry)
+{
+	*(entry->pprev) = entry->next;
+	if (entry->next)
+		entry->next->pprev = entry->pprev;
+	if (entry->level >= 0)
+	{
+		if (slots[entry->level][entry->slot] == NULL)
+			occupied[entry->level][entry->slot / 64] &= ~(1ULL << (entry->slot % 64));
+		inWheel--;
+	}
+
+	*(entry->typePprev) = entry->typeNext;
+	if (entry->typeNext)
+		entry->typeNext->typePprev = entry->typePprev;
+
+	count--;
+	if (!nextValid || !(entry->when > next))
+		nextValid = false;
+}
+
+void TimerWheel::advance (uint64_t to)
+{
+	while (current <= to)
+	{
+		if (inWheel == 0)
+		{
+			current = to + 1;
+			break;
+		}
+
+		int idx = current & TIMERWHEEL_MASK;
+		if (idx == 0)
+		{
+			// cascade timers from higher levels
+			for (int l = 1; l < TIMERWHEEL_LEVELS; l++)
+			{
+				int s = (current >> (l * TIMERWHEEL_BITS)) & TIMERWHEEL_MASK;
+				cascade (l, s);
+				if (s != 0)
+					break;
+			}
+		}
+
+		// move timers to due list
+		TimerEntry *entry = slots[0][idx];
+		slots[0][idx] = NULL;
+		occupied[0][idx / 64] &= ~(1ULL << (idx % 64));
+		while (entry)
+		{
+			TimerEntry *n = entry->next;
+			inWheel--;
+			insertDue (entry);
+			entry = n;
+		}
+
+		current++;
+
+		// skip empty slots up to next cascade
+		idx = current & TIMERWHEEL_MASK;
+		if (idx != 0 && current <= to)
+		{
+			int s = firstOccupied (0, idx);
+			uint64_t skip_to;
+			if (s < idx)
+				skip_to = (current | TIMERWHEEL_MASK) + 1;
+			else
+				skip_to = current + (s - idx);
+			current = skip_to < to + 1 ? skip_to : to + 1;
+		}
+	}
+}
+
+void TimerWheel::cascade (int level, int slot)
+{
+	TimerEntry *entry = slots[level][slot];
+	slots[level][slot] = NULL;
+	occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+	while (entry)
+	{
+		TimerEntry *n = entry->next;
+		inWheel--;
+		insert (entry);
+		entry = n;
+	}
+}
+
+int TimerWheel::firstOccupied (int level, int from)
+{
+	// search from given slot to end, then from start
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int s = pass == 0 ? from : 0;
+		int end = pass == 0 ? TIMERWHEEL_SIZE : from;
+		while (s < end)
+		{
+			uint64_t w = occupied[level][s / 64] >> (s % 64);
+			if (w)
+			{
+				s += __builtin_ctzll (w);
+				return s < end ? s : -1;
+			}
+			s = (s / 64 + 1) * 64;
+		}
+	}
+	return -1;
+}
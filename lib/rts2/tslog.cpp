@@ -0,0 +1,507 @@
+/*
+ * Binary columnar time-series store.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "tslog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define TSLOG_MAGIC        "RTS2TSL\n"
+#define TSLOG_VERSION      1
+#define TSLOG_BLOCK_MAGIC  0x314b4c42
+
+using namespace rts2core;
+
+// all multibyte numbers are stored in little endian byte order
+
+static void putU32 (unsigned char *p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++, v >>= 8)
+		p[i] = v & 0xff;
+}
+
+static uint32_t getU32 (const unsigned char *p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t doubleBits (double d)
+{
+	uint64_t b;
+	memcpy (&b, &d, sizeof (b));
+	return b;
+}
+
+static double bitsDouble (uint64_t b)
+{
+	double d;
+	memcpy (&d, &b, sizeof (d));
+	return d;
+}
+
+static void putDouble (unsigned char *p, double d)
+{
+	uint64_t b = doubleBits (d);
+	for (int i = 0; i < 8; i++, b >>= 8)
+		p[i] = b & 0xff;
+}
+
+static double getDouble (const unsigned char *p)
+{
+	uint64_t b = 0;
+	for (int i = 7; i >= 0; i--)
+		b = (b << 8) | p[i];
+	return bitsDouble (b);
+}
+
+static void putVarint (std::vector <unsigned char> &out, int64_t v)
+{
+	// zig-zag mapping, so small negative numbers take few bytes as well
+	uint64_t u = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+	while (u >= 0x80)
+	{
+		out.push_back ((u & 0x7f) | 0x80);
+		u >>= 7;
+	}
+	out.push_back (u);
+}
+
+static bool getVarint (const unsigned char *&p, const unsigned char *end, int64_t &v)
+{
+	uint64_t u = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (p == end)
+			return false;
+		unsigned char c = *p++;
+		u |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+		{
+			v = (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+static int64_t toUsec (double t)
+{
+	return (int64_t) llround (t * 1e6);
+}
+
+static void blockExtremes (const double *t, const double *v, size_t count, double &tmin, double &tmax, double &vmin, double &vmax)
+{
+	tmin = tmax = toUsec (t[0]) / 1e6;
+	vmin = vmax = NAN;
+	for (size_t i = 0; i < count; i++)
+	{
+		double ti = toUsec (t[i]) / 1e6;
+		if (ti < tmin)
+			tmin = ti;
+		if (ti > tmax)
+			tmax = ti;
+		if (isnan (v[i]))
+			continue;
+		if (isnan (vmin) || v[i] < vmin)
+			vmin = v[i];
+		if (isnan (vmax) || v[i] > vmax)
+			vmax = v[i];
+	}
+}
+
+TimeseriesWriter::TimeseriesWriter ()
+{
+	fd = -1;
+	flushInterval = TSLOG_FLUSH_INTERVAL;
+}
+
+TimeseriesWriter::~TimeseriesWriter ()
+{
+	close ();
+}
+
+int TimeseriesWriter::open (const char *path, const char *name, int32_t type)
+{
+	close ();
+	fd = ::open (path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (fd < 0)
+		return -1;
+
+	struct stat st;
+	if (fstat (fd, &st))
+		goto err;
+
+	if (st.st_size >= TSLOG_HEADER_SIZE)
+	{
+		unsigned char h[TSLOG_HEADER_SIZE];
+		if (pread (fd, h, TSLOG_HEADER_SIZE, 0) != TSLOG_HEADER_SIZE)
+			goto err;
+		if (memcmp (h, TSLOG_MAGIC, 8) || getU32 (h + 8) != TSLOG_VERSION)
+		{
+			errno = EINVAL;
+			goto err;
+		}
+		// find end of the last complete block
+		off_t off = TSLOG_HEADER_SIZE;
+		while (off + TSLOG_BLOCK_HEADER <= st.st_size)
+		{
+			if (pread (fd, h, TSLOG_BLOCK_HEADER, off) != TSLOG_BLOCK_HEADER)
+				goto err;
+			if (getU32 (h) != TSLOG_BLOCK_MAGIC || off + TSLOG_BLOCK_HEADER + getU32 (h + 8) > st.st_size)
+				break;
+			off += TSLOG_BLOCK_HEADER + getU32 (h + 8);
+		}
+		if (off != st.st_size && ftruncate (fd, off))
+			goto err;
+		return 0;
+	}
+
+	// new file, or file with truncated header
+	if (st.st_size > 0 && ftruncate (fd, 0))
+		goto err;
+	{
+		unsigned char h[TSLOG_HEADER_SIZE];
+		memset (h, 0, sizeof (h));
+		memcpy (h, TSLOG_MAGIC, 8);
+		putU32 (h + 8, TSLOG_VERSION);
+		putU32 (h + 12, type);
+		strncpy ((char *) h + 16, name, TSLOG_HEADER_SIZE - 17);
+		if (write (fd, h, TSLOG_HEADER_SIZE) != TSLOG_HEADER_SIZE)
+			goto err;
+	}
+	return 0;
+
+err:
+	int e = errno;
+	::close (fd);
+	fd = -1;
+	errno = e;
+	return -1;
+}
+
+void TimeseriesWriter::close ()
+{
+	if (fd < 0)
+		return;
+	flush ();
+	::close (fd);
+	fd = -1;
+}
+
+int TimeseriesWriter::add (double t, double v)
+{
+	times.push_back (t);
+	values.push_back (v);
+	if (times.size () >= TSLOG_BLOCK_SAMPLES || t - times[0] >= flushInterval)
+		return flush ();
+	return 0;
+}
+
+int TimeseriesWriter::flush ()
+{
+	if (times.empty ())
+		return 0;
+	if (fd < 0)
+		return -1;
+	size_t len = encodeBlock (&(times[0]), &(values[0]), times.size (), buf);
+	times.clear ();
+	values.clear ();
+
+	// single write, so concurrent readers see either no block or complete block
+	const unsigned char *p = &(buf[0]);
+	while (len > 0)
+	{
+		ssize_t ret = write (fd, p, len);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+size_t TimeseriesWriter::encodeBlock (const double *t, const double *v, size_t count, std::vector <unsigned char> &out)
+{
+	out.resize (TSLOG_BLOCK_HEADER);
+	if (count == 0)
+		return 0;
+
+	// times
+	int64_t last = toUsec (t[0]);
+	int64_t lastDelta = 0;
+	putVarint (out, last);
+	for (size_t i = 1; i < count; i++)
+	{
+		int64_t us = toUsec (t[i]);
+		int64_t delta = us - last;
+		putVarint (out, delta - lastDelta);
+		lastDelta = delta;
+		last = us;
+	}
+
+	// values - control byte holds number of leading and trailing zero bytes of XOR with previous value
+	uint64_t prev = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t b = doubleBits (v[i]);
+		uint64_t x = b ^ prev;
+		prev = b;
+		if (x == 0)
+		{
+			out.push_back (0x80);
+			continue;
+		}
+		int lz = 0;
+		while (!(x & (0xffull << (56 - lz * 8))))
+			lz++;
+		int tz = 0;
+		while (!(x & (0xffull << (tz * 8))))
+			tz++;
+		out.push_back ((lz << 4) | tz);
+		for (int j = 7 - lz; j >= tz; j--)
+			out.push_back ((x >> (j * 8)) & 0xff);
+	}
+
+	double tmin, tmax, vmin, vmax;
+	blockExtremes (t, v, count, tmin, tmax, vmin, vmax);
+
+	unsigned char *h = &(out[0]);
+	putU32 (h, TSLOG_BLOCK_MAGIC);
+	putU32 (h + 4, count);
+	putU32 (h + 8, out.size () - TSLOG_BLOCK_HEADER);
+	putU32 (h + 12, 0);
+	putDouble (h + 16, tmin);
+	putDouble (h + 24, tmax);
+	putDouble (h + 32, vmin);
+	putDouble (h + 40, vmax);
+
+	return out.size ();
+}
+
+TimeseriesReader::TimeseriesReader ()
+{
+	type = 0;
+	fd = -1;
+	map = NULL;
+	mapSize = 0;
+}
+
+TimeseriesReader::~TimeseriesReader ()
+{
+	close ();
+}
+
+int TimeseriesReader::open (const char *_path)
+{
+	close ();
+	path = std::string (_path);
+	fd = ::open (_path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (refresh ())
+	{
+		close ();
+		return -1;
+	}
+	return 0;
+}
+
+void TimeseriesReader::close ()
+{
+	if (map)
+		munmap (map, mapSize);
+	map = NULL;
+	mapSize = 0;
+	if (fd >= 0)
+		::close (fd);
+	fd = -1;
+	blocks.clear ();
+}
+
+int TimeseriesReader::refresh ()
+{
+	if (fd < 0)
+		return -1;
+
+	struct stat st;
+	if (fstat (fd, &st))
+		return -1;
+
+	if (map)
+		munmap (map, mapSize);
+	map = NULL;
+	mapSize = 0;
+	blocks.clear ();
+
+	if (st.st_size < TSLOG_HEADER_SIZE)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	void *m = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED)
+		return -1;
+	map = (unsigned char *) m;
+	mapSize = st.st_size;
+
+	if (memcmp (map, TSLOG_MAGIC, 8) || getU32 (map + 8) != TSLOG_VERSION)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	type = getU32 (map + 12);
+	name = std::string ((const char *) map + 16, strnlen ((const char *) map + 16, TSLOG_HEADER_SIZE - 16));
+
+	size_t off = TSLOG_HEADER_SIZE;
+	while (off + TSLOG_BLOCK_HEADER <= mapSize)
+	{
+		const unsigned char *h = map + off;
+		TimeseriesBlock b;
+		b.offset = off;
+		b.count = getU32 (h + 4);
+		b.size = getU32 (h + 8);
+		if (getU32 (h) != TSLOG_BLOCK_MAGIC || off + TSLOG_BLOCK_HEADER + b.size > mapSize)
+			break;
+		b.tmin = getDouble (h + 16);
+		b.tmax = getDouble (h + 24);
+		b.vmin = getDouble (h + 32);
+		b.vmax = getDouble (h + 40);
+		blocks.push_back (b);
+		off += TSLOG_BLOCK_HEADER + b.size;
+	}
+	return 0;
+}
+
+size_t TimeseriesReader::getSamples ()
+{
+	size_t ret = 0;
+	for (std::vector <TimeseriesBlock>::iterator iter = blocks.begin (); iter != blocks.end (); iter++)
+		ret += iter->count;
+	return ret;
+}
+
+int TimeseriesReader::readBlock (size_t i, std::vector <double> &t, std::vector <double> &v)
+{
+	if (i >= blocks.size ())
+		return -1;
+	TimeseriesBlock &b = blocks[i];
+	return decodeBlock (map + b.offset + TSLOG_BLOCK_HEADER, b.size, b.count, t, v);
+}
+
+size_t TimeseriesReader::scan (double from, double to, std::vector <double> &t, std::vector <double> &v)
+{
+	size_t ret = 0;
+	std::vector <double> bt;
+	std::vector <double> bv;
+	for (size_t i = 0; i < blocks.size (); i++)
+	{
+		if (blocks[i].tmax < from || blocks[i].tmin > to)
+			continue;
+		// whole block in range - decode directly to the output
+		if (blocks[i].tmin >= from && blocks[i].tmax <= to)
+		{
+			if (readBlock (i, t, v) == 0)
+				ret += blocks[i].count;
+			continue;
+		}
+		bt.clear ();
+		bv.clear ();
+		if (readBlock (i, bt, bv))
+			continue;
+		for (size_t j = 0; j < bt.size (); j++)
+		{
+			if (bt[j] >= from && bt[j] <= to)
+			{
+				t.push_back (bt[j]);
+				v.push_back (bv[j]);
+				ret++;
+			}
+		}
+	}
+	return ret;
+}
+
+int TimeseriesReader::decodeBlock (const unsigned char *data, size_t size, uint32_t count, std::vector <double> &t, std::vector <double> &v)
+{
+	const unsigned char *p = data;
+	const unsigned char *end = data + size;
+
+	size_t ts = t.size ();
+	t.resize (ts + count);
+	v.resize (ts + count);
+
+	int64_t last = 0;
+	int64_t delta = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int64_t d;
+		if (!getVarint (p, end, d))
+			goto err;
+		if (i == 0)
+		{
+			last = d;
+		}
+		else
+		{
+			delta += d;
+			last += delta;
+		}
+		t[ts + i] = last / 1e6;
+	}
+
+	{
+		uint64_t prev = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (p == end)
+				goto err;
+			int lz = *p >> 4;
+			int tz = *p & 0x0f;
+			p++;
+			if (lz + tz > 8)
+				goto err;
+			uint64_t x = 0;
+			int n = 8 - lz - tz;
+			if (p + n > end)
+				goto err;
+			for (int j = 0; j < n; j++)
+				x = (x << 8) | *p++;
+			if (n > 0)
+				x <<= tz * 8;
+			prev ^= x;
+			v[ts + i] = bitsDouble (prev);
+		}
+	}
+	return 0;
+
+err:
+	t.resize (ts);
+	v.resize (ts);
+	return -1;
+}
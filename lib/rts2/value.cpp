@@ -83,9 +83,20 @@ int Value::sendMetaInfo (Connection * connection)
 	return 0;
 }
 
-void Value::send (Connection * connection)
+std::string Value::getSendMessage ()
 {
-	connection->sendValueRaw (getName (), getValue ());
+	std::string msg (PROTO_VALUE " ");
+	msg += getName ();
+	msg += ' ';
+	msg += getValue ();
+	return msg;
+}
+
+int Value::sendMessage (Connection * connection, const std::string &msg)
+{
+	if (connection->getConnState () == CONN_INPROGRESS)
+		return -1;
+	return connection->sendMsg (msg.c_str ());
 }
 
 ValueString::ValueString (std::string in_val_name): Value (in_val_name)
@@ -134,9 +145,21 @@ int ValueString::setValueInteger (int in_value)
 	return 0;
 }
 
-void ValueString::send (Connection * connection)
+std::string ValueString::getSendMessage ()
 {
-	connection->sendValue (getName (), getValue ());
+	std::string msg (PROTO_VALUE " ");
+	msg += getName ();
+	msg += " \"";
+	msg += getValue ();
+	msg += '"';
+	return msg;
+}
+
+int ValueString::sendMessage (Connection * connection, const std::string &msg)
+{
+	if (connection->getConnState () == CONN_INPROGRESS || connection->getConnState () == CONN_UNKNOW)
+		return -1;
+	return connection->sendMsg (msg.c_str ());
 }
 
 void ValueString::setFromValue (Value * newValue)
@@ -33,6 +33,7 @@ void ValueDoubleStat::clearStat ()
 	max = NAN;
 	stdev = NAN;
 	valueList.clear ();
+	runStat.clear ();
 	changed ();
 }
 
@@ -40,30 +41,22 @@ void ValueDoubleStat::calculate ()
 {
 	if (valueList.size () == 0)
 		return;
-	std::deque < double >sorted = valueList;
-	std::sort (sorted.begin (), sorted.end ());
-	min = *(sorted.begin ());
-	max = *(--sorted.end ());
 	numMes = valueList.size ();
-	double sum = 0;
-	stdev = 0;
-	double tmp_stdev;
-	for (std::deque < double >::iterator iter = sorted.begin (); iter != sorted.end (); iter++)
-	{
-		sum += (*iter);
-		tmp_stdev = *iter - getValueDouble ();
-		tmp_stdev *= tmp_stdev;
-		stdev += tmp_stdev;
-	}
-	setValueDouble (sum / numMes);
-	stdev = sqrt (stdev / numMes);
-	if ((numMes % 2) == 1)
-		mode = sorted[numMes / 2];
-	else
-		mode = (sorted[numMes / 2 - 1] + sorted[numMes / 2]) / 2.0;
+	min = runStat.getMin ();
+	max = runStat.getMax ();
+	setValueDouble (runStat.getMean ());
+	stdev = runStat.getStdev ();
+	mode = runStat.getMedian ();
 	changed ();
 }
 
+void ValueDoubleStat::rebuildStat ()
+{
+	runStat.clear ();
+	for (std::deque <double>::iterator iter = valueList.begin (); iter != valueList.end (); iter++)
+		runStat.add (*iter);
+}
+
 ValueDoubleStat::ValueDoubleStat (std::string in_val_name):ValueDouble (in_val_name)
 {
 	clearStat ();
@@ -113,11 +106,11 @@ const char * ValueDoubleStat::getDisplayValue ()
 	return buf;
 }
 
-void ValueDoubleStat::send (Connection * connection)
+std::string ValueDoubleStat::getSendMessage ()
 {
 	if (numMes != (int) valueList.size ())
 		calculate ();
-	ValueDouble::send (connection);
+	return ValueDouble::getSendMessage ();
 }
 
 void ValueDoubleStat::setFromValue (Value * newValue)
@@ -131,6 +124,7 @@ void ValueDoubleStat::setFromValue (Value * newValue)
 		max = ((ValueDoubleStat *) newValue)->getMax ();
 		stdev = ((ValueDoubleStat *) newValue)->getStdev ();
 		valueList = ((ValueDoubleStat *) newValue)->getMesList ();
+		rebuildStat ();
 	}
 }
 
@@ -144,6 +138,7 @@ void ValueDoubleTimeserie::clearStat ()
 	alpha = NAN;
 	beta = NAN;
 	valueList.clear ();
+	runStat.clear ();
 	changed ();
 }
 
@@ -151,55 +146,27 @@ void ValueDoubleTimeserie::calculate ()
 {
 	if (valueList.size () == 0)
 		return;
-	std::deque < std::pair <double, double> > sorted = valueList;
-	std::sort (sorted.begin (), sorted.end ());
-	min = sorted.begin ()->first;
-	max = (--sorted.end ())->first;
 	numMes = valueList.size ();
-	double sum = 0;
-	double sum2 = 0;
-	for (std::deque < std::pair <double, double> >::iterator iter = sorted.begin (); iter != sorted.end (); iter++)
-	{
-		sum += iter->first;
-		sum2 += iter->second;
-	}
-	setValueDouble (sum / numMes);
-
-	alpha = 0;
-	beta = 0;
-
-	sum2 /= numMes;
+	min = runStat.getMin ();
+	max = runStat.getMax ();
+	setValueDouble (runStat.getMean ());
+	stdev = runStat.getStdev ();
 
-	double std = 0;
-	double alpha2 = 0;
-	double sx = 0;
-
-	// calculate stdev, alpha, beta
-	stdev = 0;
-	for (std::deque < std::pair <double, double> >::iterator iter = sorted.begin (); iter != sorted.end (); iter++)
-	{
-		std = iter->first - getValueDouble ();
-		std *= std;
-		stdev += std;
-
-		double x = (iter->second - sum2);
-		sx += x;
-		alpha += x * iter->first;
-		alpha2 += x * x;
-	}
-	stdev = sqrt (stdev / numMes);
-
-	beta = (alpha - sx * sum / numMes) / (alpha2 - sx * sx / numMes);
+	beta = runStat.getSlope ();
 	// transform alpha to median value of X
-	alpha = (sum - beta * alpha) / numMes;
+	alpha = getValueDouble () - beta * runStat.getCoMoment () / numMes;
 
-	if ((numMes % 2) == 1)
-		mode = sorted[numMes / 2].first;
-	else
-		mode = (sorted[numMes / 2 - 1].first + sorted[numMes / 2].first) / 2.0;
+	mode = runStat.getMedian ();
 	changed ();
 }
 
+void ValueDoubleTimeserie::rebuildStat ()
+{
+	runStat.clear ();
+	for (std::deque <std::pair <double, double> >::iterator iter = valueList.begin (); iter != valueList.end (); iter++)
+		runStat.add (iter->first, iter->second);
+}
+
 ValueDoubleTimeserie::ValueDoubleTimeserie (std::string in_val_name):ValueDouble (in_val_name)
 {
 	clearStat ();
@@ -239,11 +206,11 @@ const char * ValueDoubleTimeserie::getDisplayValue ()
 	return buf;
 }
 
-void ValueDoubleTimeserie::send (Connection * connection)
+std::string ValueDoubleTimeserie::getSendMessage ()
 {
 	if (numMes != (int) valueList.size ())
 		calculate ();
-	ValueDouble::send (connection);
+	return ValueDouble::getSendMessage ();
 }
 
 void ValueDoubleTimeserie::setFromValue (Value * newValue)
@@ -259,5 +226,6 @@ void ValueDoubleTimeserie::setFromValue (Value * newValue)
 		alpha = ((ValueDoubleTimeserie *) newValue)->getAlpha ();
 		beta = ((ValueDoubleTimeserie *) newValue)->getBeta ();
 		valueList = ((ValueDoubleTimeserie *) newValue)->getMesList ();
+		rebuildStat ();
 	}
 }
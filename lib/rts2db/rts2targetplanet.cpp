@@ -141,7 +141,18 @@ TargetPlanet::~TargetPlanet (void)
 void TargetPlanet::load ()
 {
 	Target::load ();
+	findPlanet ();
+}
 
+bool TargetPlanet::loadFromRow (const TargetRow &row)
+{
+	Target::loadFromRow (row);
+	findPlanet ();
+	return true;
+}
+
+void TargetPlanet::findPlanet ()
+{
 	planet_info = NULL;
 
 	for (int i = 0; i < PLANETS; i++)
@@ -45,11 +45,14 @@ class TargetPlanet:public Target
 	private:
 		planet_info_t * planet_info;
 		void getPosition (struct ln_equ_posn *pos, double JD, struct ln_equ_posn *parallax);
+		// find planet by target name
+		void findPlanet ();
 	public:
 		TargetPlanet (int tar_id, struct ln_lnlat_posn *in_obs, double in_altitude);
 		virtual ~ TargetPlanet (void);
 
 		virtual void load ();
+		virtual bool loadFromRow (const TargetRow &row);
 		virtual void getPosition (struct ln_equ_posn *pos, double JD);
 		virtual int getRST (struct ln_rst_time *rst, double JD, double horizon);
 
@@ -33,6 +33,18 @@ EllTarget::EllTarget (int in_tar_id, struct ln_lnlat_posn *in_obs, double in_alt
 void EllTarget::load ()
 {
 	Target::load ();
+	orbitFromInfo ();
+}
+
+bool EllTarget::loadFromRow (const TargetRow &row)
+{
+	Target::loadFromRow (row);
+	orbitFromInfo ();
+	return true;
+}
+
+void EllTarget::orbitFromInfo ()
+{
 	// try to parse MPC string..
 	int ret = LibnovaEllFromMPC (&orbit, designation, getTargetInfo ());
 	if (ret)
@@ -40,6 +40,13 @@ void TLETarget::load ()
 	orbitFromTLE (tarInfo);
 }
 
+bool TLETarget::loadFromRow (const TargetRow &row)
+{
+	Target::loadFromRow (row);
+	orbitFromTLE (std::string (getTargetInfo ()));
+	return true;
+}
+
 void TLETarget::orbitFromTLE (std::string target_tle)
 {
 	size_t sub = target_tle.find ('|');
@@ -74,6 +74,7 @@ DevClientCameraImage::DevClientCameraImage (rts2core::Connection * in_connection
 	}
 
 	actualImage = NULL;
+	fitsWriter = NULL;
 
 	expNum = 0;
 
@@ -84,6 +85,8 @@ DevClientCameraImage::~DevClientCameraImage (void)
 {
 	delete fitsTemplate;
 	delete actualImage;
+	for (std::list <Image *>::iterator iter = writingImages.begin (); iter != writingImages.end (); iter++)
+		delete *iter;
 }
 
 Image * DevClientCameraImage::setImage (Image * old_img, Image * new_image)
@@ -157,7 +160,7 @@ void DevClientCameraImage::postEvent (rts2core::Event * event)
 			actualImage = NULL;
 			break;
 		case EVENT_NUMBER_OF_IMAGES:
-			*((int *)event->getArg ()) += images.size ();
+			*((int *)event->getArg ()) += images.size () + writingImages.size ();
 			if (actualImage)
 				*((int *)event->getArg ()) += 1;
 			break;
@@ -173,6 +176,17 @@ void DevClientCameraImage::postEvent (rts2core::Event * event)
 				}
 			}
 			break;
+		case EVENT_FITS_WRITTEN:
+			{
+				std::list <Image *>::iterator iter = std::find (writingImages.begin (), writingImages.end (), (Image *) event->getArg ());
+				if (iter != writingImages.end ())
+				{
+					Image *image = *iter;
+					writingImages.erase (iter);
+					processWrittenImage (image);
+				}
+			}
+			break;
 	}
 	rts2core::DevClientCamera::postEvent (event);
 }
@@ -243,6 +257,7 @@ void DevClientCameraImage::newDataConn (int data_conn)
 
 			if (image == NULL)
 				return;
+			image->setFitsWriter (fitsWriter);
 			cameraMetadata (image);
 
 			const char *last_filename = image->getAbsoluteFileName ();
@@ -534,14 +549,25 @@ void DevClientCameraImage::processCameraImage (CameraImages::iterator cis)
 		{
 			// set filter..
 			// save us to the disk..
+			if (fitsWriter)
+				ci->image->writeInBackground ();
 			ci->image->saveImage ();
 		}
-		// do basic processing
-		imageProceRes res = processImage (ci->image);
-		if (res == IMAGE_KEEP_COPY)
+		if (ci->image->isWriteQueued ())
 		{
+			// image will be processed when its data are written
+			writingImages.push_back (ci->image);
 			setImage (ci->image, NULL);
 		}
+		else
+		{
+			// do basic processing
+			imageProceRes res = processImage (ci->image);
+			if (res == IMAGE_KEEP_COPY)
+			{
+				setImage (ci->image, NULL);
+			}
+		}
 	}
 	catch (rts2core::Error &ex)
 	{
@@ -551,7 +577,25 @@ void DevClientCameraImage::processCameraImage (CameraImages::iterator cis)
 	delete ci;
 	images.erase (cis);
 	// send event that there aren't any images waiting to be written
-	if (images.size () == 0 && actualImage == NULL)
+	if (images.size () == 0 && actualImage == NULL && writingImages.size () == 0)
+		getMaster ()->postEvent (new rts2core::Event (EVENT_ALL_IMAGES_WRITTEN));
+}
+
+void DevClientCameraImage::processWrittenImage (Image *image)
+{
+	imageProceRes res = IMAGE_DO_BASIC_PROCESSING;
+	try
+	{
+		res = processImage (image);
+	}
+	catch (rts2core::Error &ex)
+	{
+		logStream (MESSAGE_WARNING) << "Cannot process image " << image->getAbsoluteFileName () << " " << ex << sendLog;
+	}
+	if (res == IMAGE_DO_BASIC_PROCESSING)
+		delete image;
+
+	if (images.size () == 0 && actualImage == NULL && writingImages.size () == 0)
 		getMaster ()->postEvent (new rts2core::Event (EVENT_ALL_IMAGES_WRITTEN));
 }
 
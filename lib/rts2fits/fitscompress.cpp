@@ -0,0 +1,220 @@
+/*
+ * Tile compression of FITS images.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2fits/fitscompress.h"
+#include "tilecompress.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <vector>
+
+using namespace rts2image;
+
+FitsCompression::FitsCompression ()
+{
+	type = 0;
+	tile[0] = 0;
+	tile[1] = 1;
+}
+
+void FitsCompression::parse (std::string &fileName)
+{
+	type = 0;
+	tile[0] = 0;
+	tile[1] = 1;
+	suffix = std::string ();
+
+	size_t l = fileName.length ();
+	if (l == 0 || fileName[l - 1] != ']')
+		return;
+	size_t b = fileName.rfind ('[');
+	if (b == std::string::npos || strncasecmp (fileName.c_str () + b + 1, "compress", 8))
+		return;
+
+	suffix = fileName.substr (b);
+	fileName.erase (b);
+
+	const char *p = suffix.c_str () + 9;
+	while (isspace (*p))
+		p++;
+	type = RICE_1;
+	if (isalpha (*p))
+	{
+		switch (toupper (*p))
+		{
+			case 'G':
+				type = GZIP_1;
+				break;
+			case 'P':
+				type = PLIO_1;
+				break;
+			case 'H':
+				type = HCOMPRESS_1;
+				break;
+		}
+		// skip rest of the algorithm name
+		while (*p && !isspace (*p) && *p != ']')
+			p++;
+		while (isspace (*p))
+			p++;
+	}
+	if (isdigit (*p))
+	{
+		char *e;
+		tile[0] = strtol (p, &e, 10);
+		tile[1] = 1;
+		if (*e == ',')
+			tile[1] = strtol (e + 1, NULL, 10);
+		if (tile[1] <= 0)
+			tile[1] = 1;
+	}
+}
+
+int FitsCompression::copyFile (fitsfile *in, fitsfile *out, int *status)
+{
+	if (type == 0)
+		return fits_copy_file (in, out, 1, 1, 1, status);
+
+	int nhdus = 0;
+	fits_get_num_hdus (in, &nhdus, status);
+	for (int i = 1; i <= nhdus && *status == 0; i++)
+	{
+		int hdutype;
+		fits_movabs_hdu (in, i, &hdutype, status);
+		if (*status)
+			break;
+
+		int bitpix = 0;
+		int naxis = 0;
+		long naxes[2] = {0, 0};
+		if (hdutype == IMAGE_HDU)
+			fits_get_img_param (in, 2, &bitpix, &naxis, naxes, status);
+
+		if (hdutype != IMAGE_HDU || naxis != 2 || bitpix == LONGLONG_IMG)
+		{
+			fits_copy_hdu (in, out, 0, status);
+			continue;
+		}
+
+		if (i == 1)
+		{
+			// keep headers in primary HDU
+			fits_create_img (out, BYTE_IMG, 0, NULL, status);
+			copyKeys (in, out, false, status);
+		}
+		compressImage (in, out, bitpix, naxes, i == 1, status);
+	}
+	return *status;
+}
+
+int FitsCompression::compressImage (fitsfile *in, fitsfile *out, int bitpix, long *naxes, bool primary, int *status)
+{
+	if (type == RICE_1 && bitpix > 0)
+		return compressRice (in, out, bitpix, naxes, primary, status);
+
+	// floating point data cannot be Rice compressed without quantization
+	fits_set_compression_type (out, (type == RICE_1 || type == PLIO_1) && bitpix < 0 ? GZIP_1 : type, status);
+	long tdim[2];
+	tdim[0] = tile[0] > 0 ? tile[0] : naxes[0];
+	tdim[1] = tile[1];
+	fits_set_tile_dim (out, 2, tdim, status);
+	if (bitpix < 0)
+		fits_set_quantize_level (out, 0, status);
+	fits_img_compress (in, out, status);
+	fits_set_compression_type (out, 0, status);
+	return *status;
+}
+
+int FitsCompression::compressRice (fitsfile *in, fitsfile *out, int bitpix, long *naxes, bool primary, int *status)
+{
+	int bytepix = bitpix / 8;
+	int datatype = bitpix == BYTE_IMG ? TBYTE : (bitpix == SHORT_IMG ? TSHORT : TINT);
+	long pixels = naxes[0] * naxes[1];
+
+	// compress stored values, scaling keys are copied to compressed HDU
+	double bscale = 1;
+	double bzero = 0;
+	int s = 0;
+	fits_read_key (in, TDOUBLE, (char *) "BSCALE", &bscale, NULL, &s);
+	s = 0;
+	fits_read_key (in, TDOUBLE, (char *) "BZERO", &bzero, NULL, &s);
+
+	std::vector <char> data (pixels * bytepix);
+	int anynul = 0;
+	fits_set_bscale (in, 1, 0, status);
+	fits_read_img (in, datatype, 1, pixels, NULL, &(data[0]), &anynul, status);
+	fits_set_bscale (in, bscale, bzero, status);
+	if (*status)
+		return *status;
+
+	rts2core::TileCompressor compressor;
+	if (compressor.compress (&(data[0]), bytepix, naxes[0], naxes[1], tile[0], tile[1]))
+		return *status = BAD_DATATYPE;
+
+	char *ttype[] = { (char *) "COMPRESSED_DATA" };
+	char *tform[] = { (char *) "1PB" };
+	fits_create_tbl (out, BINARY_TBL, compressor.getTiles (), 1, ttype, tform, NULL, NULL, status);
+
+	int logtrue = 1;
+	int naxis = 2;
+	long ztile[2];
+	ztile[0] = tile[0] > 0 && tile[0] < naxes[0] ? tile[0] : naxes[0];
+	ztile[1] = tile[1] < naxes[1] ? tile[1] : naxes[1];
+	int blocksize = RICE_BLOCKSIZE;
+
+	fits_write_key (out, TLOGICAL, (char *) "ZIMAGE", &logtrue, (char *) "extension contains compressed image", status);
+	if (primary)
+		fits_write_key (out, TLOGICAL, (char *) "ZSIMPLE", &logtrue, (char *) "file does conform to FITS standard", status);
+	else
+		fits_write_key (out, TSTRING, (char *) "ZTENSION", (void *) "IMAGE", (char *) "image extension", status);
+	fits_write_key (out, TINT, (char *) "ZBITPIX", &bitpix, (char *) "data type of original image", status);
+	fits_write_key (out, TINT, (char *) "ZNAXIS", &naxis, (char *) "dimension of original image", status);
+	fits_write_key (out, TLONG, (char *) "ZNAXIS1", naxes, (char *) "length of original image axis", status);
+	fits_write_key (out, TLONG, (char *) "ZNAXIS2", naxes + 1, (char *) "length of original image axis", status);
+	fits_write_key (out, TLONG, (char *) "ZTILE1", ztile, (char *) "size of tiles to be compressed", status);
+	fits_write_key (out, TLONG, (char *) "ZTILE2", ztile + 1, (char *) "size of tiles to be compressed", status);
+	fits_write_key (out, TSTRING, (char *) "ZCMPTYPE", (void *) "RICE_1", (char *) "compression algorithm", status);
+	fits_write_key (out, TSTRING, (char *) "ZNAME1", (void *) "BLOCKSIZE", (char *) "compression block size", status);
+	fits_write_key (out, TINT, (char *) "ZVAL1", &blocksize, (char *) "pixels per block", status);
+	fits_write_key (out, TSTRING, (char *) "ZNAME2", (void *) "BYTEPIX", (char *) "bytes per pixel (1, 2, 4, or 8)", status);
+	fits_write_key (out, TINT, (char *) "ZVAL2", &bytepix, (char *) "bytes per pixel (1, 2, 4, or 8)", status);
+
+	copyKeys (in, out, true, status);
+
+	for (size_t i = 0; i < compressor.getTiles () && *status == 0; i++)
+		fits_write_col (out, TBYTE, 1, i + 1, 1, compressor.getTileSize (i), (void *) compressor.getTileData (i), status);
+
+	return *status;
+}
+
+int FitsCompression::copyKeys (fitsfile *in, fitsfile *out, bool scaling, int *status)
+{
+	int nkeys = 0;
+	fits_get_hdrspace (in, &nkeys, NULL, status);
+	for (int k = 1; k <= nkeys && *status == 0; k++)
+	{
+		char card[FLEN_CARD];
+		fits_read_record (in, k, card, status);
+		int keyclass = fits_get_keyclass (card);
+		if (keyclass == TYP_STRUC_KEY || keyclass == TYP_CMPRS_KEY || keyclass == TYP_CKSUM_KEY || (keyclass == TYP_SCAL_KEY && !scaling))
+			continue;
+		fits_write_record (out, card, status);
+	}
+	return *status;
+}
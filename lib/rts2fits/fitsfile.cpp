@@ -19,6 +19,7 @@
  */
 
 #include "rts2fits/fitsfile.h"
+#include "rts2fits/fitswriter.h"
 
 #include "configuration.h"
 
@@ -112,6 +113,7 @@ FitsFile::FitsFile (FitsFile * _fitsfile):rts2core::Expander (_fitsfile)
 	_fitsfile->imgbuf = NULL;
 
 	setFileName (_fitsfile->getFileName ());
+	compression = _fitsfile->compression;
 
 	fits_status = _fitsfile->fits_status;
 	templateFile = NULL;
@@ -216,10 +218,10 @@ int FitsFile::closeFile ()
 				fitsfile *ofptr = getFitsFile ();
 				if (createFile (memOverwrite))
 					return -1;
-				fits_copy_file (ofptr, getFitsFile (), 1, 1, 1, &fits_status);
+				compression.copyFile (ofptr, getFitsFile (), &fits_status);
 				if (fits_status)
 				{
-					logStream (MESSAGE_ERROR) << "fits_copy_file: " << getFitsErrors () << sendLog;
+					logStream (MESSAGE_ERROR) << "cannot copy memory file: " << getFitsErrors () << sendLog;
 					fits_close_file (ofptr, &fits_status);
 					return -1;
 				}
@@ -253,6 +255,26 @@ int FitsFile::closeFile ()
 	return 0;
 }
 
+void FitsFile::detachFile (FitsWriterJob *job)
+{
+	job->ffile = getFitsFile ();
+	job->fileName = std::string (getFileName ());
+	if (memFile)
+	{
+		job->imgbuf = imgbuf;
+		job->memsize = memsize;
+		job->overwrite = memOverwrite;
+		job->compression = compression;
+
+		imgbuf = NULL;
+		memsize = NULL;
+		memFile = false;
+	}
+	flags &= ~IMAGE_SAVE;
+
+	setFitsFile (NULL);
+}
+
 std::string FitsFile::getFitsErrors ()
 {
 	std::ostringstream os;
@@ -278,8 +300,12 @@ void FitsFile::setFileName (const char *_fileName)
 		return;
 	}
 
-	fileName = new char[strlen (_fileName) + 1];
-	strcpy (fileName, _fileName);
+	// compression suffix is not part of the file name
+	std::string fn (_fileName);
+	compression.parse (fn);
+
+	fileName = new char[fn.length () + 1];
+	strcpy (fileName, fn.c_str ());
 
 	// not an absolute filename..
 	if (fileName[0] != '/')
@@ -291,7 +317,7 @@ void FitsFile::setFileName (const char *_fileName)
 			logStream (MESSAGE_ERROR) << "too long cwd" << sendLog;
 			return;
 		}
-		absoluteFileName = new char[strlen (path) + strlen(_fileName) + 2];
+		absoluteFileName = new char[strlen (path) + strlen (fileName) + 2];
 		strcpy (absoluteFileName, path);
 		int l = strlen (path);
 		if (l == 0)
@@ -351,7 +377,8 @@ int FitsFile::createFile (bool _overwrite)
 		}
 	}
 
-	fits_create_file (&ffile, getFileName (), &fits_status);
+	// cfitsio handles compression suffix when writing directly to disk
+	fits_create_file (&ffile, (std::string (getFileName ()) + compression.getSuffix ()).c_str (), &fits_status);
 
 	if (fits_status)
 	{
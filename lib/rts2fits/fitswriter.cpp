@@ -0,0 +1,342 @@
+/*
+ * Background writer of FITS image data.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2fits/fitswriter.h"
+#include "rts2fits/channel.h"
+#include "imghdr.h"
+#include "utilsfunc.h"
+
+#include <cmath>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace rts2image;
+
+FitsWriterJob::FitsWriterJob ()
+{
+	image = NULL;
+	ffile = NULL;
+	imgbuf = NULL;
+	memsize = NULL;
+	overwrite = false;
+	bytes = 0;
+	duration = 0;
+	status = 0;
+}
+
+FitsWriterJob::~FitsWriterJob ()
+{
+	for (std::vector <PendingData>::iterator iter = data.begin (); iter != data.end (); iter++)
+		delete[] iter->data;
+	if (ffile)
+	{
+		int s = 0;
+		fits_close_file (ffile, &s);
+	}
+	if (imgbuf)
+		free (*imgbuf);
+	delete imgbuf;
+	delete memsize;
+}
+
+int FitsWriterJob::write ()
+{
+	struct timeval t1, t2;
+	gettimeofday (&t1, NULL);
+
+	status = 0;
+	bytes = 0;
+
+	for (std::vector <PendingData>::iterator iter = data.begin (); iter != data.end () && status == 0; iter++)
+	{
+		fits_movabs_hdu (ffile, iter->hdu, NULL, &status);
+		if (FitsWriter::writePixels (ffile, iter->dataType, iter->pixels, iter->data, &status))
+		{
+			error = "unknow data type";
+			status = BAD_DATATYPE;
+			break;
+		}
+		if (status)
+			break;
+		bytes += iter->size;
+
+		if (iter->averageKey.length () > 0)
+		{
+			Channel ch (0, iter->data, 1, &(iter->pixels), iter->dataType, false);
+			ch.computeStatistics ();
+			double avg = ch.getAverage ();
+			double stdev = ch.getStDev ();
+			if (std::isnan (avg))
+				avg = DOUBLENULLVALUE;
+			if (std::isnan (stdev))
+				stdev = DOUBLENULLVALUE;
+			fits_update_key (ffile, TDOUBLE, (char *) iter->averageKey.c_str (), &avg, (char *) "average value of image", &status);
+			fits_update_key (ffile, TDOUBLE, (char *) iter->stdevKey.c_str (), &stdev, (char *) "standard deviation value of image", &status);
+		}
+
+		// pixels are in the FITS file, free memory as soon as possible
+		delete[] iter->data;
+		iter->data = NULL;
+	}
+
+	int cs = 0;
+	if (imgbuf)
+	{
+		// memory file is copied to disk
+		if (status == 0)
+		{
+			if (mkpath (fileName.c_str (), 0777))
+			{
+				error = std::string ("cannot create path: ") + strerror (errno);
+				status = FILE_NOT_CREATED;
+			}
+			else if (overwrite && unlink (fileName.c_str ()) && errno != ENOENT)
+			{
+				error = std::string ("cannot unlink existing file: ") + strerror (errno);
+				status = FILE_NOT_CREATED;
+			}
+			else
+			{
+				fitsfile *ofptr = NULL;
+				fits_create_file (&ofptr, fileName.c_str (), &status);
+				compression.copyFile (ffile, ofptr, &status);
+				if (ofptr)
+					fits_close_file (ofptr, &cs);
+			}
+		}
+		// memfile MUST be closed before its memory is freed
+		fits_close_file (ffile, &cs);
+		free (*imgbuf);
+		delete imgbuf;
+		delete memsize;
+		imgbuf = NULL;
+		memsize = NULL;
+	}
+	else
+	{
+		fits_close_file (ffile, &cs);
+	}
+	ffile = NULL;
+
+	if (status == 0)
+		status = cs;
+
+	if (status && error.length () == 0)
+	{
+		char buf[FLEN_STATUS];
+		fits_get_errstatus (status, buf);
+		error = buf;
+	}
+
+	gettimeofday (&t2, NULL);
+	duration = (t2.tv_sec - t1.tv_sec) + (t2.tv_usec - t1.tv_usec) / 1e6;
+
+	return status ? -1 : 0;
+}
+
+FitsWriter::FitsWriter (rts2core::Block *_master, int _threads):rts2core::ConnNoSend (_master)
+{
+	numThreads = _threads > 0 ? _threads : 1;
+	exitThreads = false;
+	running = 0;
+	notifyFd = -1;
+
+	throughput = NAN;
+	bytesWritten = 0;
+
+	pthread_mutex_init (&mutex, NULL);
+	pthread_cond_init (&cond, NULL);
+}
+
+FitsWriter::~FitsWriter ()
+{
+	pthread_mutex_lock (&mutex);
+	exitThreads = true;
+	pthread_cond_broadcast (&cond);
+	pthread_mutex_unlock (&mutex);
+
+	// threads write all queued images before they exit
+	for (std::vector <pthread_t>::iterator iter = threads.begin (); iter != threads.end (); iter++)
+		pthread_join (*iter, NULL);
+
+	for (std::deque <FitsWriterJob *>::iterator iter = finished.begin (); iter != finished.end (); iter++)
+		delete *iter;
+
+	if (notifyFd >= 0)
+		close (notifyFd);
+
+	pthread_cond_destroy (&cond);
+	pthread_mutex_destroy (&mutex);
+}
+
+int FitsWriter::init ()
+{
+	// cfitsio built without --enable-reentrant shares buffers among all files
+	if (!fits_is_reentrant ())
+	{
+		logStream (MESSAGE_ERROR) << "cfitsio library is not reentrant, cannot write FITS files in background" << sendLog;
+		return -1;
+	}
+
+	int fds[2];
+	if (pipe (fds))
+	{
+		logStream (MESSAGE_ERROR) << "cannot create FITS writer pipe: " << strerror (errno) << sendLog;
+		return -1;
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		fcntl (fds[i], F_SETFL, O_NONBLOCK);
+		fcntl (fds[i], F_SETFD, FD_CLOEXEC);
+	}
+	sock = fds[0];
+	notifyFd = fds[1];
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		pthread_t t;
+		int ret = pthread_create (&t, NULL, writerThread, this);
+		if (ret)
+		{
+			logStream (MESSAGE_ERROR) << "cannot start FITS writer thread: " << strerror (ret) << sendLog;
+			return threads.size () > 0 ? 0 : -1;
+		}
+		threads.push_back (t);
+	}
+	return 0;
+}
+
+int FitsWriter::receive (rts2core::Block *block)
+{
+	if (sock < 0 || !block->isForRead (sock))
+		return 0;
+
+	char rbuf[100];
+	while (read (sock, rbuf, sizeof (rbuf)) > 0)
+		;
+
+	std::deque <FitsWriterJob *> done;
+	pthread_mutex_lock (&mutex);
+	done.swap (finished);
+	pthread_mutex_unlock (&mutex);
+
+	for (std::deque <FitsWriterJob *>::iterator iter = done.begin (); iter != done.end (); iter++)
+	{
+		FitsWriterJob *job = *iter;
+		if (job->status)
+		{
+			logStream (MESSAGE_ERROR) << "cannot write FITS file " << job->fileName << ": " << job->error << sendLog;
+		}
+		else
+		{
+			bytesWritten += job->bytes;
+			if (job->duration > 0)
+				throughput = job->bytes / job->duration / 1048576.0;
+		}
+		getMaster ()->postEvent (new rts2core::Event (EVENT_FITS_WRITTEN, job->image));
+		delete job;
+	}
+	return done.size ();
+}
+
+void FitsWriter::queue (FitsWriterJob *job)
+{
+	pthread_mutex_lock (&mutex);
+	waiting.push_back (job);
+	pthread_cond_signal (&cond);
+	pthread_mutex_unlock (&mutex);
+}
+
+int FitsWriter::getQueueSize ()
+{
+	pthread_mutex_lock (&mutex);
+	int ret = waiting.size () + running;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+int FitsWriter::writePixels (fitsfile *ffile, int dataType, long pixels, char *data, int *status)
+{
+	switch (dataType)
+	{
+		case RTS2_DATA_BYTE:
+			fits_write_img_byt (ffile, 0, 1, pixels, (unsigned char *) data, status);
+			break;
+		case RTS2_DATA_SHORT:
+			fits_write_img_sht (ffile, 0, 1, pixels, (int16_t *) data, status);
+			break;
+		case RTS2_DATA_LONG:
+			fits_write_img_int (ffile, 0, 1, pixels, (int *) data, status);
+			break;
+		case RTS2_DATA_LONGLONG:
+			fits_write_img_lnglng (ffile, 0, 1, pixels, (LONGLONG *) data, status);
+			break;
+		case RTS2_DATA_FLOAT:
+			fits_write_img_flt (ffile, 0, 1, pixels, (float *) data, status);
+			break;
+		case RTS2_DATA_DOUBLE:
+			fits_write_img_dbl (ffile, 0, 1, pixels, (double *) data, status);
+			break;
+		case RTS2_DATA_SBYTE:
+			fits_write_img_sbyt (ffile, 0, 1, pixels, (signed char *) data, status);
+			break;
+		case RTS2_DATA_USHORT:
+			fits_write_img_usht (ffile, 0, 1, pixels, (short unsigned int *) data, status);
+			break;
+		case RTS2_DATA_ULONG:
+			fits_write_img_uint (ffile, 0, 1, pixels, (unsigned int *) data, status);
+			break;
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+void *FitsWriter::writerThread (void *arg)
+{
+	FitsWriter *writer = (FitsWriter *) arg;
+
+	pthread_mutex_lock (&writer->mutex);
+	while (true)
+	{
+		while (writer->waiting.empty () && !writer->exitThreads)
+			pthread_cond_wait (&writer->cond, &writer->mutex);
+		if (writer->waiting.empty ())
+			break;
+
+		FitsWriterJob *job = writer->waiting.front ();
+		writer->waiting.pop_front ();
+		writer->running++;
+		pthread_mutex_unlock (&writer->mutex);
+
+		job->write ();
+
+		pthread_mutex_lock (&writer->mutex);
+		writer->running--;
+		writer->finished.push_back (job);
+		// wake up main loop, full pipe means it will be woken up anyway
+		char c = 0;
+		while (::write (writer->notifyFd, &c, 1) < 0 && errno == EINTR)
+			;
+	}
+	pthread_mutex_unlock (&writer->mutex);
+	return NULL;
+}
@@ -20,6 +20,7 @@
 #include <libnova/libnova.h>
 
 #include "rts2fits/image.h"
+#include "rts2fits/fitswriter.h"
 #include "imghdr.h"
 
 #include "expander.h"
@@ -115,6 +116,11 @@ void Image::initData ()
 
 	writeConnection = true;
 	writeRTS2Values = true;
+
+	writer = NULL;
+	writerJob = NULL;
+	backgroundClose = false;
+	writeQueued = false;
 }
 
 
@@ -179,6 +185,12 @@ Image::Image (Image * in_image):FitsFile (in_image)
 
 	shutter = in_image->getShutter ();
 
+	writer = in_image->writer;
+	writerJob = in_image->writerJob;
+	in_image->writerJob = NULL;
+	backgroundClose = in_image->backgroundClose;
+	writeQueued = in_image->writeQueued;
+
 	// other image will be saved!
 	flags = in_image->flags;
 	//in_image->flags &= ~IMAGE_SAVE;
@@ -262,7 +274,10 @@ Image::Image (Rts2Target * currTarget, rts2core::DevClientCamera * camera, const
 	}
 	else
 	{
-		in_filename = expandPath (rts2core::Configuration::instance ()->observatoryQuePath ());
+		// camera section can override que path, e.g. to select compression
+		std::string quePath;
+		rts2core::Configuration::instance ()->getString (getCameraName (), "que_path", quePath, rts2core::Configuration::instance ()->observatoryQuePath ().c_str ());
+		in_filename = expandPath (quePath);
 	}
 
 	createImage (in_filename, overwrite);
@@ -281,6 +296,7 @@ Image::Image (Rts2Target * currTarget, rts2core::DevClientCamera * camera, const
 Image::~Image (void)
 {
 	saveImage ();
+	delete writerJob;
 
 	for (std::map <int, TableData *>::iterator iter = arrayGroups.begin (); iter != arrayGroups.end ();)
 	{
@@ -558,6 +574,26 @@ int Image::closeFile ()
 			logStream (MESSAGE_WARNING) << "error saving " << getAbsoluteFileName () << ":" << er << sendLog;
 		}
 	}
+	if (writerJob && getFitsFile ())
+	{
+		FitsWriterJob *job = writerJob;
+		writerJob = NULL;
+		job->image = this;
+		detachFile (job);
+		if (backgroundClose && writer)
+		{
+			backgroundClose = false;
+			writeQueued = true;
+			writer->queue (job);
+			return 0;
+		}
+		int ret = job->write ();
+		if (ret)
+			logStream (MESSAGE_ERROR) << "cannot write " << job->fileName << ": " << job->error << sendLog;
+		delete job;
+		return ret;
+	}
+	backgroundClose = false;
 	return FitsFile::closeFile ();
 }
 
@@ -1005,40 +1041,36 @@ int Image::writeData (char *in_data, char *fullTop, int nchan)
 
 	long pixelSize = dataSize / getPixelByteSize ();
 
+	// pixels will be written when the file is closed
+	if (nchan > 0 && writer && getFileName ())
+	{
+		PendingData pd;
+		fits_get_hdu_num (getFitsFile (), &(pd.hdu));
+		pd.dataType = dataType;
+		pd.pixels = pixelSize;
+		pd.size = dataSize;
+		pd.data = new char[dataSize];
+		memcpy (pd.data, pixelData, dataSize);
+		if (writeRTS2Values)
+		{
+			pd.averageKey = replaceHeader ("AVERAGE");
+			pd.stdevKey = replaceHeader ("STDEV");
+			// reserve keywords, so header will not grow when they are updated
+			setValue ("AVERAGE", 0.0, "average value of image");
+			setValue ("STDEV", 0.0, "standard deviation value of image");
+		}
+		if (writerJob == NULL)
+			writerJob = new FitsWriterJob ();
+		writerJob->data.push_back (pd);
+		return ret;
+	}
+
 	if (nchan > 0)
 	{
-		switch (dataType)
+		if (FitsWriter::writePixels (getFitsFile (), dataType, pixelSize, pixelData, &fits_status))
 		{
-			case RTS2_DATA_BYTE:
-				fits_write_img_byt (getFitsFile (), 0, 1, pixelSize, (unsigned char *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_SHORT:
-				fits_write_img_sht (getFitsFile (), 0, 1, pixelSize, (int16_t *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_LONG:
-				fits_write_img_int (getFitsFile (), 0, 1, pixelSize, (int *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_LONGLONG:
-				fits_write_img_lnglng (getFitsFile (), 0, 1, pixelSize, (LONGLONG *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_FLOAT:
-				fits_write_img_flt (getFitsFile (), 0, 1, pixelSize, (float *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_DOUBLE:
-				fits_write_img_dbl (getFitsFile (), 0, 1, pixelSize, (double *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_SBYTE:
-				fits_write_img_sbyt (getFitsFile (), 0, 1, pixelSize, (signed char *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_USHORT:
-				fits_write_img_usht (getFitsFile (), 0, 1, pixelSize, (short unsigned int *) pixelData, &fits_status);
-				break;
-			case RTS2_DATA_ULONG:
-				fits_write_img_uint (getFitsFile (), 0, 1, pixelSize, (unsigned int *) pixelData, &fits_status);
-				break;
-			default:
-				logStream (MESSAGE_ERROR) << "Unknow dataType " << dataType << sendLog;
-				return -1;
+			logStream (MESSAGE_ERROR) << "Unknow dataType " << dataType << sendLog;
+			return -1;
 		}
 		if (fits_status)
 		{
@@ -1105,60 +1137,64 @@ void Image::getImgHeader (struct imghdr *im_h, int chan)
 
 void Image::getHistogram (long *histogram, long nbins)
 {
-	memset (histogram, 0, nbins * sizeof(int));
-	int bins;
 	if (channels.size () == 0)
 		loadChannels ();
 
-	switch (dataType)
-	{
-		case RTS2_DATA_USHORT:
-			bins = 65536 / nbins;
-			for (Channels::iterator iter = channels.begin (); iter != channels.end (); iter++)
-			{
-				for (uint16_t *d = (uint16_t *)((*iter)->getData ()); d < ((uint16_t *)((*iter)->getData ())) + ((*iter)->getNPixels ()); d++)
-				{
-					histogram[*d / bins]++;
-				}
-			}
-			break;
-		case RTS2_DATA_FLOAT:
-			bins = 65536 / nbins;
-			for (Channels::iterator iter = channels.begin (); iter != channels.end (); iter++)
-			{
-				for (float *d = (float *)((*iter)->getData ()); d < ((float *)((*iter)->getData ())) + ((*iter)->getNPixels ()); d++)
-				{
-					histogram[((uint16_t)*d) / bins]++;
-				}
-			}
-			break;
-		default:
-			break;
-	}
+	rts2core::BinnedHistogram hist (nbins);
+	hist.setRange (0, 65536);
+	for (size_t chan = 0; chan < channels.size (); chan++)
+		getChannelHistogram (chan, hist);
+
+	for (long i = 0; i < nbins; i++)
+		histogram[i] = hist.getCount (i);
 }
 
 void Image::getChannelHistogram (int chan, long *histogram, long nbins)
 {
-	memset (histogram, 0, nbins * sizeof(int));
-	int bins;
+	rts2core::BinnedHistogram hist (nbins);
+	hist.setRange (0, 65536);
+	getChannelHistogram (chan, hist);
+
+	for (long i = 0; i < nbins; i++)
+		histogram[i] = hist.getCount (i);
+}
+
+void Image::getChannelHistogram (int chan, rts2core::BinnedHistogram &hist)
+{
 	if (channels.size () == 0)
 		loadChannels ();
 
+	const void *data = channels[chan]->getData ();
+	long npix = channels[chan]->getNPixels ();
+
 	switch (dataType)
 	{
+		case RTS2_DATA_BYTE:
+			hist.add ((const uint8_t *) data, npix);
+			break;
+		case RTS2_DATA_SBYTE:
+			hist.add ((const int8_t *) data, npix);
+			break;
+		case RTS2_DATA_SHORT:
+			hist.add ((const int16_t *) data, npix);
+			break;
 		case RTS2_DATA_USHORT:
-			bins = 65536 / nbins;
-			for (uint16_t *d = (uint16_t *)(channels[chan]->getData ()); d < ((uint16_t *)(channels[chan]->getData ()) + channels[chan]->getNPixels ()); d++)
-			{
-				histogram[*d / bins]++;
-			}
+			hist.add ((const uint16_t *) data, npix);
+			break;
+		case RTS2_DATA_LONG:
+			hist.add ((const int32_t *) data, npix);
+			break;
+		case RTS2_DATA_ULONG:
+			hist.add ((const uint32_t *) data, npix);
+			break;
+		case RTS2_DATA_LONGLONG:
+			hist.add ((const int64_t *) data, npix);
 			break;
 		case RTS2_DATA_FLOAT:
-			bins = 65536 / nbins;
-			for (float *d = (float *)(channels[chan]->getData ()); d < ((float *)(channels[chan]->getData ()) + channels[chan]->getNPixels ()); d++)
-			{
-				histogram[((uint16_t)*d) / bins]++;
-			}
+			hist.add ((const float *) data, npix);
+			break;
+		case RTS2_DATA_DOUBLE:
+			hist.add ((const double *) data, npix);
 			break;
 		default:
 			break;
@@ -1408,48 +1444,22 @@ template <typename bt, typename dt> void Image::getChannelPseudocolourByteBuffer
 
 template <typename dt> void Image::getChannelQuantiles (int chan, dt minval, dt mval, float quantiles, dt * low_ptr, dt * high_ptr)
 {
-	long hist[65536];
-	getChannelHistogram (chan, hist, 65536);
+	// exact for 16 bit data, range is learned from the data
+	rts2core::BinnedHistogram hist (65536);
+	getChannelHistogram (chan, hist);
 
-	long psum = 0;
 	dt low = minval;
-	dt high = minval;
+	dt high = mval;
 
-	uint32_t i;
-
-	long s = getChannelNPixels (chan);
+	double l = hist.getQuantile (quantiles);
+	double h = hist.getQuantile (1 - quantiles);
 
 	// find quantiles
-	for (i = 0; (dt) i < mval; i++)
-	{
-		psum += hist[i];
-		if (psum > s * quantiles)
-		{
-			low = i;
-			break;
-		}
-	}
-
-	if (low == minval)
-	{
-		low = minval;
-		high = mval;
-	}
-	else
+	if (!std::isnan (l) && l > minval && l < mval)
 	{
-		for (; (dt) i < mval; i++)
-		{
-			psum += hist[i];
-			if (psum > s * (1 - quantiles))
-			{
-				high = i;
-				break;
-			}
-		}
-		if (high == minval)
-		{
-			high = mval;
-		}
+		low = l;
+		if (h < mval)
+			high = h;
 	}
 
 	if (low_ptr)
@@ -1729,6 +1739,8 @@ int Image::saveImage ()
 int Image::deleteImage ()
 {
 	int ret;
+	delete writerJob;
+	writerJob = NULL;
 	fits_close_file (getFitsFile (), &fits_status);
 	setFitsFile (NULL);
 	flags &= ~IMAGE_SAVE;
@@ -49,6 +49,11 @@
  * Generates zoomed JPEG images. This is primary usefull for quick access to
  * small images to be put onto preview webpages.
  *
+ * Previews are cached. The first request renders previews of all standard
+ * sizes (64, 128, 256, 512 and 1024 pixels) smaller than the image together
+ * with the requested size, so later requests are served without reading the
+ * FITS file. Previews of a changed file are discarded.
+ *
  * @subsection Example
  *
  * http://localhost:8889/preview/images/2011.1210/0001.fits?ps=200&lb=@FOC_POS
@@ -99,6 +104,7 @@
 #include "rts2fits/image.h"
 #include "rts2json/bsc.h"
 #include "rts2json/imgpreview.h"
+#include "rts2json/previewcache.h"
 #include "dirsupport.h"
 #ifdef RTS2_HAVE_LIBARCHIVE
 #include <archive.h>
@@ -106,6 +112,9 @@
 #endif
 #include <libgen.h>
 
+#include <algorithm>
+#include <functional>
+
 #include "xmlrpc++/urlencoding.h"
 
 using namespace rts2json;
@@ -229,12 +238,50 @@ void Previewer::pageLink (std::ostringstream& _os, int i, int pagesiz, int prevs
 #include <Magick++.h>
 using namespace Magick;
 
+// sizes of preview pyramid levels, terminated by 0
+static const int pyramidLevels[] = {1024, 512, 256, 128, 64, 0};
+
+/**
+ * Render previews of all pyramid levels smaller than the image, together
+ * with the requested size. Levels are zoomed from the previous level, so
+ * the FITS file is read and scaled only once.
+ */
+static void buildPyramid (rts2image::Image &image, Magick::Image *mimage, PreviewCache *cache, PreviewKey &key, int prevsize, const char *label, Blob &blob)
+{
+	size_t longest = mimage->columns () > mimage->rows () ? mimage->columns () : mimage->rows ();
+
+	std::vector <int> sizes;
+	sizes.push_back (prevsize);
+	// without cache, only requested size is rendered
+	for (const int *l = pyramidLevels; cache && *l > 0; l++)
+	{
+		if ((size_t) *l < longest && *l != prevsize)
+			sizes.push_back (*l);
+	}
+	std::sort (sizes.begin (), sizes.end (), std::greater <int> ());
+
+	for (std::vector <int>::iterator iter = sizes.begin (); iter != sizes.end (); iter++)
+	{
+		mimage->zoom (Magick::Geometry (*iter, *iter));
+		Magick::Image labelled (*mimage);
+		image.writeLabel (&labelled, 0, labelled.size ().height (), 10, label);
+
+		Blob b;
+		labelled.write (&b, "JPEG");
+		if (*iter == prevsize)
+			blob = b;
+		if (cache)
+		{
+			key.setSize (*iter);
+			cache->add (key, b.data (), b.length ());
+		}
+	}
+	key.setSize (prevsize);
+}
+
 void JpegImageRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::HttpParams *params, const char* &response_type, char* &response, size_t &response_length)
 {
 	response_type = "image/jpeg";
-	rts2image::Image image;
-	image.openFile (path.c_str (), true, false);
-	Blob blob;
 
 	const char * label = params->getString ("lb", getServer ()->getDefaultImageLabel ());
 
@@ -242,15 +289,27 @@ void JpegImageRequest::authorizedExecute (XmlRpc::XmlRpcSource *source, std::str
 	int chan = params->getInteger ("chan", getServer ()->getDefaultChannel ());
 	int colourVariant = params->getInteger ("cv", DEFAULT_COLOURVARIANT);
 
-	Magick::Image *mimage = image.getMagickImage (label, quantiles, chan, colourVariant);
-
 	cacheMaxAge (CACHE_MAX_STATIC);
 
+	PreviewCache *cache = getServer ()->getPreviewCache ();
+	PreviewKey key ("jpeg", path, quantiles, chan, colourVariant, label, 0);
+	if (cache && key.statFile () == 0 && cache->find (key, response, response_length))
+		return;
+
+	rts2image::Image image;
+	image.openFile (path.c_str (), true, false);
+	Blob blob;
+
+	Magick::Image *mimage = image.getMagickImage (label, quantiles, chan, colourVariant);
+
 	mimage->write (&blob, "JPEG");
 	response_length = blob.length();
 	response = new char[response_length];
 	memcpy (response, blob.data(), response_length);
 
+	if (cache)
+		cache->add (key, blob.data (), blob.length ());
+
 	delete mimage;
 }
 
@@ -279,6 +338,13 @@ void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string p
 	{
 		response_type = "image/jpeg";
 
+		cacheMaxAge (CACHE_MAX_STATIC);
+
+		PreviewCache *cache = getServer ()->getPreviewCache ();
+		PreviewKey key ("preview", absPathStr, quantiles, chan, colourVariant, label, prevsize > 0 ? prevsize : 0);
+		if (cache && key.statFile () == 0 && cache->find (key, response, response_length))
+			return;
+
 		rts2image::Image image;
 		image.openFile (absPath, true, false);
 		Blob blob;
@@ -286,17 +352,16 @@ void JpegPreview::authorizedExecute (XmlRpc::XmlRpcSource *source, std::string p
 		Magick::Image *mimage = image.getMagickImage (NULL, quantiles, chan, colourVariant);
 		if (prevsize > 0)
 		{
-			mimage->zoom (Magick::Geometry (prevsize, prevsize));
-			image.writeLabel (mimage, 0, mimage->size ().height (), 10, label);
+			buildPyramid (image, mimage, cache, key, prevsize, label, blob);
 		}
 		else
 		{
 			image.writeLabel (mimage, 1, mimage->rows () - 2, 10, label);
+			mimage->write (&blob, "JPEG");
+			if (cache)
+				cache->add (key, blob.data (), blob.length ());
 		}
 
-		cacheMaxAge (CACHE_MAX_STATIC);
-
-		mimage->write (&blob, "JPEG");
 		response_length = blob.length();
 		response = new char[response_length];
 		memcpy (response, blob.data(), response_length);
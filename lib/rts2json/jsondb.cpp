@@ -822,6 +822,9 @@ void JSONDBRequest::jsonTargets (rts2db::TargetSet &tar_set, std::ostringstream
 	}
 
 	double JD = ln_get_julian_from_timet (&from);
+	// scripts of all targets are needed for extended listing
+	if (extended)
+		tar_set.loadScripts ();
 	for (rts2db::TargetSet::iterator iter = tar_set.begin (); iter != tar_set.end (); iter++)
 	{
 		if (iter != tar_set.begin () && chunked == NULL)
@@ -912,6 +915,8 @@ void JSONDBRequest::jsonTargets (rts2db::TargetSet &tar_set, std::ostringstream
 			os.str ("");
 		}
 	}
+	if (extended)
+		tar_set.clearScripts ();
 	if (chunked == NULL)
 	{
 		os << "]";
@@ -0,0 +1,281 @@
+/*
+ * Cache of JPEG image previews.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "rts2json/previewcache.h"
+#include "utilsfunc.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace rts2json;
+
+// FNV-1a hash, used for cache file names
+static std::string hashString (const std::string &s)
+{
+	uint64_t h = 14695981039346656037ULL;
+	for (std::string::const_iterator iter = s.begin (); iter != s.end (); iter++)
+	{
+		h ^= (unsigned char) *iter;
+		h *= 1099511628211ULL;
+	}
+	std::ostringstream os;
+	os << std::hex << std::setfill ('0') << std::setw (16) << h;
+	return os.str ();
+}
+
+PreviewKey::PreviewKey (const char *_kind, const std::string &_path, float _quantiles, int _chan, int _colourVariant, const char *_label, int _size)
+{
+	kind = _kind;
+	path = _path;
+	quantiles = _quantiles;
+	chan = _chan;
+	colourVariant = _colourVariant;
+	label = _label ? _label : "";
+	size = _size;
+}
+
+int PreviewKey::statFile ()
+{
+	struct stat sb;
+	if (stat (path.c_str (), &sb))
+		return -1;
+	std::ostringstream os;
+	os << sb.st_mtime << ":" << sb.st_size << ":" << sb.st_ino;
+	stamp = os.str ();
+	return 0;
+}
+
+std::string PreviewKey::str ()
+{
+	std::ostringstream os;
+	os << kind << "\n" << path << "\n" << stamp << "\n" << std::setprecision (9) << quantiles << " " << chan << " " << colourVariant << " " << size << "\n" << label;
+	return os.str ();
+}
+
+PreviewCache::PreviewCache (size_t _maxSize)
+{
+	maxSize = _maxSize;
+	size = 0;
+	hits = 0;
+	misses = 0;
+	pthread_mutex_init (&mutex, NULL);
+}
+
+PreviewCache::~PreviewCache ()
+{
+	pthread_mutex_destroy (&mutex);
+}
+
+void PreviewCache::setMaxSize (size_t _maxSize)
+{
+	pthread_mutex_lock (&mutex);
+	maxSize = _maxSize;
+	while (size > maxSize)
+		dropLast ();
+	pthread_mutex_unlock (&mutex);
+}
+
+bool PreviewCache::find (PreviewKey &key, char* &response, size_t &response_length)
+{
+	std::string k = key.str ();
+
+	pthread_mutex_lock (&mutex);
+	checkStamp (key);
+
+	std::map <std::string, lru_t::iterator>::iterator iter = entries.find (k);
+	if (iter != entries.end ())
+	{
+		// move to front of LRU list
+		lru.splice (lru.begin (), lru, iter->second);
+		const std::string &data = iter->second->second.data;
+		response_length = data.length ();
+		response = new char[response_length];
+		memcpy (response, data.data (), response_length);
+		hits++;
+		pthread_mutex_unlock (&mutex);
+		return true;
+	}
+	pthread_mutex_unlock (&mutex);
+
+	std::string data;
+	if (readDisk (key, k, data))
+	{
+		response_length = data.length ();
+		response = new char[response_length];
+		memcpy (response, data.data (), response_length);
+
+		pthread_mutex_lock (&mutex);
+		hits++;
+		pthread_mutex_unlock (&mutex);
+
+		// keep it in memory as well
+		add (key, data.data (), data.length ());
+		return true;
+	}
+
+	pthread_mutex_lock (&mutex);
+	misses++;
+	pthread_mutex_unlock (&mutex);
+	return false;
+}
+
+void PreviewCache::add (PreviewKey &key, const void *data, size_t len)
+{
+	std::string k = key.str ();
+
+	pthread_mutex_lock (&mutex);
+	checkStamp (key);
+
+	std::map <std::string, lru_t::iterator>::iterator iter = entries.find (k);
+	if (iter != entries.end ())
+		removeEntry (iter->second);
+
+	lru.push_front (std::pair <std::string, entry> (k, entry ()));
+	lru.front ().second.path = key.getPath ();
+	lru.front ().second.data.assign ((const char *) data, len);
+	entries[k] = lru.begin ();
+	size += len;
+
+	fileStamp &st = stamps[key.getPath ()];
+	st.stamp = key.getStamp ();
+	st.previews++;
+
+	while (size > maxSize)
+		dropLast ();
+	pthread_mutex_unlock (&mutex);
+
+	writeDisk (key, k, data, len);
+}
+
+void PreviewCache::checkStamp (PreviewKey &key)
+{
+	std::map <std::string, fileStamp>::iterator st = stamps.find (key.getPath ());
+	if (st != stamps.end ())
+	{
+		if (st->second.stamp == key.getStamp ())
+			return;
+
+		// file was changed, remove its previews; stamp is removed with the last one
+		for (lru_t::iterator iter = lru.begin (); iter != lru.end ();)
+		{
+			if (iter->second.path == key.getPath ())
+				iter = removeEntry (iter);
+			else
+				iter++;
+		}
+	}
+
+	if (cacheDir.length () == 0)
+		return;
+
+	// disk files are outdated if the stamp file does not match
+	std::string dir = diskDir (key.getPath ());
+	std::string stampFile = dir + "/stamp";
+	std::string diskStamp;
+	std::ifstream is (stampFile.c_str ());
+	std::getline (is, diskStamp);
+	is.close ();
+	if (diskStamp == key.getStamp ())
+		return;
+
+	DIR *d = opendir (dir.c_str ());
+	if (d)
+	{
+		struct dirent *de;
+		while ((de = readdir (d)) != NULL)
+		{
+			if (de->d_name[0] != '.')
+				unlink ((dir + "/" + de->d_name).c_str ());
+		}
+		closedir (d);
+	}
+
+	if (mkpath (stampFile.c_str (), 0777))
+		return;
+	std::ofstream os (stampFile.c_str ());
+	os << key.getStamp () << std::endl;
+}
+
+PreviewCache::lru_t::iterator PreviewCache::removeEntry (lru_t::iterator iter)
+{
+	size -= iter->second.data.length ();
+	entries.erase (iter->first);
+	std::map <std::string, fileStamp>::iterator st = stamps.find (iter->second.path);
+	if (st != stamps.end () && --(st->second.previews) <= 0)
+		stamps.erase (st);
+	return lru.erase (iter);
+}
+
+void PreviewCache::dropLast ()
+{
+	removeEntry (--lru.end ());
+}
+
+std::string PreviewCache::diskDir (const std::string &path)
+{
+	return cacheDir + "/" + hashString (path);
+}
+
+std::string PreviewCache::diskFile (PreviewKey &key)
+{
+	return diskDir (key.getPath ()) + "/" + hashString (key.str ()) + ".jpg";
+}
+
+bool PreviewCache::readDisk (PreviewKey &key, const std::string &k, std::string &data)
+{
+	if (cacheDir.length () == 0)
+		return false;
+
+	std::ifstream is (diskFile (key).c_str (), std::ios::binary);
+	if (!is.good ())
+		return false;
+	std::ostringstream os;
+	os << is.rdbuf ();
+	data = os.str ();
+
+	// file starts with the key, to detect hash collisions
+	if (data.length () <= k.length () || data.compare (0, k.length (), k) != 0 || data[k.length ()] != '\0')
+		return false;
+	data.erase (0, k.length () + 1);
+	return true;
+}
+
+void PreviewCache::writeDisk (PreviewKey &key, const std::string &k, const void *data, size_t len)
+{
+	if (cacheDir.length () == 0)
+		return;
+
+	std::string fn = diskFile (key);
+	std::string tmp = fn + ".tmp";
+	if (mkpath (tmp.c_str (), 0777))
+		return;
+	FILE *f = fopen (tmp.c_str (), "w");
+	if (f == NULL)
+		return;
+	bool ok = fwrite (k.c_str (), k.length () + 1, 1, f) == 1 && fwrite (data, len, 1, f) == 1;
+	if (fclose (f) || !ok || rename (tmp.c_str (), fn.c_str ()))
+		unlink (tmp.c_str ());
+}
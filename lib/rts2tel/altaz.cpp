@@ -19,6 +19,7 @@
 
 #include "altaz.h"
 #include "configuration.h"
+#include "trajectory.h"
 
 #include "libnova_cpp.h"
 #include <libnova/libnova.h>
@@ -252,124 +253,110 @@ int AltAz::checkTrajectory (double JD, int32_t azc, int32_t altc, int32_t &azt,
 	int32_t t_az = azc;
 	int32_t t_alt = altc;
 
-	int32_t step_az = azs;
-	int32_t step_alt = alts;
-
 	int32_t soft_az = azc;
 	int32_t soft_alt = altc;
 
 	bool hard_beginning = false;
 
-	if (azc > azt)
-		step_az = -azs;
-
-	if (altc > altt)
-		step_alt = -alts;
-
 	// turned to true if we are in "soft" boundaries, e.g hit with margin applied
 	bool soft_hit = false;
 
-	for (unsigned int c = 0; c < steps; c++)
-	{
-		// check if still visible
-		struct ln_hrz_posn hrz, u_hrz;
+	TrajectoryBlock block (azc, altc, azt, altt, azs, alts);
 
-		int32_t n_az;
-		int32_t n_alt;
+	unsigned int c = 0;
+	while (c < steps)
+	{
+		size_t bs = block.fill (steps - c);
 
-		// if we already reached destionation, e.g. currently computed position is within step to target, don't go further..
-		if (labs (t_az - azt) < azs)
-		{
-			n_az = azt;
-			step_az = 0;
-		}
-		else
+		for (size_t i = 0; i < bs; i++)
 		{
-			n_az = t_az + step_az;
+			double u_az, u_zd;
+			counts2hrz (block.n_a[i], block.n_d[i], block.az[i], block.alt[i], u_az, u_zd);
 		}
 
-		if (labs (t_alt - altt) < alts)
-		{
-			n_alt = altt;
-			step_alt = 0;
-		}
-		else
+		block.checkHorizon (hardHorizon);
+
+		for (size_t i = 0; i < bs; i++, c++)
 		{
-			n_alt = t_alt + step_alt;
-		}
+			// check if still visible
+			struct ln_hrz_posn hrz;
 
-		counts2hrz (n_az, n_alt, hrz.az, hrz.alt, u_hrz.az, u_hrz.alt);
+			int32_t n_az = block.n_a[i];
+			int32_t n_alt = block.n_d[i];
 
-		// uncomment to see which checks are being performed
-		//std::cerr << "checkTrajectory hrz " << n_a << " " << n_d << " hrz alt az " << hrz.alt << " " << hrz.az << std::endl;
+			hrz.alt = block.alt[i];
+			hrz.az = block.az[i];
 
-		if (soft_hit == true || ignore_soft_beginning == true)
-		{
-			// if we really cannot go further
-			if (hardHorizon->is_good (&hrz) == 0)
+			// uncomment to see which checks are being performed
+			//std::cerr << "checkTrajectory hrz " << n_az << " " << n_alt << " hrz alt az " << hrz.alt << " " << hrz.az << std::endl;
+
+			if (soft_hit == true || ignore_soft_beginning == true)
 			{
-				// even at hard hit on first step, let's see if it can move out of limits
-				if (c == 0) 
-				{
-					logStream (MESSAGE_WARNING) << "below hard limit, see if we can move above in a few steps" << sendLog;
-					hard_beginning = true;
-				}
-				else if (hard_beginning == false || c > 20)
+				// if we really cannot go further
+				if (block.good[i] == 0)
 				{
-					logStream (MESSAGE_DEBUG) << "hit hard limit at alt az " << hrz.alt << " " << hrz.az << " " << soft_az << " " << soft_alt << " " << n_az << " " << n_alt << sendLog;
-					if (soft_hit == true)
+					// even at hard hit on first step, let's see if it can move out of limits
+					if (c == 0) 
 					{
-						// then use last good position, and return we reached horizon..
-						azt = soft_az;
-						altt = soft_alt;
-						return 2;
+						logStream (MESSAGE_WARNING) << "below hard limit, see if we can move above in a few steps" << sendLog;
+						hard_beginning = true;
 					}
-					else
+					else if (hard_beginning == false || c > 20)
 					{
-						// case when moving within soft will lead to hard hit..we don't want this path
-						azt = t_az;
-						altt = t_alt;
-						return 3;
+						logStream (MESSAGE_DEBUG) << "hit hard limit at alt az " << hrz.alt << " " << hrz.az << " " << soft_az << " " << soft_alt << " " << n_az << " " << n_alt << sendLog;
+						if (soft_hit == true)
+						{
+							// then use last good position, and return we reached horizon..
+							azt = soft_az;
+							altt = soft_alt;
+							return 2;
+						}
+						else
+						{
+							// case when moving within soft will lead to hard hit..we don't want this path
+							azt = t_az;
+							altt = t_alt;
+							return 3;
+						}
 					}
+				}
+				else
+				{
 					hard_beginning = false;
 				}
 			}
-			else
-			{
-				hard_beginning = false;
-			}
-		}
 
-		// we don't need to move anymore, full trajectory is valid
-		if (step_az == 0 && step_alt == 0)
-			return 0;
+			// we don't need to move anymore, full trajectory is valid
+			if (block.last[i])
+				return 0;
 
-		if (soft_hit == false && hard_beginning == false)
-		{
-			// check soft margins..
-			if (hardHorizon->is_good_with_margin (&hrz, alt_margin, az_margin) == 0)
+			if (soft_hit == false && hard_beginning == false)
 			{
-				if (ignore_soft_beginning == false)
+				// check soft margins..
+				if (hardHorizon->is_good_with_margin (&hrz, alt_margin, az_margin) == 0)
 				{
-					soft_hit = true;
-					soft_az = t_az;
-					soft_alt = t_alt;
+					if (ignore_soft_beginning == false)
+					{
+						soft_hit = true;
+						soft_az = t_az;
+						soft_alt = t_alt;
+					}
 				}
-			}
-			else
-			{
-				// we moved away from soft hit region
-				if (ignore_soft_beginning == true)
+				else
 				{
-					ignore_soft_beginning = false;
-					soft_az = t_az;
-					soft_alt = t_alt;
+					// we moved away from soft hit region
+					if (ignore_soft_beginning == true)
+					{
+						ignore_soft_beginning = false;
+						soft_az = t_az;
+						soft_alt = t_alt;
+					}
 				}
 			}
-		}
 
-		t_az = n_az;
-		t_alt = n_alt;
+			t_az = n_az;
+			t_alt = n_alt;
+		}
 	}
 
 	if (soft_hit == true)
@@ -0,0 +1,81 @@
+/*
+ * Cache of ERFA astrometry context.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "astromcache.h"
+
+#ifdef RTS2_LIBERFA
+
+#include <math.h>
+
+using namespace rts2teld;
+
+// true if value changed by more than threshold, or if any of the values is nan
+static bool drifted (double a, double b, double threshold)
+{
+	return !(fabs (a - b) <= threshold);
+}
+
+AstromCache::AstromCache ()
+{
+	valid = false;
+	cachedEo = 0;
+	cachedStatus = 0;
+	rebuilds = 0;
+}
+
+int AstromCache::get (double utc1, double utc2, double dut1, double elong, double phi, double hm, double phpa, double tc, double rh, double wl, eraASTROM *&astrom, double &eo)
+{
+	// pressure, temperature and humidity change refraction only slightly
+	if (!valid
+		|| drifted ((utc1 - cUtc1) + (utc2 - cUtc2), 0, ASTROM_REFRESH / 86400.0)
+		|| dut1 != cDut1 || elong != cElong || phi != cPhi || hm != cHm || wl != cWl
+		|| drifted (phpa, cPhpa, 0.1) || drifted (tc, cTc, 0.1) || drifted (rh, cRh, 0.01))
+	{
+		cachedStatus = eraApco13 (utc1, utc2, dut1, elong, phi, hm, 0, 0, phpa, tc, rh, wl, &cached, &cachedEo);
+		valid = cachedStatus >= 0;
+		if (!valid)
+			return cachedStatus;
+
+		cUtc1 = utc1;
+		cUtc2 = utc2;
+		cDut1 = dut1;
+		cElong = elong;
+		cPhi = phi;
+		cHm = hm;
+		cPhpa = phpa;
+		cTc = tc;
+		cRh = rh;
+		cWl = wl;
+		rebuilds++;
+	}
+	else
+	{
+		// only update Earth rotation angle
+		double ut11, ut12;
+		int status = eraUtcut1 (utc1, utc2, dut1, &ut11, &ut12);
+		if (status < 0)
+			return status;
+		eraAper13 (ut11, ut12, &cached);
+	}
+
+	astrom = &cached;
+	eo = cachedEo;
+	return cachedStatus;
+}
+
+#endif // RTS2_LIBERFA
@@ -19,6 +19,7 @@
 
 #include "gem.h"
 #include "configuration.h"
+#include "trajectory.h"
 
 #include "libnova_cpp.h"
 
@@ -313,9 +314,13 @@ int GEM::sky2counts (const double utc1, const double utc2, struct ln_equ_posn *p
 
 int GEM::counts2sky (int32_t ac, int32_t dc, double &ra, double &dec, int &flip, double &un_ra, double &un_dec, double JD)
 {
-	double ls, ha;
+	counts2skyLst (ac, dc, getLstDeg (JD, 0), ra, dec, flip, un_ra, un_dec);
+	return 0;
+}
 
-	ls = getLstDeg (JD, 0);
+void GEM::counts2skyLst (int32_t ac, int32_t dc, double ls, double &ra, double &dec, int &flip, double &un_ra, double &un_dec)
+{
+	double ha;
 
 	ha = (double) (ac / haCpd->getValueDouble ()) + haZero->getValueDouble ();
 	dec = (double) (dc / decCpd->getValueDouble ()) + decZero->getValueDouble ();
@@ -348,8 +353,6 @@ int GEM::counts2sky (int32_t ac, int32_t dc, double &ra, double &dec, int &flip,
 		dec -= 360.0;
 
 	ra = ln_range_degrees (ra);
-
-	return 0;
 }
 
 GEM::GEM (int in_argc, char **in_argv, bool diffTrack, bool hasTracking, bool hasUnTelCoordinates, bool parkingBlock):Telescope (in_argc, in_argv, diffTrack, hasTracking, hasUnTelCoordinates ? 1 : 0, false, parkingBlock)
@@ -625,144 +628,126 @@ int GEM::checkTrajectory (double JD, int32_t ac, int32_t dc, int32_t &at, int32_
 	int32_t t_a = ac;
 	int32_t t_d = dc;
 
-	int32_t step_a = as;
-	int32_t step_d = ds;
-
 	int32_t soft_a = ac;
 	int32_t soft_d = dc;
 
 	bool hard_beginning = false;
 
-	if (ac > at)
-		step_a = -as;
-
-	if (dc > dt)
-		step_d = -ds;
-
 	int first_flip = telFlip->getValueInteger ();
 
 	// turned to true if we are in "soft" boundaries, e.g hit with margin applied
 	bool soft_hit = false;
 
-	for (unsigned int c = 0; c < steps; c++)
-	{
-		// check if still visible
-		struct ln_equ_posn pos, un_pos;
-		struct ln_hrz_posn hrz;
-		int flip = 0;
-		int ret;
+	// sidereal times are the same for all steps
+	double ls = getLstDeg (JD, 0);
+	double lst_hrz = ln_range_degrees (15.0 * ln_get_apparent_sidereal_time (JD) + telLongitude->getValueDouble ());
+	double lat = telLatitude->getValueDouble ();
 
-		int32_t n_a;
-		int32_t n_d;
+	TrajectoryBlock block (ac, dc, at, dt, as, ds);
 
-		// if we already reached destionation, e.g. currently computed position is within step to target, don't go further..
-		if (labs (t_a - at) < as)
-		{
-			n_a = at;
-			step_a = 0;
-		}
-		else
-		{
-			n_a = t_a + step_a;
-		}
+	unsigned int c = 0;
+	while (c < steps)
+	{
+		size_t bs = block.fill (steps - c);
 
-		if (labs (t_d - dt) < ds)
+		for (size_t i = 0; i < bs; i++)
 		{
-			n_d = dt;
-			step_d = 0;
-		}
-		else
-		{
-			n_d = t_d + step_d;
+			double ra, un_ra, un_dec;
+			block.flip[i] = 0;
+			counts2skyLst (block.n_a[i], block.n_d[i], ls, ra, block.dec[i], block.flip[i], un_ra, un_dec);
+			block.ha[i] = lst_hrz - ra;
 		}
 
-		ret = counts2sky (n_a, n_d, pos.ra, pos.dec, flip, un_pos.ra, un_pos.dec, JD);
-		if (ret)
-			return -1;
+		block.hadec2hrz (lat);
+		block.checkHorizon (hardHorizon);
 
-		if (dont_flip == true && first_flip != flip)
+		for (size_t i = 0; i < bs; i++, c++)
 		{
-			at = n_a;
-			dt = n_d;
-			return 4;
-		}
+			int32_t n_a = block.n_a[i];
+			int32_t n_d = block.n_d[i];
 
-		struct ln_lnlat_posn latpos;
-		latpos.lat = telLatitude->getValueDouble ();
-		latpos.lng = telLongitude->getValueDouble ();
+			if (dont_flip == true && first_flip != block.flip[i])
+			{
+				at = n_a;
+				dt = n_d;
+				return 4;
+			}
 
-		ln_get_hrz_from_equ (&pos, &latpos, JD, &hrz);
+			// check if still visible
+			struct ln_hrz_posn hrz;
+			hrz.alt = block.alt[i];
+			hrz.az = block.az[i];
 
-		// uncomment to see which checks are being performed
-		//std::cerr << "checkTrajectory hrz " << n_a << " " << n_d << " hrz alt az " << hrz.alt << " " << hrz.az << std::endl;
+			// uncomment to see which checks are being performed
+			//std::cerr << "checkTrajectory hrz " << n_a << " " << n_d << " hrz alt az " << hrz.alt << " " << hrz.az << std::endl;
 
-		if (soft_hit == true || ignore_soft_beginning == true)
-		{
-			// if we really cannot go further
-			if (hardHorizon->is_good (&hrz) == 0)
+			if (soft_hit == true || ignore_soft_beginning == true)
 			{
-				// even at hard hit on first step, let's see if it can move out of limits
-				if (c == 0) 
-				{
-					logStream (MESSAGE_WARNING) << "below hard limit, see if we can move above in a few steps" << sendLog;
-					hard_beginning = true;
-				}
-				else if (hard_beginning == false || c > 20)
+				// if we really cannot go further
+				if (block.good[i] == 0)
 				{
-					logStream (MESSAGE_DEBUG) << "hit hard limit at alt az " << hrz.alt << " " << hrz.az << " " << soft_a << " " << soft_d << " " << n_a << " " << n_d << sendLog;
-					if (soft_hit == true)
+					// even at hard hit on first step, let's see if it can move out of limits
+					if (c == 0) 
 					{
-						// then use last good position, and return we reached horizon..
-						at = soft_a;
-						dt = soft_d;
-						return 2;
+						logStream (MESSAGE_WARNING) << "below hard limit, see if we can move above in a few steps" << sendLog;
+						hard_beginning = true;
 					}
-					else
+					else if (hard_beginning == false || c > 20)
 					{
-						// case when moving within soft will lead to hard hit..we don't want this path
-						at = t_a;
-						dt = t_d;
-						return 3;
+						logStream (MESSAGE_DEBUG) << "hit hard limit at alt az " << hrz.alt << " " << hrz.az << " " << soft_a << " " << soft_d << " " << n_a << " " << n_d << sendLog;
+						if (soft_hit == true)
+						{
+							// then use last good position, and return we reached horizon..
+							at = soft_a;
+							dt = soft_d;
+							return 2;
+						}
+						else
+						{
+							// case when moving within soft will lead to hard hit..we don't want this path
+							at = t_a;
+							dt = t_d;
+							return 3;
+						}
 					}
+				}
+				else
+				{
 					hard_beginning = false;
 				}
 			}
-			else
-			{
-				hard_beginning = false;
-			}
-		}
 
-		// we don't need to move anymore, full trajectory is valid
-		if (step_a == 0 && step_d == 0)
-			return 0;
+			// we don't need to move anymore, full trajectory is valid
+			if (block.last[i])
+				return 0;
 
-		if (soft_hit == false && hard_beginning == false)
-		{
-			// check soft margins..
-			if (hardHorizon->is_good_with_margin (&hrz, alt_margin, az_margin) == 0)
+			if (soft_hit == false && hard_beginning == false)
 			{
-				if (ignore_soft_beginning == false)
+				// check soft margins..
+				if (hardHorizon->is_good_with_margin (&hrz, alt_margin, az_margin) == 0)
 				{
-					soft_hit = true;
-					soft_a = t_a;
-					soft_d = t_d;
+					if (ignore_soft_beginning == false)
+					{
+						soft_hit = true;
+						soft_a = t_a;
+						soft_d = t_d;
+					}
 				}
-			}
-			else
-			{
-				// we moved away from soft hit region
-				if (ignore_soft_beginning == true)
+				else
 				{
-					ignore_soft_beginning = false;
-					soft_a = t_a;
-					soft_d = t_d;
+					// we moved away from soft hit region
+					if (ignore_soft_beginning == true)
+					{
+						ignore_soft_beginning = false;
+						soft_a = t_a;
+						soft_d = t_d;
+					}
 				}
 			}
-		}
 
-		t_a = n_a;
-		t_d = n_d;
+			t_a = n_a;
+			t_d = n_d;
+		}
 	}
 
 	if (soft_hit == true)
@@ -2067,9 +2067,9 @@ void Telescope::applyCorrections (struct ln_equ_posn *pos, double utc1, double u
 	double rc = ln_deg_to_rad (pos->ra);
 	double dc = ln_deg_to_rad (pos->dec);
 
-	eraASTROM astrom;
+	eraASTROM *astrom;
 
-	int status = eraApco13 (utc1, utc2, telDUT1->getValueDouble (), ln_deg_to_rad (getLongitude ()), ln_deg_to_rad (getLatitude ()), getAltitude (), 0, 0, getPressure (), telAmbientTemperature->getValueFloat (), telHumidity->getValueFloat () / 100.0, telWavelength->getValueFloat () / 1000.0, &astrom, &eo);
+	int status = astromCache.get (utc1, utc2, telDUT1->getValueDouble (), ln_deg_to_rad (getLongitude ()), ln_deg_to_rad (getLatitude ()), getAltitude (), getPressure (), telAmbientTemperature->getValueFloat (), telHumidity->getValueFloat () / 100.0, telWavelength->getValueFloat () / 1000.0, astrom, eo);
 	if (status)
 	{
 		logStream (MESSAGE_ERROR) << "cannot apply corrections to " << pos->ra << " " << pos->dec << sendLog;
@@ -2077,10 +2077,10 @@ void Telescope::applyCorrections (struct ln_equ_posn *pos, double utc1, double u
 	}
 
 	// transform ICRS to CIRS
-	eraAtciq (rc, dc, ln_deg_to_rad (pmRaDec->getRa ()), ln_deg_to_rad (pmRaDec->getDec ()), 0, 0, &astrom, &ri, &di);
+	eraAtciq (rc, dc, ln_deg_to_rad (pmRaDec->getRa ()), ln_deg_to_rad (pmRaDec->getDec ()), 0, 0, astrom, &ri, &di);
 
 	// transform CISC to observed
-	eraAtioq (ri, di, &astrom, &aob, &zob, &hob, &dob, &rob);
+	eraAtioq (ri, di, astrom, &aob, &zob, &hob, &dob, &rob);
 
 	pos->ra = ln_rad_to_deg (eraAnp (rob - eo));
 	pos->dec = ln_rad_to_deg (dob);
@@ -0,0 +1,107 @@
+/*
+ * Block evaluation of telescope trajectory steps.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "trajectory.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+using namespace rts2teld;
+
+TrajectoryBlock::TrajectoryBlock (int32_t _a, int32_t _d, int32_t _at, int32_t _dt, int32_t _as, int32_t _ds)
+{
+	size = 0;
+
+	t_a = _a;
+	t_d = _d;
+	at = _at;
+	dt = _dt;
+	as = _as;
+	ds = _ds;
+
+	step_a = (_a > _at) ? -_as : _as;
+	step_d = (_d > _dt) ? -_ds : _ds;
+}
+
+size_t TrajectoryBlock::fill (size_t maxSteps)
+{
+	for (size = 0; size < maxSteps && size < TRAJECTORY_BLOCK; )
+	{
+		// if we already reached destionation, e.g. currently computed position is within step to target, don't go further..
+		if (labs (t_a - at) < as)
+		{
+			n_a[size] = at;
+			step_a = 0;
+		}
+		else
+		{
+			n_a[size] = t_a + step_a;
+		}
+
+		if (labs (t_d - dt) < ds)
+		{
+			n_d[size] = dt;
+			step_d = 0;
+		}
+		else
+		{
+			n_d[size] = t_d + step_d;
+		}
+
+		t_a = n_a[size];
+		t_d = n_d[size];
+
+		last[size] = (step_a == 0 && step_d == 0);
+		if (last[size++])
+			break;
+	}
+	return size;
+}
+
+void TrajectoryBlock::hadec2hrz (double lat)
+{
+	const double d2r = M_PI / 180.0;
+	const double sin_lat = sin (lat * d2r);
+	const double cos_lat = cos (lat * d2r);
+
+	// straight loop over arrays, without branches
+	for (size_t i = 0; i < size; i++)
+	{
+		double sin_h = sin (ha[i] * d2r);
+		double cos_h = cos (ha[i] * d2r);
+		double sin_d = sin (dec[i] * d2r);
+		double cos_d = cos (dec[i] * d2r);
+
+		alt[i] = asin (sin_lat * sin_d + cos_lat * cos_d * cos_h) / d2r;
+		az[i] = atan2 (cos_d * sin_h, sin_lat * cos_d * cos_h - cos_lat * sin_d) / d2r;
+	}
+
+	for (size_t i = 0; i < size; i++)
+	{
+		// azimuth is undefined at zenith/nadir, handle it as ln_get_hrz_from_equ does
+		if (cos (alt[i] * d2r) < 1e-5)
+		{
+			az[i] = dec[i] > 0 ? 180 : 0;
+			alt[i] = ((dec[i] > 0 && lat > 0) || (dec[i] < 0 && lat < 0)) ? 90 : -90;
+		}
+		else if (az[i] < 0)
+		{
+			az[i] += 360;
+		}
+	}
+}
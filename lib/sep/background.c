@@ -21,6 +21,7 @@
 *%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,94 +55,52 @@ float backguess(backstruct *bkg, float *mean, float *sigma);
 int makebackspline(sep_bkg *bkg, float *map, float *dmap);
 
 
-int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
-                   double fthresh, sep_bkg **bkg)
+/* rows of background meshes shared by threads of bkg_meshrows() */
+typedef struct {
+  sep_image *image;
+  sep_bkg *bkg;
+  int bw, nx, ny;
+  int bufsize;                /* size of a full row of boxes in pixels */
+  int elsize, melsize;
+  PIXTYPE maskthresh;
+  array_converter convert, mconvert;
+  pthread_mutex_t lock;
+  int nextrow;                /* next row of boxes to be processed */
+  int endrow;                 /* row after the last one to be processed */
+  int status;
+} backrows;
+
+/* process rows of background boxes until all are done */
+static void *backrows_worker(void *arg)
 {
+  backrows *rows = (backrows *)arg;
+  sep_image *image = rows->image;
   BYTE *imt, *maskt;
-  int npix;                   /* size of image */
-  int nx, ny, nb;             /* number of background boxes in x, y, total */
-  int bufsize;                /* size of a "row" of boxes in pixels (w*bh) */
-  int elsize;                 /* size (in bytes) of an image array element */
-  int melsize;                /* size (in bytes) of a mask array element */
   PIXTYPE *buf, *buft, *mbuf, *mbuft;
-  PIXTYPE maskthresh;
-  array_converter convert, mconvert;
-  backstruct *backmesh, *bm;  /* info about each background "box" */
-  sep_bkg *bkgout;          /* output */
-  int j,k,m, status;
+  backstruct *backmesh, *bm;
+  int bufsize, nx, j, k, m, status;
 
   status = RETURN_OK;
-  npix = image->w * image->h;
-  bufsize = image->w * bh;
-  maskthresh = image->maskthresh;
-  if (image->mask == NULL) maskthresh = 0.0;
-
-  backmesh = bm = NULL;
-  bkgout = NULL;
+  nx = rows->nx;
   buf = mbuf = buft = mbuft = NULL;
-  convert = mconvert = NULL;
-
-  /* determine number of background boxes */
-  if ((nx = (image->w - 1) / bw + 1) < 1)
-    nx = 1;
-  if ((ny = (image->h - 1) / bh + 1) < 1)
-    ny = 1;
-  nb = nx*ny;
 
-  /* Allocate temp memory & initialize */
+  /* each thread has its own buffers and meshes */
   QMALLOC(backmesh, backstruct, nx, status);
   bm = backmesh;
   for (m=nx; m--; bm++)
     bm->histo=NULL;
 
-  /* Allocate the returned struct */
-  QMALLOC(bkgout, sep_bkg, 1, status);
-  bkgout->w = image->w;
-  bkgout->h = image->h;
-  bkgout->nx = nx;
-  bkgout->ny = ny;
-  bkgout->n = nb;
-  bkgout->bw = bw;
-  bkgout->bh = bh;
-  bkgout->back = NULL;
-  bkgout->sigma = NULL;
-  bkgout->dback = NULL;
-  bkgout->dsigma = NULL;
-  QMALLOC(bkgout->back, float, nb, status);
-  QMALLOC(bkgout->sigma, float, nb, status);
-  QMALLOC(bkgout->dback, float, nb, status);
-  QMALLOC(bkgout->dsigma, float, nb, status);
-
-  /* cast input array pointers. These are used to step through the arrays. */
-  imt = (BYTE *)image->data;
-  maskt = (BYTE *)image->mask;
-
-  /* get the correct array converter and element size, based on dtype code */
-  status = get_array_converter(image->dtype, &convert, &elsize);
-  if (status != RETURN_OK)
-    goto exit;
-  if (image->mask)
-    {
-      status = get_array_converter(image->mdtype, &mconvert, &melsize);
-      if (status != RETURN_OK)
-	goto exit;
-    }
-
   /* If the input array type is not PIXTYPE, allocate a buffer to hold
      converted values */
   if (image->dtype != PIXDTYPE)
     {
-      QMALLOC(buf, PIXTYPE, bufsize, status);
+      QMALLOC(buf, PIXTYPE, rows->bufsize, status);
       buft = buf;
-      if (status != RETURN_OK)
-	goto exit;
     }
   if (image->mask && (image->mdtype != PIXDTYPE))
     {
-      QMALLOC(mbuf, PIXTYPE, bufsize, status);
+      QMALLOC(mbuf, PIXTYPE, rows->bufsize, status);
       mbuft = mbuf;
-      if (status != RETURN_OK)
-	goto exit;
     }
 
   /* loop over rows of background boxes.
@@ -151,28 +110,43 @@ int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
    * because the pixel buffers are only read in from disk in
    * increments of a row of background boxes at a time.)
    */
-  for (j=0; j<ny; j++)
+  for (;;)
     {
+      pthread_mutex_lock(&rows->lock);
+      if (rows->status != RETURN_OK)
+	j = rows->endrow;
+      else
+	j = rows->nextrow++;
+      pthread_mutex_unlock(&rows->lock);
+      if (j >= rows->endrow)
+	break;
+
       /* if the last row, modify the width appropriately*/
-      if (j == ny-1 && npix%bufsize)
-        bufsize = npix%bufsize;
+      bufsize = rows->bufsize;
+      if (j == rows->ny-1 && (image->w * image->h)%bufsize)
+        bufsize = (image->w * image->h)%bufsize;
+
+      imt = (BYTE *)image->data + (size_t)rows->elsize * rows->bufsize * j;
+      maskt = image->mask ?
+	(BYTE *)image->mask + (size_t)rows->melsize * rows->bufsize * j : NULL;
 
       /* convert this row to PIXTYPE and store in buffer(s)*/
       if (image->dtype != PIXDTYPE)
-	convert(imt, bufsize, buft);
+	rows->convert(imt, bufsize, buft);
       else
 	buft = (PIXTYPE *)imt;
 
       if (image->mask)
 	{
 	  if (image->mdtype != PIXDTYPE)
-	    mconvert(maskt, bufsize, mbuft);
+	    rows->mconvert(maskt, bufsize, mbuft);
 	  else
 	    mbuft = (PIXTYPE *)maskt;
 	}
 
       /* Get clipped mean, sigma for all boxes in the row */
-      backstat(backmesh, buft, mbuft, bufsize, nx, image->w, bw, maskthresh);
+      backstat(backmesh, buft, mbuft, bufsize, nx, image->w, rows->bw,
+	       rows->maskthresh);
 
       /* Allocate histograms in each box in this row. */
       bm = backmesh;
@@ -181,42 +155,171 @@ int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
 	  bm->histo=NULL;
 	else
 	  QCALLOC(bm->histo, LONG, bm->nlevels, status);
-      backhisto(backmesh, buft, mbuft, bufsize, nx, image->w, bw, maskthresh);
+      backhisto(backmesh, buft, mbuft, bufsize, nx, image->w, rows->bw,
+		rows->maskthresh);
 
       /* Compute background statistics from the histograms */
       bm = backmesh;
       for (m=0; m<nx; m++, bm++)
 	{
 	  k = m+nx*j;
-	  backguess(bm, bkgout->back+k, bkgout->sigma+k);
+	  backguess(bm, rows->bkg->back+k, rows->bkg->sigma+k);
 	  free(bm->histo);
 	  bm->histo = NULL;
 	}
-
-      /* increment array pointers to next row of background boxes */
-      imt += elsize * bufsize;
-      if (image->mask)
-	maskt += melsize * bufsize;
     }
 
-  /* free memory */
+ exit:
+  if (status != RETURN_OK)
+    {
+      pthread_mutex_lock(&rows->lock);
+      rows->status = status;
+      pthread_mutex_unlock(&rows->lock);
+    }
   free(buf);
-  buf = NULL;
   free(mbuf);
-  mbuf = NULL;
+  if (backmesh)
+    {
+      bm = backmesh;
+      for (m=0; m<nx; m++, bm++)
+	free(bm->histo);
+    }
   free(backmesh);
-  backmesh = NULL;
+  return NULL;
+}
 
-  /* Median-filter and check suitability of the background map */
-  if ((status = filterback(bkgout, fw, fh, fthresh)) != RETURN_OK)
+/* allocate background map for w x h image, meshes are not computed */
+int bkg_alloc(int w, int h, int bw, int bh, sep_bkg **bkg)
+{
+  int nx, ny, nb;             /* number of background boxes in x, y, total */
+  sep_bkg *bkgout;            /* output */
+  int status;
+
+  status = RETURN_OK;
+  bkgout = NULL;
+
+  /* determine number of background boxes */
+  if ((nx = (w - 1) / bw + 1) < 1)
+    nx = 1;
+  if ((ny = (h - 1) / bh + 1) < 1)
+    ny = 1;
+  nb = nx*ny;
+
+  /* Allocate the returned struct */
+  QMALLOC(bkgout, sep_bkg, 1, status);
+  bkgout->w = w;
+  bkgout->h = h;
+  bkgout->nx = nx;
+  bkgout->ny = ny;
+  bkgout->n = nb;
+  bkgout->bw = bw;
+  bkgout->bh = bh;
+  bkgout->global = bkgout->globalrms = 0.0;
+  bkgout->back = NULL;
+  bkgout->sigma = NULL;
+  bkgout->dback = NULL;
+  bkgout->dsigma = NULL;
+  QMALLOC(bkgout->back, float, nb, status);
+  QMALLOC(bkgout->sigma, float, nb, status);
+  QMALLOC(bkgout->dback, float, nb, status);
+  QMALLOC(bkgout->dsigma, float, nb, status);
+
+  *bkg = bkgout;
+  return status;
+
+ exit:
+  sep_bkg_free(bkgout);
+  *bkg = NULL;
+  return status;
+}
+
+/* compute rows j0 .. j1-1 of background meshes; image rows up to
+ * j1*bkg->bh (or the last one) must be present in image */
+int bkg_meshrows(sep_image *image, sep_bkg *bkg, int j0, int j1)
+{
+  int nthreads;
+  backrows rows;              /* state shared by threads */
+  pthread_t *threads;
+  int t, status;
+
+  status = RETURN_OK;
+  threads = NULL;
+
+  rows.image = image;
+  rows.bkg = bkg;
+  rows.bw = bkg->bw;
+  rows.nx = bkg->nx;
+  rows.ny = bkg->ny;
+  rows.bufsize = image->w * bkg->bh;
+  rows.maskthresh = image->maskthresh;
+  if (image->mask == NULL) rows.maskthresh = 0.0;
+  rows.convert = rows.mconvert = NULL;
+  rows.elsize = rows.melsize = 0;
+  rows.nextrow = j0;
+  rows.endrow = j1;
+  rows.status = RETURN_OK;
+
+  /* get the correct array converter and element size, based on dtype code */
+  status = get_array_converter(image->dtype, &rows.convert, &rows.elsize);
+  if (status != RETURN_OK)
     goto exit;
+  if (image->mask)
+    {
+      status = get_array_converter(image->mdtype, &rows.mconvert,
+				   &rows.melsize);
+      if (status != RETURN_OK)
+	goto exit;
+    }
+
+  /* rows of boxes are independent, so they are processed in parallel;
+   * the calling thread processes rows as well */
+  nthreads = sep_get_threads();
+  if (nthreads > j1 - j0)
+    nthreads = j1 - j0;
+  if (nthreads > 1)
+    QMALLOC(threads, pthread_t, nthreads - 1, status);
+  pthread_mutex_init(&rows.lock, NULL);
+  for (t=0; t<nthreads-1; t++)
+    if (pthread_create(threads+t, NULL, backrows_worker, &rows))
+      break;
+  backrows_worker(&rows);
+  while (t--)
+    pthread_join(threads[t], NULL);
+  pthread_mutex_destroy(&rows.lock);
+
+  status = rows.status;
+
+ exit:
+  free(threads);
+  return status;
+}
+
+/* filter computed meshes and prepare splines for interpolation */
+int bkg_finish(sep_bkg *bkg, int fw, int fh, double fthresh)
+{
+  int status;
+
+  /* Median-filter and check suitability of the background map */
+  if ((status = filterback(bkg, fw, fh, fthresh)) != RETURN_OK)
+    return status;
 
   /* Compute 2nd derivatives along the y-direction */
-  if ((status = makebackspline(bkgout, bkgout->back, bkgout->dback)) !=
-      RETURN_OK)
+  if ((status = makebackspline(bkg, bkg->back, bkg->dback)) != RETURN_OK)
+    return status;
+  return makebackspline(bkg, bkg->sigma, bkg->dsigma);
+}
+
+int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
+                   double fthresh, sep_bkg **bkg)
+{
+  sep_bkg *bkgout;          /* output */
+  int status;
+
+  if ((status = bkg_alloc(image->w, image->h, bw, bh, &bkgout)) != RETURN_OK)
     goto exit;
-  if ((status = makebackspline(bkgout, bkgout->sigma, bkgout->dsigma)) !=
-      RETURN_OK)
+  if ((status = bkg_meshrows(image, bkgout, 0, bkgout->ny)) != RETURN_OK)
+    goto exit;
+  if ((status = bkg_finish(bkgout, fw, fh, fthresh)) != RETURN_OK)
     goto exit;
 
   *bkg = bkgout;
@@ -224,15 +327,6 @@ int sep_background(sep_image* image, int bw, int bh, int fw, int fh,
 
   /* If we encountered a problem, clean up any allocated memory */
  exit:
-  free(buf);
-  free(mbuf);
-  if (backmesh)
-    {
-      bm = backmesh;
-      for (m=0; m<nx; m++, bm++)
-	free(bm->histo);
-    }
-  free(backmesh);
   sep_bkg_free(bkgout);
   *bkg = NULL;
   return status;
@@ -28,9 +28,6 @@
 #include "sepcore.h"
 #include "extract.h"
 
-#ifndef	RAND_MAX
-#define	RAND_MAX 2147483647
-#endif
 #define	NSONMAX	1024  /* max. number per level */
 #define NSONMAX_STR "1024" /* just for error message */
 #define	NBRANCH	16    /* starting number per branch */
@@ -38,12 +35,8 @@
 
 
 int belong(int, objliststruct *, int, objliststruct *);
-int *createsubmap(objliststruct *, int, int *, int *, int *, int *);
 int gatherup(objliststruct *, objliststruct *);
 
-static objliststruct *objlist=NULL;
-static short	     *son=NULL, *ok=NULL;
-
 /******************************** deblend ************************************/
 /*
 Divide a list of isophotal detections in several parts (deblending).
@@ -52,11 +45,14 @@ NOTE: Even if the object is not deblended, the output objlist threshold is
 
 This can return two error codes: DEBLEND_OVERFLOW or MEMORY_ALLOC_ERROR
 */
-int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
-	    int deblend_nthresh, double deblend_mincont, int minarea)
+int deblend(deblendctx *ctx, objliststruct *objlistin, int l,
+	    objliststruct *objlistout, int deblend_nthresh,
+	    double deblend_mincont, int minarea)
 {
   objstruct		*obj;
-  static objliststruct	debobjlist, debobjlist2;
+  objliststruct		debobjlist, debobjlist2;
+  objliststruct		*objlist = ctx->objlist;
+  short			*son = ctx->son, *ok = ctx->ok;
   double		thresh, thresh0, value0;
   int			h,i,j,k,m,subx,suby,subh,subw,
                         xn,
@@ -68,7 +64,7 @@ int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
   status = RETURN_OK;
   xn = deblend_nthresh;
 
-  /* reset global static objlist for deblending */
+  /* reset objlist for deblending */
   memset(objlist, 0, (size_t)xn*sizeof(objliststruct));
 
   /* initialize local object lists */
@@ -116,7 +112,7 @@ int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
       
       for (i=0; i<objlist[k-1].nobj; i++)
 	{
-	  status = lutz(objlistin->plist, submap, subx, suby, subw,
+	  status = lutz(&ctx->lutz, objlistin->plist, submap, subx, suby, subw,
 			&objlist[k-1].obj[i], &debobjlist, minarea);
 	  if (status != RETURN_OK)
 	    goto exit;
@@ -135,12 +131,15 @@ int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
 		    goto exit;
 		  }
 		if (h>=nbm-1)
-		  if (!(son = (short *)
-			realloc(son,xn*NSONMAX*(nbm+=16)*sizeof(short))))
-		    {
-		      status = MEMORY_ALLOC_ERROR;
-		      goto exit;
-		    }
+		  {
+		    if (!(son = (short *)
+			  realloc(son,xn*NSONMAX*(nbm+=16)*sizeof(short))))
+		      {
+			status = MEMORY_ALLOC_ERROR;
+			goto exit;
+		      }
+		    ctx->son = son;
+		  }
 		son[k-1+xn*(i+NSONMAX*(h++))] = (short)m;
 		ok[k+xn*m] = (short)1;
 	      }
@@ -207,36 +206,59 @@ int deblend(objliststruct *objlistin, int l, objliststruct *objlistout,
 
 /******************************* allocdeblend ******************************/
 /*
-Allocate the memory allocated by global pointers in refine.c
+Allocate deblending work space, including buffers for lutz() on image of
+given width and height.
 */
-int allocdeblend(int deblend_nthresh)
+int allocdeblend(int deblend_nthresh, int w, int h, deblendctx *ctx)
 {
   int status=RETURN_OK;
-  QMALLOC(son, short,  deblend_nthresh*NSONMAX*NBRANCH, status);
-  QMALLOC(ok, short,  deblend_nthresh*NSONMAX, status);
-  QMALLOC(objlist, objliststruct, deblend_nthresh, status);
+  memset(ctx, 0, sizeof(deblendctx));
+  QMALLOC(ctx->son, short,  deblend_nthresh*NSONMAX*NBRANCH, status);
+  QMALLOC(ctx->ok, short,  deblend_nthresh*NSONMAX, status);
+  QMALLOC(ctx->objlist, objliststruct, deblend_nthresh, status);
+  if ((status = lutzalloc(w, h, &ctx->lutz)) != RETURN_OK)
+    goto exit;
 
   return status;
  exit:
-  freedeblend();
+  freedeblend(ctx);
   return status;
 }
 
 /******************************* freedeblend *******************************/
 /*
-Free the memory allocated by global pointers in refine.c
+Free deblending work space.
 */
-void freedeblend(void)
+void freedeblend(deblendctx *ctx)
 {
-  free(son);
-  son = NULL;
-  free(ok);
-  ok = NULL;
-  free(objlist);
-  objlist = NULL;
+  free(ctx->son);
+  ctx->son = NULL;
+  free(ctx->ok);
+  ctx->ok = NULL;
+  free(ctx->objlist);
+  ctx->objlist = NULL;
+  lutzfree(&ctx->lutz);
   return;
 }
 
+/********************************* pixrand ***********************************/
+/*
+Pseudo-random number in [0,1) computed from pixel position. Unlike rand(), it
+does not depend on the order in which pixels and objects are processed, so
+deblending gives the same result for any split of the image into strips.
+*/
+static float pixrand(int x, int y)
+{
+  unsigned int h = (unsigned int)x * 0x9e3779b1u ^ (unsigned int)y * 0x85ebca77u;
+
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return (h >> 8) / 16777216.0f;
+}
+
 /********************************* gatherup **********************************/
 /*
 Collect faint remaining pixels and allocate them to their most probable
@@ -337,7 +359,7 @@ int gatherup(objliststruct *objlistin, objliststruct *objlistout)
 	    }			
 	  if (p[nobj-1] > 1.0e-31)
 	    {
-	      drand = p[nobj-1]*rand()/RAND_MAX;
+	      drand = p[nobj-1]*pixrand(x, y);
 	      for (i=1; i<nobj && p[i]<drand; i++);
 	      if (i==nobj)
 		i=iclst;
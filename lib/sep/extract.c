@@ -23,6 +23,7 @@
 /* Note: was scan.c in SExtractor. */
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,11 +36,19 @@
 			             /* thresholding filtered weight-maps */
 
 /* globals */
-int plistexist_cdvalue, plistexist_thresh, plistexist_var;
-int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
-int plistsize;
+SEP_TLS int plistexist_cdvalue, plistexist_thresh, plistexist_var;
+SEP_TLS int plistoff_value, plistoff_cdvalue, plistoff_thresh, plistoff_var;
+SEP_TLS int plistsize;
 size_t extract_pixstack = 300000;
 
+/* position of object in the merged list */
+typedef struct
+{
+  int           key, seq;
+  objliststruct *objlist;
+  int           objnb;
+} objorder;
+
 /* get and set pixstack */
 void sep_set_extract_pixstack(size_t val)
 {
@@ -51,8 +60,8 @@ size_t sep_get_extract_pixstack()
   return extract_pixstack;
 }
 
-int sortit(infostruct *info, objliststruct *objlist, int minarea,
-	   objliststruct *finalobjlist,
+int sortit(deblendctx *ctx, infostruct *info, objliststruct *objlist,
+	   int minarea, objliststruct *finalobjlist,
 	   int deblend_nthresh, double deblend_mincont, double gain);
 void plistinit(int hasconv, int hasvar);
 void clean(objliststruct *objlist, double clean_param, int *survives);
@@ -60,18 +69,19 @@ int convert_to_catalog(objliststruct *objlist, int *survives,
                        sep_catalog *cat, int w, int include_pixels);
 
 int arraybuffer_init(arraybuffer *buf, void *arr, int dtype, int w, int h,
-                     int bufw, int bufh);
+                     int bufw, int bufh, int y);
 void arraybuffer_readline(arraybuffer *buf);
 void arraybuffer_free(arraybuffer *buf);
 
 /********************* array buffer functions ********************************/
 
-/* initialize buffer */
+/* initialize buffer; once bufh-1 lines are read, line `y` will be read
+ * into the middle line by the next arraybuffer_readline() */
 /* bufw must be less than or equal to w */
 int arraybuffer_init(arraybuffer *buf, void *arr, int dtype, int w, int h,
-                     int bufw, int bufh)
+                     int bufw, int bufh, int y)
 {
-  int status, yl;
+  int status;
   status = RETURN_OK;
 
   /* data info */
@@ -94,11 +104,7 @@ int arraybuffer_init(arraybuffer *buf, void *arr, int dtype, int w, int h,
     goto exit;
 
   /* initialize yoff */
-  buf->yoff = -bufh;
-
-  /* read in lines until the first data line is one line above midline */
-  for (yl=0; yl < bufh - bufh/2 - 1; yl++)
-    arraybuffer_readline(buf);
+  buf->yoff = y - bufh/2 - bufh;
 
   return status;
 
@@ -122,7 +128,7 @@ void arraybuffer_readline(arraybuffer *buf)
   buf->yoff++;
   y = buf->yoff + buf->bh - 1;
 
-  if (y < buf->dh)
+  if (y >= 0 && y < buf->dh)
     buf->readline(buf->dptr + buf->elsize * buf->dw * y, buf->dw,
                   buf->lastline);
 
@@ -168,26 +174,73 @@ void apply_mask_line(arraybuffer *mbuf, arraybuffer *imbuf, arraybuffer *nbuf)
     }
 }
 
-/****************************** extract **************************************/
-int sep_extract(sep_image *image, float thresh, int thresh_type,
-                int minarea, float *conv, int convw, int convh,
-		int filter_type, int deblend_nthresh, double deblend_cont,
-		int clean_flag, double clean_param,
-		sep_catalog **catalog)
+/* set keys of objects objfrom..objto-1 to `key` */
+static int setkeys(int **keys, int objfrom, int objto, int key)
+{
+  int *k;
+
+  if (objto == objfrom)
+    return RETURN_OK;
+  if (!(k = (int *)realloc(*keys, objto*sizeof(int))))
+    return MEMORY_ALLOC_ERROR;
+  for (; objfrom<objto; objfrom++)
+    k[objfrom] = key;
+  *keys = k;
+  return RETURN_OK;
+}
+
+/* does object have a pixel at row ytop or ybottom? */
+static int onseam(pliststruct *pixel, infostruct *info, int ytop, int ybottom)
+{
+  pliststruct *pixt;
+
+  for (pixt=pixel+info->firstpix; pixt>=pixel;
+       pixt=pixel+PLIST(pixt,nextpix))
+    if (PLIST(pixt,y) == ytop || PLIST(pixt,y) == ybottom)
+      return 1;
+  return 0;
+}
+
+/* wait until rows up to y-1 are available to streaming extraction */
+static int waitrows(extractjobs *jobs, int y)
+{
+  int status;
+
+  if (!jobs->stream)
+    return RETURN_OK;
+  if (y > jobs->image->h)
+    y = jobs->image->h;
+  pthread_mutex_lock(&jobs->lock);
+  while (jobs->rows < y && jobs->status == RETURN_OK)
+    pthread_cond_wait(&jobs->rowscond, &jobs->lock);
+  status = jobs->status;
+  pthread_mutex_unlock(&jobs->lock);
+  return status;
+}
+
+/****************************** extract_strip ********************************/
+/*
+Extract objects from rows strip->y0 .. strip->y1-1 of the image. Objects which
+touch a row next to another strip are not deblended, but stored in
+strip->seamlist, to be merged with fragments from the neighbouring strips.
+*/
+static int extract_strip(extractjobs *jobs, deblendctx *ctx,
+			 extractstrip *strip)
 {
   arraybuffer       dbuf, nbuf, mbuf;
   infostruct        curpixinfo, initinfo, freeinfo;
-  objliststruct     objlist;
+  objliststruct     objlist, fraglist;
+  objstruct         frag;
   char              newmarker;
   size_t            mem_pixstack;
   int               nposize, oldnposize;
-  int               w, h;
-  int               co, i, luflag, pstop, xl, xl2, yl, cn;
+  int               w, h, y0, y1, ytop, ybottom;
+  int               co, i, luflag, pstop, xl, xl2, yl, cn, nobj;
   int               stacksize, convn, status;
   int               bufh;
   int               isvarthresh, isvarnoise;
   short             trunflag;
-  PIXTYPE           relthresh, cdnewsymbol, pixvar, pixsig;
+  PIXTYPE           thresh, relthresh, cdnewsymbol, pixvar, pixsig;
   float             sum;
   pixstatus         cs, ps;
 
@@ -198,10 +251,12 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   PIXTYPE           *scan, *cdscan, *wscan, *dummyscan;
   PIXTYPE           *sigscan, *workscan;
   float             *convnorm;
-  int               *start, *end, *survives;
+  int               *start, *end;
   pixstatus         *psstack;
   char              errtext[512];
-  sep_catalog       *cat;
+  sep_image         *image;
+  float             *conv;
+  int               convw, convh, filter_type, minarea;
 
   status = RETURN_OK;
   pixel = NULL;
@@ -213,24 +268,32 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   marker = NULL;
   psstack = NULL;
   start = end = NULL;
-  finalobjlist = NULL;
-  survives = NULL;
-  cat = NULL;
+  dbuf.bptr = nbuf.bptr = mbuf.bptr = NULL;
   convn = 0;
   sum = 0.0;
+  image = jobs->image;
+  thresh = jobs->thresh;
+  conv = jobs->conv;
+  convw = jobs->convw;
+  convh = jobs->convh;
+  filter_type = jobs->filter_type;
+  minarea = jobs->minarea;
   w = image->w;
   h = image->h;
+  y0 = strip->y0;
+  y1 = strip->y1;
   isvarthresh = 0;
   relthresh = 0.0;
   pixvar = 0.0;
   pixsig = 0.0;
   isvarnoise = 0;
-  
-  mem_pixstack = sep_get_extract_pixstack();
+  finalobjlist = &strip->objlist;
 
-  /* seed the random number generator consistently on each call to get
-   * consistent results. rand() is used in deblending. */
-  srand(1);
+  /* rows shared with neighbouring strips */
+  ytop = y0 > 0 ? y0 : -1;
+  ybottom = y1 < h ? y1 - 1 : -1;
+
+  mem_pixstack = sep_get_extract_pixstack();
 
   /* Noise characteristics of the image: None, scalar or variable? */
   if (image->noise_type == SEP_NOISE_NONE) { } /* nothing to do */
@@ -257,7 +320,7 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   /* Deal with relative thresholding. (For an absolute threshold
   *  nothing needs to be done, as `thresh` should already contain the constant
   *  threshold, and `isvarthresh` is already 0.) */
-  if (thresh_type == SEP_THRESH_REL) {
+  if (jobs->thresh_type == SEP_THRESH_REL) {
 
     /* The image must have noise information. */
     if (image->noise_type == SEP_NOISE_NONE) return RELTHRESH_NO_NOISE;
@@ -284,10 +347,6 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   QMALLOC(psstack, pixstatus, stacksize, status);
   QCALLOC(start, int, stacksize, status);
   QMALLOC(end, int, stacksize, status);
-  if ((status = lutzalloc(w, h)) != RETURN_OK)
-    goto exit;
-  if ((status = allocdeblend(deblend_nthresh)) != RETURN_OK)
-    goto exit;
 
   /* Initialize buffers for input array(s).
    * The buffer size depends on whether or not convolution is active.
@@ -296,21 +355,36 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
    */
   bufh = conv ? convh : 1;
   status = arraybuffer_init(&dbuf, image->data, image->dtype, w, h, stacksize,
-                            bufh);
+                            bufh, y0);
   if (status != RETURN_OK) goto exit;
   if (isvarnoise) {
       status = arraybuffer_init(&nbuf, image->noise, image->ndtype, w, h,
-                                stacksize, bufh);
+                                stacksize, bufh, y0);
       if (status != RETURN_OK) goto exit;
     }
   if (image->mask) {
       status = arraybuffer_init(&mbuf, image->mask, image->mdtype, w, h,
-                                stacksize, bufh);
+                                stacksize, bufh, y0);
       if (status != RETURN_OK) goto exit;
     }
 
+  /* read in lines above the first line of the strip */
+  if ((status = waitrows(jobs, y0 + bufh/2)) != RETURN_OK)
+    goto exit;
+  for (yl=1; yl<bufh; yl++)
+    {
+      arraybuffer_readline(&dbuf);
+      if (isvarnoise)
+        arraybuffer_readline(&nbuf);
+      if (image->mask)
+        {
+          arraybuffer_readline(&mbuf);
+          apply_mask_line(&mbuf, &dbuf, (isvarnoise? &nbuf: NULL));
+        }
+    }
+
   /* `scan` (or `wscan`) is always a pointer to the current line being
-   * processed. It might be the only line in the buffer, or it might be the 
+   * processed. It might be the only line in the buffer, or it might be the
    * middle line. */
   scan = dbuf.midline;
   if (isvarnoise)
@@ -331,15 +405,12 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   objlist.nobj = 1;
   curpixinfo.pixnb = 1;
 
-  /* Init finalobjlist */
-  QMALLOC(finalobjlist, objliststruct, 1, status);
-  finalobjlist->obj = NULL;
-  finalobjlist->plist = NULL;
-  finalobjlist->nobj = finalobjlist->npix = 0;
-
+  /* fragments are copied to seamlist through single object list */
+  memset(&frag, 0, sizeof(objstruct));
+  fraglist.obj = &frag;
+  fraglist.nobj = 1;
 
   /* Allocate memory for the pixel list */
-  plistinit((conv != NULL), (image->noise_type != SEP_NOISE_NONE));
   if (!(pixel = objlist.plist = malloc(nposize=mem_pixstack*plistsize)))
     {
       status = MEMORY_ALLOC_ERROR;
@@ -349,7 +420,6 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   /*----- at the beginning, "free" object fills the whole pixel list */
   freeinfo.firstpix = 0;
   freeinfo.lastpix = nposize-plistsize;
-  printf("lastpix %d %d\n",freeinfo.lastpix,nposize);
   pixt = pixel;
   for (i=plistsize; i<nposize; i += plistsize, pixt += plistsize)
     PLIST(pixt, nextpix) = i;
@@ -380,14 +450,16 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
     }
 
   /*----- MAIN LOOP ------ */
-  for (yl=0; yl<=h; yl++)
+  for (yl=y0; yl<=y1; yl++)
     {
+      if ((status = waitrows(jobs, yl + bufh/2 + 1)) != RETURN_OK)
+	goto exit;
 
       ps = COMPLETE;
       cs = NONOBJECT;
-    
+
       /* Need an empty line for Lutz' algorithm to end gracely */
-      if (yl==h)
+      if (yl==y1)
 	{
 	  if (conv)
 	    {
@@ -395,6 +467,11 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 	      cdscan = NULL;
 	    }
 	  cdscan = dummyscan;
+
+	  /* threshold of objects completed at the seam is the same as
+	   * in the next strip */
+	  if (isvarnoise && y1 < h)
+	    arraybuffer_readline(&nbuf);
 	}
 
       else
@@ -428,11 +505,11 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 	  else
 	    {
 	      cdscan = scan;
-	    }	  
+	    }
 	}
-      
+
       trunflag = (yl==0 || yl==h-1)? SEP_OBJ_TRUNC: 0;
-      
+
       for (xl=0; xl<=w; xl++)
 	{
 	  if (xl == w)
@@ -462,7 +539,7 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
               status = UNKNOWN_NOISE_TYPE;
               goto exit;
             }
-            
+
             /* set `thresh` (This is needed later, even
              * if filter_type is SEP_FILTER_MATCHED */
             if (isvarthresh) thresh = relthresh * pixsig;
@@ -479,14 +556,14 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 	      /* flag the current object if we're near the image bounds */
 	      if (xl==0 || xl==w-1)
 		curpixinfo.flag |= SEP_OBJ_TRUNC;
-	      
+
 	      /* point pixt to first free pixel in pixel list */
 	      /* and increment the "first free pixel" */
 	      pixt = pixel + (cn=freeinfo.firstpix);
 	      freeinfo.firstpix = PLIST(pixt, nextpix);
 	      curpixinfo.lastpix = curpixinfo.firstpix = cn;
 
-	      /* set values for the new pixel */ 
+	      /* set values for the new pixel */
 	      PLIST(pixt, nextpix) = -1;
 	      PLIST(pixt, x) = xl;
 	      PLIST(pixt, y) = yl;
@@ -532,7 +609,7 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 		      goto exit;
 		    }
 
-		  /* set next free pixel to the start of the new block 
+		  /* set next free pixel to the start of the new block
 		   * and link up all the pixels in the new block */
 		  PLIST(pixel+freeinfo.firstpix, nextpix) = oldnposize;
 		  pixt = pixel + oldnposize;
@@ -618,15 +695,41 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 		    {
 		      if (start[co] == UNKNOWN)
 			{
-			  if ((int)info[co].pixnb >= minarea)
+			  if ((ytop >= 0 || ybottom >= 0) &&
+			      onseam(pixel, &info[co], ytop, ybottom))
+			    {
+			      /* keep fragment for merging, regardless
+			       * of its size */
+			      frag.firstpix = info[co].firstpix;
+			      frag.lastpix = info[co].lastpix;
+			      frag.fdnpix = info[co].pixnb;
+			      frag.flag = info[co].flag;
+			      frag.thresh = thresh;
+			      fraglist.plist = pixel;
+			      nobj = strip->seamlist.nobj;
+			      status = addobjdeep(0, &fraglist,
+						  &strip->seamlist);
+			      if (status == RETURN_OK)
+				status = setkeys(&strip->seamkeys, nobj,
+						 strip->seamlist.nobj,
+						 yl*(w+1)+xl);
+			      if (status != RETURN_OK)
+				goto exit;
+			    }
+			  else if ((int)info[co].pixnb >= minarea)
 			    {
 			      /* update threshold before object is processed */
 			      objlist.thresh = thresh;
 
-			      status = sortit(&info[co], &objlist, minarea,
-					      finalobjlist,
-					      deblend_nthresh,deblend_cont,
-                                              image->gain);
+			      nobj = finalobjlist->nobj;
+			      status = sortit(ctx, &info[co], &objlist,
+					      minarea, finalobjlist,
+					      jobs->deblend_nthresh,
+					      jobs->deblend_cont, image->gain);
+			      if (status == RETURN_OK)
+				status = setkeys(&strip->keys, nobj,
+						 finalobjlist->nobj,
+						 yl*(w+1)+xl);
 			      if (status != RETURN_OK)
 				goto exit;
 			    }
@@ -674,14 +777,359 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 
     } /*---------------- End of the loop over the y's -----------------------*/
 
+  /* threshold used for cleaning */
+  strip->lastthresh = thresh;
+
+ exit:
+  free(pixel);
+  free(info);
+  free(store);
+  free(marker);
+  free(dummyscan);
+  free(psstack);
+  free(start);
+  free(end);
+  arraybuffer_free(&dbuf);
+  arraybuffer_free(&nbuf);
+  arraybuffer_free(&mbuf);
+  free(convnorm);
+  free(sigscan);
+  free(workscan);
+
+  /* free cdscan if we didn't do it on the last `yl` line */
+  if ((cdscan != NULL) && (cdscan != dummyscan) && (cdscan != scan))
+    free(cdscan);
+
+  return status;
+}
+
+/***************************** extract_worker ********************************/
+/*
+Extract strips until all are done or an error occurs.
+*/
+void *extract_worker(void *arg)
+{
+  extractjobs	*jobs = (extractjobs *)arg;
+  deblendctx	ctx;
+  int		s, status;
+
+  plistinit((jobs->conv != NULL), (jobs->image->noise_type != SEP_NOISE_NONE));
+  status = allocdeblend(jobs->deblend_nthresh, jobs->image->w,
+			jobs->image->h, &ctx);
+
+  while (status == RETURN_OK)
+    {
+      pthread_mutex_lock(&jobs->lock);
+      if (jobs->status != RETURN_OK)
+	s = jobs->nstrips;
+      else
+	s = jobs->nextstrip++;
+      pthread_mutex_unlock(&jobs->lock);
+      if (s >= jobs->nstrips)
+	break;
+
+      status = extract_strip(jobs, &ctx, jobs->strips + s);
+    }
+
+  /* pass first error and its detail to calling thread */
+  if (status != RETURN_OK)
+    {
+      pthread_mutex_lock(&jobs->lock);
+      if (jobs->status == RETURN_OK)
+	{
+	  jobs->status = status;
+	  sep_get_errdetail(jobs->errdetail);
+	}
+      pthread_mutex_unlock(&jobs->lock);
+    }
+
+  freedeblend(&ctx);
+  return NULL;
+}
+
+/* union-find root of fragment */
+static int fragroot(int *parent, int i)
+{
+  while (parent[i] != i)
+    i = parent[i] = parent[parent[i]];
+  return i;
+}
+
+static int cmporder(const void *p1, const void *p2)
+{
+  const objorder *o1 = (const objorder *)p1, *o2 = (const objorder *)p2;
+
+  if (o1->key != o2->key)
+    return o1->key < o2->key ? -1 : 1;
+  return o1->seq - o2->seq;
+}
+
+/****************************** merge_strips *********************************/
+/*
+Merge fragments of objects crossing strip seams, deblend and analyse them,
+and put all objects into finalobjlist, in the order in which they would be
+completed by extraction of the whole image.
+*/
+static int merge_strips(extractjobs *jobs, deblendctx *ctx,
+			objliststruct *finalobjlist)
+{
+  objliststruct	frags, merged, objlist, mlist, chain;
+  objstruct	mobj;
+  extractstrip	*strip;
+  infostruct	*minfo;
+  pliststruct	*pixt;
+  objorder	*order;
+  PIXTYPE	*mthresh;
+  int		*parent, *first, *fragkeys, *mkeys, *mergedkeys, *upper, *lower;
+  int		*submap;
+  int		w, s, i, j, x, dx, r, nfrag, nobj, norder, status,
+		subx, suby, subw, subh;
+
+  status = RETURN_OK;
+  w = jobs->image->w;
+  memset(&frags, 0, sizeof(objliststruct));
+  memset(&merged, 0, sizeof(objliststruct));
+  memset(&chain, 0, sizeof(objliststruct));
+  submap = NULL;
+  minfo = NULL;
+  order = NULL;
+  mthresh = NULL;
+  parent = first = fragkeys = mkeys = mergedkeys = upper = lower = NULL;
+
+  /* put all fragments into single list */
+  QMALLOC(first, int, jobs->nstrips + 1, status);
+  nfrag = 0;
+  for (s=0; s<jobs->nstrips; s++)
+    {
+      first[s] = nfrag;
+      nfrag += jobs->strips[s].seamlist.nobj;
+    }
+  first[jobs->nstrips] = nfrag;
+
+  if (nfrag)
+    {
+      QMALLOC(fragkeys, int, nfrag, status);
+      QMALLOC(parent, int, nfrag, status);
+      QMALLOC(minfo, infostruct, nfrag, status);
+      QMALLOC(mthresh, PIXTYPE, nfrag, status);
+      QMALLOC(mkeys, int, nfrag, status);
+    }
+  for (s=0; s<jobs->nstrips; s++)
+    {
+      strip = jobs->strips + s;
+      for (i=0; i<strip->seamlist.nobj; i++)
+	{
+	  if ((status = addobjdeep(i, &strip->seamlist, &frags)) != RETURN_OK)
+	    goto exit;
+	  fragkeys[first[s]+i] = strip->seamkeys[i];
+	}
+    }
+  for (i=0; i<nfrag; i++)
+    parent[i] = i;
+
+  /* join fragments with 8-connected pixels on the two rows of each seam */
+  QMALLOC(upper, int, w, status);
+  QMALLOC(lower, int, w, status);
+  for (s=0; s<jobs->nstrips-1; s++)
+    {
+      for (x=0; x<w; x++)
+	upper[x] = lower[x] = -1;
+      for (i=first[s]; i<first[s+2]; i++)
+	for (pixt=frags.plist+frags.obj[i].firstpix; pixt>=frags.plist;
+	     pixt=frags.plist+PLIST(pixt,nextpix))
+	  {
+	    if (i < first[s+1] && PLIST(pixt,y) == jobs->strips[s].y1-1)
+	      upper[PLIST(pixt,x)] = i;
+	    else if (i >= first[s+1] && PLIST(pixt,y) == jobs->strips[s].y1)
+	      lower[PLIST(pixt,x)] = i;
+	  }
+      for (x=0; x<w; x++)
+	{
+	  if (upper[x] < 0)
+	    continue;
+	  for (dx=-1; dx<=1; dx++)
+	    if (x+dx >= 0 && x+dx < w && lower[x+dx] >= 0)
+	      {
+		i = fragroot(parent, upper[x]);
+		j = fragroot(parent, lower[x+dx]);
+		if (i < j)
+		  parent[j] = i;
+		else
+		  parent[i] = j;
+	      }
+	}
+    }
+
+  /* chain pixels of fragments; merged object takes threshold and position
+   * in the list from its last completed fragment */
+  for (i=0; i<nfrag; i++)
+    {
+      r = fragroot(parent, i);
+      if (r == i)
+	{
+	  minfo[r].firstpix = frags.obj[i].firstpix;
+	  minfo[r].pixnb = 0;
+	  minfo[r].flag = 0;
+	  mkeys[r] = -1;
+	}
+      else
+	PLIST(frags.plist+minfo[r].lastpix, nextpix) = frags.obj[i].firstpix;
+      minfo[r].lastpix = frags.obj[i].lastpix;
+      minfo[r].pixnb += frags.obj[i].fdnpix;
+      minfo[r].flag |= frags.obj[i].flag;
+      if (fragkeys[i] > mkeys[r])
+	{
+	  mkeys[r] = fragkeys[i];
+	  mthresh[r] = frags.obj[i].thresh;
+	}
+    }
+
+  for (r=0; r<nfrag; r++)
+    {
+      if (parent[r] != r || (int)minfo[r].pixnb < jobs->minarea)
+	continue;
+
+      /* order of pixels in the chain affects some measurements
+       * (analysemthresh()); rescan the merged object with lutz() to get
+       * the same order as from extraction of the whole image */
+      memset(&mobj, 0, sizeof(objstruct));
+      mobj.firstpix = minfo[r].firstpix;
+      mobj.lastpix = minfo[r].lastpix;
+      mlist.obj = &mobj;
+      mlist.nobj = 1;
+      mlist.plist = frags.plist;
+      preanalyse(0, &mlist);
+      if (!(submap = createsubmap(&mlist, 0, &subx, &suby, &subw, &subh)))
+	{
+	  status = MEMORY_ALLOC_ERROR;
+	  goto exit;
+	}
+      chain.thresh = -BIG;
+      chain.npix = 0;
+      status = lutz(&ctx->lutz, frags.plist, submap, subx, suby, subw, &mobj,
+		    &chain, 1);
+      free(submap);
+      submap = NULL;
+      if (status != RETURN_OK)
+	goto exit;
+      minfo[r].firstpix = chain.obj[0].firstpix;
+      minfo[r].lastpix = chain.obj[0].lastpix;
+
+      objlist.plist = chain.plist;
+      objlist.thresh = mthresh[r];
+      nobj = merged.nobj;
+      status = sortit(ctx, &minfo[r], &objlist, jobs->minarea, &merged,
+		      jobs->deblend_nthresh, jobs->deblend_cont,
+		      jobs->image->gain);
+      if (status == RETURN_OK)
+	status = setkeys(&mergedkeys, nobj, merged.nobj, mkeys[r]);
+      if (status != RETURN_OK)
+	goto exit;
+    }
+
+  /* order objects from all strips by their completion */
+  norder = merged.nobj;
+  for (s=0; s<jobs->nstrips; s++)
+    norder += jobs->strips[s].objlist.nobj;
+  QMALLOC(order, objorder, norder, status);
+  norder = 0;
+  for (s=0; s<=jobs->nstrips; s++)
+    {
+      objliststruct *ol = s < jobs->nstrips ? &jobs->strips[s].objlist : &merged;
+      int *keys = s < jobs->nstrips ? jobs->strips[s].keys : mergedkeys;
+      for (i=0; i<ol->nobj; i++, norder++)
+	{
+	  order[norder].key = keys[i];
+	  order[norder].seq = norder;
+	  order[norder].objlist = ol;
+	  order[norder].objnb = i;
+	}
+    }
+  qsort(order, norder, sizeof(objorder), cmporder);
+
+  for (i=0; i<norder; i++)
+    if ((status = addobjdeep(order[i].objnb, order[i].objlist, finalobjlist))
+	!= RETURN_OK)
+      goto exit;
+
+ exit:
+  free(frags.obj);
+  free(frags.plist);
+  free(merged.obj);
+  free(merged.plist);
+  free(chain.obj);
+  free(chain.plist);
+  free(minfo);
+  free(order);
+  free(mthresh);
+  free(parent);
+  free(first);
+  free(fragkeys);
+  free(mkeys);
+  free(mergedkeys);
+  free(upper);
+  free(lower);
+  return status;
+}
+
+/****************************** extract **************************************/
+int sep_extract(sep_image *image, float thresh, int thresh_type,
+                int minarea, float *conv, int convw, int convh,
+		int filter_type, int deblend_nthresh, double deblend_cont,
+		int clean_flag, double clean_param,
+		sep_catalog **catalog)
+{
+  return sep_extract_tiled(image, thresh, thresh_type, minarea, conv, convw,
+			   convh, filter_type, deblend_nthresh, deblend_cont,
+			   clean_flag, clean_param, 1, catalog);
+}
+
+/***************************** collect_strips ********************************/
+/*
+Merge extracted strips, clean them and convert them to the output catalog.
+*/
+int collect_strips(extractjobs *jobs, int clean_flag, double clean_param,
+		   sep_catalog **catalog)
+{
+  deblendctx        ctx;
+  objliststruct     *finalobjlist;
+  int               *survives;
+  int               s, status;
+  sep_catalog       *cat;
+
+  status = RETURN_OK;
+  finalobjlist = NULL;
+  survives = NULL;
+  cat = NULL;
+  memset(&ctx, 0, sizeof(deblendctx));
+
+  /* pixel list layout of this thread is used below */
+  plistinit((jobs->conv != NULL), (jobs->image->noise_type != SEP_NOISE_NONE));
+
+  /* Init finalobjlist */
+  if (jobs->nstrips == 1)
+    {
+      finalobjlist = &jobs->strips[0].objlist;
+    }
+  else
+    {
+      QCALLOC(finalobjlist, objliststruct, 1, status);
+      if ((status = allocdeblend(jobs->deblend_nthresh, jobs->image->w,
+				 jobs->image->h, &ctx)) != RETURN_OK)
+	goto exit;
+      if ((status = merge_strips(jobs, &ctx, finalobjlist)) != RETURN_OK)
+	goto exit;
+    }
+
   /* convert `finalobjlist` to an array of `sepobj` structs */
   /* if cleaning, see which objects "survive" cleaning. */
   if (clean_flag)
     {
       /* Calculate mthresh for all objects in the list (needed for cleaning) */
-      for (i=0; i<finalobjlist->nobj; i++)
+      for (s=0; s<finalobjlist->nobj; s++)
 	{
-	  status = analysemthresh(i, finalobjlist, minarea, thresh);
+	  status = analysemthresh(s, finalobjlist, jobs->minarea,
+				  jobs->strips[jobs->nstrips-1].lastthresh);
 	  if (status != RETURN_OK)
 	    goto exit;
 	}
@@ -692,42 +1140,21 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
 
   /* convert to output catalog */
   QCALLOC(cat, sep_catalog, 1, status);
-  status = convert_to_catalog(finalobjlist, survives, cat, w, 1);
+  status = convert_to_catalog(finalobjlist, survives, cat, jobs->image->w, 1);
   if (status != RETURN_OK) goto exit;
 
  exit:
-  free(finalobjlist->obj);
-  free(finalobjlist->plist);
-  free(finalobjlist);
-  freedeblend();
-  free(pixel);
-  lutzfree();
-  free(info);
-  free(store);
-  free(marker);
-  free(dummyscan);
-  free(psstack);
-  free(start);
-  free(end);
-  free(survives);
-  arraybuffer_free(&dbuf);
-  if (image->noise)
-    arraybuffer_free(&nbuf);
-  if (image->mask)
-    arraybuffer_free(&mbuf);
-  if (conv)
-    free(convnorm);
-  if (filter_type == SEP_FILTER_MATCHED)
+  if (finalobjlist && jobs->nstrips > 1)
     {
-      free(sigscan);
-      free(workscan);
+      free(finalobjlist->obj);
+      free(finalobjlist->plist);
+      free(finalobjlist);
     }
+  freedeblend(&ctx);
+  free(survives);
 
   if (status != RETURN_OK)
     {
-      /* free cdscan if we didn't do it on the last `yl` line */
-      if ((cdscan != NULL) && (cdscan != dummyscan))
-        free(cdscan);
       /* clean up catalog if it was allocated */
       sep_catalog_free(cat);
       cat = NULL;
@@ -737,20 +1164,109 @@ int sep_extract(sep_image *image, float thresh, int thresh_type,
   return status;
 }
 
+/* free objects of extracted strips */
+void free_strips(extractjobs *jobs)
+{
+  int s;
+
+  if (jobs->strips)
+    for (s=0; s<jobs->nstrips; s++)
+      {
+	free(jobs->strips[s].objlist.obj);
+	free(jobs->strips[s].objlist.plist);
+	free(jobs->strips[s].keys);
+	free(jobs->strips[s].seamlist.obj);
+	free(jobs->strips[s].seamlist.plist);
+	free(jobs->strips[s].seamkeys);
+      }
+  free(jobs->strips);
+  jobs->strips = NULL;
+}
+
+int sep_extract_tiled(sep_image *image, float thresh, int thresh_type,
+		      int minarea, float *conv, int convw, int convh,
+		      int filter_type, int deblend_nthresh,
+		      double deblend_cont, int clean_flag, double clean_param,
+		      int ntiles, sep_catalog **catalog)
+{
+  extractjobs       jobs;
+  pthread_t         *threads;
+  int               s, t, nthreads, status;
+
+  status = RETURN_OK;
+  threads = NULL;
+  *catalog = NULL;
+
+  /* strips are at least one line high */
+  if (ntiles > image->h)
+    ntiles = image->h;
+  if (ntiles < 1)
+    ntiles = 1;
+
+  memset(&jobs, 0, sizeof(extractjobs));
+  jobs.image = image;
+  jobs.thresh = thresh;
+  jobs.thresh_type = thresh_type;
+  jobs.minarea = minarea;
+  jobs.conv = conv;
+  jobs.convw = convw;
+  jobs.convh = convh;
+  jobs.filter_type = filter_type;
+  jobs.deblend_nthresh = deblend_nthresh;
+  jobs.deblend_cont = deblend_cont;
+  jobs.nstrips = ntiles;
+  jobs.status = RETURN_OK;
+  pthread_mutex_init(&jobs.lock, NULL);
+
+  QCALLOC(jobs.strips, extractstrip, ntiles, status);
+  for (s=0; s<ntiles; s++)
+    {
+      jobs.strips[s].y0 = (int)((long)image->h * s / ntiles);
+      jobs.strips[s].y1 = (int)((long)image->h * (s + 1) / ntiles);
+    }
+
+  /* the calling thread extracts strips as well */
+  nthreads = sep_get_threads();
+  if (nthreads > ntiles)
+    nthreads = ntiles;
+  if (nthreads > 1)
+    QMALLOC(threads, pthread_t, nthreads - 1, status);
+  for (t=0; t<nthreads-1; t++)
+    if (pthread_create(threads+t, NULL, extract_worker, &jobs))
+      break;
+  extract_worker(&jobs);
+  while (t--)
+    pthread_join(threads[t], NULL);
+
+  if ((status = jobs.status) != RETURN_OK)
+    {
+      put_errdetail(jobs.errdetail);
+      goto exit;
+    }
+
+  status = collect_strips(&jobs, clean_flag, clean_param, catalog);
+
+ exit:
+  free(threads);
+  free_strips(&jobs);
+  pthread_mutex_destroy(&jobs.lock);
+  return status;
+}
+
 
 /********************************* sortit ************************************/
 /*
 build the object structure.
 */
-int sortit(infostruct *info, objliststruct *objlist, int minarea,
-	   objliststruct *finalobjlist,
+int sortit(deblendctx *ctx, infostruct *info, objliststruct *objlist,
+	   int minarea, objliststruct *finalobjlist,
 	   int deblend_nthresh, double deblend_mincont, double gain)
 {
   objliststruct	        objlistout, *objlist2;
-  static objstruct	obj;
+  objstruct		obj;
   int 			i, status;
 
-  status=RETURN_OK;  
+  status=RETURN_OK;
   objlistout.obj = NULL;
   objlistout.plist = NULL;
   objlistout.nobj = objlistout.npix = 0;
@@ -768,8 +1284,8 @@ int sortit(infostruct *info, objliststruct *objlist, int minarea,
 
   preanalyse(0, objlist);
 
-  status = deblend(objlist, 0, &objlistout, deblend_nthresh, deblend_mincont,
-		   minarea);
+  status = deblend(ctx, objlist, 0, &objlistout, deblend_nthresh,
+		   deblend_mincont, minarea);
   if (status)
     {
       /* formerly, this wasn't a fatal error, so a flag was set for
@@ -1092,8 +1608,6 @@ int convert_to_catalog(objliststruct *objlist, int *survives,
   QMALLOC(cat->ycpeak, int, nobj, status);
   QMALLOC(cat->xpeak, int, nobj, status);
   QMALLOC(cat->ypeak, int, nobj, status);
-  QMALLOC(cat->cflux, float, nobj, status);
-  QMALLOC(cat->flux, float, nobj, status);
   QMALLOC(cat->flag, short, nobj, status);
 
   /* fill output arrays */
@@ -34,43 +34,35 @@
 
 void lutzsort(infostruct *, objliststruct *);
 
-/*------------------------- Static buffers for lutz() -----------------------*/
-
-static infostruct  *info=NULL, *store=NULL;
-static char	   *marker=NULL;
-static pixstatus   *psstack=NULL;
-static int         *start=NULL, *end=NULL, *discan=NULL;
-static int         xmin, ymin, xmax, ymax;
-
-
 /******************************* lutzalloc ***********************************/
 /*
 Allocate once for all memory space for buffers used by lutz().
 */
-int lutzalloc(int width, int height)
+int lutzalloc(int width, int height, lutzbuffers *b)
 {
   int *discant;
   int stacksize, i, status=RETURN_OK;
 
+  memset(b, 0, sizeof(lutzbuffers));
   stacksize = width+1;
-  xmin = ymin = 0;
-  xmax = width-1;
-  ymax = height-1;
-  QMALLOC(info, infostruct, stacksize, status);
-  QMALLOC(store, infostruct, stacksize, status);
-  QMALLOC(marker, char, stacksize, status);
-  QMALLOC(psstack, pixstatus, stacksize, status);
-  QMALLOC(start, int, stacksize, status);
-  QMALLOC(end, int, stacksize, status);
-  QMALLOC(discan, int, stacksize, status);
-  discant = discan;
+  b->xmin = b->ymin = 0;
+  b->xmax = width-1;
+  b->ymax = height-1;
+  QMALLOC(b->info, infostruct, stacksize, status);
+  QMALLOC(b->store, infostruct, stacksize, status);
+  QMALLOC(b->marker, char, stacksize, status);
+  QMALLOC(b->psstack, pixstatus, stacksize, status);
+  QMALLOC(b->start, int, stacksize, status);
+  QMALLOC(b->end, int, stacksize, status);
+  QMALLOC(b->discan, int, stacksize, status);
+  discant = b->discan;
   for (i=stacksize; i--;)
     *(discant++) = -1;
 
   return status;
 
  exit:
-  lutzfree();
+  lutzfree(b);
 
   return status;
 }
@@ -79,22 +71,22 @@ int lutzalloc(int width, int height)
 /*
 Free once for all memory space for buffers used by lutz().
 */
-void lutzfree()
+void lutzfree(lutzbuffers *b)
 {
-  free(discan);
-  discan = NULL;
-  free(info);
-  info = NULL;
-  free(store);
-  store = NULL;
-  free(marker);
-  marker = NULL;
-  free(psstack);
-  psstack = NULL;
-  free(start);
-  start = NULL;
-  free(end);
-  end = NULL;
+  free(b->discan);
+  b->discan = NULL;
+  free(b->info);
+  b->info = NULL;
+  free(b->store);
+  b->store = NULL;
+  free(b->marker);
+  b->marker = NULL;
+  free(b->psstack);
+  b->psstack = NULL;
+  free(b->start);
+  b->start = NULL;
+  free(b->end);
+  b->end = NULL;
   return;
 }
 
@@ -104,11 +96,17 @@ void lutzfree()
 C implementation of R.K LUTZ' algorithm for the extraction of 8-connected pi-
 xels in an image
 */
-int lutz(pliststruct *plistin,
+int lutz(lutzbuffers *buffers, pliststruct *plistin,
 	 int *objrootsubmap, int subx, int suby, int subw,
 	 objstruct *objparent, objliststruct *objlist, int minarea)
 {
-  static infostruct	curpixinfo,initinfo;
+  infostruct		curpixinfo,initinfo;
+  infostruct		*info = buffers->info, *store = buffers->store;
+  char			*marker = buffers->marker;
+  pixstatus		*psstack = buffers->psstack;
+  int			*start = buffers->start, *end = buffers->end;
+  int			*discan = buffers->discan;
+  int			xmax = buffers->xmax, ymax = buffers->ymax;
   objstruct		*obj;
   pliststruct		*plist,*pixel, *plistint;
   
@@ -169,6 +167,7 @@ int lutz(pliststruct *plistin,
 
   objlist->nobj = 0;
   co = pstop = 0;
+  curpixinfo = initinfo;
   curpixinfo.pixnb = 1;
 
   for (yl=sty; yl<=eny; yl++, iscan += step)
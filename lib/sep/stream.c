@@ -0,0 +1,345 @@
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+*
+* This file is part of SEP
+*
+* Background estimation and source extraction of image received in chunks.
+*
+* SEP is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SEP is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SEP.  If not, see <http://www.gnu.org/licenses/>.
+*
+*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sep.h"
+#include "sepcore.h"
+#include "extract.h"
+
+/*
+Rows of background meshes are computed as soon as all their image rows are
+received. Background of an image row is subtracted once the filtered meshes
+around it no longer change with further rows; until the last row arrives,
+the spline is fitted only through the meshes received so far. The whole
+image is extracted as a single strip by a thread started with the stream,
+which waits for rows with subtracted background, so objects are found,
+deblended and ordered exactly as by sep_extract() of the same image.
+*/
+struct sep_stream
+{
+  sep_image	image;       /* background-subtracted image and its rms */
+  sep_image	raw;         /* same data, for background meshes */
+  array_converter convert;
+  int		elsize;
+  BYTE		carry[8];    /* bytes of incomplete pixel */
+  int		ncarry;
+  size_t	npix;        /* number of received pixels */
+  sep_bkg	*bkg;        /* meshes computed from received rows */
+  int		fw, fh;
+  double	fthresh;
+  int		meshrows;    /* rows of meshes computed */
+  int		subrows;     /* image rows with subtracted background */
+  PIXTYPE	*backline;
+  float		*conv;
+  extractjobs	jobs;
+  pthread_t	thread;      /* extraction thread */
+  int		running;
+  int		clean_flag;
+  double	clean_param;
+  int		rms_map;     /* noise is rms map, or global rms */
+  int		status;      /* first error, returned by later calls */
+};
+
+/* subtract background of rows st->subrows .. y1-1 */
+static int subtract_rows(sep_stream *st, sep_bkg *bkg, int y1)
+{
+  PIXTYPE *data, *rms;
+  int     w, x, y, status;
+  float   globalrms;
+
+  status = RETURN_OK;
+  w = st->image.w;
+  globalrms = sep_bkg_globalrms(bkg);
+  for (y=st->subrows; y<y1; y++)
+    {
+      data = (PIXTYPE *)st->image.data + (size_t)w*y;
+      rms = (PIXTYPE *)st->image.noise + (size_t)w*y;
+      status = sep_bkg_line(bkg, y, st->backline, PIXDTYPE);
+      if (status != RETURN_OK)
+	return status;
+      if (st->rms_map)
+	{
+	  if ((status = sep_bkg_rmsline(bkg, y, rms, PIXDTYPE)) != RETURN_OK)
+	    return status;
+	}
+      else
+	{
+	  for (x=0; x<w; x++)
+	    rms[x] = globalrms;
+	}
+      for (x=0; x<w; x++)
+	data[x] -= st->backline[x];
+    }
+  st->subrows = y1;
+
+  /* let extraction thread know about new rows */
+  pthread_mutex_lock(&st->jobs.lock);
+  st->jobs.rows = y1;
+  pthread_cond_broadcast(&st->jobs.rowscond);
+  pthread_mutex_unlock(&st->jobs.lock);
+  return status;
+}
+
+/* process all received rows which can be processed */
+static int stream_process(sep_stream *st)
+{
+  sep_bkg *part;
+  int     w, h, bh, jp, ystable, rows, status;
+
+  status = RETURN_OK;
+  part = NULL;
+  w = st->image.w;
+  h = st->image.h;
+  bh = st->bkg->bh;
+  rows = st->npix / w;
+
+  /* rows of meshes with all image rows received */
+  jp = rows >= h ? st->bkg->ny : rows / bh;
+  if (jp > st->meshrows)
+    {
+      status = bkg_meshrows(&st->raw, st->bkg, st->meshrows, jp);
+      if (status != RETURN_OK)
+	goto exit;
+      st->meshrows = jp;
+
+      if (jp == st->bkg->ny)
+	{
+	  if ((status = bkg_finish(st->bkg, st->fw, st->fh, st->fthresh))
+	      != RETURN_OK)
+	    goto exit;
+	  if ((status = subtract_rows(st, st->bkg, h)) != RETURN_OK)
+	    goto exit;
+	}
+      else
+	{
+	  /* nodes used for interpolation of ystable and earlier rows are
+	   * filtered over meshes already received */
+	  ystable = (2 * (jp - st->fh / 2) - 1) * bh / 2;
+	  if (ystable > st->subrows)
+	    {
+	      if ((status = bkg_alloc(w, jp * bh, st->bkg->bw, bh, &part))
+		  != RETURN_OK)
+		goto exit;
+	      memcpy(part->back, st->bkg->back, part->n * sizeof(float));
+	      memcpy(part->sigma, st->bkg->sigma, part->n * sizeof(float));
+	      if ((status = bkg_finish(part, st->fw, st->fh, st->fthresh))
+		  != RETURN_OK)
+		goto exit;
+	      if ((status = subtract_rows(st, part, ystable)) != RETURN_OK)
+		goto exit;
+	    }
+	}
+    }
+
+ exit:
+  sep_bkg_free(part);
+  return status;
+}
+
+int sep_stream_new(int w, int h, int dtype, int bw, int bh, int fw, int fh,
+		   double fthresh, float thresh, int minarea, float *conv,
+		   int convw, int convh, int filter_type, int deblend_nthresh,
+		   double deblend_cont, int clean_flag, double clean_param,
+		   int rms_map, sep_stream **stream)
+{
+  sep_stream *st;
+  PIXTYPE    *data, *rms;
+  int        status;
+
+  status = RETURN_OK;
+  data = rms = NULL;
+
+  QCALLOC(st, sep_stream, 1, status);
+  pthread_mutex_init(&st->jobs.lock, NULL);
+  pthread_cond_init(&st->jobs.rowscond, NULL);
+
+  if ((status = get_array_converter(dtype, &st->convert, &st->elsize))
+      != RETURN_OK)
+    goto exit;
+
+  QMALLOC(data, PIXTYPE, (size_t)w*h, status);
+  st->image.data = data;
+  QMALLOC(rms, PIXTYPE, (size_t)w*h, status);
+  st->image.noise = rms;
+  st->image.dtype = st->image.ndtype = PIXDTYPE;
+  st->image.w = w;
+  st->image.h = h;
+  st->image.noise_type = SEP_NOISE_STDDEV;
+  st->raw.data = data;
+  st->raw.dtype = PIXDTYPE;
+  st->raw.w = w;
+  st->raw.h = h;
+  st->raw.noise_type = SEP_NOISE_NONE;
+
+  if ((status = bkg_alloc(w, h, bw, bh, &st->bkg)) != RETURN_OK)
+    goto exit;
+  st->fw = fw;
+  st->fh = fh;
+  st->fthresh = fthresh;
+  QMALLOC(st->backline, PIXTYPE, w, status);
+
+  if (conv)
+    {
+      QMALLOC(st->conv, float, convw*convh, status);
+      memcpy(st->conv, conv, convw*convh*sizeof(float));
+    }
+
+  st->jobs.image = &st->image;
+  st->jobs.thresh = thresh;
+  st->jobs.thresh_type = SEP_THRESH_REL;
+  st->jobs.minarea = minarea;
+  st->jobs.conv = st->conv;
+  st->jobs.convw = convw;
+  st->jobs.convh = convh;
+  st->jobs.filter_type = filter_type;
+  st->jobs.deblend_nthresh = deblend_nthresh;
+  st->jobs.deblend_cont = deblend_cont;
+  st->jobs.nstrips = 1;
+  st->jobs.status = RETURN_OK;
+  st->jobs.stream = 1;
+  QCALLOC(st->jobs.strips, extractstrip, 1, status);
+  st->jobs.strips[0].y0 = 0;
+  st->jobs.strips[0].y1 = h;
+
+  st->clean_flag = clean_flag;
+  st->clean_param = clean_param;
+  st->rms_map = rms_map;
+
+  /* if the thread cannot be started, the image is extracted in
+   * sep_stream_finish() */
+  st->running = !pthread_create(&st->thread, NULL, extract_worker, &st->jobs);
+
+  *stream = st;
+  return status;
+
+ exit:
+  sep_stream_free(st);
+  *stream = NULL;
+  return status;
+}
+
+int sep_stream_add(sep_stream *st, void *data, size_t size)
+{
+  BYTE   *ptr;
+  size_t total, n;
+
+  if (st->status != RETURN_OK)
+    return st->status;
+
+  ptr = (BYTE *)data;
+  total = (size_t)st->image.w * st->image.h;
+
+  /* finish pixel split between chunks */
+  if (st->ncarry)
+    {
+      n = st->elsize - st->ncarry;
+      if (n > size)
+	n = size;
+      memcpy(st->carry + st->ncarry, ptr, n);
+      st->ncarry += n;
+      ptr += n;
+      size -= n;
+      if (st->ncarry < st->elsize)
+	return RETURN_OK;
+      if (st->npix < total)
+	st->convert(st->carry, 1, (PIXTYPE *)st->image.data + st->npix++);
+      st->ncarry = 0;
+    }
+
+  n = size / st->elsize;
+  if (n > total - st->npix)
+    n = total - st->npix;
+  st->convert(ptr, n, (PIXTYPE *)st->image.data + st->npix);
+  st->npix += n;
+  ptr += n * st->elsize;
+  size -= n * st->elsize;
+  if (size > 0 && st->npix < total)
+    {
+      memcpy(st->carry, ptr, size);
+      st->ncarry = size;
+    }
+
+  return st->status = stream_process(st);
+}
+
+int sep_stream_finish(sep_stream *st, sep_catalog **catalog)
+{
+  *catalog = NULL;
+  if (st->status != RETURN_OK)
+    return st->status;
+  if (st->npix < (size_t)st->image.w * st->image.h)
+    return st->status = STREAM_INCOMPLETE;
+
+  if (st->running)
+    pthread_join(st->thread, NULL);
+  else
+    extract_worker(&st->jobs);
+  st->running = 0;
+  if ((st->status = st->jobs.status) != RETURN_OK)
+    {
+      put_errdetail(st->jobs.errdetail);
+      return st->status;
+    }
+
+  return st->status = collect_strips(&st->jobs, st->clean_flag,
+				     st->clean_param, catalog);
+}
+
+sep_image *sep_stream_image(sep_stream *st)
+{
+  return &st->image;
+}
+
+sep_bkg *sep_stream_bkg(sep_stream *st)
+{
+  return st->bkg;
+}
+
+void sep_stream_free(sep_stream *st)
+{
+  if (st == NULL)
+    return;
+
+  /* stop extraction thread waiting for rows */
+  if (st->running)
+    {
+      pthread_mutex_lock(&st->jobs.lock);
+      if (st->jobs.status == RETURN_OK)
+	st->jobs.status = STREAM_INCOMPLETE;
+      pthread_cond_broadcast(&st->jobs.rowscond);
+      pthread_mutex_unlock(&st->jobs.lock);
+      pthread_join(st->thread, NULL);
+    }
+
+  free_strips(&st->jobs);
+  pthread_cond_destroy(&st->jobs.rowscond);
+  pthread_mutex_destroy(&st->jobs.lock);
+  free(st->image.data);
+  free(st->image.noise);
+  sep_bkg_free(st->bkg);
+  free(st->backline);
+  free(st->conv);
+  free(st);
+}
@@ -26,7 +26,21 @@
 #define DETAILSIZE 512
 
 char *sep_version_string = "0.6.0";
-static char _errdetail_buffer[DETAILSIZE] = "";
+static SEP_TLS char _errdetail_buffer[DETAILSIZE] = "";
+static int _nthreads = 1;
+
+/****************************************************************************/
+/* number of threads used by sep_background() and sep_extract_tiled() */
+
+void sep_set_threads(int n)
+{
+  _nthreads = n < 1 ? 1 : n;
+}
+
+int sep_get_threads(void)
+{
+  return _nthreads;
+}
 
 /****************************************************************************/
 /* data type conversion mechanics for runtime type conversion */
@@ -56,6 +70,11 @@ PIXTYPE convert_uint16(void *ptr)
   return *(uint16_t *)ptr;
 }
 
+PIXTYPE convert_int16(void *ptr)
+{
+  return *(int16_t *)ptr;
+}
+
 /* return the correct converter depending on the datatype code */
 int get_converter(int dtype, converter *f, int *size)
 {
@@ -76,6 +95,11 @@ int get_converter(int dtype, converter *f, int *size)
       *f = convert_uint16;
       *size = sizeof(uint16_t);
     }
+  else if (dtype == SEP_TINT16)
+    {
+      *f = convert_int16;
+      *size = sizeof(int16_t);
+    }
   else if (dtype == SEP_TDOUBLE)
     {
       *f = convert_dbl;
@@ -128,6 +152,14 @@ void convert_array_uint16(void *ptr, int n, PIXTYPE *target)
     target[i] = *source;
 }
 
+void convert_array_int16(void *ptr, int n, PIXTYPE *target)
+{
+  int16_t *source = (int16_t *)ptr;
+  int i;
+  for (i=0; i<n; i++, source++)
+    target[i] = *source;
+}
+
 void convert_array_byt(void *ptr, int n, PIXTYPE *target)
 {
   BYTE *source = (BYTE *)ptr;
@@ -160,6 +192,11 @@ int get_array_converter(int dtype, array_converter *f, int *size)
       *f = convert_array_uint16;
       *size = sizeof(uint16_t);
     }
+  else if (dtype == SEP_TINT16)
+    {
+      *f = convert_array_int16;
+      *size = sizeof(int16_t);
+    }
   else if (dtype == SEP_TDOUBLE)
     {
       *f = convert_array_dbl;
@@ -202,6 +239,14 @@ void write_array_uint16(float *ptr, int n, void *target)
     t[i] = (uint16_t)(*ptr+0.5);
 }
 
+void write_array_int16(float *ptr, int n, void *target)
+{
+  int16_t *t = (int16_t *)target;
+  int i;
+  for (i=0; i<n; i++, ptr++)
+    t[i] = (int16_t)(*ptr+0.5);
+}
+
 /* return the correct writer depending on the datatype code */
 int get_array_writer(int dtype, array_writer *f, int *size)
 {
@@ -217,6 +262,11 @@ int get_array_writer(int dtype, array_writer *f, int *size)
       *f = write_array_uint16;
       *size = sizeof(uint16_t);
     }
+  else if (dtype == SEP_TINT16)
+    {
+      *f = write_array_int16;
+      *size = sizeof(int16_t);
+    }
   else if (dtype == SEP_TDOUBLE)
     {
       *f = write_array_dbl;
@@ -265,6 +315,14 @@ void subtract_array_uint16(float *ptr, int n, void *target)
     t[i] -= (uint16_t)(*ptr+0.5);
 }
 
+void subtract_array_int16(float *ptr, int n, void *target)
+{
+  int16_t *t = (int16_t *)target;
+  int i;
+  for (i=0; i<n; i++, ptr++)
+    t[i] -= (int16_t)(*ptr+0.5);
+}
+
 /* return the correct subtractor depending on the datatype code */
 int get_array_subtractor(int dtype, array_writer *f, int *size)
 {
@@ -286,6 +344,11 @@ int get_array_subtractor(int dtype, array_writer *f, int *size)
       *f = subtract_array_uint16;
       *size = sizeof(uint16_t);
     }
+  else if (dtype == SEP_TINT16)
+    {
+      *f = subtract_array_int16;
+      *size = sizeof(int16_t);
+    }
   else if (dtype == SEP_TDOUBLE)
     {
       *f = subtract_array_dbl;
@@ -346,6 +409,9 @@ void sep_get_errmsg(int status, char *errtext)
     case UNKNOWN_NOISE_TYPE:
       strcpy(errtext, "image has unknown noise_type");
       break;
+    case STREAM_INCOMPLETE:
+      strcpy(errtext, "stream finished before all image rows were received");
+      break;
     default:
        strcpy(errtext, "unknown error status");
        break;
@@ -35,8 +35,6 @@ int UCAC5Bands::openBand(const char *bfn)
 
 	if (dataSize != (size_t) (8 * total_dec * total_ra))
 		return -1;
-	
-	dataSize /= 2;
 
 	data = (uint32_t*) mmap(NULL, dataSize, PROT_READ, MAP_SHARED, fd, 0);
 	if (data == MAP_FAILED)
@@ -61,41 +59,38 @@ int UCAC5Bands::nextBand(double ra, double dec, double radius, uint16_t &dec_b,
 	}
 
 	double r_cd = radius / cd;
+	// RA bins are clamped to 0h..24h, cone crossing 0h is not wrapped
+	int ra_first = floor((total_ra / 2) * (ra - r_cd) / M_PI);
+	int ra_last = floor((total_ra / 2) * (ra + r_cd) / M_PI);
+	if (ra_first < 0)
+		ra_first = 0;
+	if (ra_last >= total_ra)
+		ra_last = total_ra - 1;
 	// has to change dec_b
 	if (dec - (dec_b * M_PI / total_dec  - M_PI / 2.0) > radius + M_PI / total_dec)
 	{
-		dec_b = floor(total_dec * (dec + M_PI / 2.0 - radius) / M_PI);
-		if (dec_b < 0)
-			dec_b = 0;
-		if (dec_b >= total_dec)
-			return -1;
-
-		ra_b = floor((total_ra / 2) * (ra - r_cd) / M_PI);
-		if (ra_b < 0)
-			ra_b = 0;
-		else if (ra_b >= total_ra)
+		int db = floor(total_dec * (dec + M_PI / 2.0 - radius) / M_PI);
+		if (db < 0)
+			db = 0;
+		if (db >= total_dec || ra_first > ra_last)
 			return -1;
+		dec_b = db;
+		ra_b = ra_first;
 	}
 	else
 	{
 		ra_b++;
 		// next band...
-		if (ra_b > floor((total_ra / 2) * (ra + r_cd) / M_PI))
+		if (ra_b > ra_last)
 		{
 			dec_b++;
-			if (dec_b > floor(total_dec * (dec + M_PI / 2.0 + radius) / M_PI))
-				return -1;
-			ra_b = floor((total_ra / 2) * (ra - r_cd) / M_PI);
-			if (ra_b < 0)
-				ra_b = 0;
-			else if (ra_b >= total_ra)
+			if (dec_b >= total_dec || dec_b > floor(total_dec * (dec + M_PI / 2.0 + radius) / M_PI))
 				return -1;
+			ra_b = ra_first;
 		}
 	}
 	ra_start = data[ra_b * total_dec + dec_b];
-	if (ra_b == total_ra)
-		len = -1;
-	else
-		len = data[(ra_b + 1) * total_dec + dec_b] - ra_start;
+	// number of stars in bin is stored in the second half of the index
+	len = data[total_dec * total_ra + ra_b * total_dec + dec_b];
 	return 0;
 }
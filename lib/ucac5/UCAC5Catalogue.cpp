@@ -0,0 +1,419 @@
+/*
+ * UCAC5 catalogue with persistent mappings of zone files.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "ucac5/UCAC5Catalogue.hpp"
+#include "ucac5/UCAC5Cone.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// zone height and RA bin width, in degrees
+#define ZONE_HEIGHT    (180.0 / UCAC5_ZONES)
+#define RA_BIN_WIDTH   (360.0 / UCAC5_RA_BINS)
+
+static bool brighter(const UCAC5Match &a, const UCAC5Match &b)
+{
+	return a.star->gmag < b.star->gmag;
+}
+
+// keep the num brightest matches, the faintest one is on top of the heap
+static void addMatch(std::vector <UCAC5Match> &matches, size_t num, const UCAC5Match &m)
+{
+	if (matches.size() < num)
+	{
+		matches.push_back(m);
+		std::push_heap(matches.begin(), matches.end(), brighter);
+		return;
+	}
+	if (!brighter(m, matches.front()))
+		return;
+	std::pop_heap(matches.begin(), matches.end(), brighter);
+	matches.back() = m;
+	std::push_heap(matches.begin(), matches.end(), brighter);
+}
+
+// magnitude limit in catalogue units (mmag)
+static int16_t toMmag(double mmag)
+{
+	if (mmag < INT16_MIN)
+		return INT16_MIN;
+	if (mmag > INT16_MAX)
+		return INT16_MAX;
+	return mmag;
+}
+
+static double normalizeRa(double ra)
+{
+	ra = fmod(ra, 360.0);
+	if (ra < 0)
+		ra += 360.0;
+	return ra;
+}
+
+UCAC5Catalogue::UCAC5Catalogue(): base(""), index(NULL), indexSize(0)
+{
+	memset(zones, 0, sizeof(zones));
+	pthread_mutex_init(&zonesMutex, NULL);
+}
+
+UCAC5Catalogue::~UCAC5Catalogue()
+{
+	for (int z = 0; z < UCAC5_ZONES; z++)
+	{
+		if (zones[z].starsSize)
+			munmap((void *) zones[z].stars, zones[z].starsSize);
+		if (zones[z].xyzSize)
+			munmap((void *) zones[z].xyz, zones[z].xyzSize);
+	}
+	if (index)
+		munmap((void *) index, indexSize);
+	pthread_mutex_destroy(&zonesMutex);
+}
+
+int UCAC5Catalogue::open(const char *_base, bool usePixels)
+{
+	base = _base;
+	std::string fn = base + "/u5index.unf";
+	int ret = mapFile(fn.c_str(), (const void **) &index, indexSize);
+	if (ret)
+		return ret;
+	// n0 (offset of the first star of RA bin in zone) and nn (number of stars) arrays
+	if (indexSize != 2 * sizeof(uint32_t) * UCAC5_ZONES * UCAC5_RA_BINS)
+	{
+		munmap((void *) index, indexSize);
+		index = NULL;
+		errno = EINVAL;
+		return -1;
+	}
+	// pixel index is optional
+	if (usePixels)
+		pixelIdx.open(_base);
+	return 0;
+}
+
+int UCAC5Catalogue::cone(double ra, double dec, double radius, double minMag, double maxMag, size_t num, std::vector <UCAC5Match> &matches)
+{
+	if (index == NULL)
+		return -1;
+
+	if (num == 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	matches.clear();
+
+	ra = normalizeRa(ra);
+
+	Vector c;
+	double ra_r = ra * M_PI / 180.0;
+	double dec_r = dec * M_PI / 180.0;
+	c.xyz.x = cos(dec_r) * cos(ra_r);
+	c.xyz.y = cos(dec_r) * sin(ra_r);
+	c.xyz.z = sin(dec_r);
+
+	double cosRad = cos(radius * M_PI / 180.0);
+	int16_t minG = toMmag(floor(minMag * 1000.0));
+	int16_t maxG = toMmag(ceil(maxMag * 1000.0));
+
+	if (pixelIdx.isOpen())
+	{
+		if (conePixels(c, radius * M_PI / 180.0, minG, maxG, num, matches))
+			return -1;
+		std::sort_heap(matches.begin(), matches.end(), brighter);
+		return matches.size();
+	}
+
+	std::vector <uint32_t> matched;
+
+	int zs = floor((dec - radius + 90.0) / ZONE_HEIGHT);
+	int ze = floor((dec + radius + 90.0) / ZONE_HEIGHT);
+	if (zs < 0)
+		zs = 0;
+	if (ze >= UCAC5_ZONES)
+		ze = UCAC5_ZONES - 1;
+
+	// RA extent of the cone, all bins when cone contains pole
+	int bs = 0;
+	int be = UCAC5_RA_BINS - 1;
+	if (fabs(dec) + radius < 90.0)
+	{
+		double dra = asin(sin(radius * M_PI / 180.0) / cos(dec_r)) * 180.0 / M_PI;
+		if (dra < 180.0)
+		{
+			bs = floor((ra - dra) / RA_BIN_WIDTH);
+			be = floor((ra + dra) / RA_BIN_WIDTH);
+			if (be - bs >= UCAC5_RA_BINS)
+			{
+				bs = 0;
+				be = UCAC5_RA_BINS - 1;
+			}
+		}
+	}
+
+	for (int z = zs; z <= ze; z++)
+	{
+		const Zone *zone = getZone(z);
+		if (zone == NULL)
+			return -1;
+		for (int b = bs; b <= be; b++)
+		{
+			int rb = (b + UCAC5_RA_BINS) % UCAC5_RA_BINS;
+			uint32_t s = index[rb * UCAC5_ZONES + z];
+			uint32_t n = index[UCAC5_ZONES * UCAC5_RA_BINS + rb * UCAC5_ZONES + z];
+			if (s + n > zone->count || n == 0)
+				continue;
+			matched.resize(n);
+			size_t k = UCAC5Cone::matchAoS(zone->xyz + s, n, c, cosRad, INFINITY, s, &matched[0]);
+			for (size_t i = 0; i < k; i++)
+			{
+				const Vector *v = zone->xyz + matched[i];
+				const struct ucac5 *star = zone->stars + matched[i];
+				if (star->gmag < minG || star->gmag > maxG)
+					continue;
+				// chord length gives precise distance for close stars
+				double dx = v->xyz.x - c.xyz.x;
+				double dy = v->xyz.y - c.xyz.y;
+				double dz = v->xyz.z - c.xyz.z;
+				UCAC5Match m;
+				m.star = star;
+				m.dist = 2 * asin(sqrt(dx * dx + dy * dy + dz * dz) / 2.0) * 180.0 / M_PI;
+				addMatch(matches, num, m);
+			}
+		}
+	}
+
+	std::sort_heap(matches.begin(), matches.end(), brighter);
+	return matches.size();
+}
+
+int UCAC5Catalogue::box(double ra1, double dec1, double ra2, double dec2, double minMag, double maxMag, size_t num, std::vector <UCAC5Match> &matches)
+{
+	if (index == NULL)
+		return -1;
+
+	if (num == 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	matches.clear();
+
+	// full circle
+	if (fabs(ra2 - ra1) >= 360.0)
+	{
+		ra1 = 0;
+		ra2 = 360.0;
+	}
+	else
+	{
+		ra1 = normalizeRa(ra1);
+		ra2 = normalizeRa(ra2);
+	}
+	if (dec1 > dec2)
+		std::swap(dec1, dec2);
+
+	int32_t ira1 = ra1 * 3600000.0;
+	int32_t ira2 = ra2 * 3600000.0;
+	int32_t idc1 = dec1 * 3600000.0;
+	int32_t idc2 = dec2 * 3600000.0;
+	bool wrap = ra1 > ra2;
+
+	int16_t minG = toMmag(floor(minMag * 1000.0));
+	int16_t maxG = toMmag(ceil(maxMag * 1000.0));
+
+	int zs = floor((dec1 + 90.0) / ZONE_HEIGHT);
+	int ze = floor((dec2 + 90.0) / ZONE_HEIGHT);
+	if (zs < 0)
+		zs = 0;
+	if (ze >= UCAC5_ZONES)
+		ze = UCAC5_ZONES - 1;
+
+	int bs = floor(ra1 / RA_BIN_WIDTH);
+	int be = floor(ra2 / RA_BIN_WIDTH);
+	if (be >= UCAC5_RA_BINS)
+		be = UCAC5_RA_BINS - 1;
+	if (wrap)
+		be += UCAC5_RA_BINS;
+
+	for (int z = zs; z <= ze; z++)
+	{
+		const Zone *zone = getZone(z);
+		if (zone == NULL)
+			return -1;
+		for (int b = bs; b <= be; b++)
+		{
+			int rb = b % UCAC5_RA_BINS;
+			uint32_t s = index[rb * UCAC5_ZONES + z];
+			uint32_t n = index[UCAC5_ZONES * UCAC5_RA_BINS + rb * UCAC5_ZONES + z];
+			if (s + n > zone->count)
+				continue;
+			const struct ucac5 *star = zone->stars + s;
+			const struct ucac5 *send = star + n;
+			for (; star < send; star++)
+			{
+				if (star->idc < idc1 || star->idc > idc2)
+					continue;
+				if (wrap ? (star->ira < ira1 && star->ira > ira2) : (star->ira < ira1 || star->ira > ira2))
+					continue;
+				if (star->gmag < minG || star->gmag > maxG)
+					continue;
+				UCAC5Match m;
+				m.star = star;
+				m.dist = NAN;
+				addMatch(matches, num, m);
+			}
+		}
+	}
+
+	std::sort_heap(matches.begin(), matches.end(), brighter);
+	return matches.size();
+}
+
+int UCAC5Catalogue::getMappedZones()
+{
+	int ret = 0;
+	pthread_mutex_lock(&zonesMutex);
+	for (int z = 0; z < UCAC5_ZONES; z++)
+	{
+		if (zones[z].mapped)
+			ret++;
+	}
+	pthread_mutex_unlock(&zonesMutex);
+	return ret;
+}
+
+int UCAC5Catalogue::conePixels(const Vector &c, double radius, int16_t minG, int16_t maxG, size_t num, std::vector <UCAC5Match> &matches)
+{
+	std::vector <uint32_t> matched;
+	pixelIdx.cone(c, 0, radius, matched);
+
+	// stars of a pixel are ordered by zone, so zone lookups are mostly avoided
+	const Zone *zone = NULL;
+	int zn = -1;
+	for (std::vector <uint32_t>::iterator iter = matched.begin(); iter != matched.end(); iter++)
+	{
+		const UCAC5Ref &ref = pixelIdx.getRef(*iter);
+		if (ref.zone >= UCAC5_ZONES)
+			continue;
+		if (ref.zone != zn)
+		{
+			zone = getZone(ref.zone);
+			if (zone == NULL)
+				return -1;
+			zn = ref.zone;
+		}
+		if (ref.offset >= zone->count)
+			continue;
+		const struct ucac5 *star = zone->stars + ref.offset;
+		if (star->gmag < minG || star->gmag > maxG)
+			continue;
+		Vector v;
+		pixelIdx.getVector(*iter, v);
+		double dx = v.xyz.x - c.xyz.x;
+		double dy = v.xyz.y - c.xyz.y;
+		double dz = v.xyz.z - c.xyz.z;
+		UCAC5Match m;
+		m.star = star;
+		m.dist = 2 * asin(sqrt(dx * dx + dy * dy + dz * dz) / 2.0) * 180.0 / M_PI;
+		addMatch(matches, num, m);
+	}
+	return 0;
+}
+
+const UCAC5Catalogue::Zone *UCAC5Catalogue::getZone(int z)
+{
+	pthread_mutex_lock(&zonesMutex);
+	Zone *zone = zones + z;
+	if (!zone->mapped)
+	{
+		char fn[20];
+		snprintf(fn, sizeof(fn), "z%03d", z + 1);
+		std::string zfn = base + "/" + fn;
+		std::string xfn = zfn + ".xyz";
+
+		const void *stars;
+		const void *xyz;
+		size_t starsSize;
+		size_t xyzSize;
+
+		if (mapFile(zfn.c_str(), &stars, starsSize))
+		{
+			pthread_mutex_unlock(&zonesMutex);
+			return NULL;
+		}
+		if (mapFile(xfn.c_str(), &xyz, xyzSize))
+		{
+			munmap((void *) stars, starsSize);
+			pthread_mutex_unlock(&zonesMutex);
+			return NULL;
+		}
+		if (starsSize / sizeof(struct ucac5) != xyzSize / sizeof(Vector))
+		{
+			munmap((void *) stars, starsSize);
+			munmap((void *) xyz, xyzSize);
+			pthread_mutex_unlock(&zonesMutex);
+			errno = EINVAL;
+			return NULL;
+		}
+		zone->xyz = (const Vector *) xyz;
+		zone->xyzSize = xyzSize;
+		zone->count = starsSize / sizeof(struct ucac5);
+		zone->starsSize = starsSize;
+		zone->stars = (const struct ucac5 *) stars;
+		zone->mapped = true;
+	}
+	pthread_mutex_unlock(&zonesMutex);
+	return zone;
+}
+
+int UCAC5Catalogue::mapFile(const char *fn, const void **data, size_t &size)
+{
+	int fd = ::open(fn, O_RDONLY);
+	if (fd == -1)
+		return -1;
+	struct stat sb;
+	if (fstat(fd, &sb))
+	{
+		close(fd);
+		return -1;
+	}
+	size = sb.st_size;
+	// empty zone cannot be mapped
+	if (size == 0)
+	{
+		close(fd);
+		*data = NULL;
+		return 0;
+	}
+	void *d = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (d == MAP_FAILED)
+		return -1;
+	*data = d;
+	return 0;
+}
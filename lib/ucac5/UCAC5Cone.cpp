@@ -0,0 +1,147 @@
+/*
+ * Cone match kernels for UCAC5 unit vector indices.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "ucac5/UCAC5Cone.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define UCAC5CONE_X86
+#include <immintrin.h>
+#endif
+
+typedef size_t (*matchSoA_t)(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched);
+
+size_t UCAC5Cone::matchSoAScalar(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched)
+{
+	size_t k = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		double d = (x[i] * c.xyz.x + y[i] * c.xyz.y) + z[i] * c.xyz.z;
+		// branchless compaction
+		matched[k] = base + i;
+		k += (d >= cosMax) & (d <= cosMin);
+	}
+	return k;
+}
+
+size_t UCAC5Cone::matchAoS(const Vector *v, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched)
+{
+	size_t k = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		double d = (v[i].xyz.x * c.xyz.x + v[i].xyz.y * c.xyz.y) + v[i].xyz.z * c.xyz.z;
+		matched[k] = base + i;
+		k += (d >= cosMax) & (d <= cosMin);
+	}
+	return k;
+}
+
+#ifdef UCAC5CONE_X86
+
+#ifdef __SSE2__
+static size_t matchSoASSE2(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched)
+{
+	const __m128d cx = _mm_set1_pd(c.xyz.x);
+	const __m128d cy = _mm_set1_pd(c.xyz.y);
+	const __m128d cz = _mm_set1_pd(c.xyz.z);
+	const __m128d lo = _mm_set1_pd(cosMax);
+	const __m128d hi = _mm_set1_pd(cosMin);
+
+	size_t k = 0;
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d d = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(x + i), cx), _mm_mul_pd(_mm_loadu_pd(y + i), cy)), _mm_mul_pd(_mm_loadu_pd(z + i), cz));
+		int mask = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(d, lo), _mm_cmple_pd(d, hi)));
+		matched[k] = base + i;
+		k += mask & 1;
+		matched[k] = base + i + 1;
+		k += mask >> 1;
+	}
+
+	return k + UCAC5Cone::matchSoAScalar(x + i, y + i, z + i, n - i, c, cosMax, cosMin, base + i, matched + k);
+}
+#endif // __SSE2__
+
+__attribute__ ((target ("avx2")))
+static size_t matchSoAAVX2(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched)
+{
+	const __m256d cx = _mm256_set1_pd(c.xyz.x);
+	const __m256d cy = _mm256_set1_pd(c.xyz.y);
+	const __m256d cz = _mm256_set1_pd(c.xyz.z);
+	const __m256d lo = _mm256_set1_pd(cosMax);
+	const __m256d hi = _mm256_set1_pd(cosMin);
+
+	size_t k = 0;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(x + i), cx), _mm256_mul_pd(_mm256_loadu_pd(y + i), cy)), _mm256_mul_pd(_mm256_loadu_pd(z + i), cz));
+		int mask = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(d, lo, _CMP_GE_OQ), _mm256_cmp_pd(d, hi, _CMP_LE_OQ)));
+		// most blocks are either completely outside or inside of the cone
+		if (mask == 0)
+			continue;
+		if (mask == 0xf)
+		{
+			matched[k++] = base + i;
+			matched[k++] = base + i + 1;
+			matched[k++] = base + i + 2;
+			matched[k++] = base + i + 3;
+			continue;
+		}
+		while (mask)
+		{
+			matched[k++] = base + i + __builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+
+	return k + UCAC5Cone::matchSoAScalar(x + i, y + i, z + i, n - i, c, cosMax, cosMin, base + i, matched + k);
+}
+
+#endif // UCAC5CONE_X86
+
+static matchSoA_t selectMatchSoA(const char **name)
+{
+#ifdef UCAC5CONE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		*name = "avx2";
+		return matchSoAAVX2;
+	}
+#ifdef __SSE2__
+	*name = "sse2";
+	return matchSoASSE2;
+#endif
+#endif
+	*name = "scalar";
+	return UCAC5Cone::matchSoAScalar;
+}
+
+static const char *matchSoAName;
+static const matchSoA_t matchSoAKernel = selectMatchSoA(&matchSoAName);
+
+size_t UCAC5Cone::matchSoA(const double *x, const double *y, const double *z, size_t n, const Vector &c, double cosMax, double cosMin, uint32_t base, uint32_t *matched)
+{
+	return matchSoAKernel(x, y, z, n, c, cosMax, cosMin, base, matched);
+}
+
+const char *UCAC5Cone::getKernelName()
+{
+	return matchSoAName;
+}
@@ -0,0 +1,208 @@
+/*
+ * HEALPix nested pixelisation of the sphere.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "ucac5/UCAC5Healpix.hpp"
+
+#include <math.h>
+
+// ring and phi offsets of base pixels (faces)
+static const int jrll[12] = { 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4 };
+static const int jpll[12] = { 1, 3, 5, 7, 0, 2, 4, 6, 1, 3, 5, 7 };
+
+// interleave bits of 16 bit number with zeros
+static uint32_t spreadBits(uint32_t v)
+{
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+// inverse of spreadBits
+static uint32_t compressBits(uint32_t v)
+{
+	v &= 0x55555555;
+	v = (v | (v >> 1)) & 0x33333333;
+	v = (v | (v >> 2)) & 0x0f0f0f0f;
+	v = (v | (v >> 4)) & 0x00ff00ff;
+	v = (v | (v >> 8)) & 0x0000ffff;
+	return v;
+}
+
+static double angle(const Vector &a, const Vector &b)
+{
+	double dx = a.xyz.x - b.xyz.x;
+	double dy = a.xyz.y - b.xyz.y;
+	double dz = a.xyz.z - b.xyz.z;
+	return 2 * asin(fmin(1, sqrt(dx * dx + dy * dy + dz * dz) / 2.0));
+}
+
+uint32_t UCAC5Healpix::vec2pix(int order, const Vector &v)
+{
+	int nside = 1 << order;
+	double z = v.xyz.z;
+	double za = fabs(z);
+	// phi in units of pi/2, range [0,4)
+	double tt = atan2(v.xyz.y, v.xyz.x) * 2 / M_PI;
+	if (tt < 0)
+		tt += 4;
+	if (tt >= 4)
+		tt -= 4;
+
+	int face, ix, iy;
+	if (za <= 2.0 / 3.0)
+	{
+		// equatorial region
+		double temp1 = nside * (0.5 + tt);
+		double temp2 = nside * (z * 0.75);
+		int jp = (int) (temp1 - temp2);
+		int jm = (int) (temp1 + temp2);
+		int ifp = jp >> order;
+		int ifm = jm >> order;
+		if (ifp == ifm)
+			face = ifp | 4;
+		else if (ifp < ifm)
+			face = ifp;
+		else
+			face = ifm + 8;
+		ix = jm & (nside - 1);
+		iy = nside - (jp & (nside - 1)) - 1;
+	}
+	else
+	{
+		// polar caps; sqrt(3 (1 - za)) is calculated from x and y to keep precision close to pole
+		int ntt = (int) tt;
+		if (ntt > 3)
+			ntt = 3;
+		double tp = tt - ntt;
+		double sth = sqrt(v.xyz.x * v.xyz.x + v.xyz.y * v.xyz.y);
+		double tmp = nside * sth * sqrt(3 / (1 + za));
+
+		int jp = (int) (tp * tmp);
+		int jm = (int) ((1 - tp) * tmp);
+		if (jp >= nside)
+			jp = nside - 1;
+		if (jm >= nside)
+			jm = nside - 1;
+		if (z >= 0)
+		{
+			face = ntt;
+			ix = nside - jm - 1;
+			iy = nside - jp - 1;
+		}
+		else
+		{
+			face = ntt + 8;
+			ix = jp;
+			iy = jm;
+		}
+	}
+	return ((uint32_t) face << (2 * order)) + spreadBits(ix) + (spreadBits(iy) << 1);
+}
+
+void UCAC5Healpix::pix2vec(int order, uint32_t pix, Vector &v)
+{
+	int nside = 1 << order;
+	uint32_t npface = 1u << (2 * order);
+	int face = pix >> (2 * order);
+	int ix = compressBits(pix & (npface - 1));
+	int iy = compressBits((pix & (npface - 1)) >> 1);
+
+	double fact2 = 4.0 / npix(order);
+	int jr = (jrll[face] << order) - ix - iy - 1;
+
+	int nr, kshift;
+	double z;
+	if (jr < nside)
+	{
+		nr = jr;
+		z = 1 - nr * (double) nr * fact2;
+		kshift = 0;
+	}
+	else if (jr > 3 * nside)
+	{
+		nr = 4 * nside - jr;
+		z = nr * (double) nr * fact2 - 1;
+		kshift = 0;
+	}
+	else
+	{
+		nr = nside;
+		z = (2 * nside - jr) * 2.0 * nside * fact2;
+		kshift = (jr - nside) & 1;
+	}
+
+	int jp = (jpll[face] * nr + ix - iy + 1 + kshift) / 2;
+	if (jp > 4 * nside)
+		jp -= 4 * nside;
+	if (jp < 1)
+		jp += 4 * nside;
+
+	double phi = (jp - (kshift + 1) * 0.5) * (M_PI / 2 / nr);
+	double sth = sqrt((1 - z) * (1 + z));
+	v.xyz.x = sth * cos(phi);
+	v.xyz.y = sth * sin(phi);
+	v.xyz.z = z;
+}
+
+double UCAC5Healpix::maxPixRad(int order)
+{
+	// distance of pixel point from its center is at most about 1.06 / nside radians, measured on random points
+	return 1.2 / (1 << order);
+}
+
+void UCAC5Healpix::queryDisc(int order, const Vector &c, double radius, std::vector <HealpixRange> &ranges)
+{
+	ranges.clear();
+	for (uint32_t f = 0; f < 12; f++)
+		queryPixel(order, 0, f, c, radius, ranges);
+}
+
+void UCAC5Healpix::queryPixel(int order, int o, uint32_t pix, const Vector &c, double radius, std::vector <HealpixRange> &ranges)
+{
+	Vector pc;
+	pix2vec(o, pix, pc);
+	double d = angle(c, pc);
+	double pr = maxPixRad(o);
+	if (d > radius + pr)
+		return;
+	int shift = 2 * (order - o);
+	// whole pixel inside cone, or pixel of the requested order
+	if (d + pr <= radius || o == order)
+	{
+		addRange(ranges, pix << shift, (pix + 1) << shift);
+		return;
+	}
+	for (uint32_t ch = pix << 2; ch < (pix << 2) + 4; ch++)
+		queryPixel(order, o + 1, ch, c, radius, ranges);
+}
+
+void UCAC5Healpix::addRange(std::vector <HealpixRange> &ranges, uint32_t first, uint32_t last)
+{
+	// pixels are visited in increasing order
+	if (!ranges.empty() && ranges.back().last == first)
+	{
+		ranges.back().last = last;
+		return;
+	}
+	HealpixRange r;
+	r.first = first;
+	r.last = last;
+	ranges.push_back(r);
+}
@@ -1,6 +1,7 @@
 #include "ucac5/UCAC5Idx.hpp"
+#include "ucac5/UCAC5Cone.hpp"
 
-#include <erfa.h>
+#include <math.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -9,7 +10,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
-UCAC5Idx::UCAC5Idx ():band(-1), fd(-1), data(NULL), dataSize(0), current(NULL), currentEnd(NULL)
+UCAC5Idx::UCAC5Idx ():band(-1), fd(-1), data(NULL), dataSize(0), current(NULL), currentEnd(NULL), matchedCount(0), matchedPos(0)
 {
 }
 
@@ -38,33 +39,45 @@ int UCAC5Idx::openIdx (int dec_band)
 	if (data == MAP_FAILED)
 		return -1;
 	current = data;
-	currentEnd = data + dataSize;
+	currentEnd = data + dataSize / sizeof(Vector);
+	matchedCount = matchedPos = 0;
 	band = dec_band;
 	return 0;
 }
 
 int UCAC5Idx::select (size_t offset, size_t length)
 {
-	if (offset + length > (dataSize / sizeof(Vector)))
+	size_t count = dataSize / sizeof(Vector);
+	if (offset > count)
 		return -1;
+	// UCAC5Bands::nextBand returns -1 length for rest of the band
+	if (length > count - offset)
+		length = count - offset;
 	current = data + offset;
 	currentEnd = current + length;
+	matchedCount = matchedPos = 0;
 	return 0;
 }
 
 int UCAC5Idx::nextMatched (Vector *fc, double minRad, double maxRad, double &d)
 {
-	while (current < currentEnd)
+	while (matchedPos >= matchedCount)
 	{
-		d = eraSepp(fc->data, current->data);
-		if (d >= minRad && d <= maxRad)
-		{
-			int ret = current - data;
-			current++;
-			return ret;
-		}
-		current++;
+		// no more entry found
+		if (current >= currentEnd)
+			return -1;
+		size_t n = currentEnd - current;
+		if (n > UCAC5IDX_BLOCK)
+			n = UCAC5IDX_BLOCK;
+		matchedCount = UCAC5Cone::matchAoS(current, n, *fc, cos(maxRad), minRad > 0 ? cos(minRad) : INFINITY, current - data, matched);
+		matchedPos = 0;
+		current += n;
 	}
-	// no more entry found
-	return -1;
+	int ret = matched[matchedPos++];
+	// chord length gives precise distance for close stars
+	double dx = data[ret].xyz.x - fc->xyz.x;
+	double dy = data[ret].xyz.y - fc->xyz.y;
+	double dz = data[ret].xyz.z - fc->xyz.z;
+	d = 2 * asin(fmin(1, sqrt(dx * dx + dy * dy + dz * dz) / 2.0));
+	return ret;
 }
@@ -0,0 +1,284 @@
+/*
+ * HEALPix pixel index of UCAC5 catalogue.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "ucac5/UCAC5PixelIdx.hpp"
+#include "ucac5/UCAC5Cone.hpp"
+#include "ucac5/UCAC5Catalogue.hpp"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PIXELIDX_MAGIC          "U5HPX01\n"
+#define PIXELIDX_HEADER_SIZE    16
+
+// maximal order of built index - offsets of order 10 take 50 MB
+#define PIXELIDX_MAX_ORDER      10
+
+static int mapRead(const char *fn, void **data, size_t &size)
+{
+	int fd = ::open(fn, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat sb;
+	if (fstat(fd, &sb))
+	{
+		close(fd);
+		return -1;
+	}
+	size = sb.st_size;
+	if (size == 0)
+	{
+		close(fd);
+		*data = NULL;
+		return 0;
+	}
+	void *d = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (d == MAP_FAILED)
+		return -1;
+	*data = d;
+	return 0;
+}
+
+static void *mapWrite(const char *fn, size_t size)
+{
+	int fd = ::open(fn, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return NULL;
+	if (ftruncate(fd, size))
+	{
+		close(fd);
+		return NULL;
+	}
+	void *d = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (d == MAP_FAILED)
+		return NULL;
+	return d;
+}
+
+static void starVector(const struct ucac5 *star, Vector &v)
+{
+	double ra = star->ira / 3600000.0 * M_PI / 180.0;
+	double dec = star->idc / 3600000.0 * M_PI / 180.0;
+	v.xyz.x = cos(dec) * cos(ra);
+	v.xyz.y = cos(dec) * sin(ra);
+	v.xyz.z = sin(dec);
+}
+
+UCAC5PixelIdx::UCAC5PixelIdx(): order(0), count(0), offsets(NULL), x(NULL), y(NULL), z(NULL), refs(NULL), idxData(NULL), idxSize(0), xyzData(NULL), xyzSize(0), refData(NULL), refSize(0)
+{
+}
+
+UCAC5PixelIdx::~UCAC5PixelIdx()
+{
+	if (idxData)
+		munmap(idxData, idxSize);
+	if (xyzData)
+		munmap(xyzData, xyzSize);
+	if (refData)
+		munmap(refData, refSize);
+}
+
+int UCAC5PixelIdx::open(const char *base)
+{
+	std::string b(base);
+	if (mapRead((b + "/u5hpx.idx").c_str(), &idxData, idxSize))
+		return -1;
+	if (idxSize < PIXELIDX_HEADER_SIZE || memcmp(idxData, PIXELIDX_MAGIC, 8))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	order = ((int32_t *) idxData)[2];
+	count = ((uint32_t *) idxData)[3];
+	if (order < 0 || order > PIXELIDX_MAX_ORDER || idxSize != PIXELIDX_HEADER_SIZE + (UCAC5Healpix::npix(order) + 1) * sizeof(uint32_t))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (mapRead((b + "/u5hpx.xyz").c_str(), &xyzData, xyzSize) || mapRead((b + "/u5hpx.ref").c_str(), &refData, refSize))
+		return -1;
+	if (xyzSize != count * 3 * sizeof(double) || refSize != count * sizeof(UCAC5Ref))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	x = (const double *) xyzData;
+	y = x + count;
+	z = y + count;
+	refs = (const UCAC5Ref *) refData;
+	offsets = (const uint32_t *) ((char *) idxData + PIXELIDX_HEADER_SIZE);
+	return 0;
+}
+
+size_t UCAC5PixelIdx::cone(const Vector &c, double minRad, double maxRad, std::vector <uint32_t> &matched)
+{
+	matched.clear();
+	if (offsets == NULL)
+		return 0;
+
+	std::vector <HealpixRange> ranges;
+	UCAC5Healpix::queryDisc(order, c, maxRad, ranges);
+
+	double cosMax = cos(maxRad);
+	double cosMin = minRad > 0 ? cos(minRad) : INFINITY;
+
+	size_t tested = 0;
+	for (std::vector <HealpixRange>::iterator iter = ranges.begin(); iter != ranges.end(); iter++)
+	{
+		uint32_t s = offsets[iter->first];
+		uint32_t n = offsets[iter->last] - s;
+		if (n == 0)
+			continue;
+		size_t k = matched.size();
+		matched.resize(k + n);
+		k += UCAC5Cone::matchSoA(x + s, y + s, z + s, n, c, cosMax, cosMin, s, &matched[k]);
+		matched.resize(k);
+		tested += n;
+	}
+	return tested;
+}
+
+int UCAC5PixelIdx::build(const char *base, int _order)
+{
+	if (_order < 0 || _order > PIXELIDX_MAX_ORDER)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	std::string b(base);
+	uint32_t np = UCAC5Healpix::npix(_order);
+	std::vector <uint32_t> pixOffsets(np + 1, 0);
+
+	// first pass - count stars in pixels
+	size_t total = 0;
+	for (int zn = 0; zn < UCAC5_ZONES; zn++)
+	{
+		char fn[20];
+		snprintf(fn, sizeof(fn), "/z%03d", zn + 1);
+		void *data;
+		size_t size;
+		if (mapRead((b + fn).c_str(), &data, size))
+			return -1;
+		const struct ucac5 *stars = (const struct ucac5 *) data;
+		size_t n = size / sizeof(struct ucac5);
+		for (size_t i = 0; i < n; i++)
+		{
+			Vector v;
+			starVector(stars + i, v);
+			pixOffsets[UCAC5Healpix::vec2pix(_order, v) + 1]++;
+		}
+		if (data)
+			munmap(data, size);
+		total += n;
+	}
+	if (total > UINT32_MAX)
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+	for (uint32_t p = 0; p < np; p++)
+		pixOffsets[p + 1] += pixOffsets[p];
+
+	// second pass - fill index, written to temporary files renamed when index is complete
+	std::string idxFn = b + "/u5hpx.idx";
+	std::string xyzFn = b + "/u5hpx.xyz";
+	std::string refFn = b + "/u5hpx.ref";
+
+	size_t xyzLen = total * 3 * sizeof(double);
+	size_t refLen = total * sizeof(UCAC5Ref);
+	double *ox = NULL;
+	UCAC5Ref *oref = NULL;
+	if (total > 0)
+	{
+		ox = (double *) mapWrite((xyzFn + ".tmp").c_str(), xyzLen);
+		if (ox == NULL)
+			return -1;
+		oref = (UCAC5Ref *) mapWrite((refFn + ".tmp").c_str(), refLen);
+		if (oref == NULL)
+		{
+			munmap(ox, xyzLen);
+			return -1;
+		}
+	}
+	double *oy = ox + total;
+	double *oz = oy + total;
+
+	std::vector <uint32_t> pos(pixOffsets.begin(), pixOffsets.end() - 1);
+	for (int zn = 0; zn < UCAC5_ZONES && total > 0; zn++)
+	{
+		char fn[20];
+		snprintf(fn, sizeof(fn), "/z%03d", zn + 1);
+		void *data;
+		size_t size;
+		if (mapRead((b + fn).c_str(), &data, size))
+		{
+			munmap(ox, xyzLen);
+			munmap(oref, refLen);
+			return -1;
+		}
+		const struct ucac5 *stars = (const struct ucac5 *) data;
+		size_t n = size / sizeof(struct ucac5);
+		for (size_t i = 0; i < n; i++)
+		{
+			Vector v;
+			starVector(stars + i, v);
+			uint32_t j = pos[UCAC5Healpix::vec2pix(_order, v)]++;
+			ox[j] = v.xyz.x;
+			oy[j] = v.xyz.y;
+			oz[j] = v.xyz.z;
+			oref[j].zone = zn;
+			oref[j].reserved = 0;
+			oref[j].offset = i;
+		}
+		if (data)
+			munmap(data, size);
+	}
+	if (total > 0)
+	{
+		munmap(ox, xyzLen);
+		munmap(oref, refLen);
+	}
+
+	FILE *f = fopen((idxFn + ".tmp").c_str(), "w");
+	if (f == NULL)
+		return -1;
+	int32_t hdr[2] = { _order, (int32_t) total };
+	if (fwrite(PIXELIDX_MAGIC, 8, 1, f) != 1 || fwrite(hdr, sizeof(hdr), 1, f) != 1 || fwrite(&pixOffsets[0], sizeof(uint32_t), np + 1, f) != np + 1)
+	{
+		fclose(f);
+		return -1;
+	}
+	if (fclose(f))
+		return -1;
+
+	if (total > 0 && (rename((xyzFn + ".tmp").c_str(), xyzFn.c_str()) || rename((refFn + ".tmp").c_str(), refFn.c_str())))
+		return -1;
+	return rename((idxFn + ".tmp").c_str(), idxFn.c_str());
+}
@@ -7,6 +7,8 @@
 namespace XmlRpc
 {
 
+	void (*XmlRpcSource::_closeFD) (int) = NULL;
+
 	XmlRpcSource::XmlRpcSource(int fd /*= -1*/, bool deleteOnClose /*= false*/)
 		: _fd(fd), _deleteOnClose(deleteOnClose), _keepOpen(false)
 	{
@@ -22,6 +24,8 @@ namespace XmlRpc
 		if (_fd != -1)
 		{
 			XmlRpcUtil::log(2,"XmlRpcSource::close: closing socket %d.", _fd);
+			if (_closeFD)
+				_closeFD(_fd);
 			XmlRpcSocket::close(_fd);
 			XmlRpcUtil::log(2,"XmlRpcSource::close: done closing socket %d.", _fd);
 			_fd = -1;
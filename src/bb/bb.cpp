@@ -105,6 +105,7 @@ int BB::init ()
 
 	XmlRpcServer::bindAndListen (rpcPort);
 	XmlRpcServer::enableIntrospection (true);
+	XmlRpcSource::setCloseFd (&getMasterPollFDClosed);
 
 #ifdef RTS2_HAVE_LIBJPEG
 	Magick::InitializeMagick (".");
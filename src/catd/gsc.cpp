@@ -28,7 +28,7 @@ class GSC:public Catd
 		virtual ~GSC (void);
 
 	protected:
-		virtual int searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, int num);
+		virtual int searchCone (struct ln_equ_posn *center, double radius, double minMag, double maxMag, int num, CatStars &stars);
 };
 
 GSC::GSC (int argc, char **argv):Catd (argc, argv)
@@ -42,8 +42,9 @@ GSC::~GSC ()
 }
 
 
-int GSC::searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, int num)
+int GSC::searchCone (struct ln_equ_posn *center, double radius, double minMag, double maxMag, int num, CatStars &stars)
 {
+	stars.clear ();
 	return 0;
 }
 
@@ -0,0 +1,162 @@
+/*
+ * UCAC5 catalogue server.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "catd.h"
+#include "ucac5/UCAC5Catalogue.hpp"
+
+#include <errno.h>
+#include <sstream>
+
+namespace rts2catd
+{
+
+/**
+ * UCAC5 catalogue server. Catalogue index and accessed zones stay mapped
+ * for the lifetime of the daemon, so searches does not pay for opening and
+ * mapping files. Magnitude limits are on Gaia G magnitude, star IDs are
+ * Gaia source IDs.
+ *
+ * Zone files must be indexed with ucac5-idx.
+ */
+class UCAC5:public Catd
+{
+	public:
+		UCAC5 (int argc, char **argv);
+		virtual ~UCAC5 (void);
+
+	protected:
+		virtual int processOption (int opt);
+		virtual int initHardware ();
+		virtual int info ();
+
+		virtual int searchCone (struct ln_equ_posn *center, double radius, double minMag, double maxMag, int num, CatStars &stars);
+		virtual int searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, double minMag, double maxMag, int num, CatStars &stars);
+
+	private:
+		const char *base;
+		UCAC5Catalogue catalogue;
+
+		rts2core::ValueInteger *mappedZones;
+
+		void fillStars (std::vector <UCAC5Match> &matches, CatStars &stars);
+};
+
+}
+
+using namespace rts2catd;
+
+UCAC5::UCAC5 (int argc, char **argv):Catd (argc, argv)
+{
+	base = NULL;
+
+	createValue (mappedZones, "mapped_zones", "number of catalogue zones mapped to memory", false);
+
+	addOption ('b', NULL, 1, "UCAC5 base path (directory with u5index.unf and zone files)");
+}
+
+UCAC5::~UCAC5 ()
+{
+}
+
+int UCAC5::processOption (int opt)
+{
+	switch (opt)
+	{
+		case 'b':
+			base = optarg;
+			break;
+		default:
+			return Catd::processOption (opt);
+	}
+	return 0;
+}
+
+int UCAC5::initHardware ()
+{
+	if (base == NULL)
+	{
+		logStream (MESSAGE_ERROR) << "UCAC5 base path must be specified with -b option" << sendLog;
+		return -1;
+	}
+	if (catalogue.open (base))
+	{
+		logStream (MESSAGE_ERROR) << "cannot open UCAC5 index " << base << "/u5index.unf: " << strerror (errno) << sendLog;
+		return -1;
+	}
+	return 0;
+}
+
+int UCAC5::info ()
+{
+	mappedZones->setValueInteger (catalogue.getMappedZones ());
+	return Catd::info ();
+}
+
+int UCAC5::searchCone (struct ln_equ_posn *center, double radius, double minMag, double maxMag, int num, CatStars &stars)
+{
+	std::vector <UCAC5Match> matches;
+	if (catalogue.cone (center->ra, center->dec, radius, minMag, maxMag, num, matches) < 0)
+	{
+		logStream (MESSAGE_ERROR) << "cone search failed: " << strerror (errno) << sendLog;
+		return -1;
+	}
+	fillStars (matches, stars);
+	return 0;
+}
+
+int UCAC5::searchCataloge (struct ln_equ_posn *c1, struct ln_equ_posn *c2, double minMag, double maxMag, int num, CatStars &stars)
+{
+	std::vector <UCAC5Match> matches;
+	if (catalogue.box (c1->ra, c1->dec, c2->ra, c2->dec, minMag, maxMag, num, matches) < 0)
+	{
+		logStream (MESSAGE_ERROR) << "box search failed: " << strerror (errno) << sendLog;
+		return -1;
+	}
+	fillStars (matches, stars);
+	return 0;
+}
+
+void UCAC5::fillStars (std::vector <UCAC5Match> &matches, CatStars &stars)
+{
+	stars.clear ();
+	stars.reserve (matches.size ());
+	for (std::vector <UCAC5Match>::iterator iter = matches.begin (); iter != matches.end (); iter++)
+	{
+		std::ostringstream os;
+		os << iter->star->srcid;
+
+		CatStar s;
+		s.id = os.str ();
+		s.ra = iter->star->ira / 3600000.0;
+		s.dec = iter->star->idc / 3600000.0;
+		s.mag = iter->star->gmag / 1000.0;
+		s.dist = iter->dist;
+		stars.push_back (s);
+	}
+	if (mappedZones->getValueInteger () != catalogue.getMappedZones ())
+	{
+		mappedZones->setValueInteger (catalogue.getMappedZones ());
+		sendValueAll (mappedZones);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	UCAC5 device (argc, argv);
+	return device.run ();
+}
@@ -428,6 +428,7 @@ void TargetApp::setTempdisable ()
 		std::cerr << "Missing camera name" << std::endl;
 		return;
 	}
+	target_set.loadScripts ();
 	for (rts2db::TargetSet::iterator iter = target_set.begin (); iter != target_set.end (); iter++)
 	{
 		std::string cs;
@@ -472,6 +473,7 @@ void TargetApp::setTempdisable ()
 			std::cerr << "Missing camera " << camera << ". Is it filled in \"cameras\" database table?" << std::endl;
 		}
 	}
+	target_set.clearScripts ();
 }
 
 int TargetApp::doProcessing ()
@@ -293,6 +293,7 @@ void Rts2ConnFwGrb::connectionError (int last_data_size)
 	logStream (MESSAGE_DEBUG) << "Rts2ConnFwGrb::connectionError" << sendLog;
 	if (sock > 0)
 	{
+		getMaster ()->pollFDClosed (sock);
 		close (sock);
 		sock = -1;
 	}
@@ -311,6 +312,7 @@ int Rts2ConnFwGrb::receive (rts2core::Block *block)
 	if (gcn_listen_sock >= 0 && block->isForRead (gcn_listen_sock))
 	{
 		// try to accept connection..
+		getMaster ()->pollFDClosed (sock);
 		close (sock);			 // close previous connections..we support only one GCN connection
 		sock = -1;
 		struct sockaddr_in other_side;
@@ -63,6 +63,7 @@ digraph "JSON API calls handling" {
 
 #include "httpd.h"
 #include "rts2json/jsonvalue.h"
+#include "tslog.h"
 
 #include "rts2db/constraints.h"
 #include "rts2db/planset.h"
@@ -288,6 +289,51 @@ void API::executeJSON (XmlRpc::XmlRpcSource *source, std::string path, XmlRpc::H
 			}
 			os << "]";
 		}
+		// range scan of binary time-series store, does not need database
+		else if (vals[0] == "tslog")
+		{
+			const char *tslogDir = ((HttpD *) getMasterApp ())->getTSLogDir ();
+			if (tslogDir == NULL)
+				throw JSONException ("time-series store directory is not configured");
+			const char *device = params->getString ("d", "");
+			const char *vn = params->getString ("n", "");
+			if (device[0] == '\0' || vn[0] == '\0' || strchr (device, '/') || strchr (vn, '/'))
+				throw JSONException ("invalid device or value name");
+			double from = params->getDouble ("from", getNow () - 86400);
+			double to = params->getDouble ("to", from + 86400);
+			const int steps = params->getInteger ("step", 1000);
+
+			std::string path = std::string (tslogDir) + "/" + device + "/" + vn + ".tsl";
+			rts2core::TimeseriesReader reader;
+			if (reader.open (path.c_str ()))
+				throw JSONException ("cannot open time-series file");
+
+			std::vector <double> t;
+			std::vector <double> v;
+			reader.scan (from, to, t, v);
+
+			// average samples into at most steps points
+			size_t bucket = (steps > 0 && t.size () > (size_t) steps) ? (t.size () + steps - 1) / steps : 1;
+
+			os << "{\"n\":" << rts2json::JsonString (reader.getName ().c_str ()) << ",\"d\":[";
+			for (size_t i = 0; i < t.size (); i += bucket)
+			{
+				double sum = 0;
+				int n = 0;
+				for (size_t j = i; j < i + bucket && j < t.size (); j++)
+				{
+					if (!std::isnan (v[j]))
+					{
+						sum += v[j];
+						n++;
+					}
+				}
+				if (i > 0)
+					os << ",";
+				os << "[" << rts2json::JsonDouble (t[i]) << "," << rts2json::JsonDouble (n > 0 ? sum / n : NAN) << "]";
+			}
+			os << "]}";
+		}
 #ifdef RTS2_HAVE_PGSQL
 		else if (vals[0] == "script")
 		{
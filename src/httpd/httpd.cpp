@@ -49,6 +49,9 @@ using namespace Magick;
 #define OPT_BB_QUEUE            OPT_LOCAL + 80
 #define OPT_SSL_CERT            OPT_LOCAL + 81
 #define OPT_SSL_KEY             OPT_LOCAL + 82
+#define OPT_PREVIEW_CACHE       OPT_LOCAL + 83
+#define OPT_PREVIEW_CACHE_DIR   OPT_LOCAL + 84
+#define OPT_TSLOG_DIR           OPT_LOCAL + 85
 
 using namespace XmlRpc;
 
@@ -453,7 +456,13 @@ rts2image::imageProceRes XmlDevCameraClient::processImage (rts2image::Image * im
 int HttpD::info ()
 {
 	bbQueueSize->setValueInteger (events.bbServers.queueSize ());
+	previewHits->setValueLong (previewCache.getHits ());
+	previewMisses->setValueLong (previewCache.getMisses ());
 #ifdef RTS2_HAVE_PGSQL
+	recordsBacklog->setValueInteger (recordWriter.getBacklog ());
+	recordsWritten->setValueLong (recordWriter.getWritten ());
+	recordsDropped->setValueLong (recordWriter.getDropped ());
+	recordsFailed->setValueLong (recordWriter.getFailed ());
 	return DeviceDb::info ();
 #else
 	return rts2core::Device::info ();
@@ -511,6 +520,15 @@ int HttpD::processOption (int in_opt)
 		case OPT_BB_QUEUE:
 			bbQueueName = optarg;
 			break;
+		case OPT_PREVIEW_CACHE:
+			previewCache.setMaxSize (atol (optarg) * 1024 * 1024);
+			break;
+		case OPT_PREVIEW_CACHE_DIR:
+			previewCache.setCacheDir (optarg);
+			break;
+		case OPT_TSLOG_DIR:
+			tslogDir = optarg;
+			break;
 #ifdef RTS2_HAVE_PGSQL
 		default:
 			return DeviceDb::processOption (in_opt);
@@ -562,6 +580,7 @@ int HttpD::init ()
 
 	XmlRpcServer::bindAndListen (rpcPort);
 	XmlRpcServer::enableIntrospection (true);
+	XmlRpcSource::setCloseFd (&getMasterPollFDClosed);
 
 	// try states..
 	if (stateChangeFile != NULL)
@@ -800,9 +819,20 @@ HttpD::HttpD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_
 	createValue (messageBufferSize, "message_buffer_size", "number of last messages to kept in memory", false, RTS2_VALUE_WRITABLE);
 	messageBufferSize->setValueInteger (100);
 
+	createValue (previewHits, "preview_hits", "number of JPEG previews served from cache", false);
+	createValue (previewMisses, "preview_misses", "number of JPEG previews rendered from FITS files", false);
+
+#ifdef RTS2_HAVE_PGSQL
+	createValue (recordsBacklog, "records_backlog", "number of value records waiting for database write", false);
+	createValue (recordsWritten, "records_written", "number of value records written to database", false);
+	createValue (recordsDropped, "records_dropped", "number of value records dropped as the queue was full", false);
+	createValue (recordsFailed, "records_failed", "number of value records lost on database errors", false);
+#endif
+
 	debugTestscript = false;
 
 	bbQueueName = NULL;
+	tslogDir = NULL;
 
 #ifndef RTS2_HAVE_PGSQL
 	config_file = NULL;
@@ -816,6 +846,9 @@ HttpD::HttpD (int argc, char **argv): rts2core::Device (argc, argv, DEVICE_TYPE_
 	addOption (OPT_DEBUG_TESTSCRIPT, "debug-test-script", 0, "print test script debugging");
 	addOption (OPT_TESTSCRIPT, "test-script", 1, "test script to run on background");
 	addOption (OPT_BB_QUEUE, "bb-queue", 1, "name of queue used for BB scheduling");
+	addOption (OPT_PREVIEW_CACHE, "preview-cache", 1, "size of memory cache for JPEG previews in MB. Default to 32");
+	addOption (OPT_PREVIEW_CACHE_DIR, "preview-cache-dir", 1, "directory for JPEG previews cache files");
+	addOption (OPT_TSLOG_DIR, "tslog-dir", 1, "directory of binary time-series store written by rts2-logd");
 #ifdef RTS2_SSL
 	addOption (OPT_SSL_CERT, "ssl-cert", 1, "OpenSSL ca certification file");
 	addOption (OPT_SSL_KEY, "ssl-key", 1, "OpenSSL private key file");
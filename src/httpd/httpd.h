@@ -30,6 +30,7 @@
 #include "rts2db/plan.h"
 #include "rts2json/addtargetreq.h"
 #include "bbapi.h"
+#include "recordwriter.h"
 #else
 #include "configuration.h"
 #include "device.h"
@@ -58,6 +59,7 @@
 #include "planreq.h"
 #include "switchstatereq.h"
 #include "api.h"
+#include "rts2json/previewcache.h"
 
 #include "connnotify.h"
 #include "rts2script/execcli.h"
@@ -453,6 +455,20 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 
 		virtual int getDefaultChannel () { return defchan; }
 
+		virtual rts2json::PreviewCache *getPreviewCache () { return &previewCache; }
+
+		/**
+		 * Return directory of binary time-series store written by rts2-logd, NULL if not set.
+		 */
+		const char *getTSLogDir () { return tslogDir; }
+
+#ifdef RTS2_HAVE_PGSQL
+		/**
+		 * Return queue of value and state records waiting for database write.
+		 */
+		RecordWriter *getRecordWriter () { return &recordWriter; }
+#endif
+
 		rts2core::ConnNotify * getNotifyConnection () { return notifyConn; }
 
 		void scriptProgress (double start, double end);
@@ -518,12 +534,26 @@ class HttpD:public rts2core::Device, XmlRpc::XmlRpcServer, rts2json::HTTPServer
 
 		rts2core::ValueInteger *numRequests;
 		rts2core::ValueBool *send_emails;
+
+		rts2json::PreviewCache previewCache;
+		rts2core::ValueLong *previewHits;
+		rts2core::ValueLong *previewMisses;
+
+#ifdef RTS2_HAVE_PGSQL
+		RecordWriter recordWriter;
+		rts2core::ValueInteger *recordsBacklog;
+		rts2core::ValueLong *recordsWritten;
+		rts2core::ValueLong *recordsDropped;
+		rts2core::ValueLong *recordsFailed;
+#endif
 		rts2core::ValueInteger *bbCadency;
 		rts2core::ValueInteger *bbQueueSize;
 		rts2core::ValueSelection *bbSelectorQueue;
 
 		const char *bbQueueName;
 
+		const char *tslogDir;
+
 		rts2core::ValueTime *bbLastSuccess;
 
 		rts2core::ValueInteger *messageBufferSize;
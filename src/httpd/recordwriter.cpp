@@ -0,0 +1,176 @@
+/*
+ * Asynchronous writer of recorded values and states.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "recordwriter.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+using namespace rts2xmlrpc;
+
+RecordWriter::RecordWriter ()
+{
+	maxQueue = RECORDS_QUEUE_SIZE;
+	writing = 0;
+
+	written = 0;
+	dropped = 0;
+	failed = 0;
+
+	stop = false;
+	thread = 0;
+	pthread_mutex_init (&mutex, NULL);
+	pthread_cond_init (&cond, NULL);
+}
+
+RecordWriter::~RecordWriter ()
+{
+	pthread_mutex_lock (&mutex);
+	stop = true;
+	pthread_cond_signal (&cond);
+	pthread_mutex_unlock (&mutex);
+
+	// writer thread writes remaining records before it ends
+	if (thread)
+		pthread_join (thread, NULL);
+
+	pthread_mutex_destroy (&mutex);
+	pthread_cond_destroy (&cond);
+}
+
+bool RecordWriter::push (record_t type, int recval_id, double rectime, double value)
+{
+	pthread_mutex_lock (&mutex);
+	if (records.size () + writing >= maxQueue)
+	{
+		dropped++;
+		pthread_mutex_unlock (&mutex);
+		return false;
+	}
+	if (thread == 0 && pthread_create (&thread, NULL, writerThread, this))
+		thread = 0;
+
+	if (records.empty ())
+		clock_gettime (CLOCK_REALTIME, &firstQueued);
+
+	Record rec;
+	rec.type = type;
+	rec.recval_id = recval_id;
+	rec.rectime = rectime;
+	rec.value = value;
+	records.push_back (rec);
+
+	// wake writer to start flush timer, or to write full batch
+	if (records.size () == 1 || records.size () == RECORDS_BATCH_SIZE)
+		pthread_cond_signal (&cond);
+	pthread_mutex_unlock (&mutex);
+	return true;
+}
+
+size_t RecordWriter::getBacklog ()
+{
+	pthread_mutex_lock (&mutex);
+	size_t ret = records.size () + writing;
+	pthread_mutex_unlock (&mutex);
+	return ret;
+}
+
+void RecordWriter::run ()
+{
+	connectDB ();
+
+	std::vector <Record> batch;
+
+	pthread_mutex_lock (&mutex);
+	while (true)
+	{
+		if (records.empty ())
+		{
+			if (stop)
+				break;
+			pthread_cond_wait (&cond, &mutex);
+			continue;
+		}
+		if (records.size () < RECORDS_BATCH_SIZE && !stop)
+		{
+			struct timespec deadline = firstQueued;
+			deadline.tv_sec += (time_t) RECORDS_FLUSH_INTERVAL;
+			deadline.tv_nsec += (long) ((RECORDS_FLUSH_INTERVAL - floor (RECORDS_FLUSH_INTERVAL)) * 1e9);
+			if (deadline.tv_nsec >= 1000000000)
+			{
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+			if (pthread_cond_timedwait (&cond, &mutex, &deadline) != ETIMEDOUT)
+				continue;
+		}
+
+		// large backlog is written in several transactions
+		size_t n = records.size ();
+		if (n > RECORDS_BATCH_SIZE * 10)
+			n = RECORDS_BATCH_SIZE * 10;
+		batch.assign (records.begin (), records.begin () + n);
+		records.erase (records.begin (), records.begin () + n);
+		writing = n;
+		// firstQueued is kept, so remaining records are written without waiting
+
+		pthread_mutex_unlock (&mutex);
+		int ret = writeBatch (batch);
+		pthread_mutex_lock (&mutex);
+
+		writing = 0;
+		if (ret)
+			failed += n;
+		else
+			written += n;
+	}
+	pthread_mutex_unlock (&mutex);
+}
+
+void RecordWriter::appendRow (std::string &sql, const Record &rec)
+{
+	char buf[100];
+	int len = snprintf (buf, sizeof (buf), "(%d,to_timestamp(%.6f),", rec.recval_id, rec.rectime);
+	switch (rec.type)
+	{
+		case RECORD_INTEGER:
+		case RECORD_STATE:
+			snprintf (buf + len, sizeof (buf) - len, "%d)", (int) rec.value);
+			break;
+		case RECORD_BOOLEAN:
+			snprintf (buf + len, sizeof (buf) - len, "%s)", rec.value ? "true" : "false");
+			break;
+		case RECORD_DOUBLE:
+			if (isnan (rec.value))
+				snprintf (buf + len, sizeof (buf) - len, "'NaN')");
+			else if (isinf (rec.value))
+				snprintf (buf + len, sizeof (buf) - len, "'%sInfinity')", rec.value < 0 ? "-" : "");
+			else
+				snprintf (buf + len, sizeof (buf) - len, "%.17g)", rec.value);
+			break;
+	}
+	sql += buf;
+}
+
+void *RecordWriter::writerThread (void *arg)
+{
+	((RecordWriter *) arg)->run ();
+	return NULL;
+}
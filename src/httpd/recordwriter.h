@@ -0,0 +1,132 @@
+/*
+ * Asynchronous writer of recorded values and states.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __RTS2_RECORDWRITER__
+#define __RTS2_RECORDWRITER__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <time.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+// maximal number of records waiting for the database
+#define RECORDS_QUEUE_SIZE       100000
+
+// number of records which triggers write
+#define RECORDS_BATCH_SIZE       500
+
+// maximal time (in seconds) record waits in the queue
+#define RECORDS_FLUSH_INTERVAL   1.0
+
+namespace rts2xmlrpc
+{
+
+typedef enum { RECORD_INTEGER, RECORD_DOUBLE, RECORD_BOOLEAN, RECORD_STATE } record_t;
+
+/**
+ * Single row of records_integer, records_double, records_boolean or records_state table.
+ */
+struct Record
+{
+	record_t type;
+	int recval_id;
+	double rectime;
+	double value;
+};
+
+/**
+ * Queue of records waiting to be written to the database. Records are
+ * pushed from the main thread by ValueChangeRecord and StateChangeRecord,
+ * and written by a writer thread with its own database connection. Records
+ * are written with multi-row INSERTs and committed together, when either
+ * batch size is reached or the oldest record waits longer than flush
+ * interval.
+ *
+ * Queue is bounded - when the database cannot keep pace, new records are
+ * dropped and counted.
+ */
+class RecordWriter
+{
+	public:
+		RecordWriter ();
+		~RecordWriter ();
+
+		/**
+		 * Queue record for writing. Starts writer thread on first call.
+		 *
+		 * @return false if queue is full and record was dropped
+		 */
+		bool push (record_t type, int recval_id, double rectime, double value);
+
+		/**
+		 * Number of records waiting in the queue, including batch being written.
+		 */
+		size_t getBacklog ();
+
+		long getWritten () { return written; }
+
+		long getDropped () { return dropped; }
+
+		long getFailed () { return failed; }
+
+		void setQueueSize (size_t _maxQueue) { maxQueue = _maxQueue; }
+
+	private:
+		std::deque <Record> records;
+		size_t maxQueue;
+		size_t writing;
+
+		// time when the oldest record in the queue was pushed
+		struct timespec firstQueued;
+
+		long written;
+		long dropped;
+		long failed;
+
+		bool stop;
+		pthread_t thread;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+
+		/**
+		 * Open database connection of the writer thread.
+		 */
+		int connectDB ();
+
+		/**
+		 * Wait for batch of records, write them, repeat until stopped.
+		 */
+		void run ();
+
+		/**
+		 * Write records to the database and commit.
+		 *
+		 * @return -1 on error, 0 on success
+		 */
+		int writeBatch (std::vector <Record> &batch);
+
+		static void appendRow (std::string &sql, const Record &rec);
+
+		static void *writerThread (void *arg);
+};
+
+}
+
+#endif // !__RTS2_RECORDWRITER__
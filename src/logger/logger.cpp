@@ -47,6 +47,7 @@ Logger::Logger (int in_argc, char **in_argv):rts2core::Client (in_argc, in_argv,
 	inputStream = NULL;
 
 	addOption ('c', NULL, 1, "specify config file with logged device, timeouts and values");
+	addOption ('b', NULL, 1, "directory of binary time-series store for numeric values");
 }
 
 int Logger::processOption (int in_opt)
@@ -59,6 +60,9 @@ int Logger::processOption (int in_opt)
 			ret = readDevices (*inputStream);
 			delete inputStream;
 			return ret;
+		case 'b':
+			setStoreDir (optarg);
+			return 0;
 		default:
 			return rts2core::Client::processOption (in_opt);
 	}
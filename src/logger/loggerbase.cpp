@@ -21,7 +21,7 @@
 
 using namespace rts2logd;
 
-DevClientLogger::DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames):rts2core::DevClient (in_conn)
+DevClientLogger::DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames, const char *in_storeDir):rts2core::DevClient (in_conn)
 {
 	exp = NULL;
 
@@ -35,6 +35,9 @@ DevClientLogger::DevClientLogger (rts2core::Connection * in_conn, double in_numb
 	logNames = in_logNames;
 
 	outputStream = &std::cout;
+
+	if (in_storeDir)
+		storeDir = std::string (in_storeDir);
 }
 
 DevClientLogger::~DevClientLogger (void)
@@ -42,6 +45,8 @@ DevClientLogger::~DevClientLogger (void)
 	if (outputStream != &std::cout)
 		delete outputStream;
 	delete exp;
+	for (std::list < rts2core::TimeseriesWriter * >::iterator iter = storeWriters.begin (); iter != storeWriters.end (); iter++)
+		delete *iter;
 }
 
 void DevClientLogger::fillLogValues ()
@@ -52,6 +57,7 @@ void DevClientLogger::fillLogValues ()
 		if (val)
 		{
 			logValues.push_back (val);
+			storeWriters.push_back (openStore (val));
 		}
 		else
 		{
@@ -61,6 +67,38 @@ void DevClientLogger::fillLogValues ()
 	}
 }
 
+rts2core::TimeseriesWriter * DevClientLogger::openStore (rts2core::Value *val)
+{
+	if (storeDir.empty ())
+		return NULL;
+	switch (val->getValueBaseType ())
+	{
+		case RTS2_VALUE_INTEGER:
+		case RTS2_VALUE_TIME:
+		case RTS2_VALUE_DOUBLE:
+		case RTS2_VALUE_FLOAT:
+		case RTS2_VALUE_BOOL:
+		case RTS2_VALUE_SELECTION:
+		case RTS2_VALUE_LONGINT:
+			break;
+		default:
+			return NULL;
+	}
+	if (val->getValueType () & RTS2_VALUE_ARRAY)
+		return NULL;
+
+	std::string path = storeDir + "/" + getName () + "/" + val->getName () + ".tsl";
+	std::string name = std::string (getName ()) + "." + val->getName ();
+	rts2core::TimeseriesWriter *writer = new rts2core::TimeseriesWriter ();
+	if (mkpath (path.c_str (), 0777) || writer->open (path.c_str (), name.c_str (), val->getValueType ()))
+	{
+		logStream (MESSAGE_ERROR) << "Cannot open time-series file " << path << ": " << strerror (errno) << sendLog;
+		delete writer;
+		return NULL;
+	}
+	return writer;
+}
+
 void DevClientLogger::setOutputFile (const char *pattern)
 {
 	if (exp == NULL)
@@ -107,6 +145,22 @@ void DevClientLogger::infoOK ()
 		*outputStream << " " << rts2core::getDisplayValue (*iter);
 	}
 	*outputStream << std::endl;
+
+	if (storeDir.empty ())
+		return;
+	struct timeval tv;
+	getConnection ()->getInfoTime (tv);
+	double t = tv.tv_sec + tv.tv_usec / (double) USEC_SEC;
+	std::list < rts2core::Value * >::iterator viter = logValues.begin ();
+	for (std::list < rts2core::TimeseriesWriter * >::iterator iter = storeWriters.begin (); iter != storeWriters.end (); iter++, viter++)
+	{
+		if (*iter && (*iter)->add (t, (*viter)->getValueDouble ()))
+		{
+			logStream (MESSAGE_ERROR) << "Cannot write value " << (*viter)->getName () << " to time-series store: " << strerror (errno) << sendLog;
+			delete *iter;
+			*iter = NULL;
+		}
+	}
 }
 
 void DevClientLogger::infoFailed ()
@@ -206,6 +260,6 @@ rts2core::DevClient * LoggerBase::createOtherType (rts2core::Connection * conn,
 {
 	LogValName *val = getLogVal (conn->getName ());
 	if (val)
-		return new DevClientLogger (conn, val->timeout, 60, val->valueList);
+		return new DevClientLogger (conn, val->timeout, 60, val->valueList, storeDir.empty () ? NULL : storeDir.c_str ());
 	return NULL;
 }
@@ -22,6 +22,7 @@
 #include "command.h"
 #include "expander.h"
 #include "utilsfunc.h"
+#include "tslog.h"
 
 #define EVENT_SET_LOGFILE RTS2_LOCAL_EVENT+800
 
@@ -45,8 +46,9 @@ class DevClientLogger:public rts2core::DevClient
 		 * @param in_numberSec             Number of seconds when the info command will be send.
 		 * @param in_fileCreationInterval  Interval between file creation.
 		 * @param in_logNames              String with space separated names of values which will be logged.
+		 * @param in_storeDir              Directory of binary time-series store, NULL if values shall not be stored.
 		 */
-		DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames);
+		DevClientLogger (rts2core::Connection * in_conn, double in_numberSec, time_t in_fileCreationInterval, std::list < std::string > &in_logNames, const char *in_storeDir = NULL);
 
 		virtual ~ DevClientLogger (void);
 		virtual void infoOK ();
@@ -68,6 +70,12 @@ class DevClientLogger:public rts2core::DevClient
 
 		std::ostream * outputStream;
 
+		/**
+		 * Writers of binary time-series files, NULL for values which cannot be stored.
+		 */
+		std::list < rts2core::TimeseriesWriter * >storeWriters;
+		std::string storeDir;
+
 		rts2core::Expander * exp;
 		std::string expandPattern;
 		std::string expandedFilename;
@@ -101,6 +109,12 @@ class DevClientLogger:public rts2core::DevClient
 		 * Change output stream according to new expansion.
 		 */
 		void changeOutputStream ();
+
+		/**
+		 * Open time-series file for value. Numeric values are stored in
+		 * storeDir/device/value.tsl files.
+		 */
+		rts2core::TimeseriesWriter *openStore (rts2core::Value *val);
 };
 
 /**
@@ -140,8 +154,14 @@ class LoggerBase
 
 		LogValName *getLogVal (const char *name);
 		int willConnect (rts2core::NetworkAddress * in_addr);
+
+		/**
+		 * Set directory of binary time-series store.
+		 */
+		void setStoreDir (const char *dir) { storeDir = std::string (dir); }
 	private:
 		std::list < LogValName > devicesNames;
+		std::string storeDir;
 };
 
 }
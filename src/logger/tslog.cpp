@@ -0,0 +1,177 @@
+/*
+ * Dump content of binary time-series store files.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "cliapp.h"
+#include "tslog.h"
+#include "utilsfunc.h"
+
+#include <iostream>
+#include <iomanip>
+#include <list>
+
+#define OP_SUMMARY          0x01
+
+namespace rts2logd
+{
+
+/**
+ * Prints samples stored by rts2-logger or rts2-logd in binary time-series
+ * files. Only blocks overlapping the requested time range are decompressed.
+ *
+ * @ingroup RTS2Logger
+ */
+class TSLogApp:public rts2core::CliApp
+{
+	public:
+		TSLogApp (int in_argc, char **in_argv);
+
+		virtual int doProcessing ();
+	protected:
+		virtual int processOption (int in_opt);
+		virtual int processArgs (const char *arg);
+
+		virtual void usage ();
+	private:
+		std::list < const char * >files;
+		double from;
+		double to;
+		int op;
+
+		void printSummary (rts2core::TimeseriesReader &reader);
+		void printSamples (rts2core::TimeseriesReader &reader);
+};
+
+}
+
+using namespace rts2logd;
+
+TSLogApp::TSLogApp (int in_argc, char **in_argv):rts2core::CliApp (in_argc, in_argv)
+{
+	from = -INFINITY;
+	to = INFINITY;
+	op = 0;
+
+	addOption ('f', NULL, 1, "print samples from this date or ctime (inclusive)");
+	addOption ('t', NULL, 1, "print samples to this date or ctime (inclusive)");
+	addOption ('s', NULL, 0, "print block summary (time range, number of samples, value range) instead of samples");
+}
+
+int TSLogApp::processOption (int in_opt)
+{
+	time_t t;
+	char *end;
+	double d;
+	switch (in_opt)
+	{
+		case 'f':
+		case 't':
+			// accept ctime as well as date
+			d = strtod (optarg, &end);
+			if (end == optarg || *end != '\0')
+			{
+				if (parseDate (optarg, &t))
+				{
+					std::cerr << "cannot parse date " << optarg << std::endl;
+					return -1;
+				}
+				d = t;
+			}
+			if (in_opt == 'f')
+				from = d;
+			else
+				to = d;
+			break;
+		case 's':
+			op |= OP_SUMMARY;
+			break;
+		default:
+			return rts2core::CliApp::processOption (in_opt);
+	}
+	return 0;
+}
+
+int TSLogApp::processArgs (const char *arg)
+{
+	files.push_back (arg);
+	return 0;
+}
+
+void TSLogApp::usage ()
+{
+	std::cout << "  " << getAppName () << " -f 2020-01-01 -t 2020-01-02 /var/lib/rts2/tslog/C0/CCD_TEMP.tsl" << std::endl
+		<< "  " << getAppName () << " -s /var/lib/rts2/tslog/T0/*.tsl" << std::endl;
+}
+
+void TSLogApp::printSummary (rts2core::TimeseriesReader &reader)
+{
+	const std::vector <rts2core::TimeseriesBlock> &blocks = reader.getBlocks ();
+	for (std::vector <rts2core::TimeseriesBlock>::const_iterator iter = blocks.begin (); iter != blocks.end (); iter++)
+	{
+		if (iter->tmax < from || iter->tmin > to)
+			continue;
+		std::cout << std::fixed << std::setprecision (6) << iter->tmin << " " << iter->tmax << " " << iter->count << " ";
+		std::cout.unsetf (std::ios_base::floatfield);
+		std::cout << std::setprecision (15) << iter->vmin << " " << iter->vmax << std::endl;
+	}
+}
+
+void TSLogApp::printSamples (rts2core::TimeseriesReader &reader)
+{
+	std::vector <double> t;
+	std::vector <double> v;
+	reader.scan (from, to, t, v);
+	for (size_t i = 0; i < t.size (); i++)
+	{
+		std::cout << std::fixed << std::setprecision (6) << t[i] << " ";
+		std::cout.unsetf (std::ios_base::floatfield);
+		std::cout << std::setprecision (15) << v[i] << std::endl;
+	}
+}
+
+int TSLogApp::doProcessing ()
+{
+	if (files.empty ())
+	{
+		help ();
+		return -1;
+	}
+	int ret = 0;
+	for (std::list < const char * >::iterator iter = files.begin (); iter != files.end (); iter++)
+	{
+		rts2core::TimeseriesReader reader;
+		if (reader.open (*iter))
+		{
+			std::cerr << "cannot open " << *iter << ": " << strerror (errno) << std::endl;
+			ret = -1;
+			continue;
+		}
+		if (files.size () > 1)
+			std::cout << "# " << reader.getName () << std::endl;
+		if (op & OP_SUMMARY)
+			printSummary (reader);
+		else
+			printSamples (reader);
+	}
+	return ret;
+}
+
+int main (int argc, char **argv)
+{
+	TSLogApp app (argc, argv);
+	return app.run ();
+}
@@ -73,6 +73,8 @@ int APMMultiBase::run ()
 	ret = initHardware ();
 	if (ret)
 		return ret;
+	// devices share single connection, so only one can talk to it
+	md.setThreaded (getThreads (), true);
 	return md.run (getDebug ());
 }
 
@@ -57,6 +57,8 @@ int SitechMultiBase::run ()
 	ret = initHardware ();
 	if (ret)
 		return ret;
+	// devices share single connection, so only one can talk to it
+	md.setThreaded (getThreads (), true);
 	return md.run ();
 }
 
@@ -27,11 +27,13 @@
 #include "rts2script/executorque.h"
 #include "rts2script/execcli.h"
 #include "rts2script/execclidb.h"
+#include "rts2fits/fitswriter.h"
 #include "rts2devcliphot.h"
 
 #define OPT_IGNORE_DAY    OPT_LOCAL + 100
 #define OPT_DONT_DARK     OPT_LOCAL + 101
 #define OPT_DISABLE_AUTO  OPT_LOCAL + 102
+#define OPT_FITS_WRITERS  OPT_LOCAL + 103
 
 namespace rts2plan
 {
@@ -155,6 +157,12 @@ class Executor:public rts2db::DeviceDb
 		rts2core::ValueInteger *img_id;
 
 		rts2core::ConnNotify *notifyConn;
+
+		// background writer of camera images
+		rts2image::FitsWriter *fitsWriter;
+		int fitsWriterThreads;
+		rts2core::ValueInteger *fitsQueue;
+		rts2core::ValueDouble *fitsThroughput;
 };
 
 }
@@ -233,9 +241,15 @@ Executor::Executor (int in_argc, char **in_argv):rts2db::DeviceDb (in_argc, in_a
 	createValue (grb_min_sep, "grb_min_sep", "[deg] when GRB is below grb_min_sep degrees from current position, telescope will not be slewed", false, RTS2_VALUE_WRITABLE | RTS2_DT_DEG_DIST);
 	grb_min_sep->setValueDouble (0);
 
+	fitsWriter = NULL;
+	fitsWriterThreads = 0;
+	fitsQueue = NULL;
+	fitsThroughput = NULL;
+
 	addOption (OPT_IGNORE_DAY, "ignore-day", 0, "observe even during daytime");
 	addOption (OPT_DONT_DARK, "no-dark", 0, "do not take on its own dark frames");
 	addOption (OPT_DISABLE_AUTO, "no-auto", 0, "disable autolooping");
+	addOption (OPT_FITS_WRITERS, "fits-writers", 1, "number of threads writing images to disk in background (default 0 - images are written by the main thread)");
 }
 
 Executor::~Executor (void)
@@ -259,6 +273,9 @@ int Executor::processOption (int in_opt)
 			autoLoop->setValueBool (false);
 			defaultAutoLoop->setValueBool (false);
 			break;
+		case OPT_FITS_WRITERS:
+			fitsWriterThreads = atoi (optarg);
+			break;
 		default:
 			return rts2db::DeviceDb::processOption (in_opt);
 	}
@@ -276,6 +293,23 @@ int Executor::init ()
 	
 	addConnection (notifyConn);
 
+	if (fitsWriterThreads > 0)
+	{
+		fitsWriter = new rts2image::FitsWriter (this, fitsWriterThreads);
+		if (fitsWriter->init ())
+		{
+			logStream (MESSAGE_WARNING) << "images will be written by the main thread" << sendLog;
+			delete fitsWriter;
+			fitsWriter = NULL;
+			return 0;
+		}
+		addConnection (fitsWriter);
+
+		createValue (fitsQueue, "fits_queue", "number of images waiting to be written to disk", false);
+		fitsQueue->setValueInteger (0);
+		createValue (fitsThroughput, "fits_throughput", "[MB/s] write speed of the last written image", false);
+	}
+
 	return ret;
 }
 
@@ -320,7 +354,11 @@ rts2core::DevClient * Executor::createOtherType (rts2core::Connection * conn, in
 		case DEVICE_TYPE_MOUNT:
 			return new rts2script::DevClientTelescopeExec (conn);
 		case DEVICE_TYPE_CCD:
-			return new rts2script::DevClientCameraExecDb (conn);
+			{
+				rts2script::DevClientCameraExecDb *cam = new rts2script::DevClientCameraExecDb (conn);
+				cam->setFitsWriter (fitsWriter);
+				return cam;
+			}
 		case DEVICE_TYPE_FOCUS:
 			return new rts2image::DevClientFocusImage (conn);
 		case DEVICE_TYPE_PHOT:
@@ -489,6 +527,13 @@ void Executor::postEvent (rts2core::Event * event)
 			*((int *) event->getArg ()) =
 				(currentTarget) ? currentTarget->getAcquired () : -2;
 			break;
+		case EVENT_FITS_WRITTEN:
+			rts2db::DeviceDb::postEvent (event);
+			fitsQueue->setValueInteger (fitsWriter->getQueueSize ());
+			fitsThroughput->setValueDouble (fitsWriter->getThroughput ());
+			sendValueAll (fitsQueue);
+			sendValueAll (fitsThroughput);
+			return;
 	}
 	rts2db::DeviceDb::postEvent (event);
 }
@@ -544,6 +589,9 @@ int Executor::info ()
 		next_plan_id->setValueInteger (getActiveQueue ()->front ().plan_id);
 	}
 
+	if (fitsWriter)
+		fitsQueue->setValueInteger (fitsWriter->getQueueSize ());
+
 	return rts2db::DeviceDb::info ();
 }
 
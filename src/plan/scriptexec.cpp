@@ -22,6 +22,7 @@
 #include "configuration.h"
 
 #include "rts2script/execcli.h"
+#include "rts2fits/fitswriter.h"
 
 #include <iomanip>
 #include <iostream>
@@ -46,6 +47,7 @@ using namespace rts2image;
 
 #define OPT_NO_WRITE              OPT_LOCAL + 710
 #define OPT_RESET                 OPT_LOCAL + 711
+#define OPT_FITS_WRITERS          OPT_LOCAL + 712
 
 bool usesNcurses = false;
 bool read100 = false;
@@ -219,6 +221,9 @@ int ScriptExec::processOption (int in_opt)
 		case OPT_NO_WRITE:
 			writeConnection = writeRTS2Values = false;
 			break;
+		case OPT_FITS_WRITERS:
+			fitsWriterThreads = atoi (optarg);
+			break;
 		default:
 			return rts2core::Client::processOption (in_opt);
 	}
@@ -252,6 +257,9 @@ ScriptExec::ScriptExec (int in_argc, char **in_argv):rts2core::Client (in_argc,
 
 	callScriptEnd = false;
 
+	fitsWriter = NULL;
+	fitsWriterThreads = 0;
+
 	addOption (OPT_CONFIG, "config", 1, "configuration file");
 
 	addOption ('c', NULL, 1, "name of next script camera");
@@ -265,6 +273,7 @@ ScriptExec::ScriptExec (int in_argc, char **in_argv):rts2core::Client (in_argc,
 	addOption ('o', NULL, 1, "filename expand string, existing file will be overwritten");
 	addOption ('t', NULL, 1, "template filename for FITS keys");
 	addOption (OPT_NO_WRITE, "no-metadata", 0, "don't write RTS2 metadata, use only template");
+	addOption (OPT_FITS_WRITERS, "fits-writers", 1, "number of threads writing images to disk in background (default 0 - images are written by the main thread)");
 
 	srandom (time (NULL));
 
@@ -333,6 +342,21 @@ int ScriptExec::init ()
 		scripts.push_back (new rts2script::ScriptForDevice (devName, std::string (defaultScript)));
 	}
 
+	if (fitsWriterThreads > 0)
+	{
+		fitsWriter = new rts2image::FitsWriter (this, fitsWriterThreads);
+		if (fitsWriter->init ())
+		{
+			logStream (MESSAGE_WARNING) << "images will be written by the main thread" << sendLog;
+			delete fitsWriter;
+			fitsWriter = NULL;
+		}
+		else
+		{
+			addConnection (fitsWriter);
+		}
+	}
+
 	// create current target
 	currentTarget = new rts2script::ScriptTarget (this);
 #if defined(RTS2_HAVE_ISATTY) && (defined(RTS2_HAVE_CURSES_H) || defined(RTS2_HAVE_NCURSES_CURSES_H))
@@ -373,12 +397,14 @@ rts2core::DevClient *ScriptExec::createOtherType (rts2core::Connection * conn, i
 					bool b = !(Configuration::instance ()->getBoolean (conn->getName (), "no-metadata", true));
 					cli = new ClientCameraScript (conn, expandPath, tf, b, b);
 					((ClientCameraScript *) cli)->setOverwrite (overwrite);
+					((ClientCameraScript *) cli)->setFitsWriter (fitsWriter);
 					break;
 				}
 			}
 
 			cli = new ClientCameraScript (conn, expandPath, templateFile, writeConnection, writeRTS2Values);
 			((ClientCameraScript *) cli)->setOverwrite (overwrite);
+			((ClientCameraScript *) cli)->setFitsWriter (fitsWriter);
 			break;
 		case DEVICE_TYPE_FOCUS:
 			cli = new rts2image::DevClientFocusImage (conn);
@@ -31,6 +31,11 @@ namespace rts2script
 	class ScriptTarget;
 }
 
+namespace rts2image
+{
+	class FitsWriter;
+}
+
 namespace rts2plan
 {
 
@@ -91,6 +96,10 @@ class ScriptExec:public rts2core::Client, public rts2script::ScriptInterface
 
 		bool writeConnection;
 		bool writeRTS2Values;
+
+		// background writer of camera images
+		rts2image::FitsWriter *fitsWriter;
+		int fitsWriterThreads;
 };
 
 }
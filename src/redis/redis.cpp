@@ -22,21 +22,39 @@
 
 using namespace std;
 
-RedisProxy::RedisProxy (int in_argc, char **in_argv):rts2db::DeviceDb (in_argc, in_argv, DEVICE_TYPE_REDIS, "REDIS")
+RedisProxy::RedisProxy (int in_argc, char **in_argv):rts2db::DeviceDb (in_argc, in_argv, DEVICE_TYPE_REDIS, "REDIS"), redis (this)
 {
-    redisConn = redisConnect("127.0.0.1", 6379);
-    if (redisConn != NULL && redisConn->err) {
-        logStream (MESSAGE_ERROR) << "Redis connection error: " << redisConn->errstr << sendLog;
-    }
+    nextFlush = 0;
+
+    createValue (flushInterval, "flush_interval", "[s] interval for coalescing value updates", false, RTS2_VALUE_WRITABLE);
+    flushInterval->setValueDouble (0.1);
+
+    createValue (valueUpdates, "value_updates", "number of value changes received", false);
+    createValue (valueCoalesced, "value_coalesced", "number of value changes replaced by newer change before flush", false);
+    createValue (redisCommands, "redis_commands", "number of commands sent to redis", false);
+    valueUpdates->setValueLong (0);
+    valueCoalesced->setValueLong (0);
+    redisCommands->setValueLong (0);
+
+    addOption (OPT_REDIS_HOST, "redis-host", 1, "redis server host, default to 127.0.0.1");
+    addOption (OPT_REDIS_PORT, "redis-port", 1, "redis server port, default to 6379");
 }
 
 RedisProxy::~RedisProxy (void)
 {
-
 }
 
 int RedisProxy::processOption (int in_opt)
 {
+    switch (in_opt)
+    {
+        case OPT_REDIS_HOST:
+            redis.setServer (optarg, redis.getPort ());
+            return 0;
+        case OPT_REDIS_PORT:
+            redis.setServer (redis.getHost ().c_str (), atoi (optarg));
+            return 0;
+    }
     return rts2db::DeviceDb::processOption (in_opt);
 }
 
@@ -55,6 +73,11 @@ int RedisProxy::init ()
 
 	addConnection (notifyConn);
 
+	redis.connect ();
+
+	// wake up for flushes of coalesced values
+	setTimeoutMin (flushInterval->getValueDouble () * USEC_SEC);
+
 	return ret;
 }
 
@@ -72,27 +95,30 @@ int RedisProxy::reloadConfig ()
 
 int RedisProxy::setValue (rts2core::Value *oldValue, rts2core::Value *newValue)
 {
+    if (oldValue == flushInterval)
+    {
+        // zero interval would flush on every loop and spin on zero poll timeout
+        if (!(newValue->getValueDouble () > 0))
+            return -2;
+        setTimeoutMin (newValue->getValueDouble () * USEC_SEC);
+        return 0;
+    }
 	return rts2db::DeviceDb::setValue (oldValue, newValue);
 }
 
 int RedisProxy::deleteConnection (rts2core::Connection * in_conn)
 {
-    redisReply *r, *r2;
-    string connName;
-    if (in_conn == getSingleCentralConn())
-        connName = "centrald";
-    else
-        connName = string(in_conn->getName());
-    r = (redisReply*)redisCommand(redisConn, "SREM rts2:devices %s", connName.c_str());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "KEYS rts2:%s*", connName.c_str());
-    for (size_t i=0; i < r->elements; i++) {
-        r2 = (redisReply*)redisCommand(redisConn, "DEL %s", r->element[i]->str);
-        freeReplyObject(r2);
-    }
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s disconnect", connName.c_str());
-    freeReplyObject(r);
+    string connName = getConnName (in_conn);
+    pending.erase (connName);
+
+    // all device values and state are in a single hash
+    string key = "rts2:" + connName;
+    const char *srem[] = {"SREM", "rts2:devices", connName.c_str ()};
+    sendRedis (3, srem);
+    const char *del[] = {"DEL", key.c_str ()};
+    sendRedis (2, del);
+    const char *pub[] = {"PUBLISH", connName.c_str (), "disconnect"};
+    sendRedis (3, pub);
 	return 0;
 }
 
@@ -106,6 +132,30 @@ int RedisProxy::info ()
 	return rts2db::DeviceDb::info ();
 }
 
+int RedisProxy::idle ()
+{
+    double now = getNow ();
+    redis.idle ();
+    if (now >= nextFlush)
+    {
+        flushPending ();
+        nextFlush = now + flushInterval->getValueDouble ();
+    }
+    return rts2db::DeviceDb::idle ();
+}
+
+void RedisProxy::addPollSocks ()
+{
+    rts2db::DeviceDb::addPollSocks ();
+    redis.addPollSocks ();
+}
+
+void RedisProxy::pollSuccess ()
+{
+    rts2db::DeviceDb::pollSuccess ();
+    redis.pollSuccess ();
+}
+
 void RedisProxy::changeMasterState (rts2_status_t old_state, rts2_status_t new_state)
 {
 	return rts2db::DeviceDb::changeMasterState (old_state, new_state);
@@ -122,41 +172,36 @@ int RedisProxy::commandAuthorized (rts2core::Connection * conn)
 
 rts2core::DevClient *RedisProxy::createOtherType (rts2core::Connection *conn, int other_device_type)
 {
-    redisReply *r;
     string connName(conn->getName());
     if (connName == "") connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SADD rts2:devices %s", connName.c_str());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s connect", connName.c_str());
-    freeReplyObject(r);
+    const char *sadd[] = {"SADD", "rts2:devices", connName.c_str ()};
+    sendRedis (3, sadd);
+    const char *pub[] = {"PUBLISH", connName.c_str (), "connect"};
+    sendRedis (3, pub);
     return new RedisProxyClient (conn);
 }
 
 void RedisProxy::stateChangedEvent(rts2core::Connection *conn, rts2core::ServerState *new_state)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (conn == getSingleCentralConn())
-        connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SET rts2:%s:State %d", connName.c_str(), new_state->getValue());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s state", connName.c_str());
-    freeReplyObject(r);
+    // state changes are rare and important, they are not coalesced
+    string connName = getConnName (conn);
+    string key = "rts2:" + connName;
+    char state[20];
+    snprintf (state, sizeof (state), "%d", new_state->getValue ());
+    const char *hset[] = {"HSET", key.c_str (), "State", state};
+    sendRedis (4, hset);
+    const char *pub[] = {"PUBLISH", connName.c_str (), "state"};
+    sendRedis (3, pub);
 }
 
 void RedisProxy::valueChangedEvent(rts2core::Connection *conn, rts2core::Value *new_value)
 {
-    redisReply *r;
-    string connName(conn->getName());
-    if (conn == getSingleCentralConn())
-        connName = "centrald";
-    r = (redisReply*)redisCommand(redisConn, "SADD rts2:%s:values %s", connName.c_str(), string(new_value->getName()).c_str());
-    freeReplyObject(r);
-    string key = "rts2:" + connName + ":" + new_value->getName();
-    r = (redisReply*)redisCommand(redisConn, "SET %s %s", key.c_str(), new_value->getValue());
-    freeReplyObject(r);
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH %s value %s", connName.c_str(), new_value->getName().c_str());
-    freeReplyObject(r);
+    valueUpdates->inc ();
+    RedisPending &dev = pending[getConnName (conn)];
+    std::pair <RedisPending::iterator, bool> ins = dev.insert (std::pair <std::string, std::string> (new_value->getName (), ""));
+    if (!ins.second)
+        valueCoalesced->inc ();
+    ins.first->second = new_value->getValue ();
 }
 
 void RedisProxy::message(rts2core::Message &msg)
@@ -168,9 +213,55 @@ void RedisProxy::message(rts2core::Message &msg)
     snprintf(buf, 1000, "%02i:%02i:%02i.%03i %s %s %s", tmesg.tm_hour, tmesg.tm_min, tmesg.tm_sec,
              (int)(msg.getMessageTimeUSec() / 1000), msg.getMessageOName(), msg.getTypeString(), msg.getMessageString().c_str());
 
-    redisReply *r;
-    r = (redisReply*)redisCommand(redisConn, "PUBLISH message %s", buf);
-    freeReplyObject(r);
+    const char *pub[] = {"PUBLISH", "message", buf};
+    sendRedis (3, pub);
+}
+
+void RedisProxy::sendRedis (int argc, const char **argv)
+{
+    if (redis.command (argc, argv) == 0)
+        redisCommands->inc ();
+}
+
+void RedisProxy::flushPending ()
+{
+    if (!redis.isOpen ())
+    {
+        // values will be sent when device changes them after reconnect
+        pending.clear ();
+        return;
+    }
+    std::vector <const char *> argv;
+    for (std::map <std::string, RedisPending>::iterator iter = pending.begin (); iter != pending.end (); iter++)
+    {
+        if (iter->second.empty ())
+            continue;
+        string key = "rts2:" + iter->first;
+        argv.clear ();
+        argv.push_back ("HMSET");
+        argv.push_back (key.c_str ());
+        for (RedisPending::iterator fi = iter->second.begin (); fi != iter->second.end (); fi++)
+        {
+            argv.push_back (fi->first.c_str ());
+            argv.push_back (fi->second.c_str ());
+        }
+        sendRedis (argv.size (), &(argv[0]));
+
+        for (RedisPending::iterator fi = iter->second.begin (); fi != iter->second.end (); fi++)
+        {
+            string msg = "value " + fi->first;
+            const char *pub[] = {"PUBLISH", iter->first.c_str (), msg.c_str ()};
+            sendRedis (3, pub);
+        }
+    }
+    pending.clear ();
+}
+
+string RedisProxy::getConnName (rts2core::Connection *conn)
+{
+    if (conn == getSingleCentralConn())
+        return string ("centrald");
+    return string (conn->getName ());
 }
 
 int main (int argc, char **argv)
@@ -26,7 +26,19 @@
 #include <rts2db/plan.h>
 #include <rts2db/target.h>
 #include <devclient.h>
-#include <hiredis.h>
+
+#include "redisconn.h"
+
+#include <map>
+#include <string>
+
+#define OPT_REDIS_HOST      OPT_LOCAL + 1
+#define OPT_REDIS_PORT      OPT_LOCAL + 2
+
+/**
+ * Values of a single device waiting to be written to redis, indexed by value name.
+ */
+typedef std::map <std::string, std::string> RedisPending;
 
 class RedisProxy : public rts2db::DeviceDb
 {
@@ -68,9 +80,41 @@ protected:
 
     virtual int deleteConnection (rts2core::Connection * in_conn);
 
+    virtual int idle ();
+
+    virtual void addPollSocks ();
+
+    virtual void pollSuccess ();
+
 private:
     rts2core::ConnNotify *notifyConn;
-    redisContext *redisConn;
+
+    // asynchronous connection to redis
+    RedisConn redis;
+
+    /**
+     * Device values changed since the last flush, indexed by device
+     * name. Repeated changes of the same value are coalesced.
+     */
+    std::map <std::string, RedisPending> pending;
+    double nextFlush;
+
+    rts2core::ValueDouble *flushInterval;
+    rts2core::ValueLong *valueUpdates;
+    rts2core::ValueLong *valueCoalesced;
+    rts2core::ValueLong *redisCommands;
+
+    /**
+     * Queue command to redis, reply is not waited for.
+     */
+    void sendRedis (int argc, const char **argv);
+
+    /**
+     * Write pending values as one HMSET per device, followed by PUBLISH of changed values.
+     */
+    void flushPending ();
+
+    std::string getConnName (rts2core::Connection *conn);
 };
 
 class RedisProxyClient : public rts2core::DevClient
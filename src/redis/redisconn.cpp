@@ -0,0 +1,171 @@
+/*
+ * Asynchronous connection to redis server.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "redisconn.h"
+
+// hiredis event adapter - hiredis tells which events it waits for, Block poll loop watches socket
+
+static void redisAddRead (void *privdata)
+{
+    ((RedisConn *) privdata)->setRead (true);
+}
+
+static void redisDelRead (void *privdata)
+{
+    ((RedisConn *) privdata)->setRead (false);
+}
+
+static void redisAddWrite (void *privdata)
+{
+    ((RedisConn *) privdata)->setWrite (true);
+}
+
+static void redisDelWrite (void *privdata)
+{
+    ((RedisConn *) privdata)->setWrite (false);
+}
+
+static void redisCleanup (void *privdata)
+{
+    ((RedisConn *) privdata)->setRead (false);
+    ((RedisConn *) privdata)->setWrite (false);
+}
+
+static void redisConnected (const redisAsyncContext *ac, int status)
+{
+    ((RedisConn *) ac->data)->connectFinished (ac, status);
+}
+
+static void redisDisconnectedCallback (const redisAsyncContext *ac, int status)
+{
+    ((RedisConn *) ac->data)->disconnected (ac, status);
+}
+
+RedisConn::RedisConn (rts2core::Block *_master)
+{
+    master = _master;
+    ac = NULL;
+    readEv = false;
+    writeEv = false;
+    connected = false;
+
+    host = "127.0.0.1";
+    port = 6379;
+    reconnectInterval = 5;
+    nextReconnect = 0;
+}
+
+RedisConn::~RedisConn ()
+{
+    if (ac)
+    {
+        redisAsyncContext *a = ac;
+        ac = NULL;
+        connected = false;
+        master->pollFDClosed (a->c.fd);
+        redisAsyncFree (a);
+    }
+}
+
+void RedisConn::connect ()
+{
+    nextReconnect = getNow () + reconnectInterval;
+    redisAsyncContext *a = redisAsyncConnect (host.c_str (), port);
+    if (a == NULL)
+    {
+        logStream (MESSAGE_ERROR) << "Cannot allocate redis context" << sendLog;
+        return;
+    }
+    if (a->err)
+    {
+        logStream (MESSAGE_ERROR) << "Redis connection error: " << a->errstr << sendLog;
+        redisAsyncFree (a);
+        return;
+    }
+    a->data = this;
+    a->ev.data = this;
+    a->ev.addRead = redisAddRead;
+    a->ev.delRead = redisDelRead;
+    a->ev.addWrite = redisAddWrite;
+    a->ev.delWrite = redisDelWrite;
+    a->ev.cleanup = redisCleanup;
+    ac = a;
+    connected = false;
+    redisAsyncSetConnectCallback (a, redisConnected);
+    redisAsyncSetDisconnectCallback (a, redisDisconnectedCallback);
+    // wait for connection to finish
+    writeEv = true;
+}
+
+int RedisConn::command (int argc, const char **argv, redisCallbackFn *fn, void *privdata)
+{
+    if (ac == NULL)
+        return -1;
+    return redisAsyncCommandArgv (ac, fn, privdata, argc, argv, NULL) == REDIS_OK ? 0 : -1;
+}
+
+void RedisConn::idle ()
+{
+    if (ac == NULL && getNow () >= nextReconnect)
+        connect ();
+}
+
+void RedisConn::addPollSocks ()
+{
+    if (ac && (readEv || writeEv))
+        master->addPollFD (ac->c.fd, (readEv ? POLLIN : 0) | (writeEv ? POLLOUT : 0));
+}
+
+void RedisConn::pollSuccess ()
+{
+    if (ac == NULL)
+        return;
+    int fd = ac->c.fd;
+    if (master->isForRead (fd) || master->isHup (fd))
+        redisAsyncHandleRead (ac);
+    // read handler can free the context on error
+    if (ac && master->isForWrite (fd))
+        redisAsyncHandleWrite (ac);
+}
+
+void RedisConn::connectFinished (const redisAsyncContext *_ac, int status)
+{
+    if (status == REDIS_OK)
+    {
+        connected = true;
+        return;
+    }
+    // hiredis frees the context after failed connection, disconnect callback is not called
+    disconnected (_ac, status);
+}
+
+void RedisConn::disconnected (const redisAsyncContext *_ac, int status)
+{
+    if (status != REDIS_OK)
+        logStream (MESSAGE_ERROR) << "Redis connection error: " << _ac->errstr << sendLog;
+    // hiredis frees the context after this callback
+    if (_ac == ac)
+    {
+        master->pollFDClosed (_ac->c.fd);
+        ac = NULL;
+    }
+    connected = false;
+    readEv = false;
+    writeEv = false;
+    nextReconnect = getNow () + reconnectInterval;
+}
@@ -0,0 +1,116 @@
+/*
+ * Asynchronous connection to redis server.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _REDISCONN_H_
+#define _REDISCONN_H_
+
+#include <block.h>
+#include <hiredis.h>
+#include <async.h>
+
+#include <string>
+
+/**
+ * Asynchronous (hiredis) connection to redis server, driven by Block poll
+ * loop. Commands are queued in hiredis output buffer and written when the
+ * socket is ready, so several commands are sent in a single write
+ * (pipelined). Lost connection is reestablished from idle call.
+ *
+ * Block owning the connection must call addPollSocks, pollSuccess and
+ * idle from its own methods of the same name.
+ */
+class RedisConn
+{
+public:
+    RedisConn (rts2core::Block *_master);
+
+    ~RedisConn ();
+
+    void setServer (const char *_host, int _port) { host = _host; port = _port; }
+
+    const std::string &getHost () { return host; }
+
+    int getPort () { return port; }
+
+    /**
+     * Set interval between reconnection attempts.
+     *
+     * @param _interval  interval in seconds
+     */
+    void setReconnectInterval (double _interval) { reconnectInterval = _interval; }
+
+    /**
+     * Start connecting to the server. Commands can be queued before
+     * connection is established.
+     */
+    void connect ();
+
+    /**
+     * Returns true if connection to the server is established.
+     */
+    bool isConnected () { return ac != NULL && connected; }
+
+    /**
+     * Returns true if connection is established or being established,
+     * so commands can be queued.
+     */
+    bool isOpen () { return ac != NULL; }
+
+    /**
+     * Queue command to redis.
+     *
+     * @param fn        reply callback, NULL if reply is not waited for
+     * @param privdata  data passed to the callback
+     *
+     * @return 0 if command was queued, -1 if connection is not available
+     */
+    int command (int argc, const char **argv, redisCallbackFn *fn = NULL, void *privdata = NULL);
+
+    /**
+     * Reconnect if connection was lost and reconnection interval expired.
+     */
+    void idle ();
+
+    void addPollSocks ();
+
+    void pollSuccess ();
+
+    // called from hiredis adapter
+    void setRead (bool _read) { readEv = _read; }
+
+    void setWrite (bool _write) { writeEv = _write; }
+
+    void connectFinished (const redisAsyncContext *_ac, int status);
+
+    void disconnected (const redisAsyncContext *_ac, int status);
+
+private:
+    rts2core::Block *master;
+
+    redisAsyncContext *ac;
+    bool readEv;
+    bool writeEv;
+    bool connected;
+
+    std::string host;
+    int port;
+    double reconnectInterval;
+    double nextReconnect;
+};
+
+#endif // _REDISCONN_H_
@@ -91,6 +91,11 @@ int SitechMulti::processOption (int opt)
 				return -1;
 			break;
 
+		// run loop below calls info of all rotators, devices cannot run in threads
+		case OPT_THREADS:
+			logStream (MESSAGE_ERROR) << "--threads is not supported by Sitech rotators" << sendLog;
+			return -1;
+
 		default:
 			return MultiBase::processOption (opt);
 	}
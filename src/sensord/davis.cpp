@@ -21,6 +21,8 @@
 #include "connection/serial.h"
 
 #define EVENT_LOOP          RTS2_LOCAL_EVENT + 1601
+// ACK followed by LOOP packet
+#define LOOP_SIZE           100
 #define OPT_WIND_BAD        OPT_LOCAL + 370
 #define OPT_PEEKWIND_BAD    OPT_LOCAL + 371
 #define OPT_HUM_BAD         OPT_LOCAL + 372
@@ -28,6 +30,22 @@
 namespace rts2sensord
 {
 
+class Davis;
+
+/**
+ * LOOP request, answered by LOOP packet.
+ */
+class DavisLoop:public rts2core::SerialTransaction
+{
+	public:
+		DavisLoop (Davis *_davis):rts2core::SerialTransaction ("LPS 2 1\n", 8, LOOP_SIZE, NULL, 5) { davis = _davis; }
+
+		virtual void finished (rts2core::transStatusT status, const char *rbuf, int rlen);
+
+	private:
+		Davis *davis;
+};
+
 /**
  * Class for Davis Vantage serial connected weather station.
  *
@@ -39,13 +57,15 @@ class Davis:public SensorWeather
 		Davis (int argc, char **argv);
 		virtual ~Davis ();
 
-		virtual void addPollSocks ();
-		virtual void pollSuccess ();
-
 		virtual int info ();
 
 		virtual void postEvent (rts2core::Event *event);
 
+		/**
+		 * Called when LOOP request finished.
+		 */
+		void loopReceived (rts2core::transStatusT status, const char *rbuf, int rlen);
+
 	protected:
 		virtual int processOption (int opt);
 		virtual int initHardware ();
@@ -54,8 +74,7 @@ class Davis:public SensorWeather
 		char *device_file;
 		rts2core::ConnSerial *davisConn;
 
-		char dataBuff[101];
-		int lastReceivedChar;
+		char dataBuff[LOOP_SIZE + 1];
 
 		// values with Davis data
 		rts2core::ValueSelection *barTrend;
@@ -105,8 +124,6 @@ Davis::Davis (int argc, char **argv):SensorWeather (argc, argv)
 	device_file = NULL;
 	davisConn = NULL;
 
-	lastReceivedChar = 0;
-
 	maxHumidity = NULL;
 	maxWindSpeed = NULL;
 	maxPeekWindSpeed = NULL;
@@ -142,53 +159,38 @@ Davis::Davis (int argc, char **argv):SensorWeather (argc, argv)
 
 }
 
-Davis::~Davis ()
+void DavisLoop::finished (rts2core::transStatusT status, const char *rbuf, int rlen)
 {
-	delete davisConn;
+	davis->loopReceived (status, rbuf, rlen);
 }
 
-void Davis::addPollSocks ()
+Davis::~Davis ()
 {
-	SensorWeather::addPollSocks ();
-	davisConn->add (this);
+	// davisConn is deleted by block
 }
 
-void Davis::pollSuccess ()
+void Davis::loopReceived (rts2core::transStatusT status, const char *rbuf, int rlen)
 {
-	if (davisConn->receivedData (this))
+	if (status == rts2core::TRANS_OK)
 	{
-		int ret = davisConn->readPort (dataBuff + lastReceivedChar, 100 - lastReceivedChar);
-		if (ret > 0)
+		memcpy (dataBuff, rbuf, LOOP_SIZE);
+		// check that the first received character is ACK
+		if (dataBuff[0] != 0x06)
+		{
+			logStream (MESSAGE_ERROR) << "data buffer does not start with ACK" << sendLog;
+			davisConn->flushPortIO ();
+		}
+		else if (checkCrc ())
+		{
+			processData ();
+			updateInfoTime ();
+		}
+		else
 		{
-			// check that the first received character is ACK
-			if (lastReceivedChar == 0 && dataBuff[0] != 0x06)
-			{
-				logStream (MESSAGE_ERROR) << "data buffer does not start with ACK" << sendLog;
-				sleep (4);
-				davisConn->flushPortIO ();
-				davisConn->writePort ("LPS 2 1\n", 8);
-				return;
-			}
-			lastReceivedChar += ret;
-			if (lastReceivedChar >= 100)
-			{
-				if (checkCrc ())
-				{
-					processData ();
-                                        updateInfoTime ();
-				}
-				else
-				{
-					logStream (MESSAGE_ERROR) << "invalid CRC received!" << sendLog;
-				}
-				// make sure we start with empty received buffer
-				lastReceivedChar = 0;
-				addTimer (2, new rts2core::Event (EVENT_LOOP));
-			}
+			logStream (MESSAGE_ERROR) << "invalid CRC received!" << sendLog;
 		}
 	}
-
-	SensorWeather::pollSuccess ();
+	addTimer (2, new rts2core::Event (EVENT_LOOP));
 }
 
 int Davis::info ()
@@ -202,8 +204,8 @@ void Davis::postEvent (rts2core::Event *event)
 	switch (event->getType ())
 	{
 		case EVENT_LOOP:
-			if (lastReceivedChar == 0)
-				davisConn->writePort ("LPS 2 1\n", 8);
+			if (davisConn->transactionsQueued () == 0)
+				davisConn->queueTransaction (new DavisLoop (this));
 			break;
 	}
 	SensorWeather::postEvent (event);
@@ -249,7 +251,11 @@ int Davis::initHardware ()
 	davisConn = new rts2core::ConnSerial (device_file, this, rts2core::BS19200, rts2core::C8, rts2core::NONE, 30);
 	int ret = davisConn->init ();
 	if (ret)
+	{
+		delete davisConn;
+		davisConn = NULL;
 		return ret;
+	}
 	davisConn->setDebug (getDebug ());
 	davisConn->writePort ('\r');
 	ret = davisConn->readPort (dataBuff, 2);
@@ -261,7 +267,9 @@ int Davis::initHardware ()
 	{
 		logStream (MESSAGE_ERROR) << "invalid reply" << dataBuff[0] << dataBuff[1] << sendLog;
 	}
-	davisConn->writePort ("LPS 2 1\n", 8);
+	// LOOP packets are received from main loop
+	addConnection (davisConn);
+	davisConn->queueTransaction (new DavisLoop (this));
 	return 0;
 }
 
@@ -309,7 +317,7 @@ static unsigned short crc_table [256] = {
 	0x6e17,  0x7e36,  0x4e55,  0x5e74,  0x2e93,  0x3eb2,  0x0ed1,  0x1ef0,  
 };
 
-	for (int i = 1; i < lastReceivedChar; i++)
+	for (int i = 1; i < LOOP_SIZE; i++)
 	{
 		crc = crc_table [(crc >> 8) ^ (unsigned char) (dataBuff[i])] ^ (crc << 8);
 	}
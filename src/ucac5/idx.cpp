@@ -19,8 +19,11 @@
 
 #include "app.h"
 #include "ucac5/UCAC5Record.hpp"
+#include "ucac5/UCAC5PixelIdx.hpp"
 
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -45,11 +48,15 @@ class Ucac5Idx:public rts2core::App
 	private:
 		std::vector <const char *> files;
 		bool dump;
+		const char *base;
+		int pixelOrder;
 };
 
-Ucac5Idx::Ucac5Idx (int argc, char **argv):App (argc, argv), dump(false)
+Ucac5Idx::Ucac5Idx (int argc, char **argv):App (argc, argv), dump(false), base(NULL), pixelOrder(-1)
 {
 	addOption('d', NULL, 0, "prints processed stars");
+	addOption('b', NULL, 1, "UCAC5 base path, for HEALPix pixel index");
+	addOption('p', NULL, 1, "build HEALPix pixel index of given order (8 is recommended) from zone files in base path");
 }
 
 int Ucac5Idx::run()
@@ -58,6 +65,23 @@ int Ucac5Idx::run()
 	if (ret)
 		return ret;
 
+	if (pixelOrder >= 0)
+	{
+		if (base == NULL)
+		{
+			std::cerr << "base path (-b) must be specified for pixel index" << std::endl;
+			return -1;
+		}
+		std::cout << "Building pixel index of order " << pixelOrder << " in " << base << std::endl;
+		ret = UCAC5PixelIdx::build(base, pixelOrder);
+		if (ret)
+		{
+			std::cerr << "Cannot build pixel index: " << strerror(errno) << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
 	for (std::vector <const char *>::iterator iter = files.begin(); iter != files.end(); iter++)
 	{
 		int fd = open(*iter, O_RDONLY);
@@ -131,6 +155,12 @@ int Ucac5Idx::processOption (int opt)
 		case 'd':
 			dump = true;
 			break;
+		case 'b':
+			base = optarg;
+			break;
+		case 'p':
+			pixelOrder = atoi(optarg);
+			break;
 		default:
 			return App::processOption(opt);
 	}